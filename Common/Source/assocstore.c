@@ -0,0 +1,641 @@
+/****************************************************************************
+ *
+ * MODULE:      assocstore.c
+ *
+ * DESCRIPTION:
+ * Coordinator's association table and channel held in flash, see
+ * assocstore.h.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "config.h"
+#include "persist.h"
+#include "assocstore.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Journal records: type (1) | fields, zero padded */
+#define ASSOC_RECORD_LEN            11
+#define ASSOC_RECORD_ENTRY          0x01    /* ext H (4) | ext L (4) | short (2) */
+#define ASSOC_RECORD_CHANNEL        0x02    /* channel (1) */
+#define ASSOC_RECORD_COMMIT         0x03    /* generation (4) */
+#define ASSOC_RECORD_REMOVE         0x04    /* ext H (4) | ext L (4) */
+
+/* A compacted sector holds at most the channel, every entry and the commit */
+#define ASSOC_COMMIT_SEARCH_SLOTS   (ASSOC_STORE_MAX_ENTRIES + 2)
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE bool_t bFindCommit(tsPersistLog *psLog, uint32 *pu32Generation);
+PRIVATE void vReplay(tsPersistLog *psLog);
+PRIVATE void vApply(uint8 *pu8Record);
+PRIVATE void vDelete(tsAssocEntry *psEntry);
+PRIVATE bool_t bAppend(uint8 *pu8Record);
+PRIVATE bool_t bCompact(void);
+PRIVATE void vEntryRecord(tsAssocEntry *psEntry, uint8 *pu8Record);
+PRIVATE void vChannelRecord(uint8 u8Channel, uint8 *pu8Record);
+PRIVATE void vCommitRecord(uint32 u32Generation, uint8 *pu8Record);
+PRIVATE void vClearRecord(uint8 u8Type, uint8 *pu8Record);
+PRIVATE uint32 u32GetU32(uint8 *pu8In);
+PRIVATE void vPutU32(uint8 *pu8Out, uint32 u32Value);
+
+/****************************************************************************/
+/***        Local Variables                                               ***/
+/****************************************************************************/
+PRIVATE const uint8 au8Sector[2] = { ASSOC_STORE_SECTOR_A, ASSOC_STORE_SECTOR_B };
+
+PRIVATE bool_t bOpen = FALSE;
+PRIVATE tsPersistLog sLog;          /* Journal in use */
+PRIVATE uint8 u8Current;            /* Index into au8Sector of sLog */
+PRIVATE uint32 u32Generation;
+
+PRIVATE uint8 u8StoredChannel;
+PRIVATE uint16 u16Count;
+PRIVATE tsAssocEntry asEntry[ASSOC_STORE_MAX_ENTRIES];
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: bAssocStoreOpen
+ *
+ * DESCRIPTION:
+ * Loads the table from the latest committed journal, discarding anything
+ * left in the other sector by an interrupted compaction. Blank flash gives
+ * an empty table.
+ *
+ * RETURNS: bool_t FALSE if the flash could not be used
+ *
+ ****************************************************************************/
+PUBLIC bool_t bAssocStoreOpen(void)
+{
+    tsPersistLog asLog[2];
+    uint32 au32Generation[2];
+    bool_t abCommitted[2];
+    uint8 au8Record[ASSOC_RECORD_LEN];
+    uint8 s;
+
+    bOpen           = FALSE;
+    u8StoredChannel = 0;
+    u16Count        = 0;
+
+    for (s = 0; s < 2; s++)
+    {
+        if (!bPersistOpen(&asLog[s], au8Sector[s], ASSOC_RECORD_LEN))
+        {
+            return FALSE;
+        }
+        abCommitted[s] = bFindCommit(&asLog[s], &au32Generation[s]);
+    }
+
+    if (abCommitted[0] && abCommitted[1])
+    {
+        u8Current = ((int32)(au32Generation[1] - au32Generation[0]) > 0) ? 1 : 0;
+    }
+    else if (abCommitted[0] || abCommitted[1])
+    {
+        u8Current = abCommitted[1] ? 1 : 0;
+    }
+    else
+    {
+        /* Nothing committed, start a new journal */
+        u8Current = 0;
+        au32Generation[0] = 0;
+        vCommitRecord(0, au8Record);
+        if (((asLog[0].u16Next > 0) && !bPersistErase(&asLog[0])) ||
+            !bPersistAppend(&asLog[0], au8Record))
+        {
+            return FALSE;
+        }
+    }
+
+    if ((asLog[1 - u8Current].u16Next > 0) && !bPersistErase(&asLog[1 - u8Current]))
+    {
+        return FALSE;
+    }
+
+    sLog          = asLog[u8Current];
+    u32Generation = au32Generation[u8Current];
+    vReplay(&sLog);
+    bOpen = TRUE;
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: u8AssocStoreChannel
+ *
+ * RETURNS: uint8 channel the network was last started on, 0 if none
+ *
+ ****************************************************************************/
+PUBLIC uint8 u8AssocStoreChannel(void)
+{
+    return u8StoredChannel;
+}
+
+/****************************************************************************
+ *
+ * NAME: u16AssocStoreCount
+ *
+ * RETURNS: uint16 entries in the table
+ *
+ ****************************************************************************/
+PUBLIC uint16 u16AssocStoreCount(void)
+{
+    return u16Count;
+}
+
+/****************************************************************************
+ *
+ * NAME: psAssocStoreEntry
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16Entry        R   Entry, below u16AssocStoreCount()
+ *
+ * RETURNS: tsAssocEntry * entry
+ *
+ ****************************************************************************/
+PUBLIC tsAssocEntry *psAssocStoreEntry(uint16 u16Entry)
+{
+    return &asEntry[u16Entry];
+}
+
+/****************************************************************************
+ *
+ * NAME: psAssocStoreFind
+ *
+ * DESCRIPTION:
+ * Looks up an end device by extended address.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32ExtAdrH      R   Extended address, high word
+ *                  u32ExtAdrL      R   Extended address, low word
+ *
+ * RETURNS: tsAssocEntry * entry, NULL if the device is not in the table
+ *
+ ****************************************************************************/
+PUBLIC tsAssocEntry *psAssocStoreFind(uint32 u32ExtAdrH, uint32 u32ExtAdrL)
+{
+    uint16 n;
+
+    for (n = 0; n < u16Count; n++)
+    {
+        if ((asEntry[n].u32ExtAdrH == u32ExtAdrH) && (asEntry[n].u32ExtAdrL == u32ExtAdrL))
+        {
+            return &asEntry[n];
+        }
+    }
+
+    return NULL;
+}
+
+/****************************************************************************
+ *
+ * NAME: bAssocStoreSetChannel
+ *
+ * DESCRIPTION:
+ * Records the channel the network has been started on.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u8Channel       R   Channel
+ *
+ * RETURNS: bool_t FALSE if the change could not be written
+ *
+ ****************************************************************************/
+PUBLIC bool_t bAssocStoreSetChannel(uint8 u8Channel)
+{
+    uint8 au8Record[ASSOC_RECORD_LEN];
+
+    if (u8Channel == u8StoredChannel)
+    {
+        return TRUE;
+    }
+
+    u8StoredChannel = u8Channel;
+    vChannelRecord(u8Channel, au8Record);
+
+    return bAppend(au8Record);
+}
+
+/****************************************************************************
+ *
+ * NAME: bAssocStorePut
+ *
+ * DESCRIPTION:
+ * Adds an end device, or changes the short address of one already known.
+ * Nothing is written if the device is already held with this address.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32ExtAdrH      R   Extended address, high word
+ *                  u32ExtAdrL      R   Extended address, low word
+ *                  u16ShortAdr     R   Short address allocated
+ *
+ * RETURNS: bool_t FALSE if the table is full or the change could not be
+ *          written
+ *
+ ****************************************************************************/
+PUBLIC bool_t bAssocStorePut(uint32 u32ExtAdrH, uint32 u32ExtAdrL, uint16 u16ShortAdr)
+{
+    tsAssocEntry *psEntry;
+    uint8 au8Record[ASSOC_RECORD_LEN];
+
+    psEntry = psAssocStoreFind(u32ExtAdrH, u32ExtAdrL);
+    if (psEntry == NULL)
+    {
+        if (u16Count >= ASSOC_STORE_MAX_ENTRIES)
+        {
+            return FALSE;
+        }
+        psEntry = &asEntry[u16Count++];
+        psEntry->u32ExtAdrH = u32ExtAdrH;
+        psEntry->u32ExtAdrL = u32ExtAdrL;
+    }
+    else if (psEntry->u16ShortAdr == u16ShortAdr)
+    {
+        return TRUE;
+    }
+
+    psEntry->u16ShortAdr = u16ShortAdr;
+    vEntryRecord(psEntry, au8Record);
+
+    return bAppend(au8Record);
+}
+
+/****************************************************************************
+ *
+ * NAME: bAssocStoreRemove
+ *
+ * DESCRIPTION:
+ * Removes an end device that has left the network.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32ExtAdrH      R   Extended address, high word
+ *                  u32ExtAdrL      R   Extended address, low word
+ *
+ * RETURNS: bool_t FALSE if the change could not be written
+ *
+ ****************************************************************************/
+PUBLIC bool_t bAssocStoreRemove(uint32 u32ExtAdrH, uint32 u32ExtAdrL)
+{
+    tsAssocEntry *psEntry;
+    uint8 au8Record[ASSOC_RECORD_LEN];
+
+    psEntry = psAssocStoreFind(u32ExtAdrH, u32ExtAdrL);
+    if (psEntry == NULL)
+    {
+        return TRUE;
+    }
+
+    vDelete(psEntry);
+    vClearRecord(ASSOC_RECORD_REMOVE, au8Record);
+    vPutU32(&au8Record[1], u32ExtAdrH);
+    vPutU32(&au8Record[5], u32ExtAdrL);
+
+    return bAppend(au8Record);
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: bFindCommit
+ *
+ * DESCRIPTION:
+ * Looks for the commit record, which follows the compacted table at the
+ * start of a journal.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psLog           R   Journal
+ *                  pu32Generation  W   Generation of the journal
+ *
+ * RETURNS: bool_t TRUE if the journal is committed
+ *
+ ****************************************************************************/
+PRIVATE bool_t bFindCommit(tsPersistLog *psLog, uint32 *pu32Generation)
+{
+    uint8 au8Record[ASSOC_RECORD_LEN];
+    uint16 n;
+
+    for (n = 0; (n < psLog->u16Next) && (n < ASSOC_COMMIT_SEARCH_SLOTS); n++)
+    {
+        if (bPersistRead(psLog, n, au8Record) && (au8Record[0] == ASSOC_RECORD_COMMIT))
+        {
+            *pu32Generation = u32GetU32(&au8Record[1]);
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/****************************************************************************
+ *
+ * NAME: vReplay
+ *
+ * DESCRIPTION:
+ * Rebuilds the table from every intact record in a journal.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psLog           R   Journal
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vReplay(tsPersistLog *psLog)
+{
+    uint8 au8Record[ASSOC_RECORD_LEN];
+    uint16 n;
+
+    for (n = 0; n < psLog->u16Next; n++)
+    {
+        if (bPersistRead(psLog, n, au8Record))
+        {
+            vApply(au8Record);
+        }
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: vApply
+ *
+ * DESCRIPTION:
+ * Applies one journal record to the table.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Record       R   Record
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vApply(uint8 *pu8Record)
+{
+    tsAssocEntry *psEntry;
+    uint32 u32ExtAdrH;
+    uint32 u32ExtAdrL;
+
+    switch (pu8Record[0])
+    {
+    case ASSOC_RECORD_ENTRY:
+        u32ExtAdrH = u32GetU32(&pu8Record[1]);
+        u32ExtAdrL = u32GetU32(&pu8Record[5]);
+        psEntry    = psAssocStoreFind(u32ExtAdrH, u32ExtAdrL);
+        if ((psEntry == NULL) && (u16Count < ASSOC_STORE_MAX_ENTRIES))
+        {
+            psEntry = &asEntry[u16Count++];
+            psEntry->u32ExtAdrH = u32ExtAdrH;
+            psEntry->u32ExtAdrL = u32ExtAdrL;
+        }
+        if (psEntry != NULL)
+        {
+            psEntry->u16ShortAdr = (uint16)((pu8Record[9] << 8) | pu8Record[10]);
+        }
+        break;
+
+    case ASSOC_RECORD_REMOVE:
+        psEntry = psAssocStoreFind(u32GetU32(&pu8Record[1]), u32GetU32(&pu8Record[5]));
+        if (psEntry != NULL)
+        {
+            vDelete(psEntry);
+        }
+        break;
+
+    case ASSOC_RECORD_CHANNEL:
+        u8StoredChannel = pu8Record[1];
+        break;
+
+    default:
+        break;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: vDelete
+ *
+ * DESCRIPTION:
+ * Removes an entry from the table, moving the last entry into its place.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psEntry         R   Entry
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vDelete(tsAssocEntry *psEntry)
+{
+    *psEntry = asEntry[--u16Count];
+}
+
+/****************************************************************************
+ *
+ * NAME: bAppend
+ *
+ * DESCRIPTION:
+ * Journals a change already made to the table, compacting into the other
+ * sector instead if the journal is full.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Record       R   Record
+ *
+ * RETURNS: bool_t FALSE if the change could not be written
+ *
+ ****************************************************************************/
+PRIVATE bool_t bAppend(uint8 *pu8Record)
+{
+    if (!bOpen)
+    {
+        return FALSE;
+    }
+
+    if (sLog.u16Next >= sLog.u16Slots)
+    {
+        return bCompact();
+    }
+
+    return bPersistAppend(&sLog, pu8Record);
+}
+
+/****************************************************************************
+ *
+ * NAME: bCompact
+ *
+ * DESCRIPTION:
+ * Writes the table to the other sector, commits it with the next
+ * generation and then erases the full sector.
+ *
+ * RETURNS: bool_t FALSE if the flash could not be written
+ *
+ ****************************************************************************/
+PRIVATE bool_t bCompact(void)
+{
+    tsPersistLog sNext;
+    uint8 au8Record[ASSOC_RECORD_LEN];
+    uint8 u8Next = 1 - u8Current;
+    uint16 n;
+
+    if (!bPersistOpen(&sNext, au8Sector[u8Next], ASSOC_RECORD_LEN) ||
+        !bPersistErase(&sNext))
+    {
+        return FALSE;
+    }
+
+    if (u8StoredChannel != 0)
+    {
+        vChannelRecord(u8StoredChannel, au8Record);
+        if (!bPersistAppend(&sNext, au8Record))
+        {
+            return FALSE;
+        }
+    }
+
+    for (n = 0; n < u16Count; n++)
+    {
+        vEntryRecord(&asEntry[n], au8Record);
+        if (!bPersistAppend(&sNext, au8Record))
+        {
+            return FALSE;
+        }
+    }
+
+    vCommitRecord(u32Generation + 1, au8Record);
+    if (!bPersistAppend(&sNext, au8Record))
+    {
+        return FALSE;
+    }
+
+    /* The new journal is committed; a reset from here on leaves it in use */
+    u32Generation++;
+    (void)bPersistErase(&sLog);
+    sLog      = sNext;
+    u8Current = u8Next;
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: vEntryRecord
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psEntry         R   Entry
+ *                  pu8Record       W   Record
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vEntryRecord(tsAssocEntry *psEntry, uint8 *pu8Record)
+{
+    vClearRecord(ASSOC_RECORD_ENTRY, pu8Record);
+    vPutU32(&pu8Record[1], psEntry->u32ExtAdrH);
+    vPutU32(&pu8Record[5], psEntry->u32ExtAdrL);
+    pu8Record[9]  = (uint8)(psEntry->u16ShortAdr >> 8);
+    pu8Record[10] = (uint8)(psEntry->u16ShortAdr);
+}
+
+/****************************************************************************
+ *
+ * NAME: vChannelRecord
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u8Channel       R   Channel
+ *                  pu8Record       W   Record
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vChannelRecord(uint8 u8Channel, uint8 *pu8Record)
+{
+    vClearRecord(ASSOC_RECORD_CHANNEL, pu8Record);
+    pu8Record[1] = u8Channel;
+}
+
+/****************************************************************************
+ *
+ * NAME: vCommitRecord
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32Generation   R   Generation of the journal
+ *                  pu8Record       W   Record
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vCommitRecord(uint32 u32Generation, uint8 *pu8Record)
+{
+    vClearRecord(ASSOC_RECORD_COMMIT, pu8Record);
+    vPutU32(&pu8Record[1], u32Generation);
+}
+
+/****************************************************************************
+ *
+ * NAME: vClearRecord
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u8Type          R   Record type
+ *                  pu8Record       W   Record, zeroed after the type
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vClearRecord(uint8 u8Type, uint8 *pu8Record)
+{
+    uint8 n;
+
+    pu8Record[0] = u8Type;
+    for (n = 1; n < ASSOC_RECORD_LEN; n++)
+    {
+        pu8Record[n] = 0;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: u32GetU32
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8In           R   Input
+ *
+ * RETURNS: uint32 big endian value
+ *
+ ****************************************************************************/
+PRIVATE uint32 u32GetU32(uint8 *pu8In)
+{
+    return ((uint32)pu8In[0] << 24) | ((uint32)pu8In[1] << 16) |
+           ((uint32)pu8In[2] << 8)  | (uint32)pu8In[3];
+}
+
+/****************************************************************************
+ *
+ * NAME: vPutU32
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Out          W   Output
+ *                  u32Value        R   Value, written big endian
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vPutU32(uint8 *pu8Out, uint32 u32Value)
+{
+    pu8Out[0] = (uint8)(u32Value >> 24);
+    pu8Out[1] = (uint8)(u32Value >> 16);
+    pu8Out[2] = (uint8)(u32Value >> 8);
+    pu8Out[3] = (uint8)(u32Value);
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,73 @@
+/****************************************************************************
+ *
+ * MODULE:      assocstore.h
+ *
+ * DESCRIPTION:
+ * Coordinator's association table and channel held in flash, so a restart
+ * can resume the network without the end devices rejoining.
+ *
+ * Changes are appended to a journal (see persist.h) in one of two sectors.
+ * When the journal fills, the live table is written to the other sector
+ * followed by a commit record carrying a new generation, and only then is
+ * the full sector erased. At start-up the committed sector with the latest
+ * generation is used, so a reset part way through compaction loses
+ * nothing. Erases alternate between the two sectors.
+ *
+ ****************************************************************************/
+
+#ifndef  ASSOCSTORE_H_INCLUDED
+#define  ASSOCSTORE_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "config.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Flash sectors used by the journal */
+#define ASSOC_STORE_SECTOR_A        2
+#define ASSOC_STORE_SECTOR_B        3
+
+#define ASSOC_STORE_MAX_ENTRIES     MAX_END_DEVICES
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/* One associated end device */
+typedef struct
+{
+    uint32  u32ExtAdrH;
+    uint32  u32ExtAdrL;
+    uint16  u16ShortAdr;
+} tsAssocEntry;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC bool_t bAssocStoreOpen(void);
+PUBLIC uint8  u8AssocStoreChannel(void);
+PUBLIC uint16 u16AssocStoreCount(void);
+PUBLIC tsAssocEntry *psAssocStoreEntry(uint16 u16Entry);
+PUBLIC tsAssocEntry *psAssocStoreFind(uint32 u32ExtAdrH, uint32 u32ExtAdrL);
+PUBLIC bool_t bAssocStoreSetChannel(uint8 u8Channel);
+PUBLIC bool_t bAssocStorePut(uint32 u32ExtAdrH, uint32 u32ExtAdrL, uint16 u16ShortAdr);
+PUBLIC bool_t bAssocStoreRemove(uint32 u32ExtAdrH, uint32 u32ExtAdrL);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* ASSOCSTORE_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,243 @@
+/****************************************************************************
+ *
+ * MODULE:      chanagility.c
+ *
+ * DESCRIPTION:
+ * Moving the PAN off a noisy channel, see chanagility.h.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "config.h"
+#include "tickclock.h"
+#include "chanagility.h"
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vLinkMonitorInit
+ *
+ * DESCRIPTION:
+ * Starts the first window.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psMonitor       W   Monitor
+ *                  u32NowMs        R   Current time (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vLinkMonitorInit(tsLinkMonitor *psMonitor, uint32 u32NowMs)
+{
+    psMonitor->u32WindowStartMs  = u32NowMs;
+    psMonitor->u32HoldOffUntilMs = u32NowMs;
+    psMonitor->u16Received       = 0;
+    psMonitor->u16Lost           = 0;
+}
+
+/****************************************************************************
+ *
+ * NAME: vLinkMonitorFrames
+ *
+ * DESCRIPTION:
+ * Counts frames received and frames known to be lost in this window.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psMonitor       RW  Monitor
+ *                  u16Received     R   Frames received
+ *                  u16Lost         R   Frames lost
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vLinkMonitorFrames(tsLinkMonitor *psMonitor, uint16 u16Received, uint16 u16Lost)
+{
+    if ((uint32)psMonitor->u16Received + u16Received <= 0xffff)
+    {
+        psMonitor->u16Received += u16Received;
+    }
+    if ((uint32)psMonitor->u16Lost + u16Lost <= 0xffff)
+    {
+        psMonitor->u16Lost += u16Lost;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: bLinkMonitorCheck
+ *
+ * DESCRIPTION:
+ * Closes the window once it has run its length and starts the next. Loss
+ * is only reported outside the hold off period.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psMonitor       RW  Monitor
+ *                  u32NowMs        R   Current time (ms)
+ *
+ * RETURNS:
+ * TRUE if the window just closed lost more than CHAN_AGILITY_LOSS_PERCENT
+ * of its frames
+ *
+ ****************************************************************************/
+PUBLIC bool_t bLinkMonitorCheck(tsLinkMonitor *psMonitor, uint32 u32NowMs)
+{
+    uint32 u32Frames;
+    bool_t bLossy;
+
+    if ((u32NowMs - psMonitor->u32WindowStartMs) < CHAN_AGILITY_WINDOW_MS)
+    {
+        return FALSE;
+    }
+
+    u32Frames = (uint32)psMonitor->u16Received + psMonitor->u16Lost;
+    bLossy = (u32Frames >= CHAN_AGILITY_MIN_FRAMES) &&
+             ((uint32)psMonitor->u16Lost * 100 > u32Frames * CHAN_AGILITY_LOSS_PERCENT) &&
+             TICK_CLOCK_EXPIRED(u32NowMs, psMonitor->u32HoldOffUntilMs);
+
+    psMonitor->u32WindowStartMs = u32NowMs;
+    psMonitor->u16Received      = 0;
+    psMonitor->u16Lost          = 0;
+
+    return bLossy;
+}
+
+/****************************************************************************
+ *
+ * NAME: vLinkMonitorHoldOff
+ *
+ * DESCRIPTION:
+ * Ignores loss for CHAN_AGILITY_HOLDOFF_MS and starts a new window.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psMonitor       RW  Monitor
+ *                  u32NowMs        R   Current time (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vLinkMonitorHoldOff(tsLinkMonitor *psMonitor, uint32 u32NowMs)
+{
+    vLinkMonitorInit(psMonitor, u32NowMs);
+    psMonitor->u32HoldOffUntilMs = u32NowMs + CHAN_AGILITY_HOLDOFF_MS;
+}
+
+/****************************************************************************
+ *
+ * NAME: u8ChanAgilitySelect
+ *
+ * DESCRIPTION:
+ * Picks the quietest channel from an energy scan of SCAN_CHANNELS. The
+ * current channel is kept unless another is quieter by at least
+ * CHAN_AGILITY_ENERGY_MARGIN, so the PAN does not move for nothing.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Energy       R   Energy per channel scanned, in order
+ *                  u8Results       R   Number of results
+ *                  u8Current       R   Current channel, 0 if none
+ *
+ * RETURNS:
+ * Channel to use
+ *
+ ****************************************************************************/
+PUBLIC uint8 u8ChanAgilitySelect(uint8 *pu8Energy, uint8 u8Results, uint8 u8Current)
+{
+    uint8 u8Best = 0;
+    uint8 u8BestEnergy = 0xff;
+    uint8 u8CurrentEnergy = 0xff;
+    uint8 u8Channel;
+    uint8 i = 0;
+
+    for (u8Channel = CHANNEL_MIN; (u8Channel < 32) && (i < u8Results); u8Channel++)
+    {
+        if (!(SCAN_CHANNELS & (1UL << u8Channel)))
+        {
+            continue;
+        }
+
+        if ((u8Best == 0) || (pu8Energy[i] < u8BestEnergy))
+        {
+            u8Best = u8Channel;
+            u8BestEnergy = pu8Energy[i];
+        }
+        if (u8Channel == u8Current)
+        {
+            u8CurrentEnergy = pu8Energy[i];
+        }
+        i++;
+    }
+
+    if ((u8Best == 0) ||
+        ((u8Current != 0) && (u8BestEnergy + CHAN_AGILITY_ENERGY_MARGIN > u8CurrentEnergy)))
+    {
+        return u8Current;
+    }
+
+    return u8Best;
+}
+
+/****************************************************************************
+ *
+ * NAME: u8ChanAgilityEncode
+ *
+ * DESCRIPTION:
+ * Builds a channel change command.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Buf          W   At least CHAN_AGILITY_CMD_LEN bytes
+ *                  u8Channel       R   Channel to move to
+ *                  u16DelayMs      R   Time until the move (ms)
+ *
+ * RETURNS:
+ * Length of the command
+ *
+ ****************************************************************************/
+PUBLIC uint8 u8ChanAgilityEncode(uint8 *pu8Buf, uint8 u8Channel, uint16 u16DelayMs)
+{
+    pu8Buf[0] = CHAN_AGILITY_OPCODE;
+    pu8Buf[1] = u8Channel;
+    pu8Buf[2] = (uint8)(u16DelayMs >> 8);
+    pu8Buf[3] = (uint8)(u16DelayMs);
+
+    return CHAN_AGILITY_CMD_LEN;
+}
+
+/****************************************************************************
+ *
+ * NAME: bChanAgilityDecode
+ *
+ * DESCRIPTION:
+ * Parses a channel change command.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Data         R   Command, opcode first
+ *                  u8Len           R   Length of the command
+ *                  pu8Channel      W   Channel to move to
+ *                  pu16DelayMs     W   Time until the move (ms)
+ *
+ * RETURNS:
+ * TRUE if the command is valid
+ *
+ ****************************************************************************/
+PUBLIC bool_t bChanAgilityDecode(uint8 *pu8Data, uint8 u8Len, uint8 *pu8Channel, uint16 *pu16DelayMs)
+{
+    if ((u8Len < CHAN_AGILITY_CMD_LEN) || (pu8Data[0] != CHAN_AGILITY_OPCODE) ||
+        (pu8Data[1] >= 32) || !(SCAN_CHANNELS & (1UL << pu8Data[1])))
+    {
+        return FALSE;
+    }
+
+    *pu8Channel  = pu8Data[1];
+    *pu16DelayMs = (uint16)((pu8Data[2] << 8) | pu8Data[3]);
+
+    return TRUE;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
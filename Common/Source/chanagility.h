@@ -0,0 +1,86 @@
+/****************************************************************************
+ *
+ * MODULE:      chanagility.h
+ *
+ * DESCRIPTION:
+ * Moving the PAN off a channel that has become noisy. The coordinator
+ * counts the frames it receives and the frames it can tell were lost over
+ * a fixed window. When too many are lost it scans the band for energy and,
+ * if another channel is clearly quieter, announces the move to the end
+ * devices with a broadcast command and restarts the PAN there once the
+ * announcements are done.
+ *
+ * After a move, or a scan that finds nowhere better, monitoring is held
+ * off for a while so a busy band does not keep the coordinator scanning.
+ *
+ ****************************************************************************/
+
+#ifndef  CHANAGILITY_H_INCLUDED
+#define  CHANAGILITY_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "config.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Loss is judged over windows of CHAN_AGILITY_WINDOW_MS holding at least
+   CHAN_AGILITY_MIN_FRAMES frames */
+#define CHAN_AGILITY_WINDOW_MS      10000
+#define CHAN_AGILITY_MIN_FRAMES     20
+#define CHAN_AGILITY_LOSS_PERCENT   20
+#define CHAN_AGILITY_HOLDOFF_MS     60000
+
+/* Energy (ED units) by which a channel must beat the current one */
+#define CHAN_AGILITY_ENERGY_MARGIN  16
+
+/* The move is announced CHAN_AGILITY_ANNOUNCEMENTS times,
+   CHAN_AGILITY_ANNOUNCE_MS apart */
+#define CHAN_AGILITY_ANNOUNCEMENTS  5
+#define CHAN_AGILITY_ANNOUNCE_MS    100
+
+/* Channel change command: opcode, channel, delay before the move (ms) */
+#define CHAN_AGILITY_OPCODE         0xd3
+#define CHAN_AGILITY_CMD_LEN        4
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/* Frame counts for the current window */
+typedef struct
+{
+    uint32  u32WindowStartMs;
+    uint32  u32HoldOffUntilMs;
+    uint16  u16Received;
+    uint16  u16Lost;
+} tsLinkMonitor;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC void   vLinkMonitorInit(tsLinkMonitor *psMonitor, uint32 u32NowMs);
+PUBLIC void   vLinkMonitorFrames(tsLinkMonitor *psMonitor, uint16 u16Received, uint16 u16Lost);
+PUBLIC bool_t bLinkMonitorCheck(tsLinkMonitor *psMonitor, uint32 u32NowMs);
+PUBLIC void   vLinkMonitorHoldOff(tsLinkMonitor *psMonitor, uint32 u32NowMs);
+PUBLIC uint8  u8ChanAgilitySelect(uint8 *pu8Energy, uint8 u8Results, uint8 u8Current);
+PUBLIC uint8  u8ChanAgilityEncode(uint8 *pu8Buf, uint8 u8Channel, uint16 u16DelayMs);
+PUBLIC bool_t bChanAgilityDecode(uint8 *pu8Data, uint8 u8Len, uint8 *pu8Channel, uint16 *pu16DelayMs);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* CHANAGILITY_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -41,11 +41,21 @@ extern "C" {
 #define PAN_ID                      0x70FD
 #define COORDINATOR_ADR             0x0000
 #define END_DEVICE_START_ADR        0x0001
-#define MAX_END_DEVICES             10
+/* Devices the coordinator can hold */
+#ifndef MAX_END_DEVICES
+#define MAX_END_DEVICES             250
+#endif
+
+/* Devices given a reporting slot in a beacon enabled network, the rest
+   being refused. Each waits one beacon in every 15 of these between its
+   slots, which must be well inside TX_QUEUE_MAX_AGE_MS, see tdma.h. */
+#ifndef TDMA_MAX_DEVICES
+#define TDMA_MAX_DEVICES            30
+#endif
 
 /* Defines the channels to scan. Each bit represents one channel. All channels
    in the channels (11-26) in the 2.4GHz band are scanned. */
-#define SCAN_CHANNELS 		        0x00000800UL
+#define SCAN_CHANNELS 		        0x07FFF800UL
 #define CHANNEL_MIN                 11
 
 /* Duration (ms) = 15.36ms x (2^ACTIVE_SCAN_DURATION + 1) */
@@ -53,6 +63,40 @@ extern "C" {
 /* Duration (ms) = 15.36ms x (2^ENERGY_SCAN_DURATION + 1) */
 #define ENERGY_SCAN_DURATION        3
 
+/* When TRUE the coordinator ranges each associated beacon in turn and
+   calculates distances itself, and beacons neither range nor report */
+#ifndef COORDINATOR_INITIATED_RANGING
+#define COORDINATOR_INITIATED_RANGING   FALSE
+#endif
+
+/* When TRUE the coordinator runs a beacon enabled PAN and each end device
+   sends its reports only in its own time slot of the superframe, see tdma.h */
+#ifndef BEACON_ENABLED_NETWORK
+#define BEACON_ENABLED_NETWORK      FALSE
+#endif
+
+/* When TRUE end devices built as tags range against the anchors, and the
+   coordinator tracks the position of every tag. The anchors are the first
+   TAG_ANCHORS devices to associate, placed where the coordinator is built
+   to put them or where a survey finds them. They answer the tags' bursts
+   but range and report only in a survey. */
+#ifndef MULTI_TAG_TRACKING
+#define MULTI_TAG_TRACKING          FALSE
+#endif
+#ifndef TAG_ANCHORS
+#define TAG_ANCHORS                 2
+#endif
+
+/* Most anchors a network positions against. A survey, see survey.h, places
+   at most this many, taking them from the first devices to associate. */
+#define MAX_ANCHORS                 8
+
+/* Beacon interval (ms) = 15.36ms x 2^BEACON_ORDER
+   Active period (ms)   = 15.36ms x 2^SUPERFRAME_ORDER
+   Used only when BEACON_ENABLED_NETWORK is TRUE */
+#define BEACON_ORDER                5
+#define SUPERFRAME_ORDER            5
+
 /****************************************************************************/
 /***        Type Definitions                                              ***/
 /****************************************************************************/
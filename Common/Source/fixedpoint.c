@@ -0,0 +1,206 @@
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "fixedpoint.h"
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: u32FixedSqrt64
+ *
+ * DESCRIPTION:
+ * Integer square root, rounded down, by the bitwise digit-by-digit method.
+ * Uses only shifts, adds and compares; at most 32 iterations. Values that
+ * fit 32 bits, such as squared distances under 655 m, take the cheaper
+ * 32 bit path on the 32 bit core.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u64Value        R   Value to take the root of
+ *
+ * RETURNS: uint32 floor(sqrt(u64Value))
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32FixedSqrt64(uint64 u64Value)
+{
+    uint64 u64Root = 0;
+    uint64 u64Bit  = 1uLL << 62;
+    uint32 u32Value;
+    uint32 u32Root = 0;
+    uint32 u32Bit  = 1UL << 30;
+
+    if ((u64Value >> 32) == 0)
+    {
+        u32Value = (uint32)u64Value;
+
+        while (u32Bit > u32Value)
+        {
+            u32Bit >>= 2;
+        }
+
+        while (u32Bit != 0)
+        {
+            if (u32Value >= u32Root + u32Bit)
+            {
+                u32Value -= u32Root + u32Bit;
+                u32Root   = (u32Root >> 1) + u32Bit;
+            }
+            else
+            {
+                u32Root >>= 1;
+            }
+            u32Bit >>= 2;
+        }
+
+        return u32Root;
+    }
+
+    while (u64Bit > u64Value)
+    {
+        u64Bit >>= 2;
+    }
+
+    while (u64Bit != 0)
+    {
+        if (u64Value >= u64Root + u64Bit)
+        {
+            u64Value -= u64Root + u64Bit;
+            u64Root   = (u64Root >> 1) + u64Bit;
+        }
+        else
+        {
+            u64Root >>= 1;
+        }
+        u64Bit >>= 2;
+    }
+
+    return (uint32)u64Root;
+}
+
+/****************************************************************************
+ *
+ * NAME: u64FixedDistSq
+ *
+ * DESCRIPTION:
+ * Squared distance between two points, each coordinate difference squared
+ * in 64 bits.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pi32A           R   First point (cm per axis)
+ *                  pi32B           R   Second point (cm per axis)
+ *                  u8Axes          R   Axes to use
+ *
+ * RETURNS: uint64 squared distance (cm^2)
+ *
+ ****************************************************************************/
+PUBLIC uint64 u64FixedDistSq(const int32 *pi32A, const int32 *pi32B, uint8 u8Axes)
+{
+    uint64 u64Sum = 0;
+    int32 i32Diff;
+    uint8 n;
+
+    for (n = 0; n < u8Axes; n++)
+    {
+        i32Diff = pi32A[n] - pi32B[n];
+        u64Sum += (uint64)((int64)i32Diff * i32Diff);
+    }
+
+    return u64Sum;
+}
+
+/****************************************************************************
+ *
+ * NAME: u32FixedDist
+ *
+ * DESCRIPTION:
+ * Distance between two points, rounded down.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pi32A           R   First point (cm per axis)
+ *                  pi32B           R   Second point (cm per axis)
+ *                  u8Axes          R   Axes to use
+ *
+ * RETURNS: uint32 distance (cm)
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32FixedDist(const int32 *pi32A, const int32 *pi32B, uint8 u8Axes)
+{
+    return u32FixedSqrt64(u64FixedDistSq(pi32A, pi32B, u8Axes));
+}
+
+/****************************************************************************
+ *
+ * NAME: i32FixedSaturate
+ *
+ * DESCRIPTION:
+ * Narrows a 64 bit intermediate to +/- a limit.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  i64Value        R   Value
+ *                  i32Limit        R   Limit, positive
+ *
+ * RETURNS: int32 saturated value
+ *
+ ****************************************************************************/
+PUBLIC int32 i32FixedSaturate(int64 i64Value, int32 i32Limit)
+{
+    if (i64Value > i32Limit)
+    {
+        return i32Limit;
+    }
+    if (i64Value < -i32Limit)
+    {
+        return -i32Limit;
+    }
+    return (int32)i64Value;
+}
+
+/****************************************************************************
+ *
+ * NAME: pcFixedToStr
+ *
+ * DESCRIPTION:
+ * Writes a value held in units of 10^-u8Decimals as a decimal, for vPrintf
+ * to print with %s; vPrintf has no field widths to zero pad the fraction
+ * with, so 105 hundredths would otherwise print as 1.5.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32Value        R   Value, scaled by 10^u8Decimals
+ *                  u8Decimals      R   Digits after the point, at most 9
+ *                  pcStr           W   At least FIXED_STR_LEN characters
+ *
+ * RETURNS: char * pcStr
+ *
+ ****************************************************************************/
+PUBLIC char *pcFixedToStr(uint32 u32Value, uint8 u8Decimals, char *pcStr)
+{
+    char acDigits[FIXED_STR_LEN];
+    uint8 u8Digits = 0;
+    uint8 u8Len = 0;
+
+    /* Least significant digit first, at least one before the point */
+    do
+    {
+        acDigits[u8Digits++] = (char)('0' + u32Value % 10);
+        u32Value /= 10;
+    } while ((u32Value != 0) || (u8Digits <= u8Decimals));
+
+    while (u8Digits > 0)
+    {
+        if (u8Digits == u8Decimals)
+        {
+            pcStr[u8Len++] = '.';
+        }
+        pcStr[u8Len++] = acDigits[--u8Digits];
+    }
+    pcStr[u8Len] = '\0';
+
+    return pcStr;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,53 @@
+/****************************************************************************
+ *
+ * MODULE:      fixedpoint.h
+ *
+ * DESCRIPTION:
+ * Integer maths helpers for the JN5148, which has no floating point unit.
+ * Positions are held as int32 cm per axis. Squares and sums of squares of
+ * coordinate differences are formed in 64 bits, so any coordinates within
+ * +/- 2^30 cm can be used without overflow.
+ *
+ ****************************************************************************/
+
+#ifndef  FIXEDPOINT_H_INCLUDED
+#define  FIXEDPOINT_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Signed division rounded to the nearest integer (d must be positive) */
+#define FIXED_DIV_ROUND(n, d) \
+    (((n) >= 0) ? (((n) + ((d) / 2)) / (d)) : (((n) - ((d) / 2)) / (d)))
+
+/* Longest string pcFixedToStr writes, with its terminator */
+#define FIXED_STR_LEN               12
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC uint32 u32FixedSqrt64(uint64 u64Value);
+PUBLIC uint64 u64FixedDistSq(const int32 *pi32A, const int32 *pi32B, uint8 u8Axes);
+PUBLIC uint32 u32FixedDist(const int32 *pi32A, const int32 *pi32B, uint8 u8Axes);
+PUBLIC int32  i32FixedSaturate(int64 i64Value, int32 i32Limit);
+PUBLIC char  *pcFixedToStr(uint32 u32Value, uint8 u8Decimals, char *pcStr);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* FIXEDPOINT_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
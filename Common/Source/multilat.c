@@ -0,0 +1,463 @@
+/****************************************************************************
+ *
+ * MODULE:      multilat.c
+ *
+ * DESCRIPTION:
+ * Fixed point multilateration, see multilat.h.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "fixedpoint.h"
+#include "multilat.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Unit vectors of the Jacobian are held in Q14 */
+#define UNIT_SHIFT                  14
+
+/* Rows of the linear system are scaled to below 2^ROW_BITS, so the
+   products taken in elimination fit an int64 */
+#define ROW_BITS                    30
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/* Augmented d x (d + 1) system */
+typedef int64 tsLinearSystem[MULTILAT_AXES][MULTILAT_AXES + 1];
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE bool_t bLinearSeed(tsMultilatRange *pasRange, uint8 u8Ranges, uint8 u8Dims,
+                           tsMultilatPoint *psSeed);
+PRIVATE void vOffsetSeed(tsMultilatRange *pasRange, uint8 u8Ranges, uint8 u8Dims,
+                         tsMultilatPoint *psSeed);
+PRIVATE bool_t bSolveLinear(tsLinearSystem ai64M, uint8 u8Dims, int32 *pi32X);
+PRIVATE void vScaleRow(int64 *pi64Row, uint8 u8Len);
+PRIVATE int32 i32RangeCm(tsMultilatRange *psRange);
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: bMultilatSolve
+ *
+ * DESCRIPTION:
+ * Finds the position whose distances to the anchors best fit the ranges in
+ * the least squares sense. Coordinates beyond u8Dims are left at 0 and
+ * ignored in the anchors.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pasRange        R   Ranges, first MULTILAT_MAX_ANCHORS used
+ *                  u8Ranges        R   Number of ranges
+ *                  u8Dims          R   2 or 3
+ *                  psFix           W   Position and fit
+ *
+ * RETURNS:
+ * FALSE if there are fewer ranges than dimensions
+ *
+ ****************************************************************************/
+PUBLIC bool_t bMultilatSolve(tsMultilatRange *pasRange, uint8 u8Ranges, uint8 u8Dims,
+                             tsMultilatFix *psFix)
+{
+    tsLinearSystem ai64M;
+    int32 ai32Diff[MULTILAT_AXES];
+    int32 ai32Unit[MULTILAT_AXES];
+    int32 ai32Step[MULTILAT_AXES];
+    int32 *pi32Pos = psFix->sPos.ai32Cm;
+    uint64 u64SumSq;
+    uint32 u32Dist;
+    int32 i32Residual;
+    int32 i32MaxStep;
+    bool_t bConverged = FALSE;
+    uint8 u8Used;
+    uint8 i, j, k;
+
+    if (u8Ranges > MULTILAT_MAX_ANCHORS)
+    {
+        u8Ranges = MULTILAT_MAX_ANCHORS;
+    }
+    if ((u8Dims < 2) || (u8Dims > MULTILAT_AXES) || (u8Ranges < u8Dims))
+    {
+        return FALSE;
+    }
+
+    for (j = 0; j < MULTILAT_AXES; j++)
+    {
+        pi32Pos[j] = 0;
+    }
+    if ((u8Ranges == u8Dims) || !bLinearSeed(pasRange, u8Ranges, u8Dims, &psFix->sPos))
+    {
+        vOffsetSeed(pasRange, u8Ranges, u8Dims, &psFix->sPos);
+    }
+
+    psFix->u8Anchors    = u8Ranges;
+    psFix->u8Iterations = 0;
+
+    /* Each pass evaluates the fit at the current position, then steps */
+    for (;;)
+    {
+        for (j = 0; j < u8Dims; j++)
+        {
+            for (k = 0; k <= u8Dims; k++)
+            {
+                ai64M[j][k] = 0;
+            }
+        }
+        u64SumSq = 0;
+        u8Used   = 0;
+
+        for (i = 0; i < u8Ranges; i++)
+        {
+            for (j = 0; j < u8Dims; j++)
+            {
+                ai32Diff[j] = pi32Pos[j] - pasRange[i].sAnchor.ai32Cm[j];
+            }
+            u32Dist     = u32FixedDist(pi32Pos, pasRange[i].sAnchor.ai32Cm, u8Dims);
+            i32Residual = (int32)u32Dist - i32RangeCm(&pasRange[i]);
+            u64SumSq   += (uint64)((int64)i32Residual * i32Residual);
+
+            /* No direction to the anchor when on top of it */
+            if (u32Dist == 0)
+            {
+                continue;
+            }
+            u8Used++;
+
+            for (j = 0; j < u8Dims; j++)
+            {
+                ai32Unit[j] = (ai32Diff[j] * (1L << UNIT_SHIFT)) / (int32)u32Dist;
+            }
+            for (j = 0; j < u8Dims; j++)
+            {
+                for (k = 0; k < u8Dims; k++)
+                {
+                    ai64M[j][k] += (int64)ai32Unit[j] * ai32Unit[k];
+                }
+                /* Right hand side in Q28 like the matrix, so the step is in cm */
+                ai64M[j][u8Dims] -= ((int64)ai32Unit[j] * i32Residual) << UNIT_SHIFT;
+            }
+        }
+
+        u32Dist = u32FixedSqrt64(u64SumSq / u8Ranges);
+        psFix->u16RmsCm = (u32Dist > 0xffff) ? 0xffff : (uint16)u32Dist;
+
+        if (bConverged || (psFix->u8Iterations >= MULTILAT_MAX_ITERATIONS) ||
+            (u8Used < u8Dims) || !bSolveLinear(ai64M, u8Dims, ai32Step))
+        {
+            break;
+        }
+
+        i32MaxStep = 0;
+        for (j = 0; j < u8Dims; j++)
+        {
+            pi32Pos[j] = i32FixedSaturate((int64)pi32Pos[j] + ai32Step[j], MULTILAT_MAX_CM);
+            if (ai32Step[j] > i32MaxStep)
+            {
+                i32MaxStep = ai32Step[j];
+            }
+            else if (-ai32Step[j] > i32MaxStep)
+            {
+                i32MaxStep = -ai32Step[j];
+            }
+        }
+        psFix->u8Iterations++;
+
+        /* Converged, one more pass for the fit at the final position */
+        bConverged = (i32MaxStep <= MULTILAT_CONVERGED_CM);
+    }
+
+    return TRUE;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: bLinearSeed
+ *
+ * DESCRIPTION:
+ * Least squares solution of the range equations linearised by subtracting
+ * the first anchor's: 2 q.p = |q|^2 - r^2 + r0^2, with q and p relative to
+ * the first anchor.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pasRange        R   Ranges
+ *                  u8Ranges        R   Number of ranges, more than u8Dims
+ *                  u8Dims          R   Dimensions
+ *                  psSeed          W   Seed position
+ *
+ * RETURNS:
+ * FALSE if the anchors do not span the dimensions
+ *
+ ****************************************************************************/
+PRIVATE bool_t bLinearSeed(tsMultilatRange *pasRange, uint8 u8Ranges, uint8 u8Dims,
+                           tsMultilatPoint *psSeed)
+{
+    tsLinearSystem ai64M;
+    int32 ai32Q[MULTILAT_AXES];
+    int32 ai32X[MULTILAT_AXES];
+    int32 *pi32Origin = pasRange[0].sAnchor.ai32Cm;
+    int64 i64R0Sq;
+    int64 i64C;
+    int32 i32Range;
+    uint8 i, j, k;
+
+    for (j = 0; j < u8Dims; j++)
+    {
+        for (k = 0; k <= u8Dims; k++)
+        {
+            ai64M[j][k] = 0;
+        }
+    }
+
+    i32Range = i32RangeCm(&pasRange[0]);
+    i64R0Sq  = (int64)i32Range * i32Range;
+
+    for (i = 1; i < u8Ranges; i++)
+    {
+        i32Range = i32RangeCm(&pasRange[i]);
+        i64C     = i64R0Sq - (int64)i32Range * i32Range;
+        for (j = 0; j < u8Dims; j++)
+        {
+            ai32Q[j] = pasRange[i].sAnchor.ai32Cm[j] - pi32Origin[j];
+        }
+        i64C += (int64)u64FixedDistSq(pasRange[i].sAnchor.ai32Cm, pi32Origin, u8Dims);
+
+        /* Normal equations, sum 2 q q^T p = sum q c */
+        for (j = 0; j < u8Dims; j++)
+        {
+            for (k = 0; k < u8Dims; k++)
+            {
+                ai64M[j][k] += 2 * (int64)ai32Q[j] * ai32Q[k];
+            }
+            ai64M[j][u8Dims] += (int64)ai32Q[j] * i64C;
+        }
+    }
+
+    if (!bSolveLinear(ai64M, u8Dims, ai32X))
+    {
+        return FALSE;
+    }
+
+    for (j = 0; j < u8Dims; j++)
+    {
+        psSeed->ai32Cm[j] = i32FixedSaturate((int64)pi32Origin[j] + ai32X[j], MULTILAT_MAX_CM);
+    }
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: vOffsetSeed
+ *
+ * DESCRIPTION:
+ * Seed at the centroid of the anchors moved along the last axis by the
+ * mean range, for when the linear seed cannot be found.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pasRange        R   Ranges
+ *                  u8Ranges        R   Number of ranges
+ *                  u8Dims          R   Dimensions
+ *                  psSeed          W   Seed position
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vOffsetSeed(tsMultilatRange *pasRange, uint8 u8Ranges, uint8 u8Dims,
+                         tsMultilatPoint *psSeed)
+{
+    int32 i32Sum;
+    uint8 i, j;
+
+    for (j = 0; j <= u8Dims; j++)
+    {
+        i32Sum = 0;
+        for (i = 0; i < u8Ranges; i++)
+        {
+            i32Sum += (j < u8Dims) ? pasRange[i].sAnchor.ai32Cm[j] :
+                                     i32RangeCm(&pasRange[i]);
+        }
+
+        if (j < u8Dims)
+        {
+            psSeed->ai32Cm[j] = i32Sum / u8Ranges;
+        }
+        else
+        {
+            psSeed->ai32Cm[u8Dims - 1] = i32FixedSaturate((int64)psSeed->ai32Cm[u8Dims - 1] + i32Sum / u8Ranges,
+                                                  MULTILAT_MAX_CM);
+        }
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: bSolveLinear
+ *
+ * DESCRIPTION:
+ * Solves a d x d system by fraction free Gaussian elimination with partial
+ * pivoting. Each row is scaled down to ROW_BITS after it changes; scaling a
+ * whole row leaves the solution unchanged.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  ai64M           RW  Augmented matrix, destroyed
+ *                  u8Dims          R   d
+ *                  pi32X           W   Solution, rounded and saturated
+ *
+ * RETURNS:
+ * FALSE if the matrix is singular
+ *
+ ****************************************************************************/
+PRIVATE bool_t bSolveLinear(tsLinearSystem ai64M, uint8 u8Dims, int32 *pi32X)
+{
+    int64 i64Pivot;
+    int64 i64Factor;
+    int64 i64Sum;
+    int64 i64Swap;
+    uint8 u8Best;
+    uint8 c, r, k;
+
+    for (r = 0; r < u8Dims; r++)
+    {
+        vScaleRow(ai64M[r], u8Dims + 1);
+    }
+
+    for (c = 0; c < u8Dims; c++)
+    {
+        u8Best = c;
+        for (r = c + 1; r < u8Dims; r++)
+        {
+            if (((ai64M[r][c] < 0) ? -ai64M[r][c] : ai64M[r][c]) >
+                ((ai64M[u8Best][c] < 0) ? -ai64M[u8Best][c] : ai64M[u8Best][c]))
+            {
+                u8Best = r;
+            }
+        }
+        if (ai64M[u8Best][c] == 0)
+        {
+            return FALSE;
+        }
+        if (u8Best != c)
+        {
+            for (k = c; k <= u8Dims; k++)
+            {
+                i64Swap          = ai64M[c][k];
+                ai64M[c][k]      = ai64M[u8Best][k];
+                ai64M[u8Best][k] = i64Swap;
+            }
+        }
+
+        for (r = c + 1; r < u8Dims; r++)
+        {
+            i64Factor = ai64M[r][c];
+            if (i64Factor == 0)
+            {
+                continue;
+            }
+            for (k = c; k <= u8Dims; k++)
+            {
+                ai64M[r][k] = ai64M[r][k] * ai64M[c][c] - ai64M[c][k] * i64Factor;
+            }
+            vScaleRow(ai64M[r], u8Dims + 1);
+        }
+    }
+
+    for (c = u8Dims; c-- > 0;)
+    {
+        i64Sum = ai64M[c][u8Dims];
+        for (k = c + 1; k < u8Dims; k++)
+        {
+            i64Sum -= ai64M[c][k] * pi32X[k];
+        }
+
+        i64Pivot = ai64M[c][c];
+        if (i64Pivot < 0)
+        {
+            i64Pivot = -i64Pivot;
+            i64Sum   = -i64Sum;
+        }
+        pi32X[c] = i32FixedSaturate(FIXED_DIV_ROUND(i64Sum, i64Pivot), 0x3fffffff);
+    }
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: vScaleRow
+ *
+ * DESCRIPTION:
+ * Shifts a row down until every element is below 2^ROW_BITS in magnitude.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pi64Row         RW  Row
+ *                  u8Len           R   Elements in the row
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vScaleRow(int64 *pi64Row, uint8 u8Len)
+{
+    uint64 u64Max = 0;
+    uint64 u64Abs;
+    uint8 u8Shift = 0;
+    uint8 k;
+
+    for (k = 0; k < u8Len; k++)
+    {
+        u64Abs = (pi64Row[k] < 0) ? (uint64)-pi64Row[k] : (uint64)pi64Row[k];
+        if (u64Abs > u64Max)
+        {
+            u64Max = u64Abs;
+        }
+    }
+
+    while ((u64Max >> u8Shift) >= (1ULL << ROW_BITS))
+    {
+        u8Shift++;
+    }
+
+    if (u8Shift != 0)
+    {
+        for (k = 0; k < u8Len; k++)
+        {
+            pi64Row[k] >>= u8Shift;
+        }
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: i32RangeCm
+ *
+ * DESCRIPTION:
+ * Range limited to 0 to MULTILAT_MAX_CM. A ToF distance can come out
+ * negative close to the anchor.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psRange         R   Range
+ *
+ * RETURNS: int32 range (cm)
+ *
+ ****************************************************************************/
+PRIVATE int32 i32RangeCm(tsMultilatRange *psRange)
+{
+    return (psRange->i32RangeCm < 0) ? 0 : i32FixedSaturate(psRange->i32RangeCm, MULTILAT_MAX_CM);
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
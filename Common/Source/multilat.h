@@ -0,0 +1,90 @@
+/****************************************************************************
+ *
+ * MODULE:      multilat.h
+ *
+ * DESCRIPTION:
+ * Fixed point multilateration: the position of a target from its ranges to
+ * anchors at known positions, in two or three dimensions.
+ *
+ * The range equations are linearised against the first anchor and solved
+ * by least squares for a seed, which is then refined by Gauss-Newton on
+ * the true ranges. With only as many anchors as dimensions the linear seed
+ * is undetermined, and the seed is instead placed on the positive side of
+ * the last axis, so anchors laid out along the other axes fix the target
+ * to that side as the original two beacon layout did.
+ *
+ * Work per fix is bounded: at most MULTILAT_MAX_ANCHORS ranges are used and
+ * at most MULTILAT_MAX_ITERATIONS + 1 passes made over them, each pass
+ * costing one 64 bit square root and one division per dimension for every
+ * anchor, and one elimination of at most 3 x 3.
+ *
+ * Coordinates and ranges are in cm and must lie within MULTILAT_MAX_CM, so
+ * every intermediate fits its integer type.
+ *
+ ****************************************************************************/
+
+#ifndef  MULTILAT_H_INCLUDED
+#define  MULTILAT_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+#define MULTILAT_AXES               3
+#define MULTILAT_MAX_ANCHORS        8
+#define MULTILAT_MAX_ITERATIONS     5
+
+/* Refinement stops once no coordinate moves by more than this (cm) */
+#define MULTILAT_CONVERGED_CM       1
+
+/* Largest coordinate or range magnitude (cm) */
+#define MULTILAT_MAX_CM             32767
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/* Position (cm), x, y then z */
+typedef struct
+{
+    int32   ai32Cm[MULTILAT_AXES];
+} tsMultilatPoint;
+
+/* Range to one anchor */
+typedef struct
+{
+    tsMultilatPoint sAnchor;
+    int32   i32RangeCm;
+} tsMultilatRange;
+
+typedef struct
+{
+    tsMultilatPoint sPos;
+    uint16  u16RmsCm;           /* RMS range residual at the position */
+    uint8   u8Anchors;          /* Ranges used */
+    uint8   u8Iterations;       /* Gauss-Newton steps taken */
+} tsMultilatFix;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC bool_t bMultilatSolve(tsMultilatRange *pasRange, uint8 u8Ranges, uint8 u8Dims,
+                             tsMultilatFix *psFix);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* MULTILAT_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
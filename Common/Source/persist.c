@@ -0,0 +1,303 @@
+/****************************************************************************
+ *
+ * MODULE:      persist.c
+ *
+ * DESCRIPTION:
+ * Journal of fixed size records in one sector of the serial flash, see
+ * persist.h.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include <AppHardwareApi.h>
+#include "persist.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* First byte of a written slot. Erased flash reads 0xff. */
+#define PERSIST_MARKER              0x5a
+#define PERSIST_ERASED              0xff
+
+/* Marker and checksum around the payload */
+#define PERSIST_SLOT_LEN(len)       ((uint16)(len) + 2)
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE uint32 u32SlotAddress(tsPersistLog *psLog, uint16 u16Slot);
+PRIVATE uint8 u8SlotMarker(tsPersistLog *psLog, uint16 u16Slot);
+PRIVATE uint8 u8Checksum(uint8 *pu8Data, uint8 u8Len);
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: bPersistOpen
+ *
+ * DESCRIPTION:
+ * Opens the journal in a sector, finding the first free slot.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psLog           W   Journal
+ *                  u8Sector        R   Flash sector holding the journal
+ *                  u8RecordLen     R   Payload bytes per record
+ *
+ * RETURNS: bool_t FALSE if the flash could not be initialised
+ *
+ ****************************************************************************/
+PUBLIC bool_t bPersistOpen(tsPersistLog *psLog, uint8 u8Sector, uint8 u8RecordLen)
+{
+    uint16 u16Low;
+    uint16 u16High;
+    uint16 u16Mid;
+
+    if ((u8RecordLen == 0) || (u8RecordLen > PERSIST_MAX_RECORD) ||
+        !bAHI_FlashInit(E_FL_CHIP_AUTO, NULL))
+    {
+        return FALSE;
+    }
+
+    psLog->u8Sector    = u8Sector;
+    psLog->u8RecordLen = u8RecordLen;
+    psLog->u16Slots    = (uint16)(PERSIST_SECTOR_SIZE / PERSIST_SLOT_LEN(u8RecordLen));
+
+    /* Binary search for the first slot still erased */
+    u16Low  = 0;
+    u16High = psLog->u16Slots;
+    while (u16Low < u16High)
+    {
+        u16Mid = u16Low + (u16High - u16Low) / 2;
+        if (u8SlotMarker(psLog, u16Mid) == PERSIST_ERASED)
+        {
+            u16High = u16Mid;
+        }
+        else
+        {
+            u16Low = u16Mid + 1;
+        }
+    }
+    psLog->u16Next = u16Low;
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: bPersistRead
+ *
+ * DESCRIPTION:
+ * Reads the record in a slot.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psLog           R   Journal
+ *                  u16Slot         R   Slot, below psLog->u16Next
+ *                  pu8Record       W   Payload
+ *
+ * RETURNS: bool_t FALSE if the slot is free or its record is torn
+ *
+ ****************************************************************************/
+PUBLIC bool_t bPersistRead(tsPersistLog *psLog, uint16 u16Slot, uint8 *pu8Record)
+{
+    uint8 au8Slot[PERSIST_SLOT_LEN(PERSIST_MAX_RECORD)];
+    uint8 n;
+
+    if ((u16Slot >= psLog->u16Next) ||
+        !bAHI_FullFlashRead(u32SlotAddress(psLog, u16Slot),
+                            PERSIST_SLOT_LEN(psLog->u8RecordLen), au8Slot))
+    {
+        return FALSE;
+    }
+
+    if ((au8Slot[0] != PERSIST_MARKER) ||
+        (au8Slot[psLog->u8RecordLen + 1] != u8Checksum(&au8Slot[1], psLog->u8RecordLen)))
+    {
+        return FALSE;
+    }
+
+    for (n = 0; n < psLog->u8RecordLen; n++)
+    {
+        pu8Record[n] = au8Slot[n + 1];
+    }
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: bPersistReadLast
+ *
+ * DESCRIPTION:
+ * Reads the most recent intact record.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psLog           R   Journal
+ *                  pu8Record       W   Payload
+ *
+ * RETURNS: bool_t FALSE if the journal holds no intact record
+ *
+ ****************************************************************************/
+PUBLIC bool_t bPersistReadLast(tsPersistLog *psLog, uint8 *pu8Record)
+{
+    uint16 u16Slot = psLog->u16Next;
+
+    while (u16Slot > 0)
+    {
+        if (bPersistRead(psLog, --u16Slot, pu8Record))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/****************************************************************************
+ *
+ * NAME: bPersistAppend
+ *
+ * DESCRIPTION:
+ * Appends a record, first erasing the sector if it is full. The marker is
+ * the first byte programmed, so a slot is never left looking free once any
+ * of it has been written.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psLog           RW  Journal
+ *                  pu8Record       R   Payload
+ *
+ * RETURNS: bool_t FALSE if the flash could not be written
+ *
+ ****************************************************************************/
+PUBLIC bool_t bPersistAppend(tsPersistLog *psLog, uint8 *pu8Record)
+{
+    uint8 au8Slot[PERSIST_SLOT_LEN(PERSIST_MAX_RECORD)];
+    uint8 n;
+
+    if ((psLog->u16Next >= psLog->u16Slots) && !bPersistErase(psLog))
+    {
+        return FALSE;
+    }
+
+    au8Slot[0] = PERSIST_MARKER;
+    for (n = 0; n < psLog->u8RecordLen; n++)
+    {
+        au8Slot[n + 1] = pu8Record[n];
+    }
+    au8Slot[psLog->u8RecordLen + 1] = u8Checksum(pu8Record, psLog->u8RecordLen);
+
+    /* The slot is consumed even if programming fails, as it may be part
+       written */
+    if (!bAHI_FullFlashProgram(u32SlotAddress(psLog, psLog->u16Next++),
+                               PERSIST_SLOT_LEN(psLog->u8RecordLen), au8Slot))
+    {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: bPersistErase
+ *
+ * DESCRIPTION:
+ * Erases every record in the journal.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psLog           RW  Journal
+ *
+ * RETURNS: bool_t FALSE if the sector could not be erased
+ *
+ ****************************************************************************/
+PUBLIC bool_t bPersistErase(tsPersistLog *psLog)
+{
+    if (!bAHI_FlashEraseSector(psLog->u8Sector))
+    {
+        return FALSE;
+    }
+
+    psLog->u16Next = 0;
+
+    return TRUE;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: u32SlotAddress
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psLog           R   Journal
+ *                  u16Slot         R   Slot
+ *
+ * RETURNS: uint32 flash address of the slot
+ *
+ ****************************************************************************/
+PRIVATE uint32 u32SlotAddress(tsPersistLog *psLog, uint16 u16Slot)
+{
+    return (uint32)psLog->u8Sector * PERSIST_SECTOR_SIZE +
+           (uint32)u16Slot * PERSIST_SLOT_LEN(psLog->u8RecordLen);
+}
+
+/****************************************************************************
+ *
+ * NAME: u8SlotMarker
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psLog           R   Journal
+ *                  u16Slot         R   Slot
+ *
+ * RETURNS: uint8 first byte of the slot, read as written if the read fails
+ *
+ ****************************************************************************/
+PRIVATE uint8 u8SlotMarker(tsPersistLog *psLog, uint16 u16Slot)
+{
+    uint8 u8Marker;
+
+    if (!bAHI_FullFlashRead(u32SlotAddress(psLog, u16Slot), 1, &u8Marker))
+    {
+        return PERSIST_MARKER;
+    }
+
+    return u8Marker;
+}
+
+/****************************************************************************
+ *
+ * NAME: u8Checksum
+ *
+ * DESCRIPTION:
+ * Complemented sum of a payload, so an all zero payload does not check.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Data         R   Payload
+ *                  u8Len           R   Payload length
+ *
+ * RETURNS: uint8 checksum
+ *
+ ****************************************************************************/
+PRIVATE uint8 u8Checksum(uint8 *pu8Data, uint8 u8Len)
+{
+    uint8 u8Sum = 0;
+    uint8 n;
+
+    for (n = 0; n < u8Len; n++)
+    {
+        u8Sum += pu8Data[n];
+    }
+
+    return (uint8)~u8Sum;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
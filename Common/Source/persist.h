@@ -0,0 +1,71 @@
+/****************************************************************************
+ *
+ * MODULE:      persist.h
+ *
+ * DESCRIPTION:
+ * Journal of fixed size records in one sector of the serial flash. Records
+ * are appended in turn rather than rewritten in place, so each byte of the
+ * sector is programmed once per erase. The sector is erased only when it
+ * fills.
+ *
+ * Each record occupies a slot: marker (1) | payload | checksum (1). Slots
+ * are used in order, so the used slots form a prefix of the sector and the
+ * first free one is found with a binary search. A record torn by a reset
+ * fails its checksum and is skipped.
+ *
+ ****************************************************************************/
+
+#ifndef  PERSIST_H_INCLUDED
+#define  PERSIST_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Sector size of the M25P40 serial flash fitted to JN5148 modules. The
+   application image occupies the lower sectors. */
+#define PERSIST_SECTOR_SIZE         0x10000UL
+
+/* Largest record payload */
+#define PERSIST_MAX_RECORD          32
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/* Journal in one flash sector */
+typedef struct
+{
+    uint8   u8Sector;
+    uint8   u8RecordLen;        /* Payload bytes per record */
+    uint16  u16Slots;           /* Records the sector holds */
+    uint16  u16Next;            /* First free slot */
+} tsPersistLog;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC bool_t bPersistOpen(tsPersistLog *psLog, uint8 u8Sector, uint8 u8RecordLen);
+PUBLIC bool_t bPersistRead(tsPersistLog *psLog, uint16 u16Slot, uint8 *pu8Record);
+PUBLIC bool_t bPersistReadLast(tsPersistLog *psLog, uint8 *pu8Record);
+PUBLIC bool_t bPersistAppend(tsPersistLog *psLog, uint8 *pu8Record);
+PUBLIC bool_t bPersistErase(tsPersistLog *psLog);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* PERSIST_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
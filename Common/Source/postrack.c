@@ -0,0 +1,401 @@
+/****************************************************************************
+ *
+ * MODULE:      postrack.c
+ *
+ * DESCRIPTION:
+ * Fixed point position tracking, see postrack.h.
+ *
+ * The state is held in mm and mm/s and the covariance in the matching
+ * squared units, which keeps every product within 64 bits for rooms of any
+ * realistic size. Unit vectors are held as fractions of 2^14 and gains as
+ * fractions of 2^16.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "fixedpoint.h"
+#include "multilat.h"
+#include "postrack.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+#define UNIT_SHIFT                  14
+#define GAIN_ONE                    65536LL
+
+#define MM_PER_CM                   10
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE bool_t bElapsedMs(tsPosTrack *psTrack, uint32 u32NowMs, uint32 *pu32DtMs);
+PRIVATE void   vPredict(tsPosTrack *psTrack, uint32 u32DtMs);
+PRIVATE int64  i64Variance(uint32 u32StdDevCm);
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vPosTrackReset
+ *
+ * DESCRIPTION:
+ * Discards the track.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTrack         W   Track
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vPosTrackReset(tsPosTrack *psTrack)
+{
+    psTrack->bValid    = FALSE;
+    psTrack->u8Dims    = 0;
+    psTrack->u8Misses  = 0;
+    psTrack->u32LastMs = 0;
+}
+
+/****************************************************************************
+ *
+ * NAME: vPosTrackStart
+ *
+ * DESCRIPTION:
+ * Starts a track at a position, with the target assumed stationary.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTrack         W   Track
+ *                  u8Dims          R   Axes to track, 2 or 3
+ *                  u32NowMs        R   Time of the position (ms)
+ *                  psPos           R   Position (cm)
+ *                  u32StdDevCm     R   Standard deviation of each coordinate
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vPosTrackStart(tsPosTrack *psTrack, uint8 u8Dims, uint32 u32NowMs,
+                           tsMultilatPoint *psPos, uint32 u32StdDevCm)
+{
+    int64 i64PosVar = i64Variance(u32StdDevCm);
+    uint8 i, j;
+
+    psTrack->bValid    = TRUE;
+    psTrack->u8Dims    = u8Dims;
+    psTrack->u8Misses  = 0;
+    psTrack->u32LastMs = u32NowMs;
+
+    for (i = 0; i < POS_TRACK_STATES; i++)
+    {
+        for (j = 0; j < POS_TRACK_STATES; j++)
+        {
+            psTrack->ai64P[i][j] = 0;
+        }
+        psTrack->ai32X[i] = 0;
+    }
+
+    for (i = 0; i < u8Dims; i++)
+    {
+        psTrack->ai32X[i] = psPos->ai32Cm[i] * MM_PER_CM;
+        psTrack->ai64P[i][i] = i64PosVar;
+        psTrack->ai64P[u8Dims + i][u8Dims + i] = POS_TRACK_INIT_VEL_VAR;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: bPosTrackRange
+ *
+ * DESCRIPTION:
+ * Predicts the track forward to the time of a range and fuses the range
+ * into it, linearised about the prediction. With h the predicted distance
+ * and u the unit vector from the anchor, H = [u 0] and g = P H' gives
+ * S = H g + R, K = g / S and P = P - g K'.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTrack         RW  Track
+ *                  u32NowMs        R   Time of the range (ms)
+ *                  psAnchor        R   Anchor position (cm)
+ *                  i32RangeCm      R   Range to the anchor (cm)
+ *                  u32StdDevCm     R   Standard deviation of the range
+ *
+ * RETURNS:
+ * TRUE if the range was used. FALSE if it was rejected, or if there is no
+ * track to apply it to, which bValid then shows.
+ *
+ ****************************************************************************/
+PUBLIC bool_t bPosTrackRange(tsPosTrack *psTrack, uint32 u32NowMs, const tsMultilatPoint *psAnchor,
+                             int32 i32RangeCm, uint32 u32StdDevCm)
+{
+    int32 ai32Anchor[MULTILAT_AXES];
+    int32 ai32Unit[MULTILAT_AXES];
+    int64 ai64G[POS_TRACK_STATES];
+    int64 ai64K[POS_TRACK_STATES];
+    uint8 u8Dims = psTrack->u8Dims;
+    uint8 u8States = 2 * u8Dims;
+    uint32 u32DtMs;
+    uint32 u32Dist;
+    int64 i64S;
+    int64 i64Innovation;
+    uint8 i, j;
+
+    if (!bElapsedMs(psTrack, u32NowMs, &u32DtMs))
+    {
+        psTrack->bValid = FALSE;
+        return FALSE;
+    }
+
+    vPredict(psTrack, u32DtMs);
+    if (u32DtMs > 0)
+    {
+        psTrack->u32LastMs = u32NowMs;
+    }
+
+    for (i = 0; i < MULTILAT_AXES; i++)
+    {
+        ai32Anchor[i] = (i < u8Dims) ? psAnchor->ai32Cm[i] * MM_PER_CM : 0;
+    }
+    u32Dist = u32FixedDist(psTrack->ai32X, ai32Anchor, u8Dims);
+    if (u32Dist == 0)
+    {
+        /* No direction to linearise about */
+        return FALSE;
+    }
+
+    for (i = 0; i < u8Dims; i++)
+    {
+        ai32Unit[i] = (int32)(((int64)(psTrack->ai32X[i] - ai32Anchor[i]) << UNIT_SHIFT) /
+                              (int64)u32Dist);
+    }
+
+    /* g = P H' */
+    for (i = 0; i < u8States; i++)
+    {
+        ai64G[i] = 0;
+        for (j = 0; j < u8Dims; j++)
+        {
+            ai64G[i] += psTrack->ai64P[i][j] * ai32Unit[j];
+        }
+        ai64G[i] = FIXED_DIV_ROUND(ai64G[i], 1LL << UNIT_SHIFT);
+    }
+
+    /* Innovation and its variance */
+    i64S = 0;
+    for (j = 0; j < u8Dims; j++)
+    {
+        i64S += ai64G[j] * ai32Unit[j];
+    }
+    i64S = (i64S >> UNIT_SHIFT) + i64Variance(u32StdDevCm);
+    if (i64S < POS_TRACK_MIN_VAR)
+    {
+        i64S = POS_TRACK_MIN_VAR;
+    }
+    i64Innovation = (int64)i32RangeCm * MM_PER_CM - u32Dist;
+
+    if ((uint64)(i64Innovation * i64Innovation) >
+        (uint64)POS_TRACK_GATE_SIGMA * POS_TRACK_GATE_SIGMA * (uint64)i64S)
+    {
+        if (++psTrack->u8Misses >= POS_TRACK_MAX_MISSES)
+        {
+            psTrack->bValid = FALSE;
+        }
+        return FALSE;
+    }
+    psTrack->u8Misses = 0;
+
+    for (i = 0; i < u8States; i++)
+    {
+        ai64K[i] = (ai64G[i] * GAIN_ONE) / i64S;
+        psTrack->ai32X[i] += (int32)FIXED_DIV_ROUND(ai64K[i] * i64Innovation, GAIN_ONE);
+    }
+
+    /* P = P - g K', kept symmetric */
+    for (i = 0; i < u8States; i++)
+    {
+        for (j = i; j < u8States; j++)
+        {
+            psTrack->ai64P[i][j] -= (ai64G[i] * ai64K[j]) / GAIN_ONE;
+            psTrack->ai64P[j][i]  = psTrack->ai64P[i][j];
+        }
+        if (psTrack->ai64P[i][i] < 1)
+        {
+            psTrack->ai64P[i][i] = 1;
+        }
+    }
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: bPosTrackPredict
+ *
+ * DESCRIPTION:
+ * Position and velocity the track predicts at a given time. The track is
+ * not changed.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTrack         R   Track
+ *                  u32NowMs        R   Time of the prediction (ms)
+ *                  psPos           W   Position (cm)
+ *                  psVel           W   Velocity (cm/s), may be NULL
+ *
+ * RETURNS:
+ * FALSE if there is no usable track
+ *
+ ****************************************************************************/
+PUBLIC bool_t bPosTrackPredict(tsPosTrack *psTrack, uint32 u32NowMs,
+                               tsMultilatPoint *psPos, tsMultilatPoint *psVel)
+{
+    uint32 u32DtMs;
+    int32 i32Pos;
+    uint8 i;
+
+    if (!bElapsedMs(psTrack, u32NowMs, &u32DtMs))
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < MULTILAT_AXES; i++)
+    {
+        psPos->ai32Cm[i] = 0;
+        if (psVel != NULL)
+        {
+            psVel->ai32Cm[i] = 0;
+        }
+    }
+
+    for (i = 0; i < psTrack->u8Dims; i++)
+    {
+        i32Pos = psTrack->ai32X[i] +
+                 (int32)FIXED_DIV_ROUND((int64)psTrack->ai32X[psTrack->u8Dims + i] * u32DtMs, 1000);
+        psPos->ai32Cm[i] = FIXED_DIV_ROUND(i32Pos, MM_PER_CM);
+        if (psVel != NULL)
+        {
+            psVel->ai32Cm[i] = FIXED_DIV_ROUND(psTrack->ai32X[psTrack->u8Dims + i], MM_PER_CM);
+        }
+    }
+
+    return TRUE;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: bElapsedMs
+ *
+ * DESCRIPTION:
+ * Time since the track was last updated, if the track is still usable.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTrack         R   Track
+ *                  u32NowMs        R   Current time (ms)
+ *                  pu32DtMs        W   Elapsed time (ms)
+ *
+ * RETURNS: bool_t FALSE if there is no track or it has gone stale
+ *
+ ****************************************************************************/
+PRIVATE bool_t bElapsedMs(tsPosTrack *psTrack, uint32 u32NowMs, uint32 *pu32DtMs)
+{
+    int32 i32Dt = (int32)(u32NowMs - psTrack->u32LastMs);
+
+    if (!psTrack->bValid || (i32Dt > POS_TRACK_MAX_GAP_MS))
+    {
+        return FALSE;
+    }
+
+    /* Ranges may be handled slightly out of order, treat as simultaneous */
+    *pu32DtMs = (i32Dt > 0) ? (uint32)i32Dt : 0;
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: vPredict
+ *
+ * DESCRIPTION:
+ * Constant velocity prediction, axis by axis as in toftrack.c. Each d x d
+ * block of P is updated from the four blocks at the same place, with white
+ * acceleration of density q adding q dt^3/3, q dt^2/2 and q dt on the
+ * diagonal. dt is in ms, so each power of dt is scaled by 1000.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTrack         RW  Track
+ *                  u32DtMs         R   Prediction interval (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vPredict(tsPosTrack *psTrack, uint32 u32DtMs)
+{
+    int64 i64Dt = u32DtMs;
+    int64 i64Q  = (POS_TRACK_ACCEL_NOISE * i64Dt) / 1000;
+    int64 i64PP, i64PV, i64VP, i64VV;
+    uint8 d = psTrack->u8Dims;
+    uint8 i, j;
+
+    if (u32DtMs == 0)
+    {
+        return;
+    }
+
+    for (i = 0; i < d; i++)
+    {
+        psTrack->ai32X[i] += (int32)FIXED_DIV_ROUND((int64)psTrack->ai32X[d + i] * i64Dt, 1000);
+    }
+
+    for (i = 0; i < d; i++)
+    {
+        for (j = 0; j < d; j++)
+        {
+            i64PP = psTrack->ai64P[i][j];
+            i64PV = psTrack->ai64P[i][d + j];
+            i64VP = psTrack->ai64P[d + i][j];
+            i64VV = psTrack->ai64P[d + i][d + j];
+
+            psTrack->ai64P[i][j]         = i64PP + ((i64PV + i64VP) * i64Dt) / 1000 +
+                                           (i64VV * i64Dt * i64Dt) / 1000000;
+            psTrack->ai64P[i][d + j]     = i64PV + (i64VV * i64Dt) / 1000;
+            psTrack->ai64P[d + i][j]     = i64VP + (i64VV * i64Dt) / 1000;
+
+            if (i == j)
+            {
+                psTrack->ai64P[i][j]     += ((i64Q * i64Dt) / 1000 * i64Dt) / 3000;
+                psTrack->ai64P[i][d + j] += (i64Q * i64Dt) / 2000;
+                psTrack->ai64P[d + i][j] += (i64Q * i64Dt) / 2000;
+                psTrack->ai64P[d + i][d + j] = i64VV + i64Q;
+            }
+        }
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: i64Variance
+ *
+ * DESCRIPTION:
+ * Variance in mm^2 of a standard deviation in cm, floored.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32StdDevCm     R   Standard deviation (cm)
+ *
+ * RETURNS: int64 variance (mm^2)
+ *
+ ****************************************************************************/
+PRIVATE int64 i64Variance(uint32 u32StdDevCm)
+{
+    int64 i64StdDevMm = (int64)u32StdDevCm * MM_PER_CM;
+    int64 i64Var      = i64StdDevMm * i64StdDevMm;
+
+    return (i64Var < POS_TRACK_MIN_VAR) ? POS_TRACK_MIN_VAR : i64Var;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,90 @@
+/****************************************************************************
+ *
+ * MODULE:      postrack.h
+ *
+ * DESCRIPTION:
+ * Fixed point extended Kalman filter tracking the position of a target,
+ * and its velocity, from ranges to anchors at known positions. Each range
+ * is applied on its own at the time it arrives, so reports from different
+ * anchors need not line up, and the track is predicted forward between
+ * them so position can be output at a steady rate.
+ *
+ * A track is started from a multilateration fix. It is dropped when no
+ * range has been applied for POS_TRACK_MAX_GAP_MS, or after
+ * POS_TRACK_MAX_MISSES ranges in a row fall outside the gate, and must
+ * then be started again.
+ *
+ ****************************************************************************/
+
+#ifndef  POSTRACK_H_INCLUDED
+#define  POSTRACK_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "multilat.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Position then velocity for each axis */
+#define POS_TRACK_STATES            (2 * MULTILAT_AXES)
+
+/* Process noise: spectral density of the random acceleration of the target
+   on each axis (mm^2/s^3). 1e6 allows roughly 1 m/s^2 of unmodelled
+   acceleration, as for a person walking. */
+#define POS_TRACK_ACCEL_NOISE       1000000LL
+
+/* Variance given to the velocity when a track starts ((mm/s)^2) */
+#define POS_TRACK_INIT_VEL_VAR      1000000LL
+
+/* Floor on the variance of a range or start position (mm^2) */
+#define POS_TRACK_MIN_VAR           2500LL
+
+/* A track not updated for this long is dropped */
+#define POS_TRACK_MAX_GAP_MS        5000
+
+/* Ranges further than this many standard deviations from the prediction
+   are rejected */
+#define POS_TRACK_GATE_SIGMA        4
+#define POS_TRACK_MAX_MISSES        6
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+typedef struct
+{
+    bool_t  bValid;             /* Track has been started */
+    uint8   u8Dims;             /* Axes tracked */
+    uint8   u8Misses;           /* Consecutive ranges rejected by the gate */
+    uint32  u32LastMs;          /* Time of the state below */
+    int32   ai32X[POS_TRACK_STATES];    /* Position (mm), then velocity (mm/s) */
+    int64   ai64P[POS_TRACK_STATES][POS_TRACK_STATES];
+} tsPosTrack;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC void   vPosTrackReset(tsPosTrack *psTrack);
+PUBLIC void   vPosTrackStart(tsPosTrack *psTrack, uint8 u8Dims, uint32 u32NowMs,
+                             tsMultilatPoint *psPos, uint32 u32StdDevCm);
+PUBLIC bool_t bPosTrackRange(tsPosTrack *psTrack, uint32 u32NowMs, const tsMultilatPoint *psAnchor,
+                             int32 i32RangeCm, uint32 u32StdDevCm);
+PUBLIC bool_t bPosTrackPredict(tsPosTrack *psTrack, uint32 u32NowMs,
+                               tsMultilatPoint *psPos, tsMultilatPoint *psVel);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* POSTRACK_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
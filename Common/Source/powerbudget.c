@@ -0,0 +1,165 @@
+/****************************************************************************
+ *
+ * MODULE:      powerbudget.c
+ *
+ * DESCRIPTION:
+ * Estimate of a node's current draw, see powerbudget.h.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "powerbudget.h"
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vPowerBudgetInit
+ *
+ * DESCRIPTION:
+ * Clears the time accumulated in each state and starts in the active state.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psBudget        W   Budget
+ *                  bHighPowerModule R  TRUE on a high power module
+ *                  u32NowMs        R   Current time (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vPowerBudgetInit(tsPowerBudget *psBudget, bool_t bHighPowerModule, uint32 u32NowMs)
+{
+    uint8 n;
+
+    psBudget->eState           = E_POWER_STATE_ACTIVE;
+    psBudget->u32EnteredMs     = u32NowMs;
+    psBudget->bHighPowerModule = bHighPowerModule;
+
+    for (n = 0; n < E_POWER_STATES; n++)
+    {
+        psBudget->au32Ms[n] = 0;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: vPowerBudgetEnter
+ *
+ * DESCRIPTION:
+ * Charges the time since the last call to the state being left, so the
+ * current state may be entered again to bring the totals up to date.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psBudget        RW  Budget
+ *                  eState          R   State entered
+ *                  u32NowMs        R   Current time (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vPowerBudgetEnter(tsPowerBudget *psBudget, tePowerState eState, uint32 u32NowMs)
+{
+    psBudget->au32Ms[psBudget->eState] += u32NowMs - psBudget->u32EnteredMs;
+    psBudget->eState       = eState;
+    psBudget->u32EnteredMs = u32NowMs;
+}
+
+/****************************************************************************
+ *
+ * NAME: u32PowerBudgetStateUa
+ *
+ * DESCRIPTION:
+ * Typical current in a state.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psBudget        R   Budget
+ *                  eState          R   State
+ *
+ * RETURNS:
+ * Current (uA)
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32PowerBudgetStateUa(tsPowerBudget *psBudget, tePowerState eState)
+{
+    switch (eState)
+    {
+    case E_POWER_STATE_ACTIVE:
+        return POWER_UA_ACTIVE + (psBudget->bHighPowerModule ? POWER_UA_HPM_ACTIVE : 0);
+    case E_POWER_STATE_IDLE:
+        return POWER_UA_IDLE;
+    case E_POWER_STATE_DOZE:
+        return POWER_UA_DOZE;
+    default:
+        return POWER_UA_SLEEP;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: u32PowerBudgetAverageUa
+ *
+ * DESCRIPTION:
+ * Average current over the time accumulated so far.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psBudget        R   Budget
+ *
+ * RETURNS:
+ * Current (uA), 0 if no time has been accumulated
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32PowerBudgetAverageUa(tsPowerBudget *psBudget)
+{
+    uint64 u64Charge = 0;
+    uint32 u32TotalMs = 0;
+    uint8 n;
+
+    for (n = 0; n < E_POWER_STATES; n++)
+    {
+        u64Charge  += (uint64)psBudget->au32Ms[n] * u32PowerBudgetStateUa(psBudget, (tePowerState)n);
+        u32TotalMs += psBudget->au32Ms[n];
+    }
+
+    if (u32TotalMs == 0)
+    {
+        return 0;
+    }
+
+    return (uint32)(u64Charge / u32TotalMs);
+}
+
+/****************************************************************************
+ *
+ * NAME: u32PowerBudgetLifeHours
+ *
+ * DESCRIPTION:
+ * Battery life at the average current so far.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psBudget        R   Budget
+ *                  u32CapacityMah  R   Battery capacity (mAh)
+ *
+ * RETURNS:
+ * Life (hours), 0 if no time has been accumulated
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32PowerBudgetLifeHours(tsPowerBudget *psBudget, uint32 u32CapacityMah)
+{
+    uint32 u32AverageUa = u32PowerBudgetAverageUa(psBudget);
+
+    if (u32AverageUa == 0)
+    {
+        return 0;
+    }
+
+    return (uint32)(((uint64)u32CapacityMah * 1000) / u32AverageUa);
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
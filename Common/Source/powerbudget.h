@@ -0,0 +1,79 @@
+/****************************************************************************
+ *
+ * MODULE:      powerbudget.h
+ *
+ * DESCRIPTION:
+ * Estimate of a battery powered node's current draw. The time spent in
+ * each power state is accumulated, and weighted by a typical current for
+ * the state to give the average current and battery life. The currents
+ * are approximate JN5148 module data sheet figures, not measurements, and
+ * should be replaced by figures measured on the board where they matter.
+ *
+ ****************************************************************************/
+
+#ifndef  POWERBUDGET_H_INCLUDED
+#define  POWERBUDGET_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Typical current (uA) in each state for a standard module. Active is
+   taken as mostly receiving, as during a burst or with the receiver on
+   when idle. */
+#define POWER_UA_ACTIVE             23000
+#define POWER_UA_IDLE               5500
+#define POWER_UA_DOZE               1000
+#define POWER_UA_SLEEP              3
+
+/* Extra current (uA) drawn while active by the LNA and PA of a high power
+   module */
+#define POWER_UA_HPM_ACTIVE         12000
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+typedef enum
+{
+    E_POWER_STATE_ACTIVE,       /* CPU running, radio in use */
+    E_POWER_STATE_IDLE,         /* CPU running, receiver off */
+    E_POWER_STATE_DOZE,         /* CPU stopped, woken by any interrupt */
+    E_POWER_STATE_SLEEP,        /* Sleeping on the wake timer, RAM held */
+    E_POWER_STATES
+} tePowerState;
+
+typedef struct
+{
+    tePowerState eState;
+    uint32  u32EnteredMs;       /* Time the current state was entered */
+    bool_t  bHighPowerModule;
+    uint32  au32Ms[E_POWER_STATES];
+} tsPowerBudget;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC void   vPowerBudgetInit(tsPowerBudget *psBudget, bool_t bHighPowerModule, uint32 u32NowMs);
+PUBLIC void   vPowerBudgetEnter(tsPowerBudget *psBudget, tePowerState eState, uint32 u32NowMs);
+PUBLIC uint32 u32PowerBudgetStateUa(tsPowerBudget *psBudget, tePowerState eState);
+PUBLIC uint32 u32PowerBudgetAverageUa(tsPowerBudget *psBudget);
+PUBLIC uint32 u32PowerBudgetLifeHours(tsPowerBudget *psBudget, uint32 u32CapacityMah);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* POWERBUDGET_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
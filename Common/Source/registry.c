@@ -0,0 +1,440 @@
+/****************************************************************************
+ *
+ * MODULE:      registry.c
+ *
+ * DESCRIPTION:
+ * Coordinator's registry of associated end devices, see registry.h.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "config.h"
+#include "registry.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+#define REGISTRY_WORDS              ((REGISTRY_SLOTS + 31) / 32)
+#define REGISTRY_HASH_MASK          (REGISTRY_HASH_SIZE - 1)
+
+/* Fibonacci hashing multiplier, 2^32 / golden ratio */
+#define REGISTRY_HASH_MULTIPLIER    0x9e3779b1UL
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE uint16 u16Hash(uint32 u32ExtAdrH, uint32 u32ExtAdrL);
+PRIVATE uint16 u16FreeSlot(void);
+PRIVATE void vOccupy(uint16 u16Slot, uint32 u32ExtAdrH, uint32 u32ExtAdrL);
+PRIVATE void vHashRemove(uint16 u16Slot);
+
+/****************************************************************************/
+/***        Local Variables                                               ***/
+/****************************************************************************/
+PRIVATE uint32 au32InUse[REGISTRY_WORDS];
+PRIVATE uint32 au32ExtAdrH[REGISTRY_SLOTS];
+PRIVATE uint32 au32ExtAdrL[REGISTRY_SLOTS];
+PRIVATE uint16 au16Hash[REGISTRY_HASH_SIZE];    /* Slot, or REGISTRY_NO_SLOT */
+PRIVATE uint16 u16Count;
+PRIVATE uint16 u16Limit;                        /* One past the highest slot in use */
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vRegistryInit
+ *
+ * DESCRIPTION:
+ * Empties the registry.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vRegistryInit(void)
+{
+    uint16 n;
+
+    for (n = 0; n < REGISTRY_WORDS; n++)
+    {
+        au32InUse[n] = 0;
+    }
+    for (n = 0; n < REGISTRY_HASH_SIZE; n++)
+    {
+        au16Hash[n] = REGISTRY_NO_SLOT;
+    }
+    u16Count = 0;
+    u16Limit = 0;
+}
+
+/****************************************************************************
+ *
+ * NAME: u16RegistryAdd
+ *
+ * DESCRIPTION:
+ * Registers an associating device. A device already registered keeps its
+ * slot; a new one takes the lowest free slot.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32ExtAdrH      R   Extended address, high word
+ *                  u32ExtAdrL      R   Extended address, low word
+ *                  pbKnown         W   TRUE if the device was registered
+ *
+ * RETURNS: uint16 slot, REGISTRY_NO_SLOT if the registry is full
+ *
+ ****************************************************************************/
+PUBLIC uint16 u16RegistryAdd(uint32 u32ExtAdrH, uint32 u32ExtAdrL, bool_t *pbKnown)
+{
+    uint16 u16Slot;
+
+    u16Slot  = u16RegistryFindExt(u32ExtAdrH, u32ExtAdrL);
+    *pbKnown = (u16Slot != REGISTRY_NO_SLOT);
+    if (*pbKnown)
+    {
+        return u16Slot;
+    }
+
+    u16Slot = u16FreeSlot();
+    if (u16Slot != REGISTRY_NO_SLOT)
+    {
+        vOccupy(u16Slot, u32ExtAdrH, u32ExtAdrL);
+    }
+
+    return u16Slot;
+}
+
+/****************************************************************************
+ *
+ * NAME: u16RegistryRestore
+ *
+ * DESCRIPTION:
+ * Registers a device with the short address it held before a restart.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32ExtAdrH      R   Extended address, high word
+ *                  u32ExtAdrL      R   Extended address, low word
+ *                  u16ShortAdr     R   Short address
+ *
+ * RETURNS: uint16 slot, REGISTRY_NO_SLOT if the address is out of range or
+ *          either address is already registered
+ *
+ ****************************************************************************/
+PUBLIC uint16 u16RegistryRestore(uint32 u32ExtAdrH, uint32 u32ExtAdrL, uint16 u16ShortAdr)
+{
+    uint16 u16Slot = u16ShortAdr - END_DEVICE_START_ADR;
+
+    if ((u16Slot >= REGISTRY_SLOTS) || bRegistryInUse(u16Slot) ||
+        (u16RegistryFindExt(u32ExtAdrH, u32ExtAdrL) != REGISTRY_NO_SLOT))
+    {
+        return REGISTRY_NO_SLOT;
+    }
+
+    vOccupy(u16Slot, u32ExtAdrH, u32ExtAdrL);
+
+    return u16Slot;
+}
+
+/****************************************************************************
+ *
+ * NAME: vRegistryRemove
+ *
+ * DESCRIPTION:
+ * Frees the slot of a device that has left.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16Slot         R   Slot
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vRegistryRemove(uint16 u16Slot)
+{
+    if (!bRegistryInUse(u16Slot))
+    {
+        return;
+    }
+
+    vHashRemove(u16Slot);
+    au32InUse[u16Slot / 32] &= ~(1UL << (u16Slot % 32));
+    u16Count--;
+
+    while ((u16Limit > 0) && !bRegistryInUse(u16Limit - 1))
+    {
+        u16Limit--;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: u16RegistryFindShort
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16ShortAdr     R   Short address
+ *
+ * RETURNS: uint16 slot of the device, REGISTRY_NO_SLOT if not registered
+ *
+ ****************************************************************************/
+PUBLIC uint16 u16RegistryFindShort(uint16 u16ShortAdr)
+{
+    uint16 u16Slot = u16ShortAdr - END_DEVICE_START_ADR;
+
+    return bRegistryInUse(u16Slot) ? u16Slot : REGISTRY_NO_SLOT;
+}
+
+/****************************************************************************
+ *
+ * NAME: u16RegistryFindExt
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32ExtAdrH      R   Extended address, high word
+ *                  u32ExtAdrL      R   Extended address, low word
+ *
+ * RETURNS: uint16 slot of the device, REGISTRY_NO_SLOT if not registered
+ *
+ ****************************************************************************/
+PUBLIC uint16 u16RegistryFindExt(uint32 u32ExtAdrH, uint32 u32ExtAdrL)
+{
+    uint16 i = u16Hash(u32ExtAdrH, u32ExtAdrL);
+    uint16 u16Slot;
+
+    while ((u16Slot = au16Hash[i]) != REGISTRY_NO_SLOT)
+    {
+        if ((au32ExtAdrL[u16Slot] == u32ExtAdrL) && (au32ExtAdrH[u16Slot] == u32ExtAdrH))
+        {
+            return u16Slot;
+        }
+        i = (i + 1) & REGISTRY_HASH_MASK;
+    }
+
+    return REGISTRY_NO_SLOT;
+}
+
+/****************************************************************************
+ *
+ * NAME: bRegistryInUse
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16Slot         R   Slot
+ *
+ * RETURNS: bool_t TRUE if a device occupies the slot
+ *
+ ****************************************************************************/
+PUBLIC bool_t bRegistryInUse(uint16 u16Slot)
+{
+    return (u16Slot < REGISTRY_SLOTS) &&
+           ((au32InUse[u16Slot / 32] >> (u16Slot % 32)) & 1);
+}
+
+/****************************************************************************
+ *
+ * NAME: u16RegistryShortAdr
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16Slot         R   Slot
+ *
+ * RETURNS: uint16 short address of the device in the slot
+ *
+ ****************************************************************************/
+PUBLIC uint16 u16RegistryShortAdr(uint16 u16Slot)
+{
+    return END_DEVICE_START_ADR + u16Slot;
+}
+
+/****************************************************************************
+ *
+ * NAME: u32RegistryExtAdrH
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16Slot         R   Slot in use
+ *
+ * RETURNS: uint32 high word of the extended address of the device
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32RegistryExtAdrH(uint16 u16Slot)
+{
+    return au32ExtAdrH[u16Slot];
+}
+
+/****************************************************************************
+ *
+ * NAME: u32RegistryExtAdrL
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16Slot         R   Slot in use
+ *
+ * RETURNS: uint32 low word of the extended address of the device
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32RegistryExtAdrL(uint16 u16Slot)
+{
+    return au32ExtAdrL[u16Slot];
+}
+
+/****************************************************************************
+ *
+ * NAME: u16RegistryCount
+ *
+ * RETURNS: uint16 devices registered
+ *
+ ****************************************************************************/
+PUBLIC uint16 u16RegistryCount(void)
+{
+    return u16Count;
+}
+
+/****************************************************************************
+ *
+ * NAME: u16RegistryLimit
+ *
+ * RETURNS: uint16 one past the highest slot in use, bounding a scan of the
+ *          registry
+ *
+ ****************************************************************************/
+PUBLIC uint16 u16RegistryLimit(void)
+{
+    return u16Limit;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: u16Hash
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32ExtAdrH      R   Extended address, high word
+ *                  u32ExtAdrL      R   Extended address, low word
+ *
+ * RETURNS: uint16 home position of the address in the hash table
+ *
+ ****************************************************************************/
+PRIVATE uint16 u16Hash(uint32 u32ExtAdrH, uint32 u32ExtAdrL)
+{
+    uint32 u32Mix = (u32ExtAdrL ^ (u32ExtAdrH * REGISTRY_HASH_MULTIPLIER)) * REGISTRY_HASH_MULTIPLIER;
+
+    return (uint16)(u32Mix >> (32 - REGISTRY_HASH_BITS));
+}
+
+/****************************************************************************
+ *
+ * NAME: u16FreeSlot
+ *
+ * RETURNS: uint16 lowest free slot, REGISTRY_NO_SLOT if none
+ *
+ ****************************************************************************/
+PRIVATE uint16 u16FreeSlot(void)
+{
+    uint32 u32Free;
+    uint16 u16Slot;
+    uint16 w;
+
+    for (w = 0; w < REGISTRY_WORDS; w++)
+    {
+        u32Free = ~au32InUse[w];
+        if (u32Free != 0)
+        {
+            u16Slot = w * 32;
+            while ((u32Free & 1) == 0)
+            {
+                u32Free >>= 1;
+                u16Slot++;
+            }
+            return (u16Slot < REGISTRY_SLOTS) ? u16Slot : REGISTRY_NO_SLOT;
+        }
+    }
+
+    return REGISTRY_NO_SLOT;
+}
+
+/****************************************************************************
+ *
+ * NAME: vOccupy
+ *
+ * DESCRIPTION:
+ * Places a device in a free slot.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16Slot         R   Free slot
+ *                  u32ExtAdrH      R   Extended address, high word
+ *                  u32ExtAdrL      R   Extended address, low word
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vOccupy(uint16 u16Slot, uint32 u32ExtAdrH, uint32 u32ExtAdrL)
+{
+    uint16 i = u16Hash(u32ExtAdrH, u32ExtAdrL);
+
+    while (au16Hash[i] != REGISTRY_NO_SLOT)
+    {
+        i = (i + 1) & REGISTRY_HASH_MASK;
+    }
+    au16Hash[i] = u16Slot;
+
+    au32ExtAdrH[u16Slot] = u32ExtAdrH;
+    au32ExtAdrL[u16Slot] = u32ExtAdrL;
+    au32InUse[u16Slot / 32] |= 1UL << (u16Slot % 32);
+    u16Count++;
+
+    if (u16Slot >= u16Limit)
+    {
+        u16Limit = u16Slot + 1;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: vHashRemove
+ *
+ * DESCRIPTION:
+ * Removes a slot from the hash table, moving back any later entry of the
+ * same probe run so lookups need no tombstones.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16Slot         R   Slot in use
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vHashRemove(uint16 u16Slot)
+{
+    uint16 i = u16Hash(au32ExtAdrH[u16Slot], au32ExtAdrL[u16Slot]);
+    uint16 j;
+    uint16 k;
+
+    while (au16Hash[i] != u16Slot)
+    {
+        i = (i + 1) & REGISTRY_HASH_MASK;
+    }
+
+    j = i;
+    while (1)
+    {
+        j = (j + 1) & REGISTRY_HASH_MASK;
+        if (au16Hash[j] == REGISTRY_NO_SLOT)
+        {
+            break;
+        }
+
+        /* The entry at j may fill the gap at i unless its home lies
+           cyclically in (i, j] */
+        k = u16Hash(au32ExtAdrH[au16Hash[j]], au32ExtAdrL[au16Hash[j]]);
+        if ((i <= j) ? ((k <= i) || (k > j)) : ((k <= i) && (k > j)))
+        {
+            au16Hash[i] = au16Hash[j];
+            i = j;
+        }
+    }
+
+    au16Hash[i] = REGISTRY_NO_SLOT;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,70 @@
+/****************************************************************************
+ *
+ * MODULE:      registry.h
+ *
+ * DESCRIPTION:
+ * Coordinator's registry of associated end devices. Each device occupies a
+ * slot, and its short address is END_DEVICE_START_ADR plus the slot, so a
+ * short address is resolved by indexing. Extended addresses are resolved
+ * through an open addressed hash table. Both lookups take constant time.
+ *
+ * A device that reassociates keeps its slot, and a slot freed when a device
+ * leaves is reused by the next new device. New devices take the lowest free
+ * slot, which keeps the addresses in use, and so the TDMA slots, compact.
+ *
+ * Per-device data is kept by the caller in arrays indexed by slot.
+ *
+ ****************************************************************************/
+
+#ifndef  REGISTRY_H_INCLUDED
+#define  REGISTRY_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "config.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+#define REGISTRY_SLOTS              MAX_END_DEVICES
+#define REGISTRY_NO_SLOT            0xffff
+
+/* The extended address hash table is kept at most half full */
+#define REGISTRY_HASH_BITS          9
+#define REGISTRY_HASH_SIZE          (1 << REGISTRY_HASH_BITS)
+
+#if REGISTRY_HASH_SIZE < (2 * REGISTRY_SLOTS)
+#error "REGISTRY_HASH_BITS too small for MAX_END_DEVICES"
+#endif
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC void   vRegistryInit(void);
+PUBLIC uint16 u16RegistryAdd(uint32 u32ExtAdrH, uint32 u32ExtAdrL, bool_t *pbKnown);
+PUBLIC uint16 u16RegistryRestore(uint32 u32ExtAdrH, uint32 u32ExtAdrL, uint16 u16ShortAdr);
+PUBLIC void   vRegistryRemove(uint16 u16Slot);
+PUBLIC uint16 u16RegistryFindShort(uint16 u16ShortAdr);
+PUBLIC uint16 u16RegistryFindExt(uint32 u32ExtAdrH, uint32 u32ExtAdrL);
+PUBLIC bool_t bRegistryInUse(uint16 u16Slot);
+PUBLIC uint16 u16RegistryShortAdr(uint16 u16Slot);
+PUBLIC uint32 u32RegistryExtAdrH(uint16 u16Slot);
+PUBLIC uint32 u32RegistryExtAdrL(uint16 u16Slot);
+PUBLIC uint16 u16RegistryCount(void);
+PUBLIC uint16 u16RegistryLimit(void);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* REGISTRY_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,393 @@
+/****************************************************************************
+ *
+ * MODULE:      report.c
+ *
+ * DESCRIPTION:
+ * Encoding and decoding of the versioned ranging report, see report.h.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "report.h"
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE uint8 *pu8PutU16(uint8 *pu8Out, uint16 u16Value);
+PRIVATE uint8 *pu8PutU32(uint8 *pu8Out, uint32 u32Value);
+PRIVATE uint16 u16GetU16(uint8 *pu8In);
+PRIVATE uint32 u32GetU32(uint8 *pu8In);
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vReportReset
+ *
+ * DESCRIPTION:
+ * Empties a report.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psReport        W   Report
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vReportReset(tsReport *psReport)
+{
+    psReport->u8Count = 0;
+}
+
+/****************************************************************************
+ *
+ * NAME: bReportAdd
+ *
+ * DESCRIPTION:
+ * Appends a measurement. Fails if the report is full or the measurement is
+ * too far from the first for its timestamp offset to be encoded, in which
+ * case the report should be sent and the measurement added to a new one.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psReport        RW  Report
+ *                  psMeasurement   R   Measurement to add
+ *
+ * RETURNS: bool_t TRUE if added
+ *
+ ****************************************************************************/
+PUBLIC bool_t bReportAdd(tsReport *psReport, tsReportMeasurement *psMeasurement)
+{
+    if (psReport->u8Count >= REPORT_MAX_MEASUREMENTS)
+    {
+        return FALSE;
+    }
+
+    if ((psReport->u8Count > 0) &&
+        ((psMeasurement->u32TimestampMs - psReport->asMeasurement[0].u32TimestampMs) > 0xffffUL))
+    {
+        return FALSE;
+    }
+
+    psReport->asMeasurement[psReport->u8Count++] = *psMeasurement;
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: u8ReportEncode
+ *
+ * DESCRIPTION:
+ * Encodes a report, opcode first, into a frame payload.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psReport        R   Report
+ *                  pu8Buffer       W   Payload
+ *                  u8Size          R   Space available in the payload
+ *
+ * RETURNS: uint8 bytes written, 0 if the report is empty or does not fit
+ *
+ ****************************************************************************/
+PUBLIC uint8 u8ReportEncode(tsReport *psReport, uint8 *pu8Buffer, uint8 u8Size)
+{
+    tsReportMeasurement *psMeasurement;
+    uint32 u32BaseMs;
+    uint8 *pu8Out = pu8Buffer;
+    uint8 u8Len;
+    uint8 n;
+
+    u8Len = REPORT_HEADER_LEN + psReport->u8Count * REPORT_RECORD_LEN;
+    if ((psReport->u8Count == 0) || (u8Len > u8Size))
+    {
+        return 0;
+    }
+
+    u32BaseMs = psReport->asMeasurement[0].u32TimestampMs;
+
+    *pu8Out++ = REPORT_OPCODE;
+    *pu8Out++ = REPORT_VERSION;
+    *pu8Out++ = psReport->u8Count;
+    *pu8Out++ = REPORT_RECORD_LEN;
+    pu8Out    = pu8PutU32(pu8Out, u32BaseMs);
+
+    for (n = 0; n < psReport->u8Count; n++)
+    {
+        psMeasurement = &psReport->asMeasurement[n];
+
+        pu8Out    = pu8PutU16(pu8Out, (uint16)(psMeasurement->u32TimestampMs - u32BaseMs));
+        pu8Out    = pu8PutU32(pu8Out, (uint32)psMeasurement->i32TofDistance);
+        pu8Out    = pu8PutU16(pu8Out, psMeasurement->u16StdDev);
+        pu8Out    = pu8PutU16(pu8Out, psMeasurement->u16RssiDistance);
+        pu8Out    = pu8PutU16(pu8Out, (uint16)psMeasurement->i16Rate);
+        *pu8Out++ = psMeasurement->u8Used;
+        *pu8Out++ = psMeasurement->u8Errors;
+        *pu8Out++ = psMeasurement->u8Sqi;
+        *pu8Out++ = psMeasurement->u8Flags;
+        *pu8Out++ = psMeasurement->u8TxPower;
+        pu8Out    = pu8PutU16(pu8Out, psMeasurement->u16Target);
+    }
+
+    return u8Len;
+}
+
+/****************************************************************************
+ *
+ * NAME: bReportDecode
+ *
+ * DESCRIPTION:
+ * Decodes a report from a frame payload, opcode first. Records longer than
+ * this version's are accepted and their extra fields ignored, and records
+ * of earlier versions are accepted without the fields they lack.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Data         R   Payload
+ *                  u8Len           R   Payload length
+ *                  psReport        W   Decoded report
+ *
+ * RETURNS: bool_t FALSE if the payload is not a valid report
+ *
+ ****************************************************************************/
+PUBLIC bool_t bReportDecode(uint8 *pu8Data, uint8 u8Len, tsReport *psReport)
+{
+    tsReportMeasurement *psMeasurement;
+    uint32 u32BaseMs;
+    uint8 u8Count;
+    uint8 u8RecordLen;
+    uint8 *pu8In;
+    uint8 n;
+
+    vReportReset(psReport);
+
+    if ((u8Len < REPORT_HEADER_LEN) || (pu8Data[0] != REPORT_OPCODE) ||
+        (pu8Data[1] == 0))
+    {
+        return FALSE;
+    }
+
+    u8Count     = pu8Data[2];
+    u8RecordLen = pu8Data[3];
+    u32BaseMs   = u32GetU32(&pu8Data[4]);
+
+    if ((u8Count > REPORT_MAX_MEASUREMENTS) || (u8RecordLen < REPORT_RECORD_V1_LEN) ||
+        ((uint16)u8Count * u8RecordLen > (uint16)(u8Len - REPORT_HEADER_LEN)))
+    {
+        return FALSE;
+    }
+
+    for (n = 0; n < u8Count; n++)
+    {
+        pu8In         = &pu8Data[REPORT_HEADER_LEN + n * u8RecordLen];
+        psMeasurement = &psReport->asMeasurement[n];
+
+        psMeasurement->u32TimestampMs  = u32BaseMs + u16GetU16(&pu8In[0]);
+        psMeasurement->i32TofDistance  = (int32)u32GetU32(&pu8In[2]);
+        psMeasurement->u16StdDev       = u16GetU16(&pu8In[6]);
+        psMeasurement->u16RssiDistance = u16GetU16(&pu8In[8]);
+        psMeasurement->i16Rate         = (int16)u16GetU16(&pu8In[10]);
+        psMeasurement->u8Used          = pu8In[12];
+        psMeasurement->u8Errors        = pu8In[13];
+        psMeasurement->u8Sqi           = pu8In[14];
+        psMeasurement->u8Flags         = pu8In[15];
+        psMeasurement->u8TxPower       = (u8RecordLen >= REPORT_RECORD_V2_LEN) ?
+                                         pu8In[16] : REPORT_TX_POWER_UNKNOWN;
+        psMeasurement->u16Target       = (u8RecordLen >= REPORT_RECORD_LEN) ?
+                                         u16GetU16(&pu8In[17]) : COORDINATOR_ADR;
+    }
+    psReport->u8Count = u8Count;
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: u8ReportPeriodEncode
+ *
+ * DESCRIPTION:
+ * Encodes a ranging period command, opcode first.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Buf          W   Output, REPORT_PERIOD_CMD_LEN bytes
+ *                  u16PeriodMs     R   Time between a tag's bursts (ms)
+ *
+ * RETURNS: uint8 bytes written
+ *
+ ****************************************************************************/
+PUBLIC uint8 u8ReportPeriodEncode(uint8 *pu8Buf, uint16 u16PeriodMs)
+{
+    pu8Buf[0] = REPORT_PERIOD_OPCODE;
+    (void)pu8PutU16(&pu8Buf[1], u16PeriodMs);
+
+    return REPORT_PERIOD_CMD_LEN;
+}
+
+/****************************************************************************
+ *
+ * NAME: bReportPeriodDecode
+ *
+ * DESCRIPTION:
+ * Decodes a ranging period command, opcode first.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Data         R   Payload
+ *                  u8Len           R   Payload length
+ *                  pu16PeriodMs    W   Time between a tag's bursts (ms)
+ *
+ * RETURNS: bool_t FALSE if the payload is not a ranging period command
+ *
+ ****************************************************************************/
+PUBLIC bool_t bReportPeriodDecode(uint8 *pu8Data, uint8 u8Len, uint16 *pu16PeriodMs)
+{
+    if ((u8Len < REPORT_PERIOD_CMD_LEN) || (pu8Data[0] != REPORT_PERIOD_OPCODE))
+    {
+        return FALSE;
+    }
+
+    *pu16PeriodMs = u16GetU16(&pu8Data[1]);
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: u8ReportSurveyEncode
+ *
+ * DESCRIPTION:
+ * Encodes an anchor survey command, opcode first.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Buf          W   Output, REPORT_SURVEY_CMD_LEN bytes
+ *                  u8Anchors       R   Anchors taking part
+ *                  u16DurationMs   R   Time the survey runs for (ms)
+ *
+ * RETURNS: uint8 bytes written
+ *
+ ****************************************************************************/
+PUBLIC uint8 u8ReportSurveyEncode(uint8 *pu8Buf, uint8 u8Anchors, uint16 u16DurationMs)
+{
+    pu8Buf[0] = REPORT_SURVEY_OPCODE;
+    pu8Buf[1] = u8Anchors;
+    (void)pu8PutU16(&pu8Buf[2], u16DurationMs);
+
+    return REPORT_SURVEY_CMD_LEN;
+}
+
+/****************************************************************************
+ *
+ * NAME: bReportSurveyDecode
+ *
+ * DESCRIPTION:
+ * Decodes an anchor survey command, opcode first.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Data         R   Payload
+ *                  u8Len           R   Payload length
+ *                  pu8Anchors      W   Anchors taking part
+ *                  pu16DurationMs  W   Time the survey runs for (ms)
+ *
+ * RETURNS: bool_t FALSE if the payload is not an anchor survey command
+ *
+ ****************************************************************************/
+PUBLIC bool_t bReportSurveyDecode(uint8 *pu8Data, uint8 u8Len, uint8 *pu8Anchors,
+                                  uint16 *pu16DurationMs)
+{
+    if ((u8Len < REPORT_SURVEY_CMD_LEN) || (pu8Data[0] != REPORT_SURVEY_OPCODE))
+    {
+        return FALSE;
+    }
+
+    *pu8Anchors     = pu8Data[1];
+    *pu16DurationMs = u16GetU16(&pu8Data[2]);
+    return TRUE;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: pu8PutU16
+ *
+ * DESCRIPTION:
+ * Writes a 16 bit value big endian.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Out          W   Output
+ *                  u16Value        R   Value
+ *
+ * RETURNS: uint8 * next output byte
+ *
+ ****************************************************************************/
+PRIVATE uint8 *pu8PutU16(uint8 *pu8Out, uint16 u16Value)
+{
+    *pu8Out++ = (uint8)(u16Value >> 8);
+    *pu8Out++ = (uint8)(u16Value);
+    return pu8Out;
+}
+
+/****************************************************************************
+ *
+ * NAME: pu8PutU32
+ *
+ * DESCRIPTION:
+ * Writes a 32 bit value big endian.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Out          W   Output
+ *                  u32Value        R   Value
+ *
+ * RETURNS: uint8 * next output byte
+ *
+ ****************************************************************************/
+PRIVATE uint8 *pu8PutU32(uint8 *pu8Out, uint32 u32Value)
+{
+    *pu8Out++ = (uint8)(u32Value >> 24);
+    *pu8Out++ = (uint8)(u32Value >> 16);
+    *pu8Out++ = (uint8)(u32Value >> 8);
+    *pu8Out++ = (uint8)(u32Value);
+    return pu8Out;
+}
+
+/****************************************************************************
+ *
+ * NAME: u16GetU16
+ *
+ * DESCRIPTION:
+ * Reads a big endian 16 bit value.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8In           R   Input
+ *
+ * RETURNS: uint16 value
+ *
+ ****************************************************************************/
+PRIVATE uint16 u16GetU16(uint8 *pu8In)
+{
+    return (uint16)(((uint16)pu8In[0] << 8) | pu8In[1]);
+}
+
+/****************************************************************************
+ *
+ * NAME: u32GetU32
+ *
+ * DESCRIPTION:
+ * Reads a big endian 32 bit value.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8In           R   Input
+ *
+ * RETURNS: uint32 value
+ *
+ ****************************************************************************/
+PRIVATE uint32 u32GetU32(uint8 *pu8In)
+{
+    return ((uint32)pu8In[0] << 24) | ((uint32)pu8In[1] << 16) |
+           ((uint32)pu8In[2] << 8)  | (uint32)pu8In[3];
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,121 @@
+/****************************************************************************
+ *
+ * MODULE:      report.h
+ *
+ * DESCRIPTION:
+ * Versioned ranging report carrying several measurements in one MAC frame.
+ * Shared by the end device, which encodes reports, and the coordinator,
+ * which decodes them.
+ *
+ * Layout, all fields big endian:
+ *
+ *   Header       opcode (1) | version (1) | count (1) | record length (1) |
+ *                base timestamp ms (4)
+ *   Record x N   timestamp offset ms (2) | ToF distance cm (4) |
+ *                standard deviation cm (2) | RSSI distance cm (2) |
+ *                rate cm/s (2) | readings used (1) | errors (1) | SQI (1) |
+ *                flags (1) | transmit power level (1) | target address (2)
+ *
+ * The record length lets a decoder skip fields appended by later versions.
+ * Version 1 records end at the flags and decode with the power unknown,
+ * and version 2 records end at the power. Both were always ranged against
+ * the coordinator, and decode with it as the target.
+ *
+ * The coordinator sets the period at which tags range with a broadcast
+ * command: opcode (1) | period ms (2).
+ *
+ ****************************************************************************/
+
+#ifndef  REPORT_H_INCLUDED
+#define  REPORT_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "config.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+#define REPORT_OPCODE               0xd2
+#define REPORT_VERSION              3
+
+#define REPORT_HEADER_LEN           8
+#define REPORT_RECORD_LEN           19
+#define REPORT_RECORD_V1_LEN        16
+#define REPORT_RECORD_V2_LEN        17
+
+/* Measurements per frame. 8 + 5 x 19 bytes fits the MAC payload with room
+   for the application sequence number. */
+#define REPORT_MAX_MEASUREMENTS     5
+#define REPORT_MAX_LEN              (REPORT_HEADER_LEN + REPORT_MAX_MEASUREMENTS * REPORT_RECORD_LEN)
+
+/* Measurement flags */
+#define REPORT_FLAG_MODE_MASK       0x03    /* Ranging mode of the burst */
+#define REPORT_FLAG_REJECTED        0x04    /* Burst rejected by the track */
+
+/* Transmit power level of a version 1 record */
+#define REPORT_TX_POWER_UNKNOWN     0xff
+
+/* Ranging period command */
+#define REPORT_PERIOD_OPCODE        0xd4
+#define REPORT_PERIOD_CMD_LEN       3
+
+/* Anchor survey command: the first anchors range each other for the given
+   time, and other devices hold their bursts. A time of 0 ends a survey. */
+#define REPORT_SURVEY_OPCODE        0xd5
+#define REPORT_SURVEY_CMD_LEN       4
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/* One burst as reported */
+typedef struct
+{
+    uint32  u32TimestampMs;     /* Burst finish, sender's clock */
+    int32   i32TofDistance;     /* Filtered ToF distance (cm) */
+    uint16  u16StdDev;          /* Standard deviation of the distance (cm) */
+    uint16  u16RssiDistance;    /* RSSI distance (cm), saturated */
+    int16   i16Rate;            /* Rate of change of distance (cm/s) */
+    uint8   u8Used;             /* Readings used by the estimator */
+    uint8   u8Errors;           /* Readings that failed */
+    uint8   u8Sqi;              /* Mean SQI of the successful readings */
+    uint8   u8Flags;
+    uint8   u8TxPower;          /* Transmit power level of the burst */
+    uint16  u16Target;          /* Short address of the node ranged against */
+} tsReportMeasurement;
+
+typedef struct
+{
+    uint8   u8Count;
+    tsReportMeasurement asMeasurement[REPORT_MAX_MEASUREMENTS];
+} tsReport;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC void   vReportReset(tsReport *psReport);
+PUBLIC bool_t bReportAdd(tsReport *psReport, tsReportMeasurement *psMeasurement);
+PUBLIC uint8  u8ReportEncode(tsReport *psReport, uint8 *pu8Buffer, uint8 u8Size);
+PUBLIC bool_t bReportDecode(uint8 *pu8Data, uint8 u8Len, tsReport *psReport);
+PUBLIC uint8  u8ReportPeriodEncode(uint8 *pu8Buf, uint16 u16PeriodMs);
+PUBLIC bool_t bReportPeriodDecode(uint8 *pu8Data, uint8 u8Len, uint16 *pu16PeriodMs);
+PUBLIC uint8  u8ReportSurveyEncode(uint8 *pu8Buf, uint8 u8Anchors, uint16 u16DurationMs);
+PUBLIC bool_t bReportSurveyDecode(uint8 *pu8Data, uint8 u8Len, uint8 *pu8Anchors,
+                                  uint16 *pu16DurationMs);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* REPORT_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
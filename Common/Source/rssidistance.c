@@ -0,0 +1,66 @@
+/****************************************************************************
+ *
+ * MODULE:      rssidistance.c
+ *
+ * DESCRIPTION:
+ * Distance estimated from the RSSI of a ToF reading.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "rssidistance.h"
+
+/****************************************************************************/
+/***        Local Variables                                               ***/
+/****************************************************************************/
+/* RSSI to Distance (cm) lookup table. Generated from formula in JN-UG-3063 */
+PRIVATE const uint32 au32RSSIdistance[] = { 502377, 447744, 399052, 355656, 316979, 282508,
+        251785, 224404, 200000, 178250, 158866, 141589, 126191, 112468, 100237,
+        89337, 79621, 70963, 63246, 56368, 50238, 44774, 39905, 35566, 31698,
+        28251, 25179, 22440, 20000, 17825, 15887, 14159, 12619, 11247, 10024,
+        8934, 7962, 7096, 6325, 5637, 5024, 4477, 3991, 3557, 3170, 2825, 2518,
+        2244, 2000, 1783, 1589, 1416, 1262, 1125, 1002, 893, 796, 710, 632,
+        564, 502, 448, 399, 356, 317, 283, 252, 224, 200, 178, 159, 142, 126,
+        112, 100, 89, 80, 71, 63, 56, 50, 45, 40, 36, 32, 28, 25, 22, 20, 18,
+        16, 14, 13, 11, 10, 9, 8, 7, 6, 6, 5, 4, 4, 4, 3, 3, 3, 2, 2 };
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: u32RssiDistanceCm
+ *
+ * DESCRIPTION:
+ * Looks up the distance for an RSSI value. Values outside the table are
+ * clamped to its ends.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  s8Rssi          R   RSSI of a reading
+ *
+ * RETURNS: uint32 distance (cm)
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32RssiDistanceCm(int8 s8Rssi)
+{
+    uint8 u8Last = (uint8)(sizeof(au32RSSIdistance) / sizeof(au32RSSIdistance[0]) - 1);
+
+    if (s8Rssi < 0)
+    {
+        return au32RSSIdistance[0];
+    }
+    if ((uint8)s8Rssi > u8Last)
+    {
+        return au32RSSIdistance[u8Last];
+    }
+
+    return au32RSSIdistance[s8Rssi];
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,35 @@
+/****************************************************************************
+ *
+ * MODULE:      rssidistance.h
+ *
+ * DESCRIPTION:
+ * Distance estimated from the RSSI of a ToF reading.
+ *
+ ****************************************************************************/
+
+#ifndef  RSSIDISTANCE_H_INCLUDED
+#define  RSSIDISTANCE_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC uint32 u32RssiDistanceCm(int8 s8Rssi);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* RSSIDISTANCE_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
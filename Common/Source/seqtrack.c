@@ -0,0 +1,155 @@
+/****************************************************************************
+ *
+ * MODULE:      seqtrack.c
+ *
+ * DESCRIPTION:
+ * Receive side sequence number tracking, see seqtrack.h.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "seqtrack.h"
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE void vRestart(tsSeqTrack *psTrack, uint8 u8Seq);
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vSeqTrackReset
+ *
+ * DESCRIPTION:
+ * Forgets the sequence and clears the counters, for a new link.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTrack         W   Tracker
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vSeqTrackReset(tsSeqTrack *psTrack)
+{
+    psTrack->bValid         = FALSE;
+    psTrack->u8Highest      = 0;
+    psTrack->u32Seen        = 0;
+    psTrack->u8DuplicateRun = 0;
+    psTrack->u32Received    = 0;
+    psTrack->u32Lost        = 0;
+    psTrack->u32Duplicates  = 0;
+    psTrack->u32Reordered   = 0;
+    psTrack->u32Restarts    = 0;
+}
+
+/****************************************************************************
+ *
+ * NAME: eSeqTrackUpdate
+ *
+ * DESCRIPTION:
+ * Classifies a received frame by its sequence number and updates the
+ * counters. Frames skipped over are counted as lost at once, and taken
+ * off again if they turn up late.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTrack         RW  Tracker
+ *                  u8Seq           R   Sequence number of the frame
+ *                  pu8Missed       W   Frames found missing by this one
+ *
+ * RETURNS:
+ * Whether the frame is new, reordered or a duplicate
+ *
+ ****************************************************************************/
+PUBLIC teSeqResult eSeqTrackUpdate(tsSeqTrack *psTrack, uint8 u8Seq, uint8 *pu8Missed)
+{
+    int16 i16Ahead;
+    uint32 u32Bit;
+
+    *pu8Missed = 0;
+
+    i16Ahead = (int8)(u8Seq - psTrack->u8Highest);
+
+    if (!psTrack->bValid ||
+        (i16Ahead > SEQ_TRACK_WINDOW) || (i16Ahead <= -SEQ_TRACK_WINDOW))
+    {
+        vRestart(psTrack, u8Seq);
+        return E_SEQ_NEW;
+    }
+
+    if (i16Ahead > 0)
+    {
+        /* Slide the window up to the new frame */
+        *pu8Missed = (uint8)(i16Ahead - 1);
+        psTrack->u32Lost       += *pu8Missed;
+        psTrack->u32Seen        = (i16Ahead < SEQ_TRACK_WINDOW) ?
+                                  ((psTrack->u32Seen << i16Ahead) | 1) : 1;
+        psTrack->u8Highest      = u8Seq;
+        psTrack->u8DuplicateRun = 0;
+        psTrack->u32Received++;
+        return E_SEQ_NEW;
+    }
+
+    u32Bit = 1UL << (-i16Ahead);
+    if (psTrack->u32Seen & u32Bit)
+    {
+        if (++psTrack->u8DuplicateRun < SEQ_TRACK_MAX_DUPLICATES)
+        {
+            psTrack->u32Duplicates++;
+            return E_SEQ_DUPLICATE;
+        }
+        vRestart(psTrack, u8Seq);
+        return E_SEQ_NEW;
+    }
+
+    psTrack->u8DuplicateRun = 0;
+    psTrack->u32Seen |= u32Bit;
+    psTrack->u32Received++;
+    psTrack->u32Reordered++;
+    if (psTrack->u32Lost > 0)
+    {
+        psTrack->u32Lost--;
+    }
+    return E_SEQ_REORDERED;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vRestart
+ *
+ * DESCRIPTION:
+ * Starts tracking again from a frame, keeping the counters.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTrack         RW  Tracker
+ *                  u8Seq           R   Sequence number of the frame
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vRestart(tsSeqTrack *psTrack, uint8 u8Seq)
+{
+    if (psTrack->bValid)
+    {
+        psTrack->u32Restarts++;
+    }
+
+    psTrack->bValid         = TRUE;
+    psTrack->u8Highest      = u8Seq;
+    psTrack->u32Seen        = 1;
+    psTrack->u8DuplicateRun = 0;
+    psTrack->u32Received++;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,78 @@
+/****************************************************************************
+ *
+ * MODULE:      seqtrack.h
+ *
+ * DESCRIPTION:
+ * Receive side tracking of the application sequence number on one link.
+ * The last SEQ_TRACK_WINDOW sequence numbers are held in a bitmap behind
+ * the highest seen, so a frame can be told apart as new, a duplicate of
+ * one already received, or a late frame arriving out of order. Counters
+ * of each outcome, and of frames missing from the sequence, give the
+ * delivery rate of the link.
+ *
+ * Numbers wrap at 256. A frame more than SEQ_TRACK_WINDOW ahead of or
+ * behind the highest seen is taken as the sender having restarted its
+ * sequence, and tracking starts again from it. So is a run of
+ * SEQ_TRACK_MAX_DUPLICATES duplicates, longer than MAC retries can cause,
+ * for a sender that restarted just behind the highest seen.
+ *
+ ****************************************************************************/
+
+#ifndef  SEQTRACK_H_INCLUDED
+#define  SEQTRACK_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Width of the bitmap */
+#define SEQ_TRACK_WINDOW            32
+#define SEQ_TRACK_MAX_DUPLICATES    4
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+typedef enum
+{
+    E_SEQ_NEW,                  /* In order, or after a gap */
+    E_SEQ_REORDERED,            /* Missing until now, arrived late */
+    E_SEQ_DUPLICATE             /* Already received, to be discarded */
+} teSeqResult;
+
+typedef struct
+{
+    bool_t  bValid;             /* A frame has been received */
+    uint8   u8Highest;          /* Highest sequence number seen */
+    uint32  u32Seen;            /* Bit n set if u8Highest - n was received */
+    uint8   u8DuplicateRun;     /* Duplicates in a row */
+    uint32  u32Received;        /* Frames accepted, new or reordered */
+    uint32  u32Lost;            /* Frames missing from the sequence */
+    uint32  u32Duplicates;
+    uint32  u32Reordered;
+    uint32  u32Restarts;        /* Times the sequence was restarted */
+} tsSeqTrack;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC void        vSeqTrackReset(tsSeqTrack *psTrack);
+PUBLIC teSeqResult eSeqTrackUpdate(tsSeqTrack *psTrack, uint8 u8Seq, uint8 *pu8Missed);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* SEQTRACK_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,567 @@
+/****************************************************************************
+ *
+ * MODULE:      survey.c
+ *
+ * DESCRIPTION:
+ * Anchor positions from the anchors' ranges to each other, see survey.h.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "config.h"
+#include "fixedpoint.h"
+#include "multilat.h"
+#include "persist.h"
+#include "survey.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Journal records: sequence (1) | anchors (1) | anchor (1) | x, y, z (2 each) */
+#define SURVEY_RECORD_LEN           9
+
+/* Passes solving each anchor again against all the others */
+#define SURVEY_REFINE_PASSES        2
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE bool_t bPlace(int32 ai32Distance[MAX_ANCHORS][MAX_ANCHORS], tsMultilatPoint *pasAnchor,
+                      uint8 u8Anchor, uint8 u8Anchors, uint8 u8Dims);
+PRIVATE bool_t bPlaceAbove(int32 ai32Distance[MAX_ANCHORS][MAX_ANCHORS], tsMultilatPoint *pasAnchor,
+                           uint8 u8Anchor);
+PRIVATE bool_t bOpenLog(void);
+PRIVATE bool_t bReadGroup(uint16 u16Last, uint8 *pu8Anchors, tsMultilatPoint *pasAnchor);
+PRIVATE void vPutI16(uint8 *pu8Out, int32 i32Value);
+PRIVATE int32 i32GetI16(uint8 *pu8In);
+
+/****************************************************************************/
+/***        Local Variables                                               ***/
+/****************************************************************************/
+PRIVATE bool_t bOpen = FALSE;
+PRIVATE tsPersistLog sLog;
+PRIVATE uint8 u8Sequence = 0;       /* Sequence of the latest group */
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vSurveyReset
+ *
+ * DESCRIPTION:
+ * Clears the distances held, ready for a new survey.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psSurvey        W   Survey
+ *                  u8Anchors       R   Anchors taking part, at most MAX_ANCHORS
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vSurveyReset(tsSurvey *psSurvey, uint8 u8Anchors)
+{
+    uint8 i, j;
+
+    psSurvey->u8Anchors = (u8Anchors < MAX_ANCHORS) ? u8Anchors : MAX_ANCHORS;
+    for (i = 0; i < MAX_ANCHORS; i++)
+    {
+        for (j = 0; j < MAX_ANCHORS; j++)
+        {
+            psSurvey->asRange[i][j].i32DistanceCm = 0;
+            psSurvey->asRange[i][j].u16StdDevCm   = 0;
+            psSurvey->asRange[i][j].u8Reports     = 0;
+        }
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: vSurveyRange
+ *
+ * DESCRIPTION:
+ * Holds the latest distance one anchor reported to another. Ranges to or
+ * from devices outside the survey are ignored.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psSurvey        RW  Survey
+ *                  u8From          R   Anchor that ranged
+ *                  u8To            R   Anchor ranged against
+ *                  i32DistanceCm   R   Filtered distance (cm)
+ *                  u16StdDevCm     R   Its standard deviation (cm)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vSurveyRange(tsSurvey *psSurvey, uint8 u8From, uint8 u8To, int32 i32DistanceCm,
+                         uint16 u16StdDevCm)
+{
+    tsSurveyRange *psRange;
+
+    if ((u8From >= psSurvey->u8Anchors) || (u8To >= psSurvey->u8Anchors) || (u8From == u8To))
+    {
+        return;
+    }
+
+    psRange = &psSurvey->asRange[u8From][u8To];
+    psRange->i32DistanceCm = (i32DistanceCm > 0) ? i32DistanceCm : 0;
+    psRange->u16StdDevCm   = u16StdDevCm;
+    if (psRange->u8Reports < 0xff)
+    {
+        psRange->u8Reports++;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: bSurveyDistance
+ *
+ * DESCRIPTION:
+ * Distance between two anchors, combining the two directions of the pair
+ * by inverse variance when both are held.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psSurvey        R   Survey
+ *                  u8A, u8B        R   Anchors
+ *                  pi32DistanceCm  W   Distance (cm)
+ *
+ * RETURNS: bool_t FALSE if neither direction has SURVEY_MIN_REPORTS
+ *
+ ****************************************************************************/
+PUBLIC bool_t bSurveyDistance(tsSurvey *psSurvey, uint8 u8A, uint8 u8B, int32 *pi32DistanceCm)
+{
+    tsSurveyRange *psAB = &psSurvey->asRange[u8A][u8B];
+    tsSurveyRange *psBA = &psSurvey->asRange[u8B][u8A];
+    bool_t bAB = (psAB->u8Reports >= SURVEY_MIN_REPORTS);
+    bool_t bBA = (psBA->u8Reports >= SURVEY_MIN_REPORTS);
+    uint64 u64VarAB, u64VarBA;
+
+    if (bAB && bBA)
+    {
+        u64VarAB = (uint64)psAB->u16StdDevCm * psAB->u16StdDevCm + 1;
+        u64VarBA = (uint64)psBA->u16StdDevCm * psBA->u16StdDevCm + 1;
+        *pi32DistanceCm = (int32)(((uint64)psAB->i32DistanceCm * u64VarBA +
+                                   (uint64)psBA->i32DistanceCm * u64VarAB) /
+                                  (u64VarAB + u64VarBA));
+    }
+    else if (bAB || bBA)
+    {
+        *pi32DistanceCm = bAB ? psAB->i32DistanceCm : psBA->i32DistanceCm;
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: bSurveySolve
+ *
+ * DESCRIPTION:
+ * Places the anchors from the distances between every pair of them.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psSurvey        R   Survey
+ *                  u8Dims          R   Dimensions, 2 or 3
+ *                  pasAnchor       W   Position of each anchor (cm)
+ *                  pu16RmsCm       W   RMS of the distance residuals (cm)
+ *
+ * RETURNS: bool_t FALSE if a pair has no distance, the anchors could not
+ *          be placed or the residual exceeds SURVEY_MAX_RMS_CM
+ *
+ ****************************************************************************/
+PUBLIC bool_t bSurveySolve(tsSurvey *psSurvey, uint8 u8Dims, tsMultilatPoint *pasAnchor,
+                           uint16 *pu16RmsCm)
+{
+    int32 ai32Distance[MAX_ANCHORS][MAX_ANCHORS];
+    uint8 u8Anchors = psSurvey->u8Anchors;
+    uint64 u64SumSq = 0;
+    uint16 u16Pairs = 0;
+    int32 i32Error;
+    uint32 u32Rms;
+    uint8 i, j, p;
+
+    *pu16RmsCm = 0xffff;
+    if ((u8Anchors < 2) || (u8Dims < 2) || (u8Dims > MULTILAT_AXES))
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < u8Anchors; i++)
+    {
+        ai32Distance[i][i] = 0;
+        for (j = i + 1; j < u8Anchors; j++)
+        {
+            if (!bSurveyDistance(psSurvey, i, j, &ai32Distance[i][j]) ||
+                (ai32Distance[i][j] > MULTILAT_MAX_CM))
+            {
+                return FALSE;
+            }
+            ai32Distance[j][i] = ai32Distance[i][j];
+        }
+        for (j = 0; j < MULTILAT_AXES; j++)
+        {
+            pasAnchor[i].ai32Cm[j] = 0;
+        }
+    }
+
+    /* Anchors 0 and 1 fix the origin and the x axis */
+    if (ai32Distance[0][1] == 0)
+    {
+        return FALSE;
+    }
+    pasAnchor[1].ai32Cm[0] = ai32Distance[0][1];
+
+    /* Anchor 2, and anchor 3 in three dimensions, on the positive side of
+       the next axis, which fixes the frame's handedness. The rest against
+       all those before them. */
+    for (i = 2; i < u8Anchors; i++)
+    {
+        if (!((i <= u8Dims) ? bPlaceAbove(ai32Distance, pasAnchor, i) :
+                              bPlace(ai32Distance, pasAnchor, i, i, u8Dims)))
+        {
+            return FALSE;
+        }
+    }
+
+    /* Again against all the others, so the later anchors' distances also
+       place the earlier ones. Those fixing the frame are left in it. */
+    if (u8Anchors - 1 > u8Dims)
+    {
+        for (p = 0; p < SURVEY_REFINE_PASSES; p++)
+        {
+            for (i = u8Dims; i < u8Anchors; i++)
+            {
+                if (!bPlace(ai32Distance, pasAnchor, i, u8Anchors, u8Dims))
+                {
+                    return FALSE;
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < u8Anchors; i++)
+    {
+        for (j = i + 1; j < u8Anchors; j++)
+        {
+            i32Error = (int32)u32FixedDist(pasAnchor[i].ai32Cm, pasAnchor[j].ai32Cm, MULTILAT_AXES) -
+                       ai32Distance[i][j];
+            u64SumSq += (uint64)((int64)i32Error * i32Error);
+            u16Pairs++;
+        }
+    }
+    u32Rms = u32FixedSqrt64(u64SumSq / u16Pairs);
+    *pu16RmsCm = (u32Rms > 0xffff) ? 0xffff : (uint16)u32Rms;
+
+    return (u32Rms <= SURVEY_MAX_RMS_CM);
+}
+
+/****************************************************************************
+ *
+ * NAME: bSurveyLoad
+ *
+ * DESCRIPTION:
+ * Reads the latest complete geometry saved.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Anchors      W   Anchors placed
+ *                  pasAnchor       W   Position of each, MAX_ANCHORS entries
+ *
+ * RETURNS: bool_t FALSE if none is saved or the flash could not be used
+ *
+ ****************************************************************************/
+PUBLIC bool_t bSurveyLoad(uint8 *pu8Anchors, tsMultilatPoint *pasAnchor)
+{
+    uint16 n;
+
+    if (!bOpenLog())
+    {
+        return FALSE;
+    }
+
+    for (n = sLog.u16Next; n > 0; n--)
+    {
+        if (bReadGroup(n - 1, pu8Anchors, pasAnchor))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/****************************************************************************
+ *
+ * NAME: bSurveySave
+ *
+ * DESCRIPTION:
+ * Appends a geometry to the journal, erasing it first if the group would
+ * not fit.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u8Anchors       R   Anchors placed, 2 to MAX_ANCHORS
+ *                  pasAnchor       R   Position of each (cm)
+ *
+ * RETURNS: bool_t FALSE if the flash could not be written
+ *
+ ****************************************************************************/
+PUBLIC bool_t bSurveySave(uint8 u8Anchors, tsMultilatPoint *pasAnchor)
+{
+    uint8 au8Record[SURVEY_RECORD_LEN];
+    uint8 n, j;
+
+    if ((u8Anchors < 2) || (u8Anchors > MAX_ANCHORS) || !bOpenLog())
+    {
+        return FALSE;
+    }
+
+    if ((sLog.u16Next + u8Anchors > sLog.u16Slots) && !bPersistErase(&sLog))
+    {
+        return FALSE;
+    }
+
+    u8Sequence++;
+    for (n = 0; n < u8Anchors; n++)
+    {
+        au8Record[0] = u8Sequence;
+        au8Record[1] = u8Anchors;
+        au8Record[2] = n;
+        for (j = 0; j < MULTILAT_AXES; j++)
+        {
+            vPutI16(&au8Record[3 + 2 * j], pasAnchor[n].ai32Cm[j]);
+        }
+        if (!bPersistAppend(&sLog, au8Record))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: bPlace
+ *
+ * DESCRIPTION:
+ * Places one anchor by multilateration against others already placed.
+ * Axes beyond those solved for are left at 0.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  ai32Distance    R   Distance between each pair (cm)
+ *                  pasAnchor       RW  Positions (cm)
+ *                  u8Anchor        R   Anchor to place
+ *                  u8Anchors       R   Anchors below this are ranged against
+ *                  u8Dims          R   Dimensions solved in
+ *
+ * RETURNS: bool_t FALSE if the anchor could not be placed
+ *
+ ****************************************************************************/
+PRIVATE bool_t bPlace(int32 ai32Distance[MAX_ANCHORS][MAX_ANCHORS], tsMultilatPoint *pasAnchor,
+                      uint8 u8Anchor, uint8 u8Anchors, uint8 u8Dims)
+{
+    tsMultilatRange asRange[MULTILAT_MAX_ANCHORS];
+    tsMultilatFix sFix;
+    uint8 u8Ranges = 0;
+    uint8 n;
+
+    for (n = 0; (n < u8Anchors) && (u8Ranges < MULTILAT_MAX_ANCHORS); n++)
+    {
+        if (n != u8Anchor)
+        {
+            asRange[u8Ranges].sAnchor    = pasAnchor[n];
+            asRange[u8Ranges].i32RangeCm = ai32Distance[u8Anchor][n];
+            u8Ranges++;
+        }
+    }
+
+    if (!bMultilatSolve(asRange, u8Ranges, u8Dims, &sFix))
+    {
+        return FALSE;
+    }
+
+    for (n = 0; n < MULTILAT_AXES; n++)
+    {
+        pasAnchor[u8Anchor].ai32Cm[n] = (n < u8Dims) ? sFix.sPos.ai32Cm[n] : 0;
+    }
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: bPlaceAbove
+ *
+ * DESCRIPTION:
+ * Places an anchor that fixes the frame: anchor 2 off the x axis, or
+ * anchor 3 off the plane of the first three. It is placed against those
+ * before it on the axes they span, then lifted along the next axis by the
+ * mean of what its distances leave over. Distances too short to reach off
+ * the axis or plane leave it on them, rather than the solution failing.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  ai32Distance    R   Distance between each pair (cm)
+ *                  pasAnchor       RW  Positions (cm)
+ *                  u8Anchor        R   Anchor to place, 2 or 3
+ *
+ * RETURNS: bool_t FALSE if the anchor could not be placed
+ *
+ ****************************************************************************/
+PRIVATE bool_t bPlaceAbove(int32 ai32Distance[MAX_ANCHORS][MAX_ANCHORS], tsMultilatPoint *pasAnchor,
+                           uint8 u8Anchor)
+{
+    uint8 u8Axis = u8Anchor - 1;    /* Axis lifted along */
+    int64 i64Sum = 0;
+    int64 i64D01 = ai32Distance[0][1];
+    uint8 n;
+
+    if (u8Axis == 1)
+    {
+        /* Along the x axis from anchors 0 and 1 */
+        i64Sum = (int64)ai32Distance[u8Anchor][0] * ai32Distance[u8Anchor][0] -
+                 (int64)ai32Distance[u8Anchor][1] * ai32Distance[u8Anchor][1] + i64D01 * i64D01;
+        pasAnchor[u8Anchor].ai32Cm[0] = i32FixedSaturate(i64Sum / (2 * i64D01), MULTILAT_MAX_CM);
+        i64Sum = 0;
+    }
+    else if (!bPlace(ai32Distance, pasAnchor, u8Anchor, u8Anchor, u8Axis))
+    {
+        return FALSE;
+    }
+
+    for (n = 0; n < u8Anchor; n++)
+    {
+        i64Sum += (int64)ai32Distance[u8Anchor][n] * ai32Distance[u8Anchor][n] -
+                  (int64)u64FixedDistSq(pasAnchor[u8Anchor].ai32Cm, pasAnchor[n].ai32Cm, MULTILAT_AXES);
+    }
+    i64Sum /= u8Anchor;
+    pasAnchor[u8Anchor].ai32Cm[u8Axis] = (i64Sum > 0) ? (int32)u32FixedSqrt64((uint64)i64Sum) : 0;
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: bOpenLog
+ *
+ * DESCRIPTION:
+ * Opens the journal on first use.
+ *
+ * RETURNS: bool_t FALSE if the flash could not be used
+ *
+ ****************************************************************************/
+PRIVATE bool_t bOpenLog(void)
+{
+    if (!bOpen)
+    {
+        bOpen = bPersistOpen(&sLog, SURVEY_STORE_SECTOR, SURVEY_RECORD_LEN);
+    }
+    return bOpen;
+}
+
+/****************************************************************************
+ *
+ * NAME: bReadGroup
+ *
+ * DESCRIPTION:
+ * Reads the group of records ending at a slot, if that slot holds the last
+ * record of a group and every record of it is intact.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16Last         R   Slot of the last record
+ *                  pu8Anchors      W   Anchors placed
+ *                  pasAnchor       W   Position of each (cm)
+ *
+ * RETURNS: bool_t TRUE if a complete group was read
+ *
+ ****************************************************************************/
+PRIVATE bool_t bReadGroup(uint16 u16Last, uint8 *pu8Anchors, tsMultilatPoint *pasAnchor)
+{
+    uint8 au8Record[SURVEY_RECORD_LEN];
+    uint8 u8Seq, u8Anchors;
+    uint8 n, j;
+
+    if (!bPersistRead(&sLog, u16Last, au8Record))
+    {
+        return FALSE;
+    }
+
+    u8Seq     = au8Record[0];
+    u8Anchors = au8Record[1];
+    if ((u8Anchors < 2) || (u8Anchors > MAX_ANCHORS) ||
+        (au8Record[2] != u8Anchors - 1) || (u16Last + 1 < u8Anchors))
+    {
+        return FALSE;
+    }
+
+    for (n = 0; n < u8Anchors; n++)
+    {
+        if (!bPersistRead(&sLog, u16Last + 1 - u8Anchors + n, au8Record) ||
+            (au8Record[0] != u8Seq) || (au8Record[1] != u8Anchors) || (au8Record[2] != n))
+        {
+            return FALSE;
+        }
+        for (j = 0; j < MULTILAT_AXES; j++)
+        {
+            pasAnchor[n].ai32Cm[j] = i32GetI16(&au8Record[3 + 2 * j]);
+        }
+    }
+
+    *pu8Anchors = u8Anchors;
+    u8Sequence  = u8Seq;
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: vPutI16
+ *
+ * DESCRIPTION:
+ * Writes a coordinate as a 16 bit value big endian.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Out          W   Output
+ *                  i32Value        R   Value, within MULTILAT_MAX_CM
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vPutI16(uint8 *pu8Out, int32 i32Value)
+{
+    uint16 u16Value = (uint16)(int16)i32Value;
+
+    pu8Out[0] = (uint8)(u16Value >> 8);
+    pu8Out[1] = (uint8)(u16Value);
+}
+
+/****************************************************************************
+ *
+ * NAME: i32GetI16
+ *
+ * DESCRIPTION:
+ * Reads a 16 bit value big endian as a coordinate.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8In           R   Input
+ *
+ * RETURNS: int32 value
+ *
+ ****************************************************************************/
+PRIVATE int32 i32GetI16(uint8 *pu8In)
+{
+    return (int32)(int16)(uint16)((pu8In[0] << 8) | pu8In[1]);
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,91 @@
+/****************************************************************************
+ *
+ * MODULE:      survey.h
+ *
+ * DESCRIPTION:
+ * Anchor positions found by the anchors ranging each other, so they can be
+ * placed anywhere without the coordinator being rebuilt.
+ *
+ * During a survey each anchor ranges every other, and the latest filtered
+ * distance of each is held for each ordered pair. The two directions of a
+ * pair are combined by inverse variance. Anchor 0 is placed at the origin
+ * and anchor 1 on the positive x axis; anchor 2 is placed on the positive y
+ * side of them and, in three dimensions, anchor 3 above the plane of the
+ * first three. The rest are placed by multilateration against those before
+ * them, then every anchor not fixing the frame is solved again against all
+ * the others. The geometry is that of the original beacon pair when there
+ * are two anchors.
+ *
+ * The geometry is kept in a journal (see persist.h) as one record per
+ * anchor, written as a group. At start-up the latest complete group is
+ * used, so a reset while a group is written leaves the previous geometry.
+ *
+ ****************************************************************************/
+
+#ifndef  SURVEY_H_INCLUDED
+#define  SURVEY_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "config.h"
+#include "multilat.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Flash sector holding the geometry */
+#define SURVEY_STORE_SECTOR         4
+
+/* Reports a direction needs before its distance is used, so the sender's
+   track has settled */
+#define SURVEY_MIN_REPORTS          3
+
+/* A solution whose RMS distance residual exceeds this (cm) is not used */
+#define SURVEY_MAX_RMS_CM           100
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/* Latest distance one anchor reported to another */
+typedef struct
+{
+    int32   i32DistanceCm;
+    uint16  u16StdDevCm;
+    uint8   u8Reports;
+} tsSurveyRange;
+
+typedef struct
+{
+    uint8   u8Anchors;
+    tsSurveyRange asRange[MAX_ANCHORS][MAX_ANCHORS];    /* [from][to] */
+} tsSurvey;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC void   vSurveyReset(tsSurvey *psSurvey, uint8 u8Anchors);
+PUBLIC void   vSurveyRange(tsSurvey *psSurvey, uint8 u8From, uint8 u8To, int32 i32DistanceCm,
+                           uint16 u16StdDevCm);
+PUBLIC bool_t bSurveyDistance(tsSurvey *psSurvey, uint8 u8A, uint8 u8B, int32 *pi32DistanceCm);
+PUBLIC bool_t bSurveySolve(tsSurvey *psSurvey, uint8 u8Dims, tsMultilatPoint *pasAnchor,
+                           uint16 *pu16RmsCm);
+PUBLIC bool_t bSurveyLoad(uint8 *pu8Anchors, tsMultilatPoint *pasAnchor);
+PUBLIC bool_t bSurveySave(uint8 u8Anchors, tsMultilatPoint *pasAnchor);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* SURVEY_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
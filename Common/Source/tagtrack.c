@@ -0,0 +1,777 @@
+/****************************************************************************
+ *
+ * MODULE:      tagtrack.c
+ *
+ * DESCRIPTION:
+ * Tracking of many targets, see tagtrack.h.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "fixedpoint.h"
+#include "multilat.h"
+#include "postrack.h"
+#include "tagtrack.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Fractional bits of the unit vectors the GDOP is found from */
+#define TAG_TRACK_UNIT_SHIFT        10
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE bool_t bStartTrack(tsTag *psTag, const tsMultilatPoint *pasAnchor, uint8 *pu8Candidate,
+                           uint8 u8Candidates, uint8 u8Dims);
+PRIVATE uint8  u8FindCandidates(tsTag *psTag, uint8 u8Anchors, uint32 u32NowMs,
+                                uint32 u32FreshMs, uint8 *pu8Candidate);
+PRIVATE void   vSelectAnchors(tsTag *psTag, const tsMultilatPoint *pasAnchor, uint8 *pu8Candidate,
+                              uint8 u8Candidates, uint8 u8Dims, tsMultilatPoint *psAt);
+PRIVATE uint16 u16Gdop(int32 ai32Unit[][MULTILAT_AXES], uint16 u16Set, uint8 u8Dims);
+PRIVATE uint8  u8OldestPending(tsTag *psTag, uint8 u8Pending);
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vTagReset
+ *
+ * DESCRIPTION:
+ * Empties a target of ranges and discards its track.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTag           W   Target
+ *                  u16Slot         R   Registry slot of the target
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTagReset(tsTag *psTag, uint16 u16Slot)
+{
+    psTag->u16Slot        = u16Slot;
+    psTag->u8Ranged       = 0;
+    psTag->u8Pending      = 0;
+    psTag->u16WindowFixes = 0;
+    psTag->u8Selected     = 0;
+    psTag->u16GdopX100    = TAG_TRACK_GDOP_NONE;
+    vPosTrackReset(&psTag->sTrack);
+}
+
+/****************************************************************************
+ *
+ * NAME: vTagRange
+ *
+ * DESCRIPTION:
+ * Holds a new range to an anchor until the target is next updated. A range
+ * not yet applied is replaced.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTag           RW  Target
+ *                  u8Anchor        R   Anchor index
+ *                  i32RangeCm      R   Range (cm)
+ *                  u32StdDevCm     R   Standard deviation of the range
+ *                  u32TimeMs       R   Time of the range, local clock (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTagRange(tsTag *psTag, uint8 u8Anchor, int32 i32RangeCm, uint32 u32StdDevCm,
+                      uint32 u32TimeMs)
+{
+    if (u8Anchor >= TAG_TRACK_MAX_ANCHORS)
+    {
+        return;
+    }
+
+    psTag->ai32RangeCm[u8Anchor]  = i32RangeCm;
+    psTag->au16StdDevCm[u8Anchor] = (u32StdDevCm > 0xffff) ? 0xffff : (uint16)u32StdDevCm;
+    psTag->au32RangeMs[u8Anchor]  = u32TimeMs;
+    psTag->u8Ranged  |= (uint8)(1 << u8Anchor);
+    psTag->u8Pending |= (uint8)(1 << u8Anchor);
+}
+
+/****************************************************************************
+ *
+ * NAME: vTagRangeLost
+ *
+ * DESCRIPTION:
+ * Forgets the range to an anchor that has left or can no longer be heard.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTag           RW  Target
+ *                  u8Anchor        R   Anchor index
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTagRangeLost(tsTag *psTag, uint8 u8Anchor)
+{
+    if (u8Anchor >= TAG_TRACK_MAX_ANCHORS)
+    {
+        return;
+    }
+
+    psTag->u8Ranged  &= (uint8)~(1 << u8Anchor);
+    psTag->u8Pending &= (uint8)~(1 << u8Anchor);
+}
+
+/****************************************************************************
+ *
+ * NAME: bTagUpdate
+ *
+ * DESCRIPTION:
+ * Applies the ranges waiting for a target to its track, oldest first, or
+ * starts the track if there is none or it is lost on the way. A track that
+ * cannot be started yet is tried again when the next range arrives. Only
+ * ranges from the anchors selected at the target's position are applied.
+ *
+ * A target that ranges one anchor per period revisits each only every
+ * u8Anchors periods, so a range stays fresh for that long, and
+ * TAG_TRACK_FRESH_MS more. One whose every anchor ranges it each period
+ * is given a period of 0.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTag           RW  Target
+ *                  pasAnchor       R   Anchor positions (cm)
+ *                  u8Anchors       R   Anchors in pasAnchor
+ *                  u8Dims          R   Axes to track, 2 or 3
+ *                  u32NowMs        R   Current time (ms)
+ *                  u16PeriodMs     R   Time between the target's bursts,
+ *                                      each to the next anchor (ms)
+ *
+ * RETURNS:
+ * TRUE if the position was updated
+ *
+ ****************************************************************************/
+PUBLIC bool_t bTagUpdate(tsTag *psTag, const tsMultilatPoint *pasAnchor, uint8 u8Anchors,
+                         uint8 u8Dims, uint32 u32NowMs, uint16 u16PeriodMs)
+{
+    uint8 au8Candidate[TAG_TRACK_CANDIDATES];
+    uint8 u8Candidates;
+    uint8 u8Pending = psTag->u8Pending;
+    bool_t bUpdated = FALSE;
+    tsMultilatPoint sAt;
+    uint8 n;
+
+    psTag->u8Pending = 0;
+
+    if (u8Anchors > TAG_TRACK_MAX_ANCHORS)
+    {
+        u8Anchors = TAG_TRACK_MAX_ANCHORS;
+    }
+
+    u8Candidates = u8FindCandidates(psTag, u8Anchors, u32NowMs,
+                                    (uint32)u16PeriodMs * u8Anchors + TAG_TRACK_FRESH_MS, au8Candidate);
+    if (bPosTrackPredict(&psTag->sTrack, psTag->sTrack.u32LastMs, &sAt, NULL))
+    {
+        vSelectAnchors(psTag, pasAnchor, au8Candidate, u8Candidates, u8Dims, &sAt);
+        u8Pending &= psTag->u8Selected;
+    }
+
+    while (psTag->sTrack.bValid && (u8Pending != 0))
+    {
+        n = u8OldestPending(psTag, u8Pending);
+        u8Pending &= (uint8)~(1 << n);
+        if ((n < u8Anchors) &&
+            bPosTrackRange(&psTag->sTrack, psTag->au32RangeMs[n], &pasAnchor[n],
+                           psTag->ai32RangeCm[n], psTag->au16StdDevCm[n]))
+        {
+            bUpdated = TRUE;
+        }
+    }
+
+    if (!psTag->sTrack.bValid)
+    {
+        bUpdated = bStartTrack(psTag, pasAnchor, au8Candidate, u8Candidates, u8Dims);
+    }
+
+    if (bUpdated && (psTag->u16WindowFixes < 0xffff))
+    {
+        psTag->u16WindowFixes++;
+    }
+    return bUpdated;
+}
+
+/****************************************************************************
+ *
+ * NAME: vTagTableInit
+ *
+ * DESCRIPTION:
+ * Empties the table.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTable         W   Table
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTagTableInit(tsTagTable *psTable)
+{
+    uint16 i;
+
+    psTable->u8Count = 0;
+    psTable->u8Next  = 0;
+
+    for (i = 0; i < REGISTRY_SLOTS; i++)
+    {
+        psTable->au8Index[i] = TAG_TRACK_NONE;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: psTagTableFind
+ *
+ * DESCRIPTION:
+ * Looks up the tag in a registry slot.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTable         R   Table
+ *                  u16Slot         R   Registry slot
+ *
+ * RETURNS: tsTag * the tag, NULL if the slot holds none
+ *
+ ****************************************************************************/
+PUBLIC tsTag *psTagTableFind(tsTagTable *psTable, uint16 u16Slot)
+{
+    if ((u16Slot >= REGISTRY_SLOTS) || (psTable->au8Index[u16Slot] == TAG_TRACK_NONE))
+    {
+        return NULL;
+    }
+
+    return &psTable->asTag[psTable->au8Index[u16Slot]];
+}
+
+/****************************************************************************
+ *
+ * NAME: psTagTableAdd
+ *
+ * DESCRIPTION:
+ * Looks up the tag in a registry slot, adding it to the end of the table
+ * if it is not there.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTable         RW  Table
+ *                  u16Slot         R   Registry slot
+ *
+ * RETURNS: tsTag * the tag, NULL if the table is full
+ *
+ ****************************************************************************/
+PUBLIC tsTag *psTagTableAdd(tsTagTable *psTable, uint16 u16Slot)
+{
+    tsTag *psTag = psTagTableFind(psTable, u16Slot);
+
+    if ((psTag != NULL) || (u16Slot >= REGISTRY_SLOTS) ||
+        (psTable->u8Count >= TAG_TRACK_MAX_TAGS))
+    {
+        return psTag;
+    }
+
+    psTag = &psTable->asTag[psTable->u8Count];
+    vTagReset(psTag, u16Slot);
+    psTable->au8Index[u16Slot] = psTable->u8Count++;
+
+    return psTag;
+}
+
+/****************************************************************************
+ *
+ * NAME: vTagTableRemove
+ *
+ * DESCRIPTION:
+ * Removes the tag in a registry slot, moving the last tag into its place
+ * to keep the table dense.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTable         RW  Table
+ *                  u16Slot         R   Registry slot
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTagTableRemove(tsTagTable *psTable, uint16 u16Slot)
+{
+    uint8 u8Index;
+    uint8 u8Last;
+
+    if ((u16Slot >= REGISTRY_SLOTS) || (psTable->au8Index[u16Slot] == TAG_TRACK_NONE))
+    {
+        return;
+    }
+
+    u8Index = psTable->au8Index[u16Slot];
+    u8Last  = psTable->u8Count - 1;
+    psTable->au8Index[u16Slot] = TAG_TRACK_NONE;
+
+    if (u8Index != u8Last)
+    {
+        psTable->asTag[u8Index] = psTable->asTag[u8Last];
+        psTable->au8Index[psTable->asTag[u8Index].u16Slot] = u8Index;
+    }
+    psTable->u8Count = u8Last;
+
+    if (psTable->u8Next >= psTable->u8Count)
+    {
+        psTable->u8Next = 0;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: vTagTableAnchorLost
+ *
+ * DESCRIPTION:
+ * Forgets every tag's range to an anchor.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTable         RW  Table
+ *                  u8Anchor        R   Anchor index
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTagTableAnchorLost(tsTagTable *psTable, uint8 u8Anchor)
+{
+    uint8 i;
+
+    for (i = 0; i < psTable->u8Count; i++)
+    {
+        vTagRangeLost(&psTable->asTag[i], u8Anchor);
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: psTagTableNext
+ *
+ * DESCRIPTION:
+ * Next tag, in round robin, with ranges waiting to be applied. Every tag
+ * is considered once before any is considered again, so a tag that reports
+ * often cannot hold back the others.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTable         RW  Table
+ *
+ * RETURNS: tsTag * the tag to update, NULL if none has ranges waiting
+ *
+ ****************************************************************************/
+PUBLIC tsTag *psTagTableNext(tsTagTable *psTable)
+{
+    uint8 u8Index = psTable->u8Next;
+    uint8 i;
+
+    for (i = 0; i < psTable->u8Count; i++)
+    {
+        if (u8Index >= psTable->u8Count)
+        {
+            u8Index = 0;
+        }
+        if (psTable->asTag[u8Index].u8Pending != 0)
+        {
+            psTable->u8Next = u8Index + 1;
+            return &psTable->asTag[u8Index];
+        }
+        u8Index++;
+    }
+
+    return NULL;
+}
+
+/****************************************************************************
+ *
+ * NAME: u16TagTablePeriodMs
+ *
+ * DESCRIPTION:
+ * Period at which each tag should range, so that the bursts of all of them
+ * fit the airtime given to ranging.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTable         R   Table
+ *
+ * RETURNS: uint16 time between a tag's bursts (ms), 0 if there are no tags
+ *
+ ****************************************************************************/
+PUBLIC uint16 u16TagTablePeriodMs(tsTagTable *psTable)
+{
+    return (uint16)(psTable->u8Count * TAG_TRACK_BURST_MS);
+}
+
+/****************************************************************************
+ *
+ * NAME: u32TagTableWindowFixes
+ *
+ * DESCRIPTION:
+ * Updates made to the tags since this was last called, in total and for
+ * the tag updated least often, and starts a new window.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTable         RW  Table
+ *                  pu16MinFixes    W   Updates of the least updated tag
+ *
+ * RETURNS: uint32 updates of every tag
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32TagTableWindowFixes(tsTagTable *psTable, uint16 *pu16MinFixes)
+{
+    uint32 u32Fixes = 0;
+    uint16 u16Min = 0xffff;
+    uint8 i;
+
+    for (i = 0; i < psTable->u8Count; i++)
+    {
+        u32Fixes += psTable->asTag[i].u16WindowFixes;
+        if (psTable->asTag[i].u16WindowFixes < u16Min)
+        {
+            u16Min = psTable->asTag[i].u16WindowFixes;
+        }
+        psTable->asTag[i].u16WindowFixes = 0;
+    }
+
+    *pu16MinFixes = (psTable->u8Count != 0) ? u16Min : 0;
+    return u32Fixes;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: bStartTrack
+ *
+ * DESCRIPTION:
+ * Starts a target's track from a fix on its candidate ranges, with the
+ * larger of their standard deviation and the residual of the fit as its
+ * uncertainty, and selects the anchors to use at the position found.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTag           RW  Target
+ *                  pasAnchor       R   Anchor positions (cm)
+ *                  pu8Candidate    R   Candidate anchors, see u8FindCandidates
+ *                  u8Candidates    R   Anchors in pu8Candidate
+ *                  u8Dims          R   Axes to track, 2 or 3
+ *
+ * RETURNS: bool_t TRUE if the track was started
+ *
+ ****************************************************************************/
+PRIVATE bool_t bStartTrack(tsTag *psTag, const tsMultilatPoint *pasAnchor, uint8 *pu8Candidate,
+                           uint8 u8Candidates, uint8 u8Dims)
+{
+    tsMultilatRange asRange[TAG_TRACK_CANDIDATES];
+    tsMultilatFix sFix;
+    uint32 u32StdDev = 0;
+    uint32 u32LatestMs = 0;
+    uint8 i, n;
+
+    for (i = 0; i < u8Candidates; i++)
+    {
+        n = pu8Candidate[i];
+        asRange[i].sAnchor    = pasAnchor[n];
+        asRange[i].i32RangeCm = psTag->ai32RangeCm[n];
+        if (psTag->au16StdDevCm[n] > u32StdDev)
+        {
+            u32StdDev = psTag->au16StdDevCm[n];
+        }
+        if ((i == 0) || ((int32)(psTag->au32RangeMs[n] - u32LatestMs) > 0))
+        {
+            u32LatestMs = psTag->au32RangeMs[n];
+        }
+    }
+
+    if (!bMultilatSolve(asRange, u8Candidates, u8Dims, &sFix))
+    {
+        return FALSE;
+    }
+
+    if (sFix.u16RmsCm > u32StdDev)
+    {
+        u32StdDev = sFix.u16RmsCm;
+    }
+    vPosTrackStart(&psTag->sTrack, u8Dims, u32LatestMs, &sFix.sPos, u32StdDev);
+    vSelectAnchors(psTag, pasAnchor, pu8Candidate, u8Candidates, u8Dims, &sFix.sPos);
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: u8FindCandidates
+ *
+ * DESCRIPTION:
+ * Anchors a target holds fresh ranges to, at most TAG_TRACK_CANDIDATES of
+ * them, in order of the standard deviation of their range.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTag           R   Target
+ *                  u8Anchors       R   Anchors to consider
+ *                  u32NowMs        R   Current time (ms)
+ *                  u32FreshMs      R   Age up to which a range is used (ms)
+ *                  pu8Candidate    W   Candidate anchors, smallest deviation
+ *                                      first
+ *
+ * RETURNS: uint8 anchors in pu8Candidate
+ *
+ ****************************************************************************/
+PRIVATE uint8 u8FindCandidates(tsTag *psTag, uint8 u8Anchors, uint32 u32NowMs,
+                               uint32 u32FreshMs, uint8 *pu8Candidate)
+{
+    uint16 *pu16StdDev = psTag->au16StdDevCm;
+    uint8 u8Count = 0;
+    uint8 i, n;
+
+    for (n = 0; n < u8Anchors; n++)
+    {
+        if (!(psTag->u8Ranged & (1 << n)) ||
+            ((int32)(u32NowMs - psTag->au32RangeMs[n]) > (int32)u32FreshMs))
+        {
+            continue;
+        }
+
+        if (u8Count < TAG_TRACK_CANDIDATES)
+        {
+            i = u8Count++;
+        }
+        else if (pu16StdDev[n] < pu16StdDev[pu8Candidate[u8Count - 1]])
+        {
+            i = u8Count - 1;
+        }
+        else
+        {
+            continue;
+        }
+
+        for (; (i > 0) && (pu16StdDev[n] < pu16StdDev[pu8Candidate[i - 1]]); i--)
+        {
+            pu8Candidate[i] = pu8Candidate[i - 1];
+        }
+        pu8Candidate[i] = n;
+    }
+
+    return u8Count;
+}
+
+/****************************************************************************
+ *
+ * NAME: vSelectAnchors
+ *
+ * DESCRIPTION:
+ * Selects the TAG_TRACK_SELECT_ANCHORS candidates, or all of them if there
+ * are no more, with the lowest GDOP at a position, and keeps that GDOP.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTag           RW  Target
+ *                  pasAnchor       R   Anchor positions (cm)
+ *                  pu8Candidate    R   Candidate anchors
+ *                  u8Candidates    R   Anchors in pu8Candidate
+ *                  u8Dims          R   Axes tracked, 2 or 3
+ *                  psAt            R   Position of the target (cm)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vSelectAnchors(tsTag *psTag, const tsMultilatPoint *pasAnchor, uint8 *pu8Candidate,
+                            uint8 u8Candidates, uint8 u8Dims, tsMultilatPoint *psAt)
+{
+    int32 ai32Unit[TAG_TRACK_CANDIDATES][MULTILAT_AXES];
+    const tsMultilatPoint *psAnchor;
+    uint8 u8Size = (u8Candidates < TAG_TRACK_SELECT_ANCHORS) ? u8Candidates : TAG_TRACK_SELECT_ANCHORS;
+    uint16 u16Best = 0;
+    uint16 u16BestGdop = TAG_TRACK_GDOP_NONE;
+    uint16 u16SetGdop;
+    uint16 u16Set;
+    uint32 u32Dist;
+    uint8 u8Bits;
+    uint8 i, j;
+
+    /* Unit vector from each candidate to the target */
+    for (i = 0; i < u8Candidates; i++)
+    {
+        psAnchor = &pasAnchor[pu8Candidate[i]];
+        u32Dist  = u32FixedDist(psAt->ai32Cm, psAnchor->ai32Cm, u8Dims);
+        for (j = 0; j < MULTILAT_AXES; j++)
+        {
+            ai32Unit[i][j] = ((j < u8Dims) && (u32Dist != 0)) ?
+                (int32)(((int64)(psAt->ai32Cm[j] - psAnchor->ai32Cm[j]) << TAG_TRACK_UNIT_SHIFT) /
+                        (int64)u32Dist) : 0;
+        }
+    }
+
+    /* Every subset of the chosen size */
+    for (u16Set = 1; u16Set < (uint16)(1 << u8Candidates); u16Set++)
+    {
+        for (u8Bits = 0, i = 0; i < u8Candidates; i++)
+        {
+            u8Bits += (u16Set >> i) & 1;
+        }
+        if (u8Bits != u8Size)
+        {
+            continue;
+        }
+
+        u16SetGdop = u16Gdop(ai32Unit, u16Set, u8Dims);
+        if ((u16Best == 0) || (u16SetGdop < u16BestGdop))
+        {
+            u16Best     = u16Set;
+            u16BestGdop = u16SetGdop;
+        }
+    }
+
+    psTag->u8Selected = 0;
+    for (i = 0; i < u8Candidates; i++)
+    {
+        if (u16Best & (1 << i))
+        {
+            psTag->u8Selected |= (uint8)(1 << pu8Candidate[i]);
+        }
+    }
+    psTag->u16GdopX100 = u16BestGdop;
+}
+
+/****************************************************************************
+ *
+ * NAME: u16Gdop
+ *
+ * DESCRIPTION:
+ * GDOP of a set of anchors: the square root of the trace of (H'H)^-1,
+ * where each row of H is the unit vector from an anchor to the target. It
+ * is found from the mean of the rows' outer products, whose entries are at
+ * most 1, so the determinant of even the 3 x 3 fits 64 bits.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  ai32Unit        R   Unit vector of each candidate,
+ *                                      TAG_TRACK_UNIT_SHIFT fractional bits
+ *                  u16Set          R   Bit i set if candidate i is in the set
+ *                  u8Dims          R   Axes, 2 or 3
+ *
+ * RETURNS: uint16 GDOP x100, TAG_TRACK_GDOP_NONE if the set does not fix a
+ *          position
+ *
+ ****************************************************************************/
+PRIVATE uint16 u16Gdop(int32 ai32Unit[][MULTILAT_AXES], uint16 u16Set, uint8 u8Dims)
+{
+    int64 a[MULTILAT_AXES][MULTILAT_AXES];
+    int64 i64Adj, i64Det;
+    uint64 u64Num, u64Den;
+    uint32 u32Gdop;
+    uint8 u8Rows = 0;
+    uint8 i, r, c;
+
+    for (r = 0; r < MULTILAT_AXES; r++)
+    {
+        for (c = 0; c < MULTILAT_AXES; c++)
+        {
+            a[r][c] = 0;
+        }
+    }
+
+    for (i = 0; i < TAG_TRACK_CANDIDATES; i++)
+    {
+        if (!(u16Set & (1 << i)))
+        {
+            continue;
+        }
+        for (r = 0; r < u8Dims; r++)
+        {
+            for (c = 0; c < u8Dims; c++)
+            {
+                a[r][c] += (int64)ai32Unit[i][r] * ai32Unit[i][c];
+            }
+        }
+        u8Rows++;
+    }
+    if (u8Rows == 0)
+    {
+        return TAG_TRACK_GDOP_NONE;
+    }
+    for (r = 0; r < u8Dims; r++)
+    {
+        for (c = 0; c < u8Dims; c++)
+        {
+            a[r][c] /= u8Rows;
+        }
+    }
+
+    /* Trace of the inverse is the trace of the adjugate over the
+       determinant */
+    if (u8Dims == 2)
+    {
+        i64Adj = a[0][0] + a[1][1];
+        i64Det = a[0][0] * a[1][1] - a[0][1] * a[1][0];
+    }
+    else
+    {
+        i64Adj = (a[1][1] * a[2][2] - a[1][2] * a[2][1]) +
+                 (a[0][0] * a[2][2] - a[0][2] * a[2][0]) +
+                 (a[0][0] * a[1][1] - a[0][1] * a[1][0]);
+        i64Det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+                 a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+                 a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+    }
+    if ((i64Det <= 0) || (i64Adj <= 0))
+    {
+        return TAG_TRACK_GDOP_NONE;
+    }
+
+    /* GDOP^2 x 10^4 = trace x 10^4 / rows, the trace carrying one more
+       factor of the unit scale squared in its numerator */
+    u64Num = (uint64)i64Adj << (2 * TAG_TRACK_UNIT_SHIFT);
+    u64Den = (uint64)i64Det * u8Rows;
+    while (u64Num > 0xffffffffffffffffULL / 10000)
+    {
+        u64Num >>= 1;
+        u64Den >>= 1;
+    }
+    if (u64Den == 0)
+    {
+        return TAG_TRACK_GDOP_NONE;
+    }
+
+    u32Gdop = u32FixedSqrt64((u64Num * 10000) / u64Den);
+    return (u32Gdop < TAG_TRACK_GDOP_NONE) ? (uint16)u32Gdop : TAG_TRACK_GDOP_NONE;
+}
+
+/****************************************************************************
+ *
+ * NAME: u8OldestPending
+ *
+ * DESCRIPTION:
+ * Anchor of the earliest of a set of ranges.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTag           R   Target
+ *                  u8Pending       R   Set of anchors, not empty
+ *
+ * RETURNS: uint8 anchor index
+ *
+ ****************************************************************************/
+PRIVATE uint8 u8OldestPending(tsTag *psTag, uint8 u8Pending)
+{
+    uint8 u8Oldest = TAG_TRACK_MAX_ANCHORS;
+    uint8 n;
+
+    for (n = 0; n < TAG_TRACK_MAX_ANCHORS; n++)
+    {
+        if (!(u8Pending & (1 << n)))
+        {
+            continue;
+        }
+        if ((u8Oldest == TAG_TRACK_MAX_ANCHORS) ||
+            ((int32)(psTag->au32RangeMs[n] - psTag->au32RangeMs[u8Oldest]) < 0))
+        {
+            u8Oldest = n;
+        }
+    }
+
+    return u8Oldest;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
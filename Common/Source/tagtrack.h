@@ -0,0 +1,136 @@
+/****************************************************************************
+ *
+ * MODULE:      tagtrack.h
+ *
+ * DESCRIPTION:
+ * Position of each target the coordinator tracks, from its ranges to the
+ * anchors. Ranges are held as they arrive and applied to the target's
+ * position track later, in time order, so the work of tracking can be
+ * scheduled apart from the reports that feed it. A target without a track
+ * is started from a multilateration fix on the ranges it holds.
+ *
+ * When more anchors hold fresh ranges than a position needs, a subset is
+ * chosen for its geometry. The TAG_TRACK_CANDIDATES fresh ranges with the
+ * smallest standard deviation are considered, and of these the
+ * TAG_TRACK_SELECT_ANCHORS whose geometric dilution of precision (GDOP) at
+ * the target is lowest are used. Ranges from other anchors are dropped.
+ * This bounds the work per update to one GDOP per subset of the candidates
+ * (15 by default) and one range update per anchor used, or to a single fix
+ * over the candidates when a track is started. The GDOP of the set in use
+ * is kept with the position.
+ *
+ * Tags are kept in a dense table, so the work per pass depends only on how
+ * many tags there are. Tags with ranges waiting are updated in round robin,
+ * at most TAG_TRACK_UPDATES_PER_PASS per main loop pass; as tags are added
+ * each is updated less often, with ranges coalescing while it waits,
+ * rather than the loop falling behind. The period the tags are told to
+ * range at grows with their number in the same way, so together they stay
+ * within the airtime the channel can give to ranging.
+ *
+ ****************************************************************************/
+
+#ifndef  TAGTRACK_H_INCLUDED
+#define  TAGTRACK_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "registry.h"
+#include "multilat.h"
+#include "postrack.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Anchors a target holds ranges to, one bit each in a uint8 */
+#define TAG_TRACK_MAX_ANCHORS       MULTILAT_MAX_ANCHORS
+
+#ifndef TAG_TRACK_MAX_TAGS
+#define TAG_TRACK_MAX_TAGS          16
+#endif
+#define TAG_TRACK_NONE              0xff
+
+/* Anchor selection. A range is used until the target has had time to
+   range every anchor again, and TAG_TRACK_FRESH_MS more for the report to
+   arrive; see bTagUpdate. */
+#define TAG_TRACK_SELECT_ANCHORS    4
+#define TAG_TRACK_CANDIDATES        6
+#define TAG_TRACK_FRESH_MS          2000
+
+/* Period a tag ranges at until told a longer one, the end device's
+   RANGING_PERIOD_MS */
+#ifndef TAG_TRACK_TAG_PERIOD_MS
+#define TAG_TRACK_TAG_PERIOD_MS     500
+#endif
+
+/* GDOP of a set of anchors that does not fix a position */
+#define TAG_TRACK_GDOP_NONE         0xffff
+
+/* Tags updated per main loop pass */
+#define TAG_TRACK_UPDATES_PER_PASS  4
+
+/* Airtime given to each ranging burst (ms). Tags are spaced so that no
+   more than 1000 / TAG_TRACK_BURST_MS bursts are due each second. */
+#define TAG_TRACK_BURST_MS          25
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/* One tracked target */
+typedef struct
+{
+    uint16  u16Slot;            /* Registry slot of the target */
+    uint8   u8Ranged;           /* Bit n set if a range to anchor n is held */
+    uint8   u8Pending;          /* Bit n set if that range is not yet applied */
+    int32   ai32RangeCm[TAG_TRACK_MAX_ANCHORS];
+    uint16  au16StdDevCm[TAG_TRACK_MAX_ANCHORS];
+    uint32  au32RangeMs[TAG_TRACK_MAX_ANCHORS];     /* Time of each range */
+    uint16  u16WindowFixes;     /* Updates since the statistics were read */
+    uint8   u8Selected;         /* Bit n set if anchor n is used */
+    uint16  u16GdopX100;        /* GDOP of the anchors used, x100 */
+    tsPosTrack sTrack;
+} tsTag;
+
+typedef struct
+{
+    uint8   u8Count;
+    uint8   u8Next;             /* Tag the round robin considers first */
+    uint8   au8Index[REGISTRY_SLOTS];       /* Table index of each slot */
+    tsTag   asTag[TAG_TRACK_MAX_TAGS];
+} tsTagTable;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC void   vTagReset(tsTag *psTag, uint16 u16Slot);
+PUBLIC void   vTagRange(tsTag *psTag, uint8 u8Anchor, int32 i32RangeCm, uint32 u32StdDevCm,
+                        uint32 u32TimeMs);
+PUBLIC void   vTagRangeLost(tsTag *psTag, uint8 u8Anchor);
+PUBLIC bool_t bTagUpdate(tsTag *psTag, const tsMultilatPoint *pasAnchor, uint8 u8Anchors,
+                         uint8 u8Dims, uint32 u32NowMs, uint16 u16PeriodMs);
+
+PUBLIC void   vTagTableInit(tsTagTable *psTable);
+PUBLIC tsTag *psTagTableFind(tsTagTable *psTable, uint16 u16Slot);
+PUBLIC tsTag *psTagTableAdd(tsTagTable *psTable, uint16 u16Slot);
+PUBLIC void   vTagTableRemove(tsTagTable *psTable, uint16 u16Slot);
+PUBLIC void   vTagTableAnchorLost(tsTagTable *psTable, uint8 u8Anchor);
+PUBLIC tsTag *psTagTableNext(tsTagTable *psTable);
+PUBLIC uint16 u16TagTablePeriodMs(tsTagTable *psTable);
+PUBLIC uint32 u32TagTableWindowFixes(tsTagTable *psTable, uint16 *pu16MinFixes);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* TAGTRACK_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,164 @@
+/****************************************************************************
+ *
+ * MODULE:      tdma.c
+ *
+ * DESCRIPTION:
+ * Reporting slots in a beacon enabled superframe, see tdma.h.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "config.h"
+#include "tdma.h"
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: bTdmaHasSlot
+ *
+ * DESCRIPTION:
+ * Whether the end device with the given short address is one of the
+ * TDMA_DEVICES given a slot.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16ShortAdr     R   End device short address
+ *
+ * RETURNS: bool_t TRUE if the device has a slot
+ *
+ ****************************************************************************/
+PUBLIC bool_t bTdmaHasSlot(uint16 u16ShortAdr)
+{
+    return (u16ShortAdr >= END_DEVICE_START_ADR) &&
+           ((u16ShortAdr - END_DEVICE_START_ADR) < TDMA_DEVICES);
+}
+
+/****************************************************************************
+ *
+ * NAME: vTdmaAssign
+ *
+ * DESCRIPTION:
+ * Gives the slot owned by the end device with the given short address.
+ * Addresses are handed out in order from END_DEVICE_START_ADR, so devices
+ * fill the slots of the first beacon before sharing later ones.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16ShortAdr     R   End device short address
+ *                  psSlot          W   Slot owned by the device
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTdmaAssign(uint16 u16ShortAdr, tsTdmaSlot *psSlot)
+{
+    uint16 u16Index = u16ShortAdr - END_DEVICE_START_ADR;
+
+    psSlot->u8Slot  = (uint8)(TDMA_FIRST_SLOT + u16Index % TDMA_SLOTS);
+    psSlot->u8Cycle = (uint8)((u16Index / TDMA_SLOTS) % TDMA_CYCLES);
+}
+
+/****************************************************************************
+ *
+ * NAME: vTdmaInit
+ *
+ * DESCRIPTION:
+ * Sets up an end device's schedule, unsynchronised until the first beacon.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psSchedule      W   Schedule
+ *                  u16ShortAdr     R   Short address of the end device
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTdmaInit(tsTdmaSchedule *psSchedule, uint16 u16ShortAdr)
+{
+    vTdmaAssign(u16ShortAdr, &psSchedule->sSlot);
+    psSchedule->bSynced = FALSE;
+}
+
+/****************************************************************************
+ *
+ * NAME: vTdmaBeacon
+ *
+ * DESCRIPTION:
+ * Marks the start of a superframe on notification of its beacon.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psSchedule      RW  Schedule
+ *                  u8Bsn           R   Beacon sequence number
+ *                  u32NowMs        R   Current time (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTdmaBeacon(tsTdmaSchedule *psSchedule, uint8 u8Bsn, uint32 u32NowMs)
+{
+    psSchedule->bSynced     = TRUE;
+    psSchedule->u8Bsn       = u8Bsn;
+    psSchedule->u32BeaconMs = u32NowMs;
+}
+
+/****************************************************************************
+ *
+ * NAME: vTdmaSyncLost
+ *
+ * DESCRIPTION:
+ * Stops the device sending until the next beacon is heard.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psSchedule      RW  Schedule
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTdmaSyncLost(tsTdmaSchedule *psSchedule)
+{
+    psSchedule->bSynced = FALSE;
+}
+
+/****************************************************************************
+ *
+ * NAME: bTdmaInSlot
+ *
+ * DESCRIPTION:
+ * Whether a frame may be started now. The notification lags the beacon by
+ * the beacon's own airtime, which the guard at the end of the slot covers.
+ * The beacon sequence number wraps at 256, so when TDMA_CYCLES does not
+ * divide 256 one group keeps its slot for an extra beacon at the wrap;
+ * a slot is still never owned by two devices at once.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psSchedule      R   Schedule
+ *                  u32NowMs        R   Current time (ms)
+ *
+ * RETURNS: bool_t TRUE inside the device's slot
+ *
+ ****************************************************************************/
+PUBLIC bool_t bTdmaInSlot(tsTdmaSchedule *psSchedule, uint32 u32NowMs)
+{
+    uint32 u32ElapsedMs;
+    uint32 u32StartMs;
+    uint32 u32EndMs;
+
+    if (!psSchedule->bSynced ||
+        ((psSchedule->u8Bsn % TDMA_CYCLES) != psSchedule->sSlot.u8Cycle))
+    {
+        return FALSE;
+    }
+
+    u32ElapsedMs = u32NowMs - psSchedule->u32BeaconMs;
+    u32StartMs   = (psSchedule->sSlot.u8Slot * TDMA_SLOT_US) / 1000;
+    u32EndMs     = ((psSchedule->sSlot.u8Slot + 1) * TDMA_SLOT_US) / 1000 - TDMA_GUARD_MS;
+
+    return (u32ElapsedMs >= u32StartMs) && (u32ElapsedMs < u32EndMs);
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,105 @@
+/****************************************************************************
+ *
+ * MODULE:      tdma.h
+ *
+ * DESCRIPTION:
+ * Reporting slots in a beacon enabled superframe. The active period after
+ * each beacon is split into 16 equal slots; slot 0 carries the beacon and
+ * each of the other 15 is owned by one end device, which only passes
+ * frames to the MAC inside it. Once more than TDMA_SLOTS devices can
+ * associate, successive beacons are taken in turn by groups of devices, so
+ * each device still owns one slot every TDMA_CYCLES beacons. Only the
+ * first TDMA_DEVICES addresses are given a slot, keeping the wait for one
+ * shorter than the time a report is held before it is dropped as stale.
+ *
+ * Slots are derived from the short address the coordinator hands out, so
+ * both ends agree on them without any further signalling.
+ *
+ ****************************************************************************/
+
+#ifndef  TDMA_H_INCLUDED
+#define  TDMA_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "config.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* A superframe slot is 2^SUPERFRAME_ORDER base slots of 60 symbols (16us) */
+#define TDMA_SLOT_US                (960UL << SUPERFRAME_ORDER)
+
+/* Slots available for reporting, 1 to 15 */
+#define TDMA_FIRST_SLOT             1
+#define TDMA_SLOTS                  15
+
+/* Devices given a slot */
+#if TDMA_MAX_DEVICES < MAX_END_DEVICES
+#define TDMA_DEVICES                TDMA_MAX_DEVICES
+#else
+#define TDMA_DEVICES                MAX_END_DEVICES
+#endif
+
+/* Beacons in a full cycle of the slot schedule */
+#define TDMA_CYCLES                 ((TDMA_DEVICES + TDMA_SLOTS - 1) / TDMA_SLOTS)
+
+/* Beacon interval, 16 superframe slots at BEACON_ORDER */
+#define TDMA_BEACON_US              (15360UL << BEACON_ORDER)
+
+/* Longest a device waits from the end of one of its slots to the start of
+   the next (ms). One group keeps its slot for an extra beacon when the
+   sequence number wraps, unless TDMA_CYCLES divides 256. */
+#define TDMA_MAX_WAIT_MS            ((((256 % TDMA_CYCLES) == 0 ? TDMA_CYCLES : TDMA_CYCLES + 1) * \
+                                      TDMA_BEACON_US) / 1000)
+
+/* Frames are not started this close to the end of a slot, leaving time for
+   the frame and its ack (ms) */
+#define TDMA_GUARD_MS               6
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/* Slot owned by one end device */
+typedef struct
+{
+    uint8   u8Slot;             /* Superframe slot */
+    uint8   u8Cycle;            /* Beacon, modulo TDMA_CYCLES, owning the slot */
+} tsTdmaSlot;
+
+/* End device's view of the superframe */
+typedef struct
+{
+    tsTdmaSlot sSlot;
+    bool_t  bSynced;            /* A beacon has been heard since sync was lost */
+    uint8   u8Bsn;              /* Sequence number of the last beacon */
+    uint32  u32BeaconMs;        /* Time the last beacon was notified */
+} tsTdmaSchedule;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC bool_t bTdmaHasSlot(uint16 u16ShortAdr);
+PUBLIC void   vTdmaAssign(uint16 u16ShortAdr, tsTdmaSlot *psSlot);
+PUBLIC void   vTdmaInit(tsTdmaSchedule *psSchedule, uint16 u16ShortAdr);
+PUBLIC void   vTdmaBeacon(tsTdmaSchedule *psSchedule, uint8 u8Bsn, uint32 u32NowMs);
+PUBLIC void   vTdmaSyncLost(tsTdmaSchedule *psSchedule);
+PUBLIC bool_t bTdmaInSlot(tsTdmaSchedule *psSchedule, uint32 u32NowMs);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* TDMA_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,126 @@
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include <AppHardwareApi.h>
+#include "tickclock.h"
+
+/****************************************************************************/
+/***        Local Variables                                               ***/
+/****************************************************************************/
+PRIVATE uint32 u32ClockMs;
+PRIVATE uint32 u32LastTicks;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vTickClockInit
+ *
+ * DESCRIPTION:
+ * Starts the tick timer free running from zero. No interrupt is used; the
+ * millisecond clock is advanced whenever u32TickClockNowMs is called.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTickClockInit(void)
+{
+    vAHI_TickTimerConfigure(E_AHI_TICK_TIMER_DISABLE);
+    vAHI_TickTimerWrite(0);
+    vAHI_TickTimerIntEnable(FALSE);
+    vAHI_TickTimerConfigure(E_AHI_TICK_TIMER_CONT);
+
+    u32ClockMs   = 0;
+    u32LastTicks = 0;
+}
+
+/****************************************************************************
+ *
+ * NAME: vTickClockResume
+ *
+ * DESCRIPTION:
+ * Restarts the tick timer after sleep, which stops it, and carries the
+ * millisecond clock on across the time asleep.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32SleptMs      R   Time asleep (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTickClockResume(uint32 u32SleptMs)
+{
+    uint32 u32ClockMsBefore = u32ClockMs;
+
+    vTickClockInit();
+    u32ClockMs = u32ClockMsBefore + u32SleptMs;
+}
+
+/****************************************************************************
+ *
+ * NAME: u32TickClockNowMs
+ *
+ * DESCRIPTION:
+ * Returns milliseconds since vTickClockInit. The 32-bit tick counter wraps
+ * every 268 seconds, so this must be called at least that often; the main
+ * loop of either node easily does so.
+ *
+ * RETURNS: uint32 current time (ms)
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32TickClockNowMs(void)
+{
+    uint32 u32Elapsed = u32AHI_TickTimerRead() - u32LastTicks;
+    uint32 u32Ms      = u32Elapsed / TICK_CLOCK_TICKS_PER_MS;
+
+    /* Carry the sub-millisecond remainder over to the next call */
+    u32LastTicks += u32Ms * TICK_CLOCK_TICKS_PER_MS;
+    u32ClockMs   += u32Ms;
+
+    return u32ClockMs;
+}
+
+/****************************************************************************
+ *
+ * NAME: u32TickClockTicks
+ *
+ * DESCRIPTION:
+ * Raw tick timer count. Unlike u32TickClockNowMs this changes no state, so
+ * it may be used to timestamp events from interrupt context.
+ *
+ * RETURNS: uint32 tick count
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32TickClockTicks(void)
+{
+    return u32AHI_TickTimerRead();
+}
+
+/****************************************************************************
+ *
+ * NAME: u32TickClockTicksToMs
+ *
+ * DESCRIPTION:
+ * Converts a tick count taken earlier with u32TickClockTicks to the
+ * millisecond time base. The count must be less than 268 seconds old.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32Ticks        R   Tick count to convert
+ *
+ * RETURNS: uint32 time (ms) at which u32Ticks was read
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32TickClockTicksToMs(uint32 u32Ticks)
+{
+    uint32 u32NowMs = u32TickClockNowMs();
+    uint32 u32Age   = u32AHI_TickTimerRead() - u32Ticks;
+
+    return u32NowMs - u32Age / TICK_CLOCK_TICKS_PER_MS;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
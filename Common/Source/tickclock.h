@@ -0,0 +1,51 @@
+/****************************************************************************
+ *
+ * MODULE:      tickclock.h
+ *
+ * DESCRIPTION:
+ * Millisecond time base derived from the free-running tick timer.
+ *
+ ****************************************************************************/
+
+#ifndef  TICKCLOCK_H_INCLUDED
+#define  TICKCLOCK_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* The tick timer is clocked from the 16MHz system clock */
+#define TICK_CLOCK_TICKS_PER_MS     16000UL
+
+/* TRUE once time u32Deadline (ms) has been reached. Safe across wraparound
+   provided the deadline is less than 2^31 ms away. */
+#define TICK_CLOCK_EXPIRED(u32Now, u32Deadline) \
+    ((int32)((u32Now) - (u32Deadline)) >= 0)
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC void   vTickClockInit(void);
+PUBLIC void   vTickClockResume(uint32 u32SleptMs);
+PUBLIC uint32 u32TickClockNowMs(void);
+PUBLIC uint32 u32TickClockTicks(void);
+PUBLIC uint32 u32TickClockTicksToMs(uint32 u32Ticks);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* TICKCLOCK_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
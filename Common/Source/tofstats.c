@@ -0,0 +1,500 @@
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "fixedpoint.h"
+#include "tofstats.h"
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE uint64 u64TofStatsVariance64(tsTofStats *psStats);
+PRIVATE uint32 u32Key(int32 i32Value, bool_t bByMagnitude);
+PRIVATE void   vEstimateFromStats(tsTofStats *psStats, tsTofEstimate *psEstimate);
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vTofStatsReset
+ *
+ * DESCRIPTION:
+ * Clears the accumulator ready for a new burst.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psStats         W   Accumulator
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTofStatsReset(tsTofStats *psStats)
+{
+    psStats->u8Count  = 0;
+    psStats->u8Errors = 0;
+    psStats->i32Pivot = 0;
+    psStats->i64Sum   = 0;
+    psStats->u64SumSq = 0;
+}
+
+/****************************************************************************
+ *
+ * NAME: vTofStatsAdd
+ *
+ * DESCRIPTION:
+ * Accumulates one successful reading.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psStats         RW  Accumulator
+ *                  s32Tof          R   Reading (ps)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTofStatsAdd(tsTofStats *psStats, int32 s32Tof)
+{
+    int64  i64Dev;
+    uint64 u64Mag;
+    uint64 u64Sq;
+
+    if (psStats->u8Count == 0)
+    {
+        psStats->i32Pivot = s32Tof;
+    }
+    psStats->u8Count++;
+
+    /* The deviation fits 33 bits, so its magnitude squares in 64 */
+    i64Dev = (int64)s32Tof - psStats->i32Pivot;
+    u64Mag = (i64Dev < 0) ? (uint64)-i64Dev : (uint64)i64Dev;
+    u64Sq  = u64Mag * u64Mag;
+
+    psStats->i64Sum += i64Dev;
+    psStats->u64SumSq = (psStats->u64SumSq > 0xffffffffffffffffuLL - u64Sq) ?
+                        0xffffffffffffffffuLL : psStats->u64SumSq + u64Sq;
+}
+
+/****************************************************************************
+ *
+ * NAME: vTofStatsAddError
+ *
+ * DESCRIPTION:
+ * Counts a reading that was rejected on its status.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psStats         RW  Accumulator
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTofStatsAddError(tsTofStats *psStats)
+{
+    psStats->u8Errors++;
+}
+
+/****************************************************************************
+ *
+ * NAME: i32TofStatsMean
+ *
+ * DESCRIPTION:
+ * Mean of the accumulated readings, rounded to the nearest picosecond.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psStats         R   Accumulator
+ *
+ * RETURNS: int32 mean ToF (ps), 0 if no readings were accumulated
+ *
+ ****************************************************************************/
+PUBLIC int32 i32TofStatsMean(tsTofStats *psStats)
+{
+    int64 i64Count = psStats->u8Count;
+
+    if (i64Count == 0)
+    {
+        return 0;
+    }
+
+    return (int32)FIXED_DIV_ROUND((int64)psStats->i32Pivot * i64Count + psStats->i64Sum, i64Count);
+}
+
+/****************************************************************************
+ *
+ * NAME: u32TofStatsVariance
+ *
+ * DESCRIPTION:
+ * Population variance of the accumulated readings.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psStats         R   Accumulator
+ *
+ * RETURNS: uint32 variance (ps^2), saturated at 0xffffffff
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32TofStatsVariance(tsTofStats *psStats)
+{
+    uint64 u64Variance = u64TofStatsVariance64(psStats);
+
+    if (u64Variance > 0xffffffffuLL)
+    {
+        return 0xffffffffUL;
+    }
+
+    return (uint32)u64Variance;
+}
+
+/****************************************************************************
+ *
+ * NAME: u32TofStatsStdDev
+ *
+ * DESCRIPTION:
+ * Population standard deviation of the accumulated readings.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psStats         R   Accumulator
+ *
+ * RETURNS: uint32 standard deviation (ps), rounded down
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32TofStatsStdDev(tsTofStats *psStats)
+{
+    return u32FixedSqrt64(u64TofStatsVariance64(psStats));
+}
+
+/****************************************************************************
+ *
+ * NAME: i32TofPsToCm
+ *
+ * DESCRIPTION:
+ * Converts a single ToF value to a distance. Whole multiples of the
+ * denominator are scaled separately, so any int32 ToF converts without
+ * overflow and still rounds only once.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  s32Tof          R   ToF (ps)
+ *
+ * RETURNS: int32 distance (cm), rounded to nearest
+ *
+ ****************************************************************************/
+PUBLIC int32 i32TofPsToCm(int32 s32Tof)
+{
+    int32 i32Whole = s32Tof / TOF_CM_PER_PS_DEN;
+    int32 i32Part  = (s32Tof % TOF_CM_PER_PS_DEN) * TOF_CM_PER_PS_NUM;
+
+    return i32Whole * TOF_CM_PER_PS_NUM + FIXED_DIV_ROUND(i32Part, TOF_CM_PER_PS_DEN);
+}
+
+/****************************************************************************
+ *
+ * NAME: i32TofSelect
+ *
+ * DESCRIPTION:
+ * Finds the value of the given rank (0 = smallest) by quickselect. The array
+ * is partially reordered in place: on return every value before u8Rank is
+ * no greater, and every value after it no smaller, than the one returned.
+ * Values may be ranked by magnitude, for selecting absolute deviations
+ * without losing their sign.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pai32Values     RW  Values to select from
+ *                  u8Count         R   Number of values, at least 1
+ *                  u8Rank          R   Rank to select, less than u8Count
+ *                  bByMagnitude    R   Rank by absolute value
+ *
+ * RETURNS: int32 value of rank u8Rank
+ *
+ ****************************************************************************/
+PUBLIC int32 i32TofSelect(int32 *pai32Values, uint8 u8Count, uint8 u8Rank, bool_t bByMagnitude)
+{
+    int32  i32Lo = 0;
+    int32  i32Hi = (int32)u8Count - 1;
+    int32  i, j;
+    int32  i32Tmp;
+    uint32 u32Pivot;
+
+    while (i32Lo < i32Hi)
+    {
+        /* Hoare partition about the middle element */
+        u32Pivot = u32Key(pai32Values[i32Lo + (i32Hi - i32Lo) / 2], bByMagnitude);
+        i = i32Lo;
+        j = i32Hi;
+
+        while (i <= j)
+        {
+            while (u32Key(pai32Values[i], bByMagnitude) < u32Pivot)
+            {
+                i++;
+            }
+            while (u32Key(pai32Values[j], bByMagnitude) > u32Pivot)
+            {
+                j--;
+            }
+            if (i <= j)
+            {
+                i32Tmp         = pai32Values[i];
+                pai32Values[i] = pai32Values[j];
+                pai32Values[j] = i32Tmp;
+                i++;
+                j--;
+            }
+        }
+
+        /* Continue only in the part holding the wanted rank */
+        if (u8Rank <= j)
+        {
+            i32Hi = j;
+        }
+        else if (u8Rank >= i)
+        {
+            i32Lo = i;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return pai32Values[u8Rank];
+}
+
+/****************************************************************************
+ *
+ * NAME: vTofEstimate
+ *
+ * DESCRIPTION:
+ * Reduces the successful readings of a burst to a single ToF value using
+ * the chosen estimator. The readings are reordered, and for MAD rejection
+ * temporarily rewritten, in place; no other storage is needed.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  eEstimator      R   Estimator to apply
+ *                  pai32Tof        RW  Successful readings (ps)
+ *                  u8Count         R   Number of readings
+ *                  psEstimate      W   Result
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTofEstimate(teTofEstimator eEstimator, int32 *pai32Tof, uint8 u8Count, tsTofEstimate *psEstimate)
+{
+    tsTofStats sStats;
+    int32  i32Median;
+    uint32 u32Mad;
+    uint32 u32Limit;
+    uint8  u8Trim;
+    uint8  n;
+
+    psEstimate->i32Tof    = 0;
+    psEstimate->u32Spread = 0;
+    psEstimate->u8Used    = 0;
+
+    if (u8Count == 0)
+    {
+        return;
+    }
+
+    vTofStatsReset(&sStats);
+
+    switch (eEstimator)
+    {
+    case E_TOF_ESTIMATOR_MEDIAN:
+    case E_TOF_ESTIMATOR_MAD_REJECT:
+        i32Median = i32TofSelect(pai32Tof, u8Count, u8Count / 2, FALSE);
+
+        /* Work on deviations from the median so the MAD can be selected
+           by magnitude while the sign, and so the reading, is kept */
+        for (n = 0; n < u8Count; n++)
+        {
+            pai32Tof[n] -= i32Median;
+        }
+        u32Mad = u32Key(i32TofSelect(pai32Tof, u8Count, u8Count / 2, TRUE), TRUE);
+
+        if (eEstimator == E_TOF_ESTIMATOR_MEDIAN)
+        {
+            psEstimate->i32Tof    = i32Median;
+            psEstimate->u32Spread = (u32Mad * 14826UL + 5000UL) / 10000UL;
+            psEstimate->u8Used    = u8Count;
+        }
+        else
+        {
+            u32Limit = (u32Mad * TOF_MAD_REJECT_NUM) / TOF_MAD_REJECT_DEN;
+            if (u32Limit < TOF_MAD_REJECT_MIN_PS)
+            {
+                u32Limit = TOF_MAD_REJECT_MIN_PS;
+            }
+
+            for (n = 0; n < u8Count; n++)
+            {
+                if (u32Key(pai32Tof[n], TRUE) <= u32Limit)
+                {
+                    vTofStatsAdd(&sStats, pai32Tof[n] + i32Median);
+                }
+            }
+            vEstimateFromStats(&sStats, psEstimate);
+        }
+
+        for (n = 0; n < u8Count; n++)
+        {
+            pai32Tof[n] += i32Median;
+        }
+        break;
+
+    case E_TOF_ESTIMATOR_TRIMMED_MEAN:
+        u8Trim = (uint8)(((uint16)u8Count * TOF_TRIM_PERCENT) / 100);
+
+        /* After selecting both cut points, the readings between them are
+           exactly the central u8Count - 2 x u8Trim values */
+        if (u8Trim > 0)
+        {
+            (void)i32TofSelect(pai32Tof, u8Count, u8Trim, FALSE);
+            (void)i32TofSelect(&pai32Tof[u8Trim], u8Count - u8Trim,
+                               u8Count - 2 * u8Trim - 1, FALSE);
+        }
+
+        for (n = u8Trim; n < u8Count - u8Trim; n++)
+        {
+            vTofStatsAdd(&sStats, pai32Tof[n]);
+        }
+        vEstimateFromStats(&sStats, psEstimate);
+        break;
+
+    case E_TOF_ESTIMATOR_MEAN:
+    default:
+        for (n = 0; n < u8Count; n++)
+        {
+            vTofStatsAdd(&sStats, pai32Tof[n]);
+        }
+        vEstimateFromStats(&sStats, psEstimate);
+        break;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: u64TofEstimateVariance
+ *
+ * DESCRIPTION:
+ * Variance of a burst estimate, spread^2 / N, used to weight it against
+ * other estimates.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psEstimate      R   Estimate
+ *
+ * RETURNS: uint64 variance (ps^2), or 0 if the estimate used no readings
+ *
+ ****************************************************************************/
+PUBLIC uint64 u64TofEstimateVariance(tsTofEstimate *psEstimate)
+{
+    if (psEstimate->u8Used == 0)
+    {
+        return 0;
+    }
+
+    return ((uint64)psEstimate->u32Spread * psEstimate->u32Spread) / psEstimate->u8Used;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: u32Key
+ *
+ * DESCRIPTION:
+ * Ordering key for i32TofSelect. Signed values are offset into unsigned
+ * order so one comparison serves both modes.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  i32Value        R   Value
+ *                  bByMagnitude    R   Use the absolute value
+ *
+ * RETURNS: uint32 key
+ *
+ ****************************************************************************/
+PRIVATE uint32 u32Key(int32 i32Value, bool_t bByMagnitude)
+{
+    if (bByMagnitude)
+    {
+        return (i32Value < 0) ? (uint32)0 - (uint32)i32Value : (uint32)i32Value;
+    }
+
+    return (uint32)i32Value ^ 0x80000000UL;
+}
+
+/****************************************************************************
+ *
+ * NAME: vEstimateFromStats
+ *
+ * DESCRIPTION:
+ * Fills an estimate from the mean and standard deviation of an accumulator.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psStats         R   Accumulator
+ *                  psEstimate      W   Result
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vEstimateFromStats(tsTofStats *psStats, tsTofEstimate *psEstimate)
+{
+    psEstimate->i32Tof    = i32TofStatsMean(psStats);
+    psEstimate->u32Spread = u32TofStatsStdDev(psStats);
+    psEstimate->u8Used    = psStats->u8Count;
+}
+
+/****************************************************************************
+ *
+ * NAME: u64TofStatsVariance64
+ *
+ * DESCRIPTION:
+ * Population variance, (N x sum(d^2) - sum(d)^2) / N^2 rounded down, for
+ * deviations d from the pivot. sum(d)^2 may not fit 64 bits, so it is not
+ * formed: with sum(d)^2 = qN + r, the variance is A / N for A = sum(d^2) - q,
+ * less one where A divides exactly and r is not 0. q is no more than
+ * sum(d^2), so nothing overflows unless that has saturated.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psStats         R   Accumulator
+ *
+ * RETURNS: uint64 variance (ps^2)
+ *
+ ****************************************************************************/
+PRIVATE uint64 u64TofStatsVariance64(tsTofStats *psStats)
+{
+    uint64 u64Count = psStats->u8Count;
+    uint64 u64Mag;
+    uint64 u64Quot;
+    uint64 u64Rem;
+    uint64 u64Excess;
+
+    if (u64Count == 0)
+    {
+        return 0;
+    }
+    if (psStats->u64SumSq == 0xffffffffffffffffuLL)
+    {
+        return psStats->u64SumSq / u64Count;
+    }
+
+    /* |sum(d)| x |sum(d)| = qN + r, one factor split as aN + b */
+    u64Mag  = (psStats->i64Sum < 0) ? (uint64)-psStats->i64Sum : (uint64)psStats->i64Sum;
+    u64Quot = (u64Mag / u64Count) * u64Mag + ((u64Mag % u64Count) * u64Mag) / u64Count;
+    u64Rem  = ((u64Mag % u64Count) * (u64Mag % u64Count)) % u64Count;
+
+    /* Exact arithmetic guarantees this, but guard against wrap regardless */
+    if (psStats->u64SumSq <= u64Quot)
+    {
+        return 0;
+    }
+
+    u64Excess = psStats->u64SumSq - u64Quot;
+    if ((u64Rem != 0) && ((u64Excess % u64Count) == 0))
+    {
+        return u64Excess / u64Count - 1;
+    }
+    return u64Excess / u64Count;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,100 @@
+/****************************************************************************
+ *
+ * MODULE:      tofstats.h
+ *
+ * DESCRIPTION:
+ * Single pass, fixed point statistics over the readings of a ToF burst.
+ *
+ ****************************************************************************/
+
+#ifndef  TOFSTATS_H_INCLUDED
+#define  TOFSTATS_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Distance (cm) = ToF (ps) x 0.03 */
+#define TOF_CM_PER_PS_NUM           3
+#define TOF_CM_PER_PS_DEN           100
+
+/* Fraction of readings discarded from each end by the trimmed mean */
+#define TOF_TRIM_PERCENT            25
+
+/* MAD rejection keeps readings within 3 robust standard deviations of the
+   median, where sigma = 1.4826 x MAD. 3 x 1.4826 ~= 89 / 20. */
+#define TOF_MAD_REJECT_NUM          89
+#define TOF_MAD_REJECT_DEN          20
+
+/* Lower bound on the MAD rejection window, so bursts in which most readings
+   are identical do not reject all the rest (ps) */
+#define TOF_MAD_REJECT_MIN_PS       100
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/* Running sums over the successful readings of a burst. The sums are exact
+   integers, so the variance formed from them at the end suffers none of the
+   cancellation that makes this form unsafe in floating point. They are of
+   the readings less the first, so they grow with the spread of the burst
+   rather than with its distance. */
+typedef struct
+{
+    uint8   u8Count;        /* Successful readings accumulated */
+    uint8   u8Errors;       /* Readings rejected on status */
+    int32   i32Pivot;       /* First reading (ps) */
+    int64   i64Sum;         /* Sum of ToF less the pivot (ps) */
+    uint64  u64SumSq;       /* Sum of its square (ps^2), saturating */
+} tsTofStats;
+
+/* Location estimators that may be applied to a burst */
+typedef enum
+{
+    E_TOF_ESTIMATOR_MEAN,           /* Mean of all successful readings */
+    E_TOF_ESTIMATOR_MEDIAN,         /* Median; spread is 1.4826 x MAD */
+    E_TOF_ESTIMATOR_TRIMMED_MEAN,   /* Mean of the central readings */
+    E_TOF_ESTIMATOR_MAD_REJECT      /* Mean after rejecting outliers by MAD */
+} teTofEstimator;
+
+/* Result of reducing a burst with one of the estimators above */
+typedef struct
+{
+    int32   i32Tof;         /* Location estimate (ps) */
+    uint32  u32Spread;      /* Standard deviation or robust equivalent (ps) */
+    uint8   u8Used;         /* Readings contributing to the estimate */
+} tsTofEstimate;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC void   vTofStatsReset(tsTofStats *psStats);
+PUBLIC void   vTofStatsAdd(tsTofStats *psStats, int32 s32Tof);
+PUBLIC void   vTofStatsAddError(tsTofStats *psStats);
+PUBLIC int32  i32TofStatsMean(tsTofStats *psStats);
+PUBLIC uint32 u32TofStatsVariance(tsTofStats *psStats);
+PUBLIC uint32 u32TofStatsStdDev(tsTofStats *psStats);
+PUBLIC int32  i32TofPsToCm(int32 s32Tof);
+
+PUBLIC int32  i32TofSelect(int32 *pai32Values, uint8 u8Count, uint8 u8Rank, bool_t bByMagnitude);
+PUBLIC void   vTofEstimate(teTofEstimator eEstimator, int32 *pai32Tof, uint8 u8Count, tsTofEstimate *psEstimate);
+PUBLIC uint64 u64TofEstimateVariance(tsTofEstimate *psEstimate);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* TOFSTATS_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
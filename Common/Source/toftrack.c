@@ -0,0 +1,263 @@
+/****************************************************************************
+ *
+ * MODULE:      toftrack.c
+ *
+ * DESCRIPTION:
+ * Fixed point Kalman filter tracking the ToF of one link, and its rate of
+ * change, across successive burst estimates. Each estimate is weighted by
+ * its variance against the prediction from earlier ones, so short, noisy
+ * bursts still give a steady distance.
+ *
+ * The state and covariance are held in ps and ps^2, which keeps every
+ * product within 64 bits for links of any realistic length. Gains are
+ * held as fractions of 2^16.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include "fixedpoint.h"
+#include "toftrack.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+#define GAIN_ONE                    65536LL
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE bool_t bElapsedMs(tsTofTrack *psTrack, uint32 u32NowMs, uint32 *pu32DtMs);
+PRIVATE void   vPredict(tsTofTrack *psTrack, uint32 u32DtMs);
+PRIVATE void   vStart(tsTofTrack *psTrack, uint32 u32NowMs, int32 i32Tof, uint64 u64Variance);
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vTofTrackReset
+ *
+ * DESCRIPTION:
+ * Discards the track. The next estimate starts a new one.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTrack         W   Track
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTofTrackReset(tsTofTrack *psTrack)
+{
+    psTrack->bValid    = FALSE;
+    psTrack->u8Misses  = 0;
+    psTrack->u32LastMs = 0;
+    psTrack->i32Tof    = 0;
+    psTrack->i32Rate   = 0;
+    psTrack->u64P00    = 0;
+    psTrack->i64P01    = 0;
+    psTrack->u64P11    = 0;
+}
+
+/****************************************************************************
+ *
+ * NAME: u64TofTrackPriorVariance
+ *
+ * DESCRIPTION:
+ * Variance the track predicts for the ToF at a given time, before any new
+ * estimate is applied. The track is not changed.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTrack         R   Track
+ *                  u32NowMs        R   Time of the prediction (ms)
+ *
+ * RETURNS: uint64 variance (ps^2), or all ones if there is no usable track
+ *
+ ****************************************************************************/
+PUBLIC uint64 u64TofTrackPriorVariance(tsTofTrack *psTrack, uint32 u32NowMs)
+{
+    tsTofTrack sPrior = *psTrack;
+    uint32 u32DtMs;
+
+    if (!bElapsedMs(&sPrior, u32NowMs, &u32DtMs))
+    {
+        return ~0ULL;
+    }
+
+    vPredict(&sPrior, u32DtMs);
+
+    return sPrior.u64P00;
+}
+
+/****************************************************************************
+ *
+ * NAME: bTofTrackUpdate
+ *
+ * DESCRIPTION:
+ * Predicts the track forward to the time of a burst estimate and fuses the
+ * estimate into it. Estimates outside the gate are rejected, unless enough
+ * have been rejected in a row that the track is restarted from this one.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTrack         RW  Track
+ *                  u32NowMs        R   Time of the estimate (ms)
+ *                  i32Tof          R   Burst estimate (ps)
+ *                  u64Variance     R   Variance of the estimate (ps^2)
+ *
+ * RETURNS: bool_t TRUE if the estimate was used
+ *
+ ****************************************************************************/
+PUBLIC bool_t bTofTrackUpdate(tsTofTrack *psTrack, uint32 u32NowMs, int32 i32Tof, uint64 u64Variance)
+{
+    uint32 u32DtMs;
+    uint64 u64S;
+    uint64 u64Innovation2;
+    int64  i64Innovation;
+    int64  i64K0;
+    int64  i64K1;
+
+    if (u64Variance < TOF_TRACK_MIN_MEAS_VAR)
+    {
+        u64Variance = TOF_TRACK_MIN_MEAS_VAR;
+    }
+
+    if (!bElapsedMs(psTrack, u32NowMs, &u32DtMs))
+    {
+        vStart(psTrack, u32NowMs, i32Tof, u64Variance);
+        return TRUE;
+    }
+
+    vPredict(psTrack, u32DtMs);
+    psTrack->u32LastMs = u32NowMs;
+
+    /* Innovation and its variance */
+    i64Innovation  = (int64)i32Tof - psTrack->i32Tof;
+    u64Innovation2 = (uint64)(i64Innovation < 0 ? -i64Innovation : i64Innovation);
+    u64Innovation2 *= u64Innovation2;
+    u64S = psTrack->u64P00 + u64Variance;
+
+    if (u64Innovation2 > (uint64)TOF_TRACK_GATE_SIGMA * TOF_TRACK_GATE_SIGMA * u64S)
+    {
+        if (++psTrack->u8Misses >= TOF_TRACK_MAX_MISSES)
+        {
+            vStart(psTrack, u32NowMs, i32Tof, u64Variance);
+            return TRUE;
+        }
+        return FALSE;
+    }
+    psTrack->u8Misses = 0;
+
+    /* Kalman gain for a measurement of the ToF alone, H = [1 0] */
+    i64K0 = (int64)((psTrack->u64P00 << 16) / u64S);
+    i64K1 = (psTrack->i64P01 * GAIN_ONE) / (int64)u64S;
+
+    psTrack->i32Tof  += (int32)FIXED_DIV_ROUND(i64K0 * i64Innovation, GAIN_ONE);
+    psTrack->i32Rate += (int32)FIXED_DIV_ROUND(i64K1 * i64Innovation, GAIN_ONE);
+
+    /* P = (I - KH) P. K1 x P01 uses the prior P01, so update P11 first. */
+    psTrack->u64P11 -= (uint64)((i64K1 * psTrack->i64P01) / GAIN_ONE);
+    psTrack->u64P00 -= (uint64)((i64K0 * (int64)psTrack->u64P00) / GAIN_ONE);
+    psTrack->i64P01 -= (i64K0 * psTrack->i64P01) / GAIN_ONE;
+
+    return TRUE;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: bElapsedMs
+ *
+ * DESCRIPTION:
+ * Time since the track was last updated, if the track is still usable.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTrack         R   Track
+ *                  u32NowMs        R   Current time (ms)
+ *                  pu32DtMs        W   Elapsed time (ms)
+ *
+ * RETURNS: bool_t FALSE if there is no track or it has gone stale
+ *
+ ****************************************************************************/
+PRIVATE bool_t bElapsedMs(tsTofTrack *psTrack, uint32 u32NowMs, uint32 *pu32DtMs)
+{
+    int32 i32Dt = (int32)(u32NowMs - psTrack->u32LastMs);
+
+    if (!psTrack->bValid || (i32Dt > TOF_TRACK_MAX_GAP_MS))
+    {
+        return FALSE;
+    }
+
+    /* Estimates may be reduced slightly out of order, treat as simultaneous */
+    *pu32DtMs = (i32Dt > 0) ? (uint32)i32Dt : 0;
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: vPredict
+ *
+ * DESCRIPTION:
+ * Constant velocity prediction. With F = [1 dt; 0 1] and white acceleration
+ * of density q, P' = F P F' + q [dt^3/3 dt^2/2; dt^2/2 dt]. dt is in ms, so
+ * each power of dt is scaled by 1000.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTrack         RW  Track
+ *                  u32DtMs         R   Prediction interval (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vPredict(tsTofTrack *psTrack, uint32 u32DtMs)
+{
+    int64 i64Dt = u32DtMs;
+    int64 i64Q  = ((int64)TOF_TRACK_ACCEL_NOISE * i64Dt) / 1000;
+
+    psTrack->i32Tof += (int32)FIXED_DIV_ROUND((int64)psTrack->i32Rate * i64Dt, 1000);
+
+    psTrack->u64P00 += (uint64)((2 * psTrack->i64P01 * i64Dt) / 1000 +
+                                ((int64)psTrack->u64P11 * i64Dt * i64Dt) / 1000000 +
+                                ((i64Q * i64Dt) / 1000 * i64Dt) / 3000);
+    psTrack->i64P01 += ((int64)psTrack->u64P11 * i64Dt) / 1000 +
+                       (i64Q * i64Dt) / 2000;
+    psTrack->u64P11 += (uint64)i64Q;
+}
+
+/****************************************************************************
+ *
+ * NAME: vStart
+ *
+ * DESCRIPTION:
+ * Starts a track at a burst estimate, with the link assumed stationary.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTrack         W   Track
+ *                  u32NowMs        R   Time of the estimate (ms)
+ *                  i32Tof          R   Burst estimate (ps)
+ *                  u64Variance     R   Variance of the estimate (ps^2)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vStart(tsTofTrack *psTrack, uint32 u32NowMs, int32 i32Tof, uint64 u64Variance)
+{
+    psTrack->bValid    = TRUE;
+    psTrack->u8Misses  = 0;
+    psTrack->u32LastMs = u32NowMs;
+    psTrack->i32Tof    = i32Tof;
+    psTrack->i32Rate   = 0;
+    psTrack->u64P00    = u64Variance;
+    psTrack->i64P01    = 0;
+    psTrack->u64P11    = TOF_TRACK_INIT_RATE_VAR;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,80 @@
+/****************************************************************************
+ *
+ * MODULE:      toftrack.h
+ *
+ * DESCRIPTION:
+ * Fixed point Kalman filter tracking the ToF of one link, and its rate of
+ * change, across successive burst estimates.
+ *
+ ****************************************************************************/
+
+#ifndef  TOFTRACK_H_INCLUDED
+#define  TOFTRACK_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Process noise: spectral density of the random acceleration of the link
+   (ps^2/s^3). 1e6 suits a tag carried at walking pace, allowing roughly
+   0.3 m/s^2 of unmodelled acceleration. */
+#define TOF_TRACK_ACCEL_NOISE       1000000ULL
+
+/* Variance given to the rate when a track starts ((ps/s)^2) */
+#define TOF_TRACK_INIT_RATE_VAR     10000000ULL
+
+/* Floor on the variance of a burst estimate, so a burst whose readings
+   happen to agree exactly cannot lock the track (ps^2) */
+#define TOF_TRACK_MIN_MEAS_VAR      2500ULL
+
+/* A track not updated for this long is restarted by the next estimate */
+#define TOF_TRACK_MAX_GAP_MS        5000
+
+/* Estimates further than this many standard deviations from the prediction
+   are rejected. After TOF_TRACK_MAX_MISSES rejections in a row the track is
+   restarted, as the link has most likely moved. */
+#define TOF_TRACK_GATE_SIGMA        4
+#define TOF_TRACK_MAX_MISSES        3
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/* Constant velocity state of one link and its covariance */
+typedef struct
+{
+    bool_t  bValid;         /* Track has been started */
+    uint8   u8Misses;       /* Consecutive estimates rejected by the gate */
+    uint32  u32LastMs;      /* Time of the state below */
+    int32   i32Tof;         /* ToF (ps) */
+    int32   i32Rate;        /* Rate of change of ToF (ps/s) */
+    uint64  u64P00;         /* Variance of ToF (ps^2) */
+    int64   i64P01;         /* Covariance of ToF and rate (ps^2/s) */
+    uint64  u64P11;         /* Variance of rate ((ps/s)^2) */
+} tsTofTrack;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC void   vTofTrackReset(tsTofTrack *psTrack);
+PUBLIC uint64 u64TofTrackPriorVariance(tsTofTrack *psTrack, uint32 u32NowMs);
+PUBLIC bool_t bTofTrackUpdate(tsTofTrack *psTrack, uint32 u32NowMs, int32 i32Tof, uint64 u64Variance);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* TOFTRACK_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,124 @@
+/****************************************************************************
+ *
+ * MODULE:      txpower.c
+ *
+ * DESCRIPTION:
+ * Closed loop transmit power control, see txpower.h.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include <AppHardwareApi.h>
+#include "txpower.h"
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vTxPowerInit
+ *
+ * DESCRIPTION:
+ * Starts at full power, so a new link is found before it is trimmed, and
+ * applies it to the radio.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psPower         W   Controller
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTxPowerInit(tsTxPower *psPower)
+{
+    psPower->u8Level    = TX_POWER_LEVEL_MAX;
+    psPower->u8Spare    = 0;
+    psPower->u32Raised  = 0;
+    psPower->u32Lowered = 0;
+
+    vTxPowerApply(psPower);
+}
+
+/****************************************************************************
+ *
+ * NAME: vTxPowerApply
+ *
+ * DESCRIPTION:
+ * Sets the radio to the level in use, after it has been reinitialised.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psPower         R   Controller
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTxPowerApply(tsTxPower *psPower)
+{
+    (void)bAHI_PhyRadioSetPower(psPower->u8Level);
+}
+
+/****************************************************************************
+ *
+ * NAME: bTxPowerUpdate
+ *
+ * DESCRIPTION:
+ * Adjusts the level after a burst and applies any change to the radio.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psPower         RW  Controller
+ *                  u8Readings      R   Readings taken in the burst
+ *                  u8Errors        R   Readings that failed
+ *                  s8RemoteRssi    R   Mean RSSI at the far end of the
+ *                                      successful readings
+ *                  u8RemoteSqi     R   Mean SQI at the far end
+ *
+ * RETURNS:
+ * TRUE if the level changed
+ *
+ ****************************************************************************/
+PUBLIC bool_t bTxPowerUpdate(tsTxPower *psPower, uint8 u8Readings, uint8 u8Errors,
+                             int8 s8RemoteRssi, uint8 u8RemoteSqi)
+{
+    int16 i16Margin = (int16)s8RemoteRssi - TX_POWER_RSSI_FLOOR;
+
+    if ((u8Errors >= u8Readings) ||
+        ((uint16)u8Errors * 100 > (uint16)u8Readings * TX_POWER_MAX_ERROR_PERCENT) ||
+        (u8RemoteSqi < TX_POWER_MIN_SQI) ||
+        (i16Margin < TX_POWER_TARGET_MARGIN_DB))
+    {
+        psPower->u8Spare = 0;
+        if (psPower->u8Level >= TX_POWER_LEVEL_MAX)
+        {
+            return FALSE;
+        }
+        psPower->u8Level++;
+        psPower->u32Raised++;
+        vTxPowerApply(psPower);
+        return TRUE;
+    }
+
+    if ((psPower->u8Level <= TX_POWER_LEVEL_MIN) ||
+        (i16Margin - TX_POWER_LEVEL_STEP_DB < TX_POWER_TARGET_MARGIN_DB))
+    {
+        psPower->u8Spare = 0;
+        return FALSE;
+    }
+
+    if (++psPower->u8Spare < TX_POWER_HOLD_BURSTS)
+    {
+        return FALSE;
+    }
+
+    psPower->u8Spare = 0;
+    psPower->u8Level--;
+    psPower->u32Lowered++;
+    vTxPowerApply(psPower);
+    return TRUE;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
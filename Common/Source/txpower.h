@@ -0,0 +1,90 @@
+/****************************************************************************
+ *
+ * MODULE:      txpower.h
+ *
+ * DESCRIPTION:
+ * Closed loop transmit power control for a ranging link. After each burst
+ * the RSSI and SQI the far end measured on this node's frames are compared
+ * against a target margin above the weakest signal ranging still works
+ * with. Power is raised at once when the margin, the SQI or the readings
+ * fail, and lowered one level only after TX_POWER_HOLD_BURSTS bursts that
+ * would all still meet the target at the lower level.
+ *
+ * The radio has four discrete power settings roughly TX_POWER_LEVEL_STEP_DB
+ * apart, and on a high power module the PA adds a fixed gain to each, so
+ * the level rather than an output power in dBm is what is reported.
+ *
+ * RSSI is in the units of the ToF API readings, one per dB. The floor and
+ * SQI limit are typical figures and should be tuned on the board.
+ *
+ ****************************************************************************/
+
+#ifndef  TXPOWER_H_INCLUDED
+#define  TXPOWER_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* Settings of bAHI_PhyRadioSetPower */
+#define TX_POWER_LEVEL_MIN          0
+#define TX_POWER_LEVEL_MAX          3
+#define TX_POWER_LEVEL_STEP_DB      11
+
+/* RSSI of the weakest frames ranging still works with, and the margin
+   held above it */
+#ifndef TX_POWER_RSSI_FLOOR
+#define TX_POWER_RSSI_FLOOR         10
+#endif
+#ifndef TX_POWER_TARGET_MARGIN_DB
+#define TX_POWER_TARGET_MARGIN_DB   20
+#endif
+
+/* Lowest SQI at which ToF readings are trusted */
+#ifndef TX_POWER_MIN_SQI
+#define TX_POWER_MIN_SQI            50
+#endif
+
+/* Failed readings in a burst above which power is raised */
+#define TX_POWER_MAX_ERROR_PERCENT  25
+
+/* Bursts with margin to spare before power is lowered */
+#define TX_POWER_HOLD_BURSTS        5
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+typedef struct
+{
+    uint8   u8Level;            /* Setting in use */
+    uint8   u8Spare;            /* Bursts in a row with margin to spare */
+    uint32  u32Raised;          /* Times the level was raised */
+    uint32  u32Lowered;         /* Times the level was lowered */
+} tsTxPower;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC void   vTxPowerInit(tsTxPower *psPower);
+PUBLIC void   vTxPowerApply(tsTxPower *psPower);
+PUBLIC bool_t bTxPowerUpdate(tsTxPower *psPower, uint8 u8Readings, uint8 u8Errors,
+                             int8 s8RemoteRssi, uint8 u8RemoteSqi);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* TXPOWER_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
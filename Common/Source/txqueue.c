@@ -0,0 +1,404 @@
+/****************************************************************************
+ *
+ * MODULE:      txqueue.c
+ *
+ * DESCRIPTION:
+ * Bounded transmit ring for acknowledged data frames, see txqueue.h.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+#include <AppQueueApi.h>
+#include <mac_sap.h>
+#include "config.h"
+#include "tickclock.h"
+#include "txqueue.h"
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+typedef enum
+{
+    E_TX_SLOT_WAITING,          /* Ready to send */
+    E_TX_SLOT_IN_FLIGHT,        /* With the MAC, awaiting confirm */
+    E_TX_SLOT_BACKOFF           /* Failed, waiting to retry */
+} teTxSlotState;
+
+typedef struct
+{
+    teTxSlotState eState;
+    uint8   u8Handle;
+    uint8   u8Retries;
+    uint8   u8Len;
+    uint16  u16DstAddr;
+    uint32  u32PostedMs;
+    uint32  u32DeadlineMs;      /* Confirm timeout, or end of backoff */
+    uint8   au8Payload[TX_QUEUE_MAX_PAYLOAD];
+} tsTxSlot;
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE void vSend(tsTxSlot *psSlot, uint32 u32NowMs);
+PRIVATE void vFailed(tsTxSlot *psSlot, uint32 u32NowMs);
+PRIVATE void vDropHead(void);
+
+/****************************************************************************/
+/***        Local Variables                                               ***/
+/****************************************************************************/
+PRIVATE tsTxSlot asSlot[TX_QUEUE_SLOTS];
+PRIVATE uint8 u8Head;
+PRIVATE uint8 u8Count;
+PRIVATE uint8 u8NextHandle;
+PRIVATE uint16 u16Src;
+PRIVATE bool_t bHeld;
+PRIVATE tsTxQueueStats sStats;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vTxQueueInit
+ *
+ * DESCRIPTION:
+ * Empties the ring and clears the statistics.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16SrcAddr      R   Short address frames are sent from
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTxQueueInit(uint16 u16SrcAddr)
+{
+    u8Head       = 0;
+    u8Count      = 0;
+    u8NextHandle = 0;
+    u16Src       = u16SrcAddr;
+    bHeld        = FALSE;
+
+    sStats.u32Posted       = 0;
+    sStats.u32Sent         = 0;
+    sStats.u32Delivered    = 0;
+    sStats.u32Retries      = 0;
+    sStats.u32Failed       = 0;
+    sStats.u32DroppedFull  = 0;
+    sStats.u32DroppedStale = 0;
+}
+
+/****************************************************************************
+ *
+ * NAME: bTxQueuePost
+ *
+ * DESCRIPTION:
+ * Queues a frame for transmission. If the ring is full the oldest frame not
+ * already with the MAC is dropped to make room, as newer data supersedes it.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16DstAddr      R   Destination short address
+ *                  pu8Payload      R   Frame payload
+ *                  u8Len           R   Payload length
+ *                  u32NowMs        R   Current time (ms)
+ *
+ * RETURNS: bool_t FALSE if the frame was too long or could not be queued
+ *
+ ****************************************************************************/
+PUBLIC bool_t bTxQueuePost(uint16 u16DstAddr, uint8 *pu8Payload, uint8 u8Len, uint32 u32NowMs)
+{
+    tsTxSlot *psSlot;
+    uint8 u8Drop;
+    uint8 n;
+
+    if (u8Len > TX_QUEUE_MAX_PAYLOAD)
+    {
+        return FALSE;
+    }
+
+    if (u8Count == TX_QUEUE_SLOTS)
+    {
+        /* Close the gap left by the oldest frame not in flight */
+        u8Drop = (asSlot[u8Head].eState == E_TX_SLOT_IN_FLIGHT) ? 1 : 0;
+        if (u8Drop >= u8Count)
+        {
+            return FALSE;
+        }
+        for (n = u8Drop; n < u8Count - 1; n++)
+        {
+            asSlot[(u8Head + n) % TX_QUEUE_SLOTS] = asSlot[(u8Head + n + 1) % TX_QUEUE_SLOTS];
+        }
+        u8Count--;
+        sStats.u32DroppedFull++;
+    }
+
+    psSlot = &asSlot[(u8Head + u8Count) % TX_QUEUE_SLOTS];
+    psSlot->eState      = E_TX_SLOT_WAITING;
+    psSlot->u8Retries   = 0;
+    psSlot->u8Len       = u8Len;
+    psSlot->u16DstAddr  = u16DstAddr;
+    psSlot->u32PostedMs = u32NowMs;
+    for (n = 0; n < u8Len; n++)
+    {
+        psSlot->au8Payload[n] = pu8Payload[n];
+    }
+    u8Count++;
+    sStats.u32Posted++;
+
+    vTxQueueService(u32NowMs);
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: vTxQueueService
+ *
+ * DESCRIPTION:
+ * Sends the frame at the head of the ring when the link is free, and
+ * handles backoff expiry, lost confirms and stale frames. Call regularly
+ * from the main loop. While sending is held only the last three are done.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32NowMs        R   Current time (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTxQueueService(uint32 u32NowMs)
+{
+    tsTxSlot *psSlot;
+
+    while (u8Count > 0)
+    {
+        psSlot = &asSlot[u8Head];
+
+        if (psSlot->eState == E_TX_SLOT_IN_FLIGHT)
+        {
+            if (!TICK_CLOCK_EXPIRED(u32NowMs, psSlot->u32DeadlineMs))
+            {
+                return;
+            }
+            vFailed(psSlot, u32NowMs);
+            continue;
+        }
+
+        if (TICK_CLOCK_EXPIRED(u32NowMs, psSlot->u32PostedMs + TX_QUEUE_MAX_AGE_MS))
+        {
+            sStats.u32DroppedStale++;
+            vDropHead();
+            continue;
+        }
+
+        if ((psSlot->eState == E_TX_SLOT_BACKOFF) &&
+            !TICK_CLOCK_EXPIRED(u32NowMs, psSlot->u32DeadlineMs))
+        {
+            return;
+        }
+
+        if (!bHeld)
+        {
+            vSend(psSlot, u32NowMs);
+        }
+        return;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: vTxQueueConfirm
+ *
+ * DESCRIPTION:
+ * Handles an MCPS data confirm. Confirms for frames no longer in flight,
+ * such as those already timed out, are ignored.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u8Handle        R   Handle of the confirmed frame
+ *                  u8Status        R   MAC status
+ *                  u32NowMs        R   Current time (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTxQueueConfirm(uint8 u8Handle, uint8 u8Status, uint32 u32NowMs)
+{
+    tsTxSlot *psSlot = &asSlot[u8Head];
+
+    if ((u8Count == 0) || (psSlot->eState != E_TX_SLOT_IN_FLIGHT) ||
+        (psSlot->u8Handle != u8Handle))
+    {
+        return;
+    }
+
+    if (u8Status == MAC_ENUM_SUCCESS)
+    {
+        sStats.u32Delivered++;
+        vDropHead();
+    }
+    else
+    {
+        vFailed(psSlot, u32NowMs);
+    }
+
+    vTxQueueService(u32NowMs);
+}
+
+/****************************************************************************
+ *
+ * NAME: vTxQueueHold
+ *
+ * DESCRIPTION:
+ * Holds or releases sending. A frame already with the MAC is not affected.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  bHold           R   TRUE to hold frames in the ring
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTxQueueHold(bool_t bHold)
+{
+    bHeld = bHold;
+}
+
+/****************************************************************************
+ *
+ * NAME: u8TxQueueWaiting
+ *
+ * RETURNS: uint8 frames in the ring, including any in flight
+ *
+ ****************************************************************************/
+PUBLIC uint8 u8TxQueueWaiting(void)
+{
+    return u8Count;
+}
+
+/****************************************************************************
+ *
+ * NAME: psTxQueueStats
+ *
+ * RETURNS: tsTxQueueStats * delivery statistics
+ *
+ ****************************************************************************/
+PUBLIC tsTxQueueStats *psTxQueueStats(void)
+{
+    return &sStats;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vSend
+ *
+ * DESCRIPTION:
+ * Passes a frame to the MAC with a new handle, requesting an ack.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psSlot          RW  Frame to send
+ *                  u32NowMs        R   Current time (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vSend(tsTxSlot *psSlot, uint32 u32NowMs)
+{
+    MAC_McpsReqRsp_s sMcpsReqRsp;
+    MAC_McpsSyncCfm_s sMcpsSyncCfm;
+    uint8 n;
+
+    sMcpsReqRsp.u8Type = MAC_MCPS_REQ_DATA;
+    sMcpsReqRsp.u8ParamLength = sizeof(MAC_McpsReqData_s);
+    sMcpsReqRsp.uParam.sReqData.u8Handle = u8NextHandle;
+
+    sMcpsReqRsp.uParam.sReqData.sFrame.sSrcAddr.u8AddrMode = 2;
+    sMcpsReqRsp.uParam.sReqData.sFrame.sSrcAddr.u16PanId = PAN_ID;
+    sMcpsReqRsp.uParam.sReqData.sFrame.sSrcAddr.uAddr.u16Short = u16Src;
+
+    sMcpsReqRsp.uParam.sReqData.sFrame.sDstAddr.u8AddrMode = 2;
+    sMcpsReqRsp.uParam.sReqData.sFrame.sDstAddr.u16PanId = PAN_ID;
+    sMcpsReqRsp.uParam.sReqData.sFrame.sDstAddr.uAddr.u16Short = psSlot->u16DstAddr;
+
+    sMcpsReqRsp.uParam.sReqData.sFrame.u8TxOptions = MAC_TX_OPTION_ACK;
+    sMcpsReqRsp.uParam.sReqData.sFrame.u8SduLength = psSlot->u8Len;
+    for (n = 0; n < psSlot->u8Len; n++)
+    {
+        sMcpsReqRsp.uParam.sReqData.sFrame.au8Sdu[n] = psSlot->au8Payload[n];
+    }
+
+    psSlot->eState        = E_TX_SLOT_IN_FLIGHT;
+    psSlot->u8Handle      = u8NextHandle++;
+    psSlot->u32DeadlineMs = u32NowMs + TX_QUEUE_CONFIRM_TIMEOUT_MS;
+    sStats.u32Sent++;
+
+    vAppApiMcpsRequest(&sMcpsReqRsp, &sMcpsSyncCfm);
+
+    /* A request the MAC rejects at once is confirmed synchronously */
+    if (sMcpsSyncCfm.u8Status != MAC_MCPS_CFM_DEFERRED)
+    {
+        if (sMcpsSyncCfm.uParam.sCfmData.u8Status == MAC_ENUM_SUCCESS)
+        {
+            sStats.u32Delivered++;
+            vDropHead();
+        }
+        else
+        {
+            vFailed(psSlot, u32NowMs);
+        }
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: vFailed
+ *
+ * DESCRIPTION:
+ * Schedules a retry of the frame at the head of the ring after an
+ * exponential backoff, or drops it once the retries are used up.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psSlot          RW  Failed frame
+ *                  u32NowMs        R   Current time (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vFailed(tsTxSlot *psSlot, uint32 u32NowMs)
+{
+    if (psSlot->u8Retries >= TX_QUEUE_MAX_RETRIES)
+    {
+        sStats.u32Failed++;
+        vDropHead();
+        return;
+    }
+
+    psSlot->eState        = E_TX_SLOT_BACKOFF;
+    psSlot->u32DeadlineMs = u32NowMs + ((uint32)TX_QUEUE_BACKOFF_MS << psSlot->u8Retries);
+    psSlot->u8Retries++;
+    sStats.u32Retries++;
+}
+
+/****************************************************************************
+ *
+ * NAME: vDropHead
+ *
+ * DESCRIPTION:
+ * Removes the frame at the head of the ring.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vDropHead(void)
+{
+    u8Head = (u8Head + 1) % TX_QUEUE_SLOTS;
+    u8Count--;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
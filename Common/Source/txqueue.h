@@ -0,0 +1,78 @@
+/****************************************************************************
+ *
+ * MODULE:      txqueue.h
+ *
+ * DESCRIPTION:
+ * Bounded transmit ring for acknowledged data frames. One frame at a time
+ * is passed to the MAC and the next is held until its confirm arrives, so
+ * the MAC queue cannot overrun. Failed frames are retried after an
+ * exponential backoff; frames that wait too long are dropped as stale.
+ * Sending can be held, for example outside the device's TDMA slot.
+ *
+ ****************************************************************************/
+
+#ifndef  TXQUEUE_H_INCLUDED
+#define  TXQUEUE_H_INCLUDED
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+#define TX_QUEUE_SLOTS              4
+#define TX_QUEUE_MAX_PAYLOAD        104
+
+/* A failed frame is retried TX_QUEUE_MAX_RETRIES times, waiting
+   TX_QUEUE_BACKOFF_MS, doubling each time */
+#define TX_QUEUE_MAX_RETRIES        3
+#define TX_QUEUE_BACKOFF_MS         16
+
+/* Frames not sent within this time of being posted are dropped */
+#define TX_QUEUE_MAX_AGE_MS         2000
+
+/* A frame whose confirm has not arrived in this time is treated as failed */
+#define TX_QUEUE_CONFIRM_TIMEOUT_MS 500
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/* Delivery statistics for the link */
+typedef struct
+{
+    uint32  u32Posted;          /* Frames accepted into the ring */
+    uint32  u32Sent;            /* Transmissions, including retries */
+    uint32  u32Delivered;       /* Frames acknowledged */
+    uint32  u32Retries;         /* Retransmissions after a failure */
+    uint32  u32Failed;          /* Frames dropped after the last retry */
+    uint32  u32DroppedFull;     /* Frames dropped to make room */
+    uint32  u32DroppedStale;    /* Frames dropped for age */
+} tsTxQueueStats;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC void   vTxQueueInit(uint16 u16SrcAddr);
+PUBLIC bool_t bTxQueuePost(uint16 u16DstAddr, uint8 *pu8Payload, uint8 u8Len, uint32 u32NowMs);
+PUBLIC void   vTxQueueService(uint32 u32NowMs);
+PUBLIC void   vTxQueueConfirm(uint8 u8Handle, uint8 u8Status, uint32 u32NowMs);
+PUBLIC void   vTxQueueHold(bool_t bHold);
+PUBLIC uint8  u8TxQueueWaiting(void);
+PUBLIC tsTxQueueStats *psTxQueueStats(void);
+
+#if defined __cplusplus
+}
+#endif
+
+#endif  /* TXQUEUE_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
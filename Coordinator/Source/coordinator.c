@@ -10,8 +10,22 @@
 #include <LedControl.h>
 #include "LcdDriver.h"
 #include "config.h"
+#include "report.h"
 #include "Printf.h"
-#include <math.h>
+#include "tickclock.h"
+#include "fixedpoint.h"
+#include "tofstats.h"
+#include "toftrack.h"
+#include "rssidistance.h"
+#include "tdma.h"
+#include "assocstore.h"
+#include "registry.h"
+#include "chanagility.h"
+#include "seqtrack.h"
+#include "multilat.h"
+#include "postrack.h"
+#include "tagtrack.h"
+#include "survey.h"
 
 /****************************************************************************/
 /***        Macro Definitions                                             ***/
@@ -28,6 +42,58 @@
   (byte & 0x02 ? '1' : '0'), \
   (byte & 0x01 ? '1' : '0') 
 
+/* Period at which the LED is toggled, and the most often the LCD is
+   refreshed */
+#define REFRESH_PERIOD_MS       250
+/* Period at which the tracked position is printed */
+#define POSITION_OUTPUT_PERIOD_MS   1000
+/* Period at which the delivery statistics of each link are printed */
+#define LINK_STATS_PERIOD_MS    10000
+/* Period at which the tags' ranging period is repeated, for tags that have
+   just joined or missed it */
+#define TAG_PERIOD_ANNOUNCE_MS  5000
+
+/* Coordinator initiated ranging. Each beacon is ranged with a burst of
+   COORD_TOF_READINGS, no more often than every COORD_RANGING_MIN_INTERVAL_MS.
+   A beacon whose ranging fails waits twice as long per failure, up to
+   2^COORD_RANGING_MAX_BACKOFF times the interval. */
+#define COORD_TOF_READINGS              10
+#define COORD_RANGING_MIN_INTERVAL_MS   100
+#define COORD_RANGING_MAX_BACKOFF       4
+
+/* Positioning. Anchor n is the beacon in registry slot n, placed at entry n
+   of ANCHOR_POSITIONS_CM (x, y, z in cm) until a survey places the anchors,
+   after which the surveyed positions are kept in flash and used instead.
+   The default is the original pair of beacons 120cm apart along the x
+   axis, with the target on the positive y side. */
+#ifndef POSITION_DIMS
+#define POSITION_DIMS                   2
+#endif
+#ifndef ANCHOR_POSITIONS_CM
+#define ANCHOR_POSITIONS_CM             { {{0, 0, 0}}, {{120, 0, 0}} }
+#endif
+#define NUM_ANCHORS                     (sizeof(asDefaultAnchorPos) / sizeof(asDefaultAnchorPos[0]))
+/* Most anchors whose ranges are tracked */
+#define TRACK_MAX_ANCHORS               ((MAX_ANCHORS < TAG_TRACK_MAX_ANCHORS) ? \
+                                         MAX_ANCHORS : TAG_TRACK_MAX_ANCHORS)
+/* Standard deviation assumed for a range reported without one, or taken
+   from RSSI */
+#define RANGE_DEFAULT_STDDEV_CM         100
+
+/* Anchor survey, see survey.h, started with 's' on the console. The
+   command is not acknowledged, so it is sent SURVEY_ANNOUNCEMENTS times
+   SURVEY_ANNOUNCE_MS apart, each carrying the time left so the anchors
+   stop together. The duration must fit 16 bits. */
+#ifndef SURVEY_DURATION_MS
+#define SURVEY_DURATION_MS              30000
+#endif
+#define SURVEY_ANNOUNCEMENTS            3
+#define SURVEY_ANNOUNCE_MS              200
+
+/* Work left for the main loop, flagged as the data it depends on changes */
+#define COORD_DIRTY_POSITION            0x01    /* An anchor distance changed */
+#define COORD_DIRTY_DISPLAY             0x02    /* LCD content changed */
+
 /****************************************************************************/
 /***        Type Definitions                                              ***/
 /****************************************************************************/
@@ -38,54 +104,147 @@ typedef enum
     E_STATE_COORDINATOR_STARTED,
 }teState;
 
-/* Data type for storing data related to all end devices that have associated */
+/* Data type for storing data related to all end devices that have associated,
+   indexed by registry slot */
 typedef struct
 {
-    bool_t bIsAssociated;
-    int32 i32TofDistance;
-    uint32 u32RssiDistance;
-    uint16 u16ShortAdr;
-    uint32 u32ExtAdrL;
-    uint32 u32ExtAdrH;
+    int16 i16TofRate;
+    uint32 u32ReportTimestampMs;
+    uint8 u8TofErrors;
+    uint8 u8TofSqi;
+    uint32 u32LastRangedMs;     /* Coordinator initiated ranging only */
+    uint8 u8RangingFailures;
+    tsTofTrack sTofTrack;
+    tsTdmaSlot sTdmaSlot;       /* Beacon enabled network only */
     uint8   u8TxPacketSeqNb;
-    uint8   u8RxPacketSeqNb;
+    tsSeqTrack sRxSeq;          /* Frames received from the device */
 }tsEndDeviceData;
 
+/* Distances read by the positioning code, one array per field indexed by
+   registry slot, so a scan over the devices reads contiguous memory */
+typedef struct
+{
+    int32   ai32TofDistance[MAX_END_DEVICES];
+    uint32  au32RssiDistance[MAX_END_DEVICES];
+    uint16  au16TofStdDev[MAX_END_DEVICES];
+}tsDistanceTable;
+
 typedef struct
 {
-    /* Data related to associated end devices */
-    uint16          u16NbrEndDevices;
+    /* Data related to associated end devices. Addresses are held by the
+       registry. */
     tsEndDeviceData sEndDeviceData[MAX_END_DEVICES];
+    tsDistanceTable sDistance;
     teState eState;
     uint8   u8Channel;
-    double x;
-    double y;
+    uint8   u8TxBroadcastSeqNb;
+    uint8   u8Dirty;            /* COORD_DIRTY_ flags */
+    uint8   u8Anchors;          /* Anchors placed in asAnchorPos */
+    tsTag   sSelf;              /* Position of the coordinator */
+    tsMultilatPoint sPosition;  /* Position last output (cm) */
+    tsMultilatPoint sVelocity;  /* Velocity last output (cm/s) */
+    uint16  u16TagPeriodMs;     /* Ranging period last announced to the tags */
+    uint32  u32TagAnnounceMs;   /* Time the period is next announced */
+    uint32  u32TagStatsMs;      /* Start of the tag statistics window */
 }tsCoordinatorData;
 
+typedef enum
+{
+    E_RANGING_IDLE,
+    E_RANGING_BUSY,             /* Burst in progress */
+    E_RANGING_DONE              /* Burst complete, awaiting reduction */
+}teRangingState;
+
+/* Burst being taken by the coordinator */
+typedef struct
+{
+    volatile teRangingState eState;
+    volatile eTofReturn eStatus;
+    uint16  u16EndDeviceIndex;
+    tsAppApiTof_Data asData[COORD_TOF_READINGS];
+}tsRangingEngine;
+
+typedef enum
+{
+    E_AGILITY_MONITORING,
+    E_AGILITY_SCANNING,         /* Energy scan of the band in progress */
+    E_AGILITY_ANNOUNCING        /* Move announced, PAN about to restart */
+}teAgilityState;
+
+/* Channel agility, see chanagility.h */
+typedef struct
+{
+    teAgilityState eState;
+    tsLinkMonitor sMonitor;
+    uint8   u8NewChannel;
+    uint8   u8Announcements;    /* Announcements still to send */
+    uint32  u32NextAnnounceMs;
+}tsChannelAgility;
+
+/* Anchor survey in progress */
+typedef struct
+{
+    bool_t  bActive;
+    uint8   u8Announcements;    /* Announcements still to send */
+    uint32  u32NextAnnounceMs;
+    uint32  u32EndMs;
+    tsSurvey sSurvey;
+}tsAnchorSurvey;
+
 /****************************************************************************/
 /***        Local Function Prototypes                                     ***/
 /****************************************************************************/
 PRIVATE void vInitSystem(void);
 PRIVATE void vStartEnergyScan(void);
-PRIVATE void vStartCoordinator(void);
+PRIVATE void vStartCoordinator(bool_t bRealignment);
 PRIVATE void vProcessEventQueues(void);
 PRIVATE void vProcessIncomingMlme(MAC_MlmeDcfmInd_s *psMlmeInd);
 PRIVATE void vProcessIncomingMcps(MAC_McpsDcfmInd_s *psMcpsInd);
 PRIVATE void vProcessIncomingHwEvent(AppQApiHwInd_s *psAHI_Ind);
 PRIVATE void vHandleNodeAssociation(MAC_MlmeDcfmInd_s *psMlmeInd);
+PRIVATE void vHandleNodeDisassociation(MAC_MlmeDcfmInd_s *psMlmeInd);
+PRIVATE bool_t bRestoreNetwork(void);
+PRIVATE void vClearEndDevice(uint16 u16Slot);
 PRIVATE void vHandleEnergyScanResponse(MAC_MlmeDcfmInd_s *psMlmeInd);
+PRIVATE void vStartAgilityScan(void);
+PRIVATE void vHandleAgilityScanResponse(MAC_MlmeDcfmInd_s *psMlmeInd);
+PRIVATE void vSendChannelChange(uint8 u8Channel, uint16 u16DelayMs);
+PRIVATE void vSendBroadcast(uint8 *pu8Cmd, uint8 u8Len);
 PRIVATE void vHandleMcpsDataInd(MAC_McpsDcfmInd_s *psMcpsInd);
 PRIVATE void vHandleMcpsDataDcfm(MAC_McpsDcfmInd_s *psMcpsInd);
 PRIVATE void vProcessReceivedDataPacket(uint8 *pu8Data, uint8 u8Len, uint16 u16Address);
 PRIVATE void vPutChar(unsigned char c);
 PRIVATE void reverse(char *str, int len);
 PRIVATE int intToStr(uint32 x, char str[], int d);
+PRIVATE void vSignedToStr(int32 i32Value, char *pcStr);
 
 PRIVATE uint32 GetDistance(uint16 iEndDevice);
 PRIVATE void lcd_BuildStatusScreen(void);
 PRIVATE void lcd_UpdateStatusScreen(void);
 PRIVATE void interrupt_handleDistanceTransmissionReceived(uint8 *pu8Data, uint8 u8Len, uint16 u16Address);
+PRIVATE void interrupt_handleReportReceived(uint8 *pu8Data, uint8 u8Len, uint16 u16Address);
 PRIVATE void task_CalculateXYPos(void);
+PRIVATE bool_t task_PredictPosition(void);
+PRIVATE void vPrintGdop(uint16 u16GdopX100);
+PRIVATE void vPrintPosition(void);
+PRIVATE void vPrintTrackChange(uint16 u16Address, bool_t bWasTracking, tsTag *psTag);
+PRIVATE uint32 u32RangeStdDevCm(uint16 u16Slot);
+PRIVATE void task_TagRange(uint16 u16Slot, tsReportMeasurement *psMeasurement, uint32 u32TimeMs);
+PRIVATE void task_UpdateTags(void);
+PRIVATE void task_AnnounceTagPeriod(void);
+PRIVATE void vPrintTags(void);
+PRIVATE void task_PrintTagStats(void);
+PRIVATE void vDistanceChanged(uint16 u16Slot, uint32 u32TimeMs);
+PRIVATE void task_StartRanging(void);
+PRIVATE void task_ProcessRanging(void);
+PRIVATE void task_ChannelAgility(void);
+PRIVATE void task_PrintLinkStats(void);
+PRIVATE void task_HandleConsole(void);
+PRIVATE void vLoadAnchors(void);
+PRIVATE void vSetAnchors(uint8 u8Anchors, const tsMultilatPoint *pasPos);
+PRIVATE void vStartSurvey(void);
+PRIVATE void task_SurveyRange(uint16 u16Slot, tsReportMeasurement *psMeasurement);
+PRIVATE void task_Survey(void);
 
 /****************************************************************************/
 /***        Local Variables                                               ***/
@@ -96,6 +255,15 @@ PRIVATE MAC_Pib_s *s_psMacPib;
 
 PRIVATE tsCoordinatorData sCoordinatorData;
 PRIVATE bool_t bLedState;
+PRIVATE tsRangingEngine sRangingEngine;
+PRIVATE tsChannelAgility sAgility;
+PRIVATE tsTagTable sTagTable;
+PRIVATE tsAnchorSurvey sAnchorSurvey;
+
+/* Anchor positions, indexed by registry slot: those built in, then those
+   found by a survey */
+PRIVATE const tsMultilatPoint asDefaultAnchorPos[] = ANCHOR_POSITIONS_CM;
+PRIVATE tsMultilatPoint asAnchorPos[TRACK_MAX_ANCHORS];
 
 /****************************************************************************/
 /***        Exported Functions                                            ***/
@@ -118,7 +286,10 @@ PRIVATE bool_t bLedState;
  ****************************************************************************/
 PUBLIC void AppColdStart(void)
 {
-    volatile int n=0;
+    uint32 u32RefreshMs = 0;
+    uint32 u32OutputMs = 0;
+    bool_t bTracking;
+    uint32 u32LinkStatsMs = LINK_STATS_PERIOD_MS;
 
     #ifdef WATCHDOG_ENABLED
         vAHI_WatchdogStop();
@@ -129,29 +300,111 @@ PUBLIC void AppColdStart(void)
     vAHI_UartSetClockDivisor(UART, E_AHI_UART_RATE_38400);
     vAHI_UartReset(UART, FALSE, FALSE);
 
+    vTickClockInit();
     vInitSystem();
     vInitPrintf((void *)vPutChar);
+    vLoadAnchors();
     vLcdResetDefault();
     lcd_BuildStatusScreen();
+    sCoordinatorData.u8Dirty &= (uint8)~COORD_DIRTY_DISPLAY;
 
     //Enable TOF ranging.
     vAppApiTofInit(TRUE);
 
-    vStartEnergyScan();
+    if (bRestoreNetwork())
+    {
+        vStartCoordinator(FALSE);
+    }
+    else
+    {
+        vStartEnergyScan();
+    }
 
     vLedInitRfd();
 
     while (1)
     {
-        for(n=0;n<1000000;n++);
-        bLedState = !bLedState;
-        vLedControl(0, bLedState);
-        lcd_BuildStatusScreen();
+        if (TICK_CLOCK_EXPIRED(u32TickClockNowMs(), u32RefreshMs))
+        {
+            u32RefreshMs = u32TickClockNowMs() + REFRESH_PERIOD_MS;
+            bLedState = !bLedState;
+            vLedControl(0, bLedState);
+            bTracking = task_PredictPosition();
+            if (TICK_CLOCK_EXPIRED(u32TickClockNowMs(), u32OutputMs))
+            {
+                u32OutputMs = u32TickClockNowMs() + POSITION_OUTPUT_PERIOD_MS;
+                if (bTracking)
+                {
+                    vPrintPosition();
+                }
+                vPrintTags();
+            }
+            if (sCoordinatorData.u8Dirty & COORD_DIRTY_DISPLAY)
+            {
+                sCoordinatorData.u8Dirty &= (uint8)~COORD_DIRTY_DISPLAY;
+                lcd_UpdateStatusScreen();
+            }
+        }
+        if (TICK_CLOCK_EXPIRED(u32TickClockNowMs(), u32LinkStatsMs))
+        {
+            u32LinkStatsMs = u32TickClockNowMs() + LINK_STATS_PERIOD_MS;
+            task_PrintLinkStats();
+            if (MULTI_TAG_TRACKING)
+            {
+                task_PrintTagStats();
+            }
+        }
+        task_HandleConsole();
         vProcessEventQueues();
-        task_CalculateXYPos();
+
+        if (sCoordinatorData.u8Dirty & COORD_DIRTY_POSITION)
+        {
+            task_CalculateXYPos();
+        }
+        task_UpdateTags();
+
+        if (sCoordinatorData.eState == E_STATE_COORDINATOR_STARTED)
+        {
+            task_ChannelAgility();
+            task_Survey();
+            if (MULTI_TAG_TRACKING)
+            {
+                task_AnnounceTagPeriod();
+            }
+        }
+
+        if (COORDINATOR_INITIATED_RANGING &&
+            (sCoordinatorData.eState == E_STATE_COORDINATOR_STARTED))
+        {
+            task_ProcessRanging();
+            if ((sAgility.eState != E_AGILITY_SCANNING) && !sAnchorSurvey.bActive)
+            {
+                task_StartRanging();
+            }
+        }
     }
 }
 
+/****************************************************************************
+ *
+ * NAME: vTofCallback
+ *
+ * DESCRIPTION:
+ * Passed to bAppApiGetTof, called when a coordinator initiated burst
+ * completes. The burst is reduced from the main loop.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  eStatus         R   Result of the burst
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vTofCallback(eTofReturn eStatus)
+{
+    sRangingEngine.eStatus = eStatus;
+    sRangingEngine.eState  = E_RANGING_DONE;
+}
+
 /****************************************************************************
  *
  * NAME: AppWarmStart
@@ -197,17 +450,30 @@ PRIVATE void vInitSystem(void)
 
     /* Initialise coordinator state */
     sCoordinatorData.eState = E_STATE_IDLE;
-    sCoordinatorData.u16NbrEndDevices = 0;
+    sCoordinatorData.u8TxBroadcastSeqNb = 0;
+    sCoordinatorData.u8Dirty = 0;
+    sCoordinatorData.u8Anchors = 0;
+    sCoordinatorData.u16TagPeriodMs   = 0;
+    sCoordinatorData.u32TagAnnounceMs = 0;
+    sCoordinatorData.u32TagStatsMs    = 0;
+    vTagReset(&sCoordinatorData.sSelf, REGISTRY_NO_SLOT);
+    vTagTableInit(&sTagTable);
+    vRegistryInit();
 
     int i;
+    for (i = 0; i < MULTILAT_AXES; i++)
+    {
+        sCoordinatorData.sPosition.ai32Cm[i] = 0;
+        sCoordinatorData.sVelocity.ai32Cm[i] = 0;
+    }
     for (i=0; i<MAX_END_DEVICES; i++)
     {
-        sCoordinatorData.sEndDeviceData[i].bIsAssociated = FALSE;
-        sCoordinatorData.sEndDeviceData[i].i32TofDistance = 0;
-        sCoordinatorData.sEndDeviceData[i].u32RssiDistance = 0;
-        sCoordinatorData.sEndDeviceData[i].u8RxPacketSeqNb = 0;
-        sCoordinatorData.sEndDeviceData[i].u8TxPacketSeqNb = 0;
+        vClearEndDevice(i);
     }
+    sRangingEngine.eState = E_RANGING_IDLE;
+    sAgility.eState = E_AGILITY_MONITORING;
+    sAnchorSurvey.bActive = FALSE;
+    vLinkMonitorInit(&sAgility.sMonitor, u32TickClockNowMs());
 
     /* Set up the MAC handles. Must be called AFTER u32AppQApiInit() */
     s_pvMac = pvAppApiGetMacHandle();
@@ -305,6 +571,13 @@ PRIVATE void vProcessIncomingMlme(MAC_MlmeDcfmInd_s *psMlmeInd)
         }
         break;
 
+    case MAC_MLME_IND_DISASSOCIATE: /* Device leaving the network */
+        if (sCoordinatorData.eState == E_STATE_COORDINATOR_STARTED)
+        {
+            vHandleNodeDisassociation(psMlmeInd);
+        }
+        break;
+
     case MAC_MLME_DCFM_SCAN: /* Incoming scan results */
         if (psMlmeInd->uParam.sDcfmScan.u8ScanType == MAC_MLME_SCAN_TYPE_ENERGY_DETECT)
         {
@@ -313,6 +586,11 @@ PRIVATE void vProcessIncomingMlme(MAC_MlmeDcfmInd_s *psMlmeInd)
                 /* Process energy scan results and start device as coordinator */
                 vHandleEnergyScanResponse(psMlmeInd);
             }
+            else if (sAgility.eState == E_AGILITY_SCANNING)
+            {
+                /* Move away if the band has a quieter channel */
+                vHandleAgilityScanResponse(psMlmeInd);
+            }
         }
         break;
 
@@ -399,16 +677,25 @@ PRIVATE void vHandleMcpsDataDcfm(MAC_McpsDcfmInd_s *psMcpsInd)
 PRIVATE void vHandleMcpsDataInd(MAC_McpsDcfmInd_s *psMcpsInd)
 {
     MAC_RxFrameData_s *psFrame;
+    tsEndDeviceData *psEndDevice;
+    uint16 u16Slot;
+    uint8 u8Missed;
 
     psFrame = &psMcpsInd->uParam.sIndData.sFrame;
 
-    /* Check application layer sequence number of frame and reject if it is
-       the same as the last frame, i.e. same frame has been received more
-       than once. */
-    uint16 u16EndDeviceIndex = psFrame->sSrcAddr.uAddr.u16Short - 1;
-    if (psFrame->au8Sdu[0] >= sCoordinatorData.sEndDeviceData[u16EndDeviceIndex].u8RxPacketSeqNb)
+    u16Slot = u16RegistryFindShort(psFrame->sSrcAddr.uAddr.u16Short);
+    if ((u16Slot == REGISTRY_NO_SLOT) || (psFrame->u8SduLength == 0))
+    {
+        return;
+    }
+    psEndDevice = &sCoordinatorData.sEndDeviceData[u16Slot];
+
+    /* Check application layer sequence number of frame and reject it if
+       the same frame has been received before. Frames missing from the
+       sequence were lost on the way. */
+    if (eSeqTrackUpdate(&psEndDevice->sRxSeq, psFrame->au8Sdu[0], &u8Missed) != E_SEQ_DUPLICATE)
     {
-        sCoordinatorData.sEndDeviceData[u16EndDeviceIndex].u8RxPacketSeqNb++;
+        vLinkMonitorFrames(&sAgility.sMonitor, 1, u8Missed);
 
         vProcessReceivedDataPacket(&psFrame->au8Sdu[1],
                                    (psFrame->u8SduLength) - 1,
@@ -441,6 +728,9 @@ PRIVATE void vProcessReceivedDataPacket(uint8 *pu8Data, uint8 u8Len, uint16 u16A
             case 0xd1:
                 interrupt_handleDistanceTransmissionReceived(&pu8Data[1], u8Len-1, u16Address);
                 break;
+            case REPORT_OPCODE:
+                interrupt_handleReportReceived(pu8Data, u8Len, u16Address);
+                break;
             default:
                 vPrintf("Unexpected data packet.\n");
                 break;
@@ -480,17 +770,121 @@ PRIVATE void interrupt_handleDistanceTransmissionReceived(uint8 *pu8Data, uint8
     uint32 midLowByte = ((uint32)pu8Data[2]) << 8;
     uint32 lowByte = ((uint32)pu8Data[3]);
 
-    uint16 u16EndDeviceIndex = u16Address - 1;
-    sCoordinatorData.sEndDeviceData[u16EndDeviceIndex].i32TofDistance = ((int32)highByte) | midHighByte | midLowByte | lowByte;
+    uint16 u16Slot = u16RegistryFindShort(u16Address);
+    if (u16Slot == REGISTRY_NO_SLOT)
+    {
+        return;
+    }
+    sCoordinatorData.sDistance.ai32TofDistance[u16Slot] = ((int32)highByte) | midHighByte | midLowByte | lowByte;
 
     highByte = ((uint32)pu8Data[4]) << 24;
     midHighByte = ((uint32)pu8Data[5]) << 16;
     midLowByte = ((uint32)pu8Data[6]) << 8;
     lowByte = ((uint32)pu8Data[7]);
 
-    sCoordinatorData.sEndDeviceData[u16EndDeviceIndex].u32RssiDistance = highByte | midHighByte | midLowByte | lowByte;
+    sCoordinatorData.sDistance.au32RssiDistance[u16Slot] = highByte | midHighByte | midLowByte | lowByte;
+
+    /* Legacy frames carry no quality information */
+    sCoordinatorData.sDistance.au16TofStdDev[u16Slot] = 0;
+    sCoordinatorData.sEndDeviceData[u16Slot].i16TofRate = 0;
+    vDistanceChanged(u16Slot, u32TickClockNowMs());
+
+    vPrintf("\nDistance Transmission Received From Beacon %i.\nTOF Distance: %i cm\nRSSI Distance: %i cm\n", u16Address, sCoordinatorData.sDistance.ai32TofDistance[u16Slot], sCoordinatorData.sDistance.au32RssiDistance[u16Slot]);
+}
+
+/****************************************************************************
+ *
+ * NAME: interrupt_handleReportReceived
+ *
+ * DESCRIPTION:
+ *     Data handler for a report of one or more measurements. The latest
+ *     measurement taken against the coordinator becomes the beacon's
+ *     current distance. Measurements a tag took against the anchors are
+ *     passed to its track.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Data             Report, opcode first
+ *                  u8Len               Size of Data Array.
+ *                  u16Address          Source Address
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void interrupt_handleReportReceived(uint8 *pu8Data, uint8 u8Len, uint16 u16Address)
+{
+    tsReport sReport;
+    tsReportMeasurement *psMeasurement;
+    tsReportMeasurement *psLatest = NULL;
+    tsEndDeviceData *psEndDevice;
+    uint32 u32NowMs = u32TickClockNowMs();
+    uint32 u32LastMs;
+    uint16 u16Slot;
+    uint8 n;
+
+    u16Slot = u16RegistryFindShort(u16Address);
+    if (u16Slot == REGISTRY_NO_SLOT)
+    {
+        vPrintf("Report from unknown Beacon %i.\n", u16Address);
+        return;
+    }
+
+    if (!bReportDecode(pu8Data, u8Len, &sReport) || (sReport.u8Count == 0))
+    {
+        vPrintf("Invalid report from Beacon %i.\n", u16Address);
+        return;
+    }
+
+    /* The report is sent soon after its last measurement, so each is placed
+       on the local clock by its age relative to that one */
+    u32LastMs = sReport.asMeasurement[sReport.u8Count - 1].u32TimestampMs;
+
+    for (n = 0; n < sReport.u8Count; n++)
+    {
+        psMeasurement = &sReport.asMeasurement[n];
+        vPrintf("\nBeacon %i to %i at %i ms: TOF %i cm +/- %i, rate %i cm/s, RSSI %i cm, used %i, errors %i, SQI %i, flags %x, TX power %i",
+                u16Address,
+                psMeasurement->u16Target,
+                psMeasurement->u32TimestampMs,
+                psMeasurement->i32TofDistance,
+                psMeasurement->u16StdDev,
+                (int32)psMeasurement->i16Rate,
+                psMeasurement->u16RssiDistance,
+                psMeasurement->u8Used,
+                psMeasurement->u8Errors,
+                psMeasurement->u8Sqi,
+                psMeasurement->u8Flags,
+                psMeasurement->u8TxPower);
+
+        if (psMeasurement->u16Target == COORDINATOR_ADR)
+        {
+            psLatest = psMeasurement;
+        }
+        else if (sAnchorSurvey.bActive)
+        {
+            task_SurveyRange(u16Slot, psMeasurement);
+        }
+        else
+        {
+            task_TagRange(u16Slot, psMeasurement,
+                          u32NowMs - (u32LastMs - psMeasurement->u32TimestampMs));
+        }
+    }
+
+    if (psLatest == NULL)
+    {
+        return;
+    }
 
-    vPrintf("\nDistance Transmission Received From Beacon %i.\nTOF Distance: %i cm\nRSSI Distance: %i cm\n", u16Address, sCoordinatorData.sEndDeviceData[u16EndDeviceIndex].i32TofDistance, sCoordinatorData.sEndDeviceData[u16EndDeviceIndex].u32RssiDistance);
+    psEndDevice   = &sCoordinatorData.sEndDeviceData[u16Slot];
+    psMeasurement = psLatest;
+
+    sCoordinatorData.sDistance.ai32TofDistance[u16Slot]  = psMeasurement->i32TofDistance;
+    sCoordinatorData.sDistance.au16TofStdDev[u16Slot]    = psMeasurement->u16StdDev;
+    sCoordinatorData.sDistance.au32RssiDistance[u16Slot] = psMeasurement->u16RssiDistance;
+    psEndDevice->i16TofRate           = psMeasurement->i16Rate;
+    psEndDevice->u32ReportTimestampMs = psMeasurement->u32TimestampMs;
+    vDistanceChanged(u16Slot, u32NowMs - (u32LastMs - psMeasurement->u32TimestampMs));
+    psEndDevice->u8TofErrors          = psMeasurement->u8Errors;
+    psEndDevice->u8TofSqi             = psMeasurement->u8Sqi;
 }
 
 /****************************************************************************
@@ -529,28 +923,48 @@ PRIVATE void vProcessIncomingHwEvent(AppQApiHwInd_s *psAHI_Ind)
 PRIVATE void vHandleNodeAssociation(MAC_MlmeDcfmInd_s *psMlmeInd)
 {
     uint16 u16ShortAdr = 0xffff;
-    uint16 u16EndDeviceIndex;
+    uint16 u16Slot;
+    bool_t bKnown;
 
 
     MAC_MlmeReqRsp_s   sMlmeReqRsp;
     MAC_MlmeSyncCfm_s  sMlmeSyncCfm;
 
-    if (sCoordinatorData.u16NbrEndDevices < MAX_END_DEVICES)
+    /* A device already registered keeps its slot and address */
+    u16Slot = u16RegistryAdd(psMlmeInd->uParam.sIndAssociate.sDeviceAddr.u32H,
+                             psMlmeInd->uParam.sIndAssociate.sDeviceAddr.u32L,
+                             &bKnown);
+    if ((u16Slot != REGISTRY_NO_SLOT) && BEACON_ENABLED_NETWORK &&
+        !bTdmaHasSlot(u16RegistryShortAdr(u16Slot)))
     {
-        /* Store end device address data */
-        u16EndDeviceIndex    = sCoordinatorData.u16NbrEndDevices;
-        u16ShortAdr = END_DEVICE_START_ADR + sCoordinatorData.u16NbrEndDevices;
+        /* No reporting slot left for it */
+        vPrintf("Beacon %i refused, no slot\n", u16Slot);
+        vRegistryRemove(u16Slot);
+        u16Slot = REGISTRY_NO_SLOT;
+    }
 
-        sCoordinatorData.sEndDeviceData[u16EndDeviceIndex].u16ShortAdr = u16ShortAdr;
+    if (u16Slot != REGISTRY_NO_SLOT)
+    {
+        u16ShortAdr = u16RegistryShortAdr(u16Slot);
+        vClearEndDevice(u16Slot);
+        vPrintf("Beacon %i %s: %i\n", u16Slot, bKnown ? "Reassociated" : "Associated", u16ShortAdr);
 
-        sCoordinatorData.sEndDeviceData[u16EndDeviceIndex].u32ExtAdrL  =
-        psMlmeInd->uParam.sIndAssociate.sDeviceAddr.u32L;
+        if (BEACON_ENABLED_NETWORK)
+        {
+            /* The end device derives the same slot from its address */
+            vTdmaAssign(u16ShortAdr, &sCoordinatorData.sEndDeviceData[u16Slot].sTdmaSlot);
+            vPrintf("Slot %i of beacon %i/%i\n",
+                    sCoordinatorData.sEndDeviceData[u16Slot].sTdmaSlot.u8Slot,
+                    sCoordinatorData.sEndDeviceData[u16Slot].sTdmaSlot.u8Cycle,
+                    TDMA_CYCLES);
+        }
 
-        sCoordinatorData.sEndDeviceData[u16EndDeviceIndex].u32ExtAdrH  =
-        psMlmeInd->uParam.sIndAssociate.sDeviceAddr.u32H;
-        sCoordinatorData.sEndDeviceData[u16EndDeviceIndex].bIsAssociated = TRUE;
-        vPrintf("Beacon %i Associated: %i\n", u16EndDeviceIndex, u16ShortAdr);
-        sCoordinatorData.u16NbrEndDevices++;
+        if (!bAssocStorePut(psMlmeInd->uParam.sIndAssociate.sDeviceAddr.u32H,
+                            psMlmeInd->uParam.sIndAssociate.sDeviceAddr.u32L,
+                            u16ShortAdr))
+        {
+            vPrintf("Association not saved\n");
+        }
 
         sMlmeReqRsp.uParam.sRspAssociate.u8Status = 0; /* Access granted */
     }
@@ -609,151 +1023,170 @@ PRIVATE void vStartEnergyScan(void)
 
 /****************************************************************************
  *
- * NAME: vHandleEnergyScanResponse
+ * NAME: bRestoreNetwork
  *
  * DESCRIPTION:
- * Selects a channel with low enery content for use by the wireless UART.
+ * Restores the channel and association table saved before a restart, so
+ * the network can be started again without an energy scan and known
+ * beacons can carry on reporting without reassociating.
  *
  * PARAMETERS:      Name            RW  Usage
  * None.
  *
- * RETURNS: void
+ * RETURNS:
+ * TRUE if a network was restored
  *
- * NOTES: Demo Application Boiler Plate for handling 802.15.4 Energy Scan
- *        Response.
- * 
  ****************************************************************************/
-PRIVATE void vHandleEnergyScanResponse(MAC_MlmeDcfmInd_s *psMlmeInd)
+PRIVATE bool_t bRestoreNetwork(void)
 {
-    uint8 u8MinEnergy;
-    uint8 i;
-	u8MinEnergy = (psMlmeInd->uParam.sDcfmScan.uList.au8EnergyDetect[0]) ;
+    tsAssocEntry *psEntry;
+    uint16 u16Slot;
+    uint16 n;
 
-    sCoordinatorData.u8Channel = CHANNEL_MIN;
+    if (!bAssocStoreOpen() || (u8AssocStoreChannel() < CHANNEL_MIN))
+    {
+        return FALSE;
+    }
 
-	/* Search list to find quietest channel */
-    while (i < psMlmeInd->uParam.sDcfmScan.u8ResultListSize)
+    sCoordinatorData.u8Channel = u8AssocStoreChannel();
+
+    for (n = 0; n < u16AssocStoreCount(); n++)
     {
-       if ((psMlmeInd->uParam.sDcfmScan.uList.au8EnergyDetect[i]) < u8MinEnergy)
-       {
-			u8MinEnergy = (psMlmeInd->uParam.sDcfmScan.uList.au8EnergyDetect[i]);
-			sCoordinatorData.u8Channel = i + CHANNEL_MIN;
-		}
-		i++;
+        psEntry = psAssocStoreEntry(n);
+        u16Slot = u16RegistryRestore(psEntry->u32ExtAdrH, psEntry->u32ExtAdrL,
+                                     psEntry->u16ShortAdr);
+        if ((u16Slot != REGISTRY_NO_SLOT) && BEACON_ENABLED_NETWORK)
+        {
+            if (bTdmaHasSlot(psEntry->u16ShortAdr))
+            {
+                vTdmaAssign(psEntry->u16ShortAdr, &sCoordinatorData.sEndDeviceData[u16Slot].sTdmaSlot);
+            }
+            else
+            {
+                /* Saved under a larger TDMA_MAX_DEVICES; it is refused when
+                   it associates again */
+                vRegistryRemove(u16Slot);
+            }
+        }
     }
 
-    vStartCoordinator();
+    vPrintf("Restored %i Beacons on channel %i\n", u16RegistryCount(),
+            sCoordinatorData.u8Channel);
+    sCoordinatorData.u8Dirty |= COORD_DIRTY_DISPLAY;
+
+    return TRUE;
 }
 
 /****************************************************************************
  *
- * NAME: vStartCoordinator
+ * NAME: vHandleNodeDisassociation
  *
  * DESCRIPTION:
- * Starts the network by configuring the controller board to act as the PAN
- * coordinator.
+ * Frees the slot of a device leaving the network, for reuse by the next
+ * device to associate.
  *
  * PARAMETERS:      Name            RW  Usage
- * None.
+ *                  psMlmeInd
  *
- * RETURNS:
- * TRUE if network was started successfully otherwise FALSE
+ * RETURNS: void
  *
- * NOTES: Demo Application Boiler Plate for starting 802.15.4 Network.
- * 
  ****************************************************************************/
-PRIVATE void vStartCoordinator(void)
+PRIVATE void vHandleNodeDisassociation(MAC_MlmeDcfmInd_s *psMlmeInd)
 {
-    /* Structures used to hold data for MLME request and response */
-    MAC_MlmeReqRsp_s   sMlmeReqRsp;
-    MAC_MlmeSyncCfm_s  sMlmeSyncCfm;
+    uint16 u16Slot;
 
-    sCoordinatorData.eState = E_STATE_COORDINATOR_STARTED;
+    u16Slot = u16RegistryFindExt(psMlmeInd->uParam.sIndDisassociate.sDeviceAddr.u32H,
+                                 psMlmeInd->uParam.sIndDisassociate.sDeviceAddr.u32L);
+    if (u16Slot == REGISTRY_NO_SLOT)
+    {
+        return;
+    }
 
-    /* Start Pan */
-    sMlmeReqRsp.u8Type = MAC_MLME_REQ_START;
-    sMlmeReqRsp.u8ParamLength = sizeof(MAC_MlmeReqStart_s);
-    sMlmeReqRsp.uParam.sReqStart.u16PanId = PAN_ID;
-    sMlmeReqRsp.uParam.sReqStart.u8Channel = sCoordinatorData.u8Channel;
-    sMlmeReqRsp.uParam.sReqStart.u8BeaconOrder = 0x0F;
-    sMlmeReqRsp.uParam.sReqStart.u8SuperframeOrder = 0x0F;
-    sMlmeReqRsp.uParam.sReqStart.u8PanCoordinator = TRUE;
-    sMlmeReqRsp.uParam.sReqStart.u8BatteryLifeExt = FALSE;
-    sMlmeReqRsp.uParam.sReqStart.u8Realignment = FALSE;
-    sMlmeReqRsp.uParam.sReqStart.u8SecurityEnable = FALSE;
+    vPrintf("Beacon %i Left: %i\n", u16Slot, u16RegistryShortAdr(u16Slot));
 
-    vAppApiMlmeRequest(&sMlmeReqRsp, &sMlmeSyncCfm);
+    (void)bAssocStoreRemove(psMlmeInd->uParam.sIndDisassociate.sDeviceAddr.u32H,
+                            psMlmeInd->uParam.sIndDisassociate.sDeviceAddr.u32L);
+    vRegistryRemove(u16Slot);
+    vClearEndDevice(u16Slot);
 }
 
 /****************************************************************************
  *
- * NAME: lcd_BuildStatusScreen
+ * NAME: vClearEndDevice
  *
  * DESCRIPTION:
- * Builds the LCD output presented to the user.
+ * Clears the data held for the device in a slot.
  *
  * PARAMETERS:      Name            RW  Usage
- * None.
+ *                  u16Slot         R   Registry slot
  *
  * RETURNS: void
  *
  ****************************************************************************/
-PRIVATE void lcd_BuildStatusScreen(void)
+PRIVATE void vClearEndDevice(uint16 u16Slot)
 {
-    #ifdef DEBUG_LCD
-        vPrintf("lcd_BuildStatusScreen\n");
-    #endif
-    vLcdClear();
-    vLcdWriteText("Esten Rye", 0, 0);
-    vLcdWriteTextRightJustified("SEIS 740", 0, 127);
-    vLcdWriteText("TOF Triangulation", 1, 0);
-    vLcdWriteText("Node 0:", 2, 0);
-    vLcdWriteTextRightJustified("Off", 2, 60);
-    vLcdWriteText("Node 1:", 2, 64);
-    vLcdWriteTextRightJustified("Off", 2, 123);
-    vLcdWriteText("A:", 3, 0);
-    vLcdWriteText("B:", 4, 0);
-    vLcdWriteText("C:", 5, 0);
-    vLcdWriteText("X:", 6, 0);
-    vLcdWriteText("Y:", 7, 0);
-    lcd_UpdateStatusScreen();
+    tsEndDeviceData *psEndDevice = &sCoordinatorData.sEndDeviceData[u16Slot];
+
+    sCoordinatorData.sDistance.ai32TofDistance[u16Slot]  = 0;
+    sCoordinatorData.sDistance.au32RssiDistance[u16Slot] = 0;
+    sCoordinatorData.sDistance.au16TofStdDev[u16Slot]    = 0;
+    vDistanceChanged(u16Slot, u32TickClockNowMs());
+    vTagTableRemove(&sTagTable, u16Slot);
+    if (u16Slot < sCoordinatorData.u8Anchors)
+    {
+        vTagTableAnchorLost(&sTagTable, (uint8)u16Slot);
+    }
+
+    psEndDevice->i16TofRate           = 0;
+    psEndDevice->u32ReportTimestampMs = 0;
+    psEndDevice->u8TofErrors          = 0;
+    psEndDevice->u8TofSqi             = 0;
+    psEndDevice->u32LastRangedMs      = 0;
+    psEndDevice->u8RangingFailures    = 0;
+    psEndDevice->u8TxPacketSeqNb      = 0;
+    vSeqTrackReset(&psEndDevice->sRxSeq);
+    vTofTrackReset(&psEndDevice->sTofTrack);
 }
 
 /****************************************************************************
  *
- * NAME: GetDistance
+ * NAME: vHandleEnergyScanResponse
  *
  * DESCRIPTION:
- * Retrieves a distance measurement for a specified end device.
+ * Selects a channel with low enery content for use by the wireless UART.
  *
  * PARAMETERS:      Name            RW  Usage
- *                  iEndDevice          index of the end device in the routing table to use.
+ * None.
  *
- * RETURNS: uint32 distance result.
+ * RETURNS: void
  *
+ * NOTES: Demo Application Boiler Plate for handling 802.15.4 Energy Scan
+ *        Response.
+ * 
  ****************************************************************************/
-
-PRIVATE uint32 GetDistance(uint16 iEndDevice)
+PRIVATE void vHandleEnergyScanResponse(MAC_MlmeDcfmInd_s *psMlmeInd)
 {
-    uint32 distance;
-    if (sCoordinatorData.sEndDeviceData[iEndDevice].i32TofDistance < 50)
-    
-    {
-        distance = sCoordinatorData.sEndDeviceData[iEndDevice].u32RssiDistance;
-    }
-    else
+	/* Search list to find quietest channel */
+    sCoordinatorData.u8Channel =
+        u8ChanAgilitySelect(psMlmeInd->uParam.sDcfmScan.uList.au8EnergyDetect,
+                            psMlmeInd->uParam.sDcfmScan.u8ResultListSize, 0);
+    if (sCoordinatorData.u8Channel == 0)
     {
-        distance = sCoordinatorData.sEndDeviceData[iEndDevice].i32TofDistance;
+        sCoordinatorData.u8Channel = CHANNEL_MIN;
     }
-    return distance;
+    vPrintf("Starting on channel %i\n", sCoordinatorData.u8Channel);
+
+    (void)bAssocStoreSetChannel(sCoordinatorData.u8Channel);
+    vStartCoordinator(FALSE);
 }
 
 /****************************************************************************
  *
- * NAME: lcd_UpdateStatusScreen
+ * NAME: vStartAgilityScan
  *
  * DESCRIPTION:
- * Updates the LCD output presented to the user.
+ * Starts an energy scan of the band while the PAN is running. Nothing is
+ * received until it completes.
  *
  * PARAMETERS:      Name            RW  Usage
  * None.
@@ -761,67 +1194,372 @@ PRIVATE uint32 GetDistance(uint16 iEndDevice)
  * RETURNS: void
  *
  ****************************************************************************/
-PRIVATE void lcd_UpdateStatusScreen(void)
+PRIVATE void vStartAgilityScan(void)
 {
-    #ifdef DEBUG_LCD
-        vPrintf("lcd_UpdateStatusScreen\n");
-    #endif
-    bool_t beacon0Assigned = sCoordinatorData.sEndDeviceData[0].bIsAssociated;
-    bool_t beacon1Assigned = sCoordinatorData.sEndDeviceData[1].bIsAssociated;
-
-    #ifdef DEBUG_LCD
-        vPrintf("Beacon 0 Associated: %i\n", beacon0Assigned);
-        vPrintf("Beacon 1 Associated: %i\n", beacon1Assigned);
-    #endif
+    MAC_MlmeReqRsp_s   sMlmeReqRsp;
+    MAC_MlmeSyncCfm_s  sMlmeSyncCfm;
 
-    if (beacon0Assigned)
-    {
-        vLcdWriteTextRightJustified(" On", 2, 60);
-    }
-    else
-    {
-        vLcdWriteTextRightJustified("Off", 2, 60);
-    }
+    sAgility.eState = E_AGILITY_SCANNING;
 
-    if (beacon1Assigned)
-    {
-        vLcdWriteTextRightJustified(" On", 2, 123);
-    }
-    else
-    {
-        vLcdWriteTextRightJustified("Off", 2, 123);
-    }
+    sMlmeReqRsp.u8Type = MAC_MLME_REQ_SCAN;
+    sMlmeReqRsp.u8ParamLength = sizeof(MAC_MlmeReqScan_s);
+    sMlmeReqRsp.uParam.sReqScan.u8ScanType = MAC_MLME_SCAN_TYPE_ENERGY_DETECT;
+    sMlmeReqRsp.uParam.sReqScan.u32ScanChannels = SCAN_CHANNELS;
+    sMlmeReqRsp.uParam.sReqScan.u8ScanDuration = ENERGY_SCAN_DURATION;
 
-    char output[20];
-    
-    intToStr(GetDistance(0), output, 0);
-    vLcdWriteTextRightJustified(output, 3, 127);
-    intToStr(GetDistance(1), output, 0);
-    vLcdWriteTextRightJustified(output, 4, 127);
-    vLcdWriteTextRightJustified("120", 5, 127);
-    intToStr((int)sCoordinatorData.x, output, 0);
-    vLcdWriteTextRightJustified(output, 6, 127);
-    intToStr((int)sCoordinatorData.y, output, 0);
-    vLcdWriteTextRightJustified(output, 7, 127);
-    vLcdRefreshAll();
+    vAppApiMlmeRequest(&sMlmeReqRsp, &sMlmeSyncCfm);
 }
 
 /****************************************************************************
  *
- * NAME: vPutChar
+ * NAME: vHandleAgilityScanResponse
  *
  * DESCRIPTION:
- * Updates the UART output presented to the user.
+ * Announces a move to a clearly quieter channel, if the scan found one.
+ * Otherwise the PAN stays where it is and monitoring is held off.
  *
  * PARAMETERS:      Name            RW  Usage
- *                  c
+ *                  psMlmeInd
  *
  * RETURNS: void
  *
- * NOTES: Demo Application Boiler Plate for supporting vPrintf functionality.
- * 
  ****************************************************************************/
-PRIVATE void vPutChar(unsigned char c) {
+PRIVATE void vHandleAgilityScanResponse(MAC_MlmeDcfmInd_s *psMlmeInd)
+{
+    uint8 u8Channel = sCoordinatorData.u8Channel;
+
+    if (psMlmeInd->uParam.sDcfmScan.u8Status == MAC_ENUM_SUCCESS)
+    {
+        u8Channel = u8ChanAgilitySelect(psMlmeInd->uParam.sDcfmScan.uList.au8EnergyDetect,
+                                        psMlmeInd->uParam.sDcfmScan.u8ResultListSize,
+                                        sCoordinatorData.u8Channel);
+    }
+
+    if (u8Channel == sCoordinatorData.u8Channel)
+    {
+        vPrintf("No quieter channel than %i\n", u8Channel);
+        sAgility.eState = E_AGILITY_MONITORING;
+        vLinkMonitorHoldOff(&sAgility.sMonitor, u32TickClockNowMs());
+        return;
+    }
+
+    vPrintf("Moving from channel %i to %i\n", sCoordinatorData.u8Channel, u8Channel);
+    sAgility.eState            = E_AGILITY_ANNOUNCING;
+    sAgility.u8NewChannel      = u8Channel;
+    sAgility.u8Announcements   = CHAN_AGILITY_ANNOUNCEMENTS;
+    sAgility.u32NextAnnounceMs = u32TickClockNowMs();
+}
+
+/****************************************************************************
+ *
+ * NAME: vSendChannelChange
+ *
+ * DESCRIPTION:
+ * Broadcasts a channel change command. It is not acknowledged, so it is
+ * sent several times.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u8Channel       R   Channel the PAN moves to
+ *                  u16DelayMs      R   Time until the move (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vSendChannelChange(uint8 u8Channel, uint16 u16DelayMs)
+{
+    uint8 au8Cmd[CHAN_AGILITY_CMD_LEN];
+
+    vSendBroadcast(au8Cmd, u8ChanAgilityEncode(au8Cmd, u8Channel, u16DelayMs));
+}
+
+/****************************************************************************
+ *
+ * NAME: vSendBroadcast
+ *
+ * DESCRIPTION:
+ * Broadcasts a command to every end device, after the broadcast sequence
+ * number. It is not acknowledged.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pu8Cmd          R   Command, opcode first
+ *                  u8Len           R   Command length
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vSendBroadcast(uint8 *pu8Cmd, uint8 u8Len)
+{
+    MAC_McpsReqRsp_s  sMcpsReqRsp;
+    MAC_McpsSyncCfm_s sMcpsSyncCfm;
+    uint8 *pu8Sdu = sMcpsReqRsp.uParam.sReqData.sFrame.au8Sdu;
+    uint8 n;
+
+    sMcpsReqRsp.u8Type = MAC_MCPS_REQ_DATA;
+    sMcpsReqRsp.u8ParamLength = sizeof(MAC_McpsReqData_s);
+    sMcpsReqRsp.uParam.sReqData.u8Handle = 0;
+
+    sMcpsReqRsp.uParam.sReqData.sFrame.sSrcAddr.u8AddrMode = 2;
+    sMcpsReqRsp.uParam.sReqData.sFrame.sSrcAddr.u16PanId = PAN_ID;
+    sMcpsReqRsp.uParam.sReqData.sFrame.sSrcAddr.uAddr.u16Short = COORDINATOR_ADR;
+
+    sMcpsReqRsp.uParam.sReqData.sFrame.sDstAddr.u8AddrMode = 2;
+    sMcpsReqRsp.uParam.sReqData.sFrame.sDstAddr.u16PanId = PAN_ID;
+    sMcpsReqRsp.uParam.sReqData.sFrame.sDstAddr.uAddr.u16Short = 0xffff;
+
+    sMcpsReqRsp.uParam.sReqData.sFrame.u8TxOptions = 0;
+
+    pu8Sdu[0] = sCoordinatorData.u8TxBroadcastSeqNb++;
+    for (n = 0; n < u8Len; n++)
+    {
+        pu8Sdu[1 + n] = pu8Cmd[n];
+    }
+    sMcpsReqRsp.uParam.sReqData.sFrame.u8SduLength = 1 + u8Len;
+
+    vAppApiMcpsRequest(&sMcpsReqRsp, &sMcpsSyncCfm);
+}
+
+/****************************************************************************
+ *
+ * NAME: task_ChannelAgility
+ *
+ * DESCRIPTION:
+ * Scans for a quieter channel when a monitoring window shows heavy loss,
+ * and carries out an announced move once the announcements are sent.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_ChannelAgility(void)
+{
+    uint32 u32Now = u32TickClockNowMs();
+
+    switch (sAgility.eState)
+    {
+    case E_AGILITY_MONITORING:
+        if (bLinkMonitorCheck(&sAgility.sMonitor, u32Now))
+        {
+            vPrintf("High loss on channel %i, scanning\n", sCoordinatorData.u8Channel);
+            vStartAgilityScan();
+        }
+        break;
+
+    case E_AGILITY_ANNOUNCING:
+        if (!TICK_CLOCK_EXPIRED(u32Now, sAgility.u32NextAnnounceMs))
+        {
+            break;
+        }
+
+        if (sAgility.u8Announcements > 0)
+        {
+            vSendChannelChange(sAgility.u8NewChannel,
+                               sAgility.u8Announcements * CHAN_AGILITY_ANNOUNCE_MS);
+            sAgility.u8Announcements--;
+            sAgility.u32NextAnnounceMs += CHAN_AGILITY_ANNOUNCE_MS;
+        }
+        else
+        {
+            sCoordinatorData.u8Channel = sAgility.u8NewChannel;
+            (void)bAssocStoreSetChannel(sCoordinatorData.u8Channel);
+            vStartCoordinator(TRUE);
+            sAgility.eState = E_AGILITY_MONITORING;
+            vLinkMonitorHoldOff(&sAgility.sMonitor, u32Now);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: vStartCoordinator
+ *
+ * DESCRIPTION:
+ * Starts the network by configuring the controller board to act as the PAN
+ * coordinator. Called again with realignment to move a running PAN to
+ * another channel.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  bRealignment    R   TRUE if the PAN is already running
+ *
+ * RETURNS:
+ * TRUE if network was started successfully otherwise FALSE
+ *
+ * NOTES: Demo Application Boiler Plate for starting 802.15.4 Network.
+ * 
+ ****************************************************************************/
+PRIVATE void vStartCoordinator(bool_t bRealignment)
+{
+    /* Structures used to hold data for MLME request and response */
+    MAC_MlmeReqRsp_s   sMlmeReqRsp;
+    MAC_MlmeSyncCfm_s  sMlmeSyncCfm;
+
+    sCoordinatorData.eState = E_STATE_COORDINATOR_STARTED;
+
+    /* Start Pan */
+    sMlmeReqRsp.u8Type = MAC_MLME_REQ_START;
+    sMlmeReqRsp.u8ParamLength = sizeof(MAC_MlmeReqStart_s);
+    sMlmeReqRsp.uParam.sReqStart.u16PanId = PAN_ID;
+    sMlmeReqRsp.uParam.sReqStart.u8Channel = sCoordinatorData.u8Channel;
+    if (BEACON_ENABLED_NETWORK)
+    {
+        sMlmeReqRsp.uParam.sReqStart.u8BeaconOrder = BEACON_ORDER;
+        sMlmeReqRsp.uParam.sReqStart.u8SuperframeOrder = SUPERFRAME_ORDER;
+    }
+    else
+    {
+        sMlmeReqRsp.uParam.sReqStart.u8BeaconOrder = 0x0F;
+        sMlmeReqRsp.uParam.sReqStart.u8SuperframeOrder = 0x0F;
+    }
+    sMlmeReqRsp.uParam.sReqStart.u8PanCoordinator = TRUE;
+    sMlmeReqRsp.uParam.sReqStart.u8BatteryLifeExt = FALSE;
+    sMlmeReqRsp.uParam.sReqStart.u8Realignment = bRealignment;
+    sMlmeReqRsp.uParam.sReqStart.u8SecurityEnable = FALSE;
+
+    vAppApiMlmeRequest(&sMlmeReqRsp, &sMlmeSyncCfm);
+}
+
+/****************************************************************************
+ *
+ * NAME: lcd_BuildStatusScreen
+ *
+ * DESCRIPTION:
+ * Builds the LCD output presented to the user.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ * None.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void lcd_BuildStatusScreen(void)
+{
+    #ifdef DEBUG_LCD
+        vPrintf("lcd_BuildStatusScreen\n");
+    #endif
+    vLcdClear();
+    vLcdWriteText("Esten Rye", 0, 0);
+    vLcdWriteTextRightJustified("SEIS 740", 0, 127);
+    vLcdWriteText("TOF Triangulation", 1, 0);
+    vLcdWriteText("Node 0:", 2, 0);
+    vLcdWriteTextRightJustified("Off", 2, 60);
+    vLcdWriteText("Node 1:", 2, 64);
+    vLcdWriteTextRightJustified("Off", 2, 123);
+    vLcdWriteText("A:", 3, 0);
+    vLcdWriteText("B:", 4, 0);
+    vLcdWriteText("C:", 5, 0);
+    vLcdWriteText("X:", 6, 0);
+    vLcdWriteText("Y:", 7, 0);
+    lcd_UpdateStatusScreen();
+}
+
+/****************************************************************************
+ *
+ * NAME: GetDistance
+ *
+ * DESCRIPTION:
+ * Retrieves a distance measurement for a specified end device.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  iEndDevice          index of the end device in the routing table to use.
+ *
+ * RETURNS: uint32 distance result.
+ *
+ ****************************************************************************/
+
+PRIVATE uint32 GetDistance(uint16 iEndDevice)
+{
+    uint32 distance;
+    if (sCoordinatorData.sDistance.ai32TofDistance[iEndDevice] < 50)
+    
+    {
+        distance = sCoordinatorData.sDistance.au32RssiDistance[iEndDevice];
+    }
+    else
+    {
+        distance = sCoordinatorData.sDistance.ai32TofDistance[iEndDevice];
+    }
+    return distance;
+}
+
+/****************************************************************************
+ *
+ * NAME: lcd_UpdateStatusScreen
+ *
+ * DESCRIPTION:
+ * Updates the LCD output presented to the user.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ * None.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void lcd_UpdateStatusScreen(void)
+{
+    #ifdef DEBUG_LCD
+        vPrintf("lcd_UpdateStatusScreen\n");
+    #endif
+    bool_t beacon0Assigned = bRegistryInUse(0);
+    bool_t beacon1Assigned = bRegistryInUse(1);
+
+    #ifdef DEBUG_LCD
+        vPrintf("Beacon 0 Associated: %i\n", beacon0Assigned);
+        vPrintf("Beacon 1 Associated: %i\n", beacon1Assigned);
+    #endif
+
+    if (beacon0Assigned)
+    {
+        vLcdWriteTextRightJustified(" On", 2, 60);
+    }
+    else
+    {
+        vLcdWriteTextRightJustified("Off", 2, 60);
+    }
+
+    if (beacon1Assigned)
+    {
+        vLcdWriteTextRightJustified(" On", 2, 123);
+    }
+    else
+    {
+        vLcdWriteTextRightJustified("Off", 2, 123);
+    }
+
+    char output[20];
+    
+    intToStr(GetDistance(0), output, 0);
+    vLcdWriteTextRightJustified(output, 3, 127);
+    intToStr(GetDistance(1), output, 0);
+    vLcdWriteTextRightJustified(output, 4, 127);
+    intToStr((sCoordinatorData.u8Anchors >= 2) ?
+             u32FixedDist(asAnchorPos[0].ai32Cm, asAnchorPos[1].ai32Cm, MULTILAT_AXES) : 0,
+             output, 1);
+    vLcdWriteTextRightJustified(output, 5, 127);
+    vSignedToStr(sCoordinatorData.sPosition.ai32Cm[0], output);
+    vLcdWriteTextRightJustified(output, 6, 127);
+    vSignedToStr(sCoordinatorData.sPosition.ai32Cm[1], output);
+    vLcdWriteTextRightJustified(output, 7, 127);
+    vLcdRefreshAll();
+}
+
+/****************************************************************************
+ *
+ * NAME: vPutChar
+ *
+ * DESCRIPTION:
+ * Updates the UART output presented to the user.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  c
+ *
+ * RETURNS: void
+ *
+ * NOTES: Demo Application Boiler Plate for supporting vPrintf functionality.
+ * 
+ ****************************************************************************/
+PRIVATE void vPutChar(unsigned char c) {
 	while ((u8AHI_UartReadLineStatus(UART) & E_AHI_UART_LS_THRE) == 0);
 	vAHI_UartWriteData(UART, c);
     while ((u8AHI_UartReadLineStatus(UART) & (E_AHI_UART_LS_THRE | E_AHI_UART_LS_TEMT)) != (E_AHI_UART_LS_THRE | E_AHI_UART_LS_TEMT));
@@ -898,35 +1636,882 @@ int intToStr(uint32 x, char str[], int d)
 
 /****************************************************************************
  *
- * NAME: vPutChar
+ * NAME: vSignedToStr
  *
  * DESCRIPTION:
- * Calculates the XY position of the coordinator based on time of flight data
- * received from beacon nodes.
+ * Converts a signed integer to a string, with a leading '-' if negative and
+ * at least one digit.
  *
  * PARAMETERS:      Name            RW  Usage
- * None.
+ *                  i32Value        R   Integer to convert
+ *                  pcStr           W   String to write result to
  *
  * RETURNS: void
  *
  ****************************************************************************/
-PRIVATE void task_CalculateXYPos(void)
+PRIVATE void vSignedToStr(int32 i32Value, char *pcStr)
 {
-    int32 a = (int32)GetDistance(0);
-    int32 b = (int32)GetDistance(1);
-    int32 c = (int32)120;
-    vPrintf("\nCalculate XY Position\nA: %i\nB: %i\nC: %i\n", a, b, c);
-    if (a > 0 && b > 0)
+    uint32 u32Magnitude = (uint32)i32Value;
+
+    if (i32Value < 0)
     {
-        int32 s = (a + b + c) / 2;
-        int32 n = s * (s-a) * (s-b) * (s-c);
-        double y = 2 * sqrt(n) / c;
-        double x = sqrt(pow(a, 2) - pow(y, 2));
-        vPrintf("N: %i\nS: %i\nX: %i\nY: %i\n", n, s, (int)x, (int)y);
-        sCoordinatorData.y = y;
-        sCoordinatorData.x = x;
+        *pcStr++ = '-';
+        u32Magnitude = 0 - u32Magnitude;
     }
+    (void)intToStr(u32Magnitude, pcStr, 1);
 }
+
+/****************************************************************************
+ *
+ * NAME: task_CalculateXYPos
+ *
+ * DESCRIPTION:
+ * Applies the new ranges from the anchors selected for their geometry to
+ * the coordinator's position track, one measurement at a time, starting
+ * the track from a multilateration fix when there is none.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_CalculateXYPos(void)
+{
+    tsTag *psSelf = &sCoordinatorData.sSelf;
+    bool_t bTracking = psSelf->sTrack.bValid;
+
+    sCoordinatorData.u8Dirty &= (uint8)~COORD_DIRTY_POSITION;
+
+    /* Every anchor ranges the coordinator itself each period */
+    (void)bTagUpdate(psSelf, asAnchorPos, sCoordinatorData.u8Anchors, POSITION_DIMS, u32TickClockNowMs(), 0);
+    vPrintTrackChange(COORDINATOR_ADR, bTracking, psSelf);
+}
+
+/****************************************************************************
+ *
+ * NAME: task_PredictPosition
+ *
+ * DESCRIPTION:
+ * Predicts the tracked position to now, flagging the display if it moved.
+ *
+ * RETURNS:
+ * TRUE if the position is being tracked
+ *
+ ****************************************************************************/
+PRIVATE bool_t task_PredictPosition(void)
+{
+    tsMultilatPoint sPos;
+    uint8 i;
+
+    if (!bPosTrackPredict(&sCoordinatorData.sSelf.sTrack, u32TickClockNowMs(),
+                          &sPos, &sCoordinatorData.sVelocity))
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < MULTILAT_AXES; i++)
+    {
+        if (sPos.ai32Cm[i] != sCoordinatorData.sPosition.ai32Cm[i])
+        {
+            sCoordinatorData.u8Dirty |= COORD_DIRTY_DISPLAY;
+        }
+    }
+    sCoordinatorData.sPosition = sPos;
+
+    return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: vPrintPosition
+ *
+ * DESCRIPTION:
+ * Prints the position and velocity last predicted, with the GDOP of the
+ * anchors in use.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vPrintPosition(void)
+{
+    tsMultilatPoint *psPos = &sCoordinatorData.sPosition;
+    tsMultilatPoint *psVel = &sCoordinatorData.sVelocity;
+
+    vPrintf("\nPosition X: %i Y: %i Z: %i cm, velocity X: %i Y: %i Z: %i cm/s",
+            psPos->ai32Cm[0],
+            psPos->ai32Cm[1],
+            psPos->ai32Cm[2],
+            psVel->ai32Cm[0],
+            psVel->ai32Cm[1],
+            psVel->ai32Cm[2]);
+    vPrintGdop(sCoordinatorData.sSelf.u16GdopX100);
+}
+
+/****************************************************************************
+ *
+ * NAME: vPrintGdop
+ *
+ * DESCRIPTION:
+ * Prints the GDOP of a position, or that its anchors do not fix one.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16GdopX100     R   GDOP x100, see tagtrack.h
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vPrintGdop(uint16 u16GdopX100)
+{
+    char acGdop[FIXED_STR_LEN];
+
+    if (u16GdopX100 == TAG_TRACK_GDOP_NONE)
+    {
+        vPrintf(", GDOP none");
+    }
+    else
+    {
+        vPrintf(", GDOP %s", pcFixedToStr(u16GdopX100, 2, acGdop));
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: vPrintTrackChange
+ *
+ * DESCRIPTION:
+ * Reports a position track that has just started or been lost.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16Address      R   Short address of the target
+ *                  bWasTracking    R   Track was valid before the update
+ *                  psTag           R   Target after the update
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vPrintTrackChange(uint16 u16Address, bool_t bWasTracking, tsTag *psTag)
+{
+    tsMultilatPoint sPos;
+
+    if (!bWasTracking &&
+        bPosTrackPredict(&psTag->sTrack, psTag->sTrack.u32LastMs, &sPos, NULL))
+    {
+        vPrintf("\nPosition track of %i started at X: %i Y: %i Z: %i cm",
+                u16Address,
+                sPos.ai32Cm[0],
+                sPos.ai32Cm[1],
+                sPos.ai32Cm[2]);
+    }
+    else if (bWasTracking && !psTag->sTrack.bValid)
+    {
+        vPrintf("\nPosition track of %i lost", u16Address);
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: u32RangeStdDevCm
+ *
+ * DESCRIPTION:
+ * Standard deviation of the distance GetDistance returns for a beacon.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16Slot         R   Registry slot of the beacon
+ *
+ * RETURNS: uint32 standard deviation (cm)
+ *
+ ****************************************************************************/
+PRIVATE uint32 u32RangeStdDevCm(uint16 u16Slot)
+{
+    tsDistanceTable *psDistance = &sCoordinatorData.sDistance;
+
+    if ((psDistance->ai32TofDistance[u16Slot] < 50) || (psDistance->au16TofStdDev[u16Slot] == 0))
+    {
+        return RANGE_DEFAULT_STDDEV_CM;
+    }
+    return psDistance->au16TofStdDev[u16Slot];
+}
+
+/****************************************************************************
+ *
+ * NAME: vDistanceChanged
+ *
+ * DESCRIPTION:
+ * Passes a changed distance to an anchor to the coordinator's position, and
+ * flags the position and display for recalculation.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16Slot         R   Registry slot of the beacon
+ *                  u32TimeMs       R   Time of the range, local clock (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vDistanceChanged(uint16 u16Slot, uint32 u32TimeMs)
+{
+    uint32 u32Distance;
+
+    if (u16Slot >= sCoordinatorData.u8Anchors)
+    {
+        return;
+    }
+
+    u32Distance = bRegistryInUse(u16Slot) ? GetDistance(u16Slot) : 0;
+    if (u32Distance != 0)
+    {
+        vTagRange(&sCoordinatorData.sSelf, (uint8)u16Slot, (int32)u32Distance,
+                  u32RangeStdDevCm(u16Slot), u32TimeMs);
+    }
+    else
+    {
+        vTagRangeLost(&sCoordinatorData.sSelf, (uint8)u16Slot);
+    }
+    sCoordinatorData.u8Dirty |= COORD_DIRTY_POSITION | COORD_DIRTY_DISPLAY;
+}
+
+/****************************************************************************
+ *
+ * NAME: task_TagRange
+ *
+ * DESCRIPTION:
+ * Holds a tag's range to an anchor for its next update, adding the tag to
+ * the table on its first range.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16Slot         R   Registry slot of the tag
+ *                  psMeasurement   R   Range as reported
+ *                  u32TimeMs       R   Time of the range, local clock (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_TagRange(uint16 u16Slot, tsReportMeasurement *psMeasurement, uint32 u32TimeMs)
+{
+    uint16 u16Anchor = u16RegistryFindShort(psMeasurement->u16Target);
+    uint32 u32StdDev = psMeasurement->u16StdDev;
+    tsTag *psTag;
+
+    if ((u16Anchor == REGISTRY_NO_SLOT) || (u16Anchor >= sCoordinatorData.u8Anchors))
+    {
+        vPrintf("\nRange from %i to %i, not an anchor", u16RegistryShortAdr(u16Slot),
+                psMeasurement->u16Target);
+        return;
+    }
+
+    psTag = psTagTableAdd(&sTagTable, u16Slot);
+    if (psTag == NULL)
+    {
+        vPrintf("\nTag table full, %i not tracked", u16RegistryShortAdr(u16Slot));
+        return;
+    }
+
+    if (u32StdDev == 0)
+    {
+        u32StdDev = RANGE_DEFAULT_STDDEV_CM;
+    }
+    vTagRange(psTag, (uint8)u16Anchor, psMeasurement->i32TofDistance, u32StdDev, u32TimeMs);
+}
+
+/****************************************************************************
+ *
+ * NAME: task_UpdateTags
+ *
+ * DESCRIPTION:
+ * Applies waiting ranges to the tags' tracks, at most
+ * TAG_TRACK_UPDATES_PER_PASS tags per pass, in round robin. The tags range
+ * at the period last announced to them, or their own if that is longer.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_UpdateTags(void)
+{
+    uint32 u32NowMs = u32TickClockNowMs();
+    uint16 u16PeriodMs = sCoordinatorData.u16TagPeriodMs;
+    bool_t bTracking;
+    tsTag *psTag;
+    uint8 n;
+
+    if (u16PeriodMs < TAG_TRACK_TAG_PERIOD_MS)
+    {
+        u16PeriodMs = TAG_TRACK_TAG_PERIOD_MS;
+    }
+
+    for (n = 0; n < TAG_TRACK_UPDATES_PER_PASS; n++)
+    {
+        psTag = psTagTableNext(&sTagTable);
+        if (psTag == NULL)
+        {
+            return;
+        }
+        bTracking = psTag->sTrack.bValid;
+        (void)bTagUpdate(psTag, asAnchorPos, sCoordinatorData.u8Anchors, POSITION_DIMS, u32NowMs,
+                         u16PeriodMs);
+        vPrintTrackChange(u16RegistryShortAdr(psTag->u16Slot), bTracking, psTag);
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: task_AnnounceTagPeriod
+ *
+ * DESCRIPTION:
+ * Broadcasts the period the tags are to range at when it changes with the
+ * number of tags, and every TAG_PERIOD_ANNOUNCE_MS for tags that missed it.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_AnnounceTagPeriod(void)
+{
+    uint8 au8Cmd[REPORT_PERIOD_CMD_LEN];
+    uint16 u16PeriodMs = u16TagTablePeriodMs(&sTagTable);
+    uint32 u32Now = u32TickClockNowMs();
+
+    if ((sTagTable.u8Count == 0) ||
+        ((u16PeriodMs == sCoordinatorData.u16TagPeriodMs) &&
+         !TICK_CLOCK_EXPIRED(u32Now, sCoordinatorData.u32TagAnnounceMs)))
+    {
+        return;
+    }
+
+    if (u16PeriodMs != sCoordinatorData.u16TagPeriodMs)
+    {
+        vPrintf("\nTag ranging period %d ms for %d tags", u16PeriodMs, sTagTable.u8Count);
+    }
+    sCoordinatorData.u16TagPeriodMs   = u16PeriodMs;
+    sCoordinatorData.u32TagAnnounceMs = u32Now + TAG_PERIOD_ANNOUNCE_MS;
+
+    vSendBroadcast(au8Cmd, u8ReportPeriodEncode(au8Cmd, u16PeriodMs));
+}
+
+/****************************************************************************
+ *
+ * NAME: vPrintTags
+ *
+ * DESCRIPTION:
+ * Prints the position and velocity each tracked tag is predicted to have
+ * now, with the GDOP of the anchors in use.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vPrintTags(void)
+{
+    tsMultilatPoint sPos;
+    tsMultilatPoint sVel;
+    uint32 u32NowMs = u32TickClockNowMs();
+    tsTag *psTag;
+    uint8 i;
+
+    for (i = 0; i < sTagTable.u8Count; i++)
+    {
+        psTag = &sTagTable.asTag[i];
+        if (!bPosTrackPredict(&psTag->sTrack, u32NowMs, &sPos, &sVel))
+        {
+            continue;
+        }
+        vPrintf("\nTag %i X: %i Y: %i Z: %i cm, velocity X: %i Y: %i Z: %i cm/s",
+                u16RegistryShortAdr(psTag->u16Slot),
+                sPos.ai32Cm[0],
+                sPos.ai32Cm[1],
+                sPos.ai32Cm[2],
+                sVel.ai32Cm[0],
+                sVel.ai32Cm[1],
+                sVel.ai32Cm[2]);
+        vPrintGdop(psTag->u16GdopX100);
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: task_PrintTagStats
+ *
+ * DESCRIPTION:
+ * Prints the position updates made per second against the number of tags,
+ * in total and for the tag updated least often, since the last print.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_PrintTagStats(void)
+{
+    uint32 u32Now = u32TickClockNowMs();
+    uint32 u32ElapsedMs = u32Now - sCoordinatorData.u32TagStatsMs;
+    uint32 u32Fixes;
+    uint32 u32Rate;
+    uint32 u32MinRate;
+    uint16 u16MinFixes;
+    char acRate[FIXED_STR_LEN];
+    char acMinRate[FIXED_STR_LEN];
+
+    u32Fixes = u32TagTableWindowFixes(&sTagTable, &u16MinFixes);
+    sCoordinatorData.u32TagStatsMs = u32Now;
+    if (u32ElapsedMs == 0)
+    {
+        return;
+    }
+
+    /* Hundredths of a fix per second */
+    u32Rate    = (uint32)(((uint64)u32Fixes * 100000) / u32ElapsedMs);
+    u32MinRate = (uint32)(((uint64)u16MinFixes * 100000) / u32ElapsedMs);
+
+    vPrintf("\nTags %d: %s fixes/s, least updated tag %s fixes/s, ranging period %d ms",
+            sTagTable.u8Count,
+            pcFixedToStr(u32Rate, 2, acRate),
+            pcFixedToStr(u32MinRate, 2, acMinRate),
+            sCoordinatorData.u16TagPeriodMs);
+}
+
+/****************************************************************************
+ *
+ * NAME: task_StartRanging
+ *
+ * DESCRIPTION:
+ * Starts a burst to the associated beacon that has waited longest since it
+ * was last ranged, once its interval has passed. Ranging one beacon at a
+ * time from the coordinator keeps beacons from colliding with each other.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_StartRanging(void)
+{
+    tsEndDeviceData *psEndDevice;
+    MAC_Addr_s sAddr;
+    uint32 u32Now;
+    uint32 u32Waited;
+    uint32 u32Interval;
+    uint32 u32Longest = 0;
+    int16 i16Next = -1;
+    uint16 i;
+
+    if (sRangingEngine.eState != E_RANGING_IDLE)
+    {
+        return;
+    }
+
+    u32Now = u32TickClockNowMs();
+    for (i = 0; i < u16RegistryLimit(); i++)
+    {
+        if (!bRegistryInUse(i))
+        {
+            continue;
+        }
+        psEndDevice = &sCoordinatorData.sEndDeviceData[i];
+
+        u32Interval = (uint32)COORD_RANGING_MIN_INTERVAL_MS <<
+            ((psEndDevice->u8RangingFailures < COORD_RANGING_MAX_BACKOFF) ?
+             psEndDevice->u8RangingFailures : COORD_RANGING_MAX_BACKOFF);
+        u32Waited = u32Now - psEndDevice->u32LastRangedMs;
+
+        if ((u32Waited >= u32Interval) && (u32Waited >= u32Longest))
+        {
+            u32Longest = u32Waited;
+            i16Next = i;
+        }
+    }
+
+    if (i16Next < 0)
+    {
+        return;
+    }
+
+    psEndDevice = &sCoordinatorData.sEndDeviceData[i16Next];
+    psEndDevice->u32LastRangedMs = u32Now;
+
+    sAddr.u8AddrMode     = 2;
+    sAddr.u16PanId       = PAN_ID;
+    sAddr.uAddr.u16Short = u16RegistryShortAdr((uint16)i16Next);
+
+    sRangingEngine.u16EndDeviceIndex = (uint16)i16Next;
+    sRangingEngine.eState = E_RANGING_BUSY;
+
+    if (!bAppApiGetTof(sRangingEngine.asData, &sAddr, COORD_TOF_READINGS,
+                       API_TOF_FORWARDS, vTofCallback))
+    {
+        sRangingEngine.eState = E_RANGING_IDLE;
+        psEndDevice->u8RangingFailures++;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: task_ProcessRanging
+ *
+ * DESCRIPTION:
+ * Reduces a completed burst with MAD rejection and fuses the result into
+ * the beacon's distance track, which becomes its current distance.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_ProcessRanging(void)
+{
+    tsEndDeviceData *psEndDevice;
+    tsDistanceTable *psDistance = &sCoordinatorData.sDistance;
+    tsAppApiTof_Data *psData;
+    tsTofEstimate sEstimate;
+    uint16 u16Slot;
+    int32 ai32Tof[COORD_TOF_READINGS];
+    uint32 u32RssiSum = 0;
+    uint32 u32SqiSum = 0;
+    uint32 u32StdDev;
+    uint8 u8NumValid = 0;
+    uint8 n;
+
+    if (sRangingEngine.eState != E_RANGING_DONE)
+    {
+        return;
+    }
+
+    u16Slot     = sRangingEngine.u16EndDeviceIndex;
+    psEndDevice = &sCoordinatorData.sEndDeviceData[u16Slot];
+
+    if (sRangingEngine.eStatus == TOF_SUCCESS)
+    {
+        for (n = 0; n < COORD_TOF_READINGS; n++)
+        {
+            psData = &sRangingEngine.asData[n];
+            if (psData->u8Status == MAC_TOF_STATUS_SUCCESS)
+            {
+                ai32Tof[u8NumValid++] = psData->s32Tof;
+                u32RssiSum += u32RssiDistanceCm(psData->s8LocalRSSI);
+                u32RssiSum += u32RssiDistanceCm(psData->s8RemoteRSSI);
+                u32SqiSum  += psData->u8LocalSQI;
+            }
+        }
+    }
+
+    sRangingEngine.eState = E_RANGING_IDLE;
+
+    vLinkMonitorFrames(&sAgility.sMonitor, (u8NumValid > 0) ? 1 : 0, (u8NumValid > 0) ? 0 : 1);
+
+    if (!bRegistryInUse(u16Slot))
+    {
+        /* Beacon left during the burst */
+        return;
+    }
+
+    if (u8NumValid == 0)
+    {
+        psEndDevice->u8RangingFailures++;
+        vPrintf("\nRanging Beacon %i failed, status %i", u16RegistryShortAdr(u16Slot), sRangingEngine.eStatus);
+        return;
+    }
+    psEndDevice->u8RangingFailures = 0;
+
+    vTofEstimate(E_TOF_ESTIMATOR_MAD_REJECT, ai32Tof, u8NumValid, &sEstimate);
+    (void)bTofTrackUpdate(&psEndDevice->sTofTrack, psEndDevice->u32LastRangedMs,
+                          sEstimate.i32Tof, u64TofEstimateVariance(&sEstimate));
+
+    /* Standard deviation in cm = sqrt(P00) x 0.03 */
+    u32StdDev = (u32FixedSqrt64(psEndDevice->sTofTrack.u64P00) * TOF_CM_PER_PS_NUM) / TOF_CM_PER_PS_DEN;
+
+    psDistance->ai32TofDistance[u16Slot]  = i32TofPsToCm(psEndDevice->sTofTrack.i32Tof);
+    psDistance->au16TofStdDev[u16Slot]    = (u32StdDev > 0xffff) ? 0xffff : (uint16)u32StdDev;
+    psDistance->au32RssiDistance[u16Slot] = u32RssiSum / (u8NumValid * 2);
+    vDistanceChanged(u16Slot, psEndDevice->u32LastRangedMs);
+    psEndDevice->i16TofRate           = (int16)i32TofPsToCm(psEndDevice->sTofTrack.i32Rate);
+    psEndDevice->u32ReportTimestampMs = psEndDevice->u32LastRangedMs;
+    psEndDevice->u8TofErrors          = COORD_TOF_READINGS - u8NumValid;
+    psEndDevice->u8TofSqi             = (uint8)(u32SqiSum / u8NumValid);
+
+    vPrintf("\nRanged Beacon %i: TOF %i cm +/- %i, RSSI %i cm, used %i, errors %i",
+            u16RegistryShortAdr(u16Slot),
+            psDistance->ai32TofDistance[u16Slot],
+            psDistance->au16TofStdDev[u16Slot],
+            psDistance->au32RssiDistance[u16Slot],
+            sEstimate.u8Used,
+            psEndDevice->u8TofErrors);
+}
+
+/****************************************************************************
+ *
+ * NAME: task_PrintLinkStats
+ *
+ * DESCRIPTION:
+ * Prints the delivery statistics of the link from each associated beacon.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_PrintLinkStats(void)
+{
+    tsSeqTrack *psSeq;
+    uint16 i;
+
+    for (i = 0; i < u16RegistryLimit(); i++)
+    {
+        if (!bRegistryInUse(i))
+        {
+            continue;
+        }
+        psSeq = &sCoordinatorData.sEndDeviceData[i].sRxSeq;
+
+        vPrintf("\nLink from Beacon %i: received %d, lost %d, duplicates %d, reordered %d, restarts %d",
+                u16RegistryShortAdr(i),
+                psSeq->u32Received,
+                psSeq->u32Lost,
+                psSeq->u32Duplicates,
+                psSeq->u32Reordered,
+                psSeq->u32Restarts);
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: task_HandleConsole
+ *
+ * DESCRIPTION:
+ * Acts on keys received on the UART: 's' starts an anchor survey.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_HandleConsole(void)
+{
+    if ((u8AHI_UartReadLineStatus(UART) & E_AHI_UART_LS_DR) == 0)
+    {
+        return;
+    }
+
+    switch (u8AHI_UartReadData(UART))
+    {
+        case 's':
+            vStartSurvey();
+            break;
+        default:
+            break;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: vLoadAnchors
+ *
+ * DESCRIPTION:
+ * Places the anchors where the last survey saved them, or where the build
+ * puts them if none has been saved.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vLoadAnchors(void)
+{
+    tsMultilatPoint asPos[MAX_ANCHORS];
+    uint8 u8Anchors;
+
+    if (bSurveyLoad(&u8Anchors, asPos))
+    {
+        vPrintf("\nSurveyed anchors restored");
+        vSetAnchors(u8Anchors, asPos);
+    }
+    else
+    {
+        vSetAnchors(NUM_ANCHORS, asDefaultAnchorPos);
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: vSetAnchors
+ *
+ * DESCRIPTION:
+ * Places the anchors used for positioning. Tracks started against the old
+ * positions are dropped and restarted from the distances held.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u8Anchors       R   Anchors placed
+ *                  pasPos          R   Position of each (cm)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vSetAnchors(uint8 u8Anchors, const tsMultilatPoint *pasPos)
+{
+    uint8 n;
+
+    if (u8Anchors > TRACK_MAX_ANCHORS)
+    {
+        u8Anchors = TRACK_MAX_ANCHORS;
+    }
+
+    for (n = 0; n < u8Anchors; n++)
+    {
+        asAnchorPos[n] = pasPos[n];
+        vPrintf("\nAnchor %d at %i, %i, %i cm", n, asAnchorPos[n].ai32Cm[0],
+                asAnchorPos[n].ai32Cm[1], asAnchorPos[n].ai32Cm[2]);
+    }
+    sCoordinatorData.u8Anchors = u8Anchors;
+
+    vTagReset(&sCoordinatorData.sSelf, REGISTRY_NO_SLOT);
+    vTagTableInit(&sTagTable);
+    for (n = 0; n < u8Anchors; n++)
+    {
+        vDistanceChanged(n, u32TickClockNowMs());
+    }
+    sCoordinatorData.u8Dirty |= COORD_DIRTY_DISPLAY;
+}
+
+/****************************************************************************
+ *
+ * NAME: vStartSurvey
+ *
+ * DESCRIPTION:
+ * Starts a survey of the anchors: the tags' anchors in a multi-tag network,
+ * otherwise every beacon associated, up to TRACK_MAX_ANCHORS. Each must be
+ * associated.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vStartSurvey(void)
+{
+    uint32 u32Now = u32TickClockNowMs();
+    uint8 u8Anchors = 0;
+    uint8 n;
+
+    if ((sCoordinatorData.eState != E_STATE_COORDINATOR_STARTED) || sAnchorSurvey.bActive)
+    {
+        vPrintf("\nSurvey not started");
+        return;
+    }
+
+    if (MULTI_TAG_TRACKING)
+    {
+        u8Anchors = (TAG_ANCHORS < TRACK_MAX_ANCHORS) ? TAG_ANCHORS : TRACK_MAX_ANCHORS;
+    }
+    else
+    {
+        while ((u8Anchors < TRACK_MAX_ANCHORS) && bRegistryInUse(u8Anchors))
+        {
+            u8Anchors++;
+        }
+    }
+
+    for (n = 0; n < u8Anchors; n++)
+    {
+        if (!bRegistryInUse(n))
+        {
+            vPrintf("\nSurvey needs anchor %d", u16RegistryShortAdr(n));
+            return;
+        }
+    }
+    if (u8Anchors < 2)
+    {
+        vPrintf("\nSurvey needs two anchors");
+        return;
+    }
+
+    vSurveyReset(&sAnchorSurvey.sSurvey, u8Anchors);
+    sAnchorSurvey.bActive           = TRUE;
+    sAnchorSurvey.u8Announcements   = SURVEY_ANNOUNCEMENTS;
+    sAnchorSurvey.u32NextAnnounceMs = u32Now;
+    sAnchorSurvey.u32EndMs          = u32Now + SURVEY_DURATION_MS;
+    vPrintf("\nSurvey of %d anchors for %d ms", u8Anchors, SURVEY_DURATION_MS);
+}
+
+/****************************************************************************
+ *
+ * NAME: task_SurveyRange
+ *
+ * DESCRIPTION:
+ * Holds a distance one anchor reported to another during a survey.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16Slot         R   Registry slot of the sender
+ *                  psMeasurement   R   Range as reported
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_SurveyRange(uint16 u16Slot, tsReportMeasurement *psMeasurement)
+{
+    uint16 u16To = u16RegistryFindShort(psMeasurement->u16Target);
+    uint16 u16StdDev = psMeasurement->u16StdDev;
+
+    if ((u16Slot >= sAnchorSurvey.sSurvey.u8Anchors) ||
+        (u16To >= sAnchorSurvey.sSurvey.u8Anchors) ||
+        (psMeasurement->u8Flags & REPORT_FLAG_REJECTED))
+    {
+        return;
+    }
+
+    if (u16StdDev == 0)
+    {
+        u16StdDev = RANGE_DEFAULT_STDDEV_CM;
+    }
+    vSurveyRange(&sAnchorSurvey.sSurvey, (uint8)u16Slot, (uint8)u16To,
+                 psMeasurement->i32TofDistance, u16StdDev);
+}
+
+/****************************************************************************
+ *
+ * NAME: task_Survey
+ *
+ * DESCRIPTION:
+ * Announces a survey, and when it ends places the anchors from the
+ * distances held, saves their positions and positions against them.
+ * Pairs left without a distance are reported, and the positions in use
+ * are kept if the anchors cannot be placed.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_Survey(void)
+{
+    uint8 au8Cmd[REPORT_SURVEY_CMD_LEN];
+    tsMultilatPoint asPos[MAX_ANCHORS];
+    tsSurvey *psSurvey = &sAnchorSurvey.sSurvey;
+    uint32 u32Now = u32TickClockNowMs();
+    uint16 u16RmsCm;
+    int32 i32Distance;
+    uint8 i, j;
+
+    if (!sAnchorSurvey.bActive)
+    {
+        return;
+    }
+
+    if ((sAnchorSurvey.u8Announcements > 0) &&
+        TICK_CLOCK_EXPIRED(u32Now, sAnchorSurvey.u32NextAnnounceMs))
+    {
+        vSendBroadcast(au8Cmd, u8ReportSurveyEncode(au8Cmd, psSurvey->u8Anchors,
+                                                    (uint16)(sAnchorSurvey.u32EndMs - u32Now)));
+        sAnchorSurvey.u8Announcements--;
+        sAnchorSurvey.u32NextAnnounceMs += SURVEY_ANNOUNCE_MS;
+    }
+
+    if (!TICK_CLOCK_EXPIRED(u32Now, sAnchorSurvey.u32EndMs))
+    {
+        return;
+    }
+    sAnchorSurvey.bActive = FALSE;
+
+    if (!bSurveySolve(psSurvey, POSITION_DIMS, asPos, &u16RmsCm))
+    {
+        for (i = 0; i < psSurvey->u8Anchors; i++)
+        {
+            for (j = i + 1; j < psSurvey->u8Anchors; j++)
+            {
+                if (!bSurveyDistance(psSurvey, i, j, &i32Distance))
+                {
+                    vPrintf("\nNo distance between anchors %d and %d",
+                            u16RegistryShortAdr(i), u16RegistryShortAdr(j));
+                }
+            }
+        }
+        vPrintf("\nSurvey failed, RMS residual %d cm", u16RmsCm);
+        return;
+    }
+
+    vPrintf("\nSurvey RMS residual %d cm", u16RmsCm);
+    if (!bSurveySave(psSurvey->u8Anchors, asPos))
+    {
+        vPrintf("\nSurvey not saved");
+    }
+    vSetAnchors(psSurvey->u8Anchors, asPos);
+}
+
 /****************************************************************************/
 /***        END OF FILE                                                   ***/
 /****************************************************************************/
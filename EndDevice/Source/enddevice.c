@@ -7,18 +7,147 @@
 #include <mac_sap.h>
 #include <mac_pib.h>
 #include <AppApiTof.h>
+#include <MicroSpecific.h>
 #include "Printf.h"
-#include <Math.h>
 #include <LedControl.h>
 #include "config.h"
+#include "tickclock.h"
+#include "fixedpoint.h"
+#include "tofstats.h"
+#include "toftrack.h"
+#include "report.h"
+#include "txqueue.h"
+#include "rssidistance.h"
+#include "tdma.h"
+#include "persist.h"
+#include "chanagility.h"
+#include "seqtrack.h"
+#include "powerbudget.h"
+#include "txpower.h"
 
 /****************************************************************************/
 /***        Macro Definitions                                             ***/
 /****************************************************************************/
 
-#define MAX_READINGS     20
+#define MAX_READINGS     40
 #define UART             E_AHI_UART_0
 
+/* A report must not go stale while waiting for the device's reporting slot */
+#if BEACON_ENABLED_NETWORK && (TDMA_MAX_WAIT_MS >= TX_QUEUE_MAX_AGE_MS)
+#error "TDMA_MAX_DEVICES too large for TX_QUEUE_MAX_AGE_MS"
+#endif
+
+/* Number of burst buffers. While one burst fills a buffer the previous ones
+   can be reduced and transmitted. */
+#define TOF_BUFFERS      2
+
+/* Sequential ranging. A burst is built from sub-bursts of
+   TOF_SUBBURST_READINGS and stops once the standard error of the tracked
+   distance falls to TOF_TARGET_STDERR_PS, or MAX_READINGS have been taken.
+   When disabled every burst is a single TOF_FIXED_READINGS burst in each
+   direction. */
+#ifndef TOF_ADAPTIVE_BURSTS
+#define TOF_ADAPTIVE_BURSTS      TRUE
+#endif
+#define TOF_SUBBURST_READINGS    5
+#define TOF_MIN_VALID_READINGS   4
+#define TOF_TARGET_STDERR_PS     150
+#define TOF_FIXED_READINGS       20
+
+/* Bursts between reports of the burst length histogram */
+#define TOF_LENGTH_REPORT_BURSTS 20
+
+/* Rate at which ToF bursts are released. May be overridden from the build,
+   or RANGING_PERIOD_MS given instead for rates below 1Hz. A lower rate
+   leaves longer to sleep between bursts in the low power modes. */
+#ifndef RANGING_RATE_HZ
+#define RANGING_RATE_HZ  2
+#endif
+#ifndef RANGING_PERIOD_MS
+#define RANGING_PERIOD_MS (1000 / RANGING_RATE_HZ)
+#endif
+
+/* When built as a tag in a multi-tag network, bursts are taken against
+   each anchor in turn rather than the coordinator, at the period the
+   coordinator sets for the number of tags, or RANGING_PERIOD_MS if that is
+   longer. An anchor answers the tags' bursts and does not range itself. */
+#ifndef END_DEVICE_TAG
+#define END_DEVICE_TAG   FALSE
+#endif
+#define RANGING_TARGETS  (MULTI_TAG_TRACKING ? TAG_ANCHORS : 1)
+#define RANGING_ENABLED  (!COORDINATOR_INITIATED_RANGING && (!MULTI_TAG_TRACKING || END_DEVICE_TAG))
+
+/* When the coordinator surveys the anchors, each anchor ranges the others
+   in turn whatever it is built as, and other devices hold their bursts.
+   Anchors are told to survey by broadcast, so must have the receiver on
+   when idle to hear it. One track is kept for each node ranged against. */
+#define TOF_TRACKS       ((RANGING_TARGETS > MAX_ANCHORS) ? RANGING_TARGETS : MAX_ANCHORS)
+
+/* Initial ranging mode, see teRangingMode. Changed at run time from the
+   console. */
+#ifndef RANGING_MODE
+#define RANGING_MODE     E_RANGING_MODE_FORWARD
+#endif
+
+/* Estimator used to reduce each burst, see teTofEstimator */
+#ifndef TOF_ESTIMATOR
+#define TOF_ESTIMATOR    E_TOF_ESTIMATOR_MAD_REJECT
+#endif
+
+/* LED flash periods (ms) while ranging and while idle */
+#define LED_PERIOD_RANGING_MS  100
+#define LED_PERIOD_IDLE_MS     1000
+
+/* Measurements are batched into one report frame until REPORT_BATCH_SIZE
+   are held or the oldest is REPORT_MAX_AGE_MS old */
+#ifndef REPORT_BATCH_SIZE
+#define REPORT_BATCH_SIZE      REPORT_MAX_MEASUREMENTS
+#endif
+#ifndef REPORT_MAX_AGE_MS
+#define REPORT_MAX_AGE_MS      500
+#endif
+
+/* Network parameters are kept in this flash sector so a restart can rejoin
+   without a scan. If REJOIN_MAX_FAILED_FRAMES frames fail before any is
+   delivered the coordinator is assumed to have moved and a scan is started. */
+#define NETWORK_FLASH_SECTOR   3
+#define NETWORK_RECORD_LEN     5
+#define REJOIN_MAX_FAILED_FRAMES 2
+
+/* Once in the network, the coordinator is assumed to have moved channel
+   without being heard if LINK_MAX_FAILED_FRAMES frames fail in a row, or
+   LINK_MAX_SYNC_LOSSES beacon syncs are lost in a row, and a scan of the
+   whole band is started to find it. */
+#define LINK_MAX_FAILED_FRAMES   5
+#define LINK_MAX_SYNC_LOSSES     2
+
+/* Power saving between bursts, see tePowerMode. The low power modes turn
+   the receiver off when idle, so broadcasts from the coordinator are not
+   heard and a channel move is only followed by scanning. */
+#ifndef POWER_MODE
+#define POWER_MODE             E_POWER_MODE_ALWAYS_ON
+#endif
+/* The receiver is needed when idle to answer the bursts of the coordinator
+   or the tags */
+#define RECEIVER_ALWAYS_ON     ((POWER_MODE == E_POWER_MODE_ALWAYS_ON) || !RANGING_ENABLED)
+/* Sleep loses beacon tracking and the receiver, so is not used in a beacon
+   enabled network or when others range against this device */
+#define SLEEP_ALLOWED          ((POWER_MODE == E_POWER_MODE_SLEEP) && \
+                                !BEACON_ENABLED_NETWORK && RANGING_ENABLED)
+/* Sleep is only worth entering for at least POWER_MIN_SLEEP_MS. A doze is
+   ended after POWER_MAX_DOZE_MS if nothing else wakes the CPU first. */
+#define POWER_MIN_SLEEP_MS     20
+#define POWER_MAX_DOZE_MS      1000
+
+/* Set FALSE on a standard module, which has no LNA or PA to enable */
+#ifndef HIGH_POWER_MODULE
+#define HIGH_POWER_MODULE      TRUE
+#endif
+/* Battery capacity (mAh) used for the battery life estimate */
+#ifndef BATTERY_CAPACITY_MAH
+#define BATTERY_CAPACITY_MAH   2400
+#endif
+
 #define BYTE_TO_BINARY_PATTERN "%c%c%c%c%c%c%c%c"
 #define BYTE_TO_BINARY(byte)  \
   (byte & 0x80 ? '1' : '0'), \
@@ -41,21 +170,124 @@ typedef enum
 	E_STATE_ASSOCIATED
 } teState;
 
+/* Direction of the readings in a burst. In a two-way burst forward and
+   reverse readings are combined so each node's turnaround offset cancels. */
+typedef enum
+{
+	E_RANGING_MODE_FORWARD,
+	E_RANGING_MODE_REVERSE,
+	E_RANGING_MODE_TWO_WAY
+} teRangingMode;
+
+/* Power saving between bursts */
+typedef enum
+{
+	E_POWER_MODE_ALWAYS_ON,     /* Receiver on when idle, CPU running */
+	E_POWER_MODE_DOZE,          /* Receiver off when idle, CPU dozes */
+	E_POWER_MODE_SLEEP          /* As doze, sleeping with RAM held between bursts */
+} tePowerMode;
+
+typedef enum
+{
+	E_TOF_DIR_FORWARD,
+	E_TOF_DIR_REVERSE,
+	E_TOF_DIRECTIONS
+} teTofDir;
+
 typedef struct
 {
 	teState eState;
 	uint8   u8Channel;
 	uint8   u8TxPacketSeqNb;
-	uint8   u8RxPacketSeqNb;
+	tsSeqTrack sRxSeq;          /* Frames received from the coordinator */
 	uint16  u16Address;
-	int32   i32TofDistance;
+	int32   i32TofDistance;     /* Filtered distance (cm) */
+	uint16  u16TofStdDev;       /* Standard deviation of the filtered distance (cm) */
+	int16   i16TofRate;         /* Rate of change of distance (cm/s) */
+	bool_t  bTofRejected;       /* Last burst was rejected by the track */
 	uint32  u32RssiDistance;
+	int32   ai32TofDirDistance[E_TOF_DIRECTIONS];
+	int32   i32BurstTof;        /* Estimate from the last burst (ps) */
+	uint64  u64BurstVariance;   /* Variance of that estimate (ps^2) */
+	uint8   u8BurstUsed;        /* Readings used by the estimator */
+	uint8   u8BurstErrors;      /* Readings that failed */
+	uint8   u8BurstSqi;         /* Mean local SQI of successful readings */
+	int8    s8BurstRemoteRssi;  /* Mean remote RSSI of successful readings */
+	uint8   u8BurstRemoteSqi;   /* Mean remote SQI of successful readings */
+	uint8   u8BurstReadings;    /* Readings taken */
+	tsTofTrack asTofTrack[TOF_TRACKS];  /* Track of each node ranged against */
+	uint8   u8NextTarget;       /* Node the next burst is taken against */
+	bool_t  bSurveying;         /* Targets are the anchors surveyed */
+	uint8   u8SurveyAnchors;    /* Anchors in the survey last commanded */
+	uint32  u32SurveyEndMs;     /* Time it ends */
+	teTofEstimator eTofEstimator;
+	teRangingMode  eRangingMode;
+	bool_t  bRejoinPending;     /* Restored from flash, not yet confirmed */
+	uint32  u32LinkDelivered;   /* Link statistics at the last delivery */
+	uint32  u32LinkFailed;
+	uint8   u8SyncLosses;       /* Sync losses since the last beacon */
+	bool_t  bChannelChangePending;
+	uint8   u8NewChannel;
+	uint32  u32ChannelChangeMs;
 } tsEndDeviceData;
 
+/* Ranging scheduler state. Bursts are released on a fixed period measured
+   against the tick timer clock so the main loop is free between bursts. */
+typedef struct
+{
+	uint32  u32PeriodMs;
+	uint32  u32NextReleaseMs;
+	uint32  u32FirstStartMs;
+	uint32  u32BurstsCompleted;
+	uint32  u32Overruns;
+	uint32  u32ReadingsTaken;
+	uint16  au16LengthHistogram[MAX_READINGS / TOF_SUBBURST_READINGS];
+} tsRangingSchedule;
+
+typedef enum
+{
+	E_TOF_BUFFER_FREE,
+	E_TOF_BUFFER_FILLING,       /* Sub-burst in progress */
+	E_TOF_BUFFER_FILLED,        /* Sub-burst complete, burst may continue */
+	E_TOF_BUFFER_READY          /* Burst complete, awaiting reduction */
+} teTofBufferState;
+
+/* Readings taken in one direction */
+typedef struct
+{
+	uint8   u8Readings;         /* Readings requested so far */
+	tsTofStats sStats;          /* Running statistics for the stopping rule */
+	tsAppApiTof_Data asData[MAX_READINGS];
+} tsTofReadings;
+
+/* One burst worth of readings. Buffers are filled and reduced in turn. */
+typedef struct
+{
+	volatile teTofBufferState eState;
+	volatile eTofReturn eStatus;
+	volatile uint32  u32FinishTicks;
+	uint32  u32StartMs;
+	teRangingMode eMode;        /* Mode the burst was started in */
+	uint8   u8TxPower;          /* Transmit power level it was started at */
+	uint8   u8Target;           /* Node ranged against, see u16TargetAdr */
+	teTofDir eSubBurstDir;      /* Direction of the last sub-burst */
+	uint8   u8SubBurst;         /* Readings requested by the last sub-burst */
+	tsTofReadings asDir[E_TOF_DIRECTIONS];
+} tsTofBuffer;
+
 /****************************************************************************/
 /***        Local Function Prototypes                                     ***/
 /****************************************************************************/
 PRIVATE void vInitSystem(void);
+PRIVATE void vInitUart(void);
+PRIVATE void vMainLoop(void);
+PRIVATE void vQueueCallback(void);
+PRIVATE void task_SavePower(void);
+PRIVATE void vDoze(uint32 u32Ms);
+PRIVATE void vSleep(uint32 u32Ms);
+PRIVATE void vWakeSystem(void);
+PRIVATE uint32 u32WakeTimerTicks(uint32 u32Ms);
+PRIVATE void vPrintPowerBudget(void);
 PRIVATE void vProcessEventQueues(void);
 PRIVATE void vProcessIncomingMlme(MAC_MlmeDcfmInd_s *psMlmeInd);
 PRIVATE void vProcessIncomingMcps(MAC_McpsDcfmInd_s *psMcpsInd);
@@ -64,14 +296,41 @@ PRIVATE void vStartActiveScan(uint32 u32ChannelstoScan);
 PRIVATE void vHandleActiveScanResponse(MAC_MlmeDcfmInd_s *psMlmeInd);
 PRIVATE void vStartAssociate(void);
 PRIVATE void vHandleAssociateResponse(MAC_MlmeDcfmInd_s *psMlmeInd);
+PRIVATE void vStartSync(void);
+PRIVATE void vEnterNetwork(void);
+PRIVATE bool_t bRestoreNetwork(void);
+PRIVATE void vSaveNetwork(void);
+PRIVATE void task_CheckLink(void);
+PRIVATE void task_ChangeChannel(void);
 PRIVATE void vHandleMcpsDataInd(MAC_McpsDcfmInd_s *psMcpsInd);
 PRIVATE void vHandleMcpsDataDcfm(MAC_McpsDcfmInd_s *psMcpsInd);
 PRIVATE void vProcessReceivedDataPacket(uint8 *pu8Data, uint8 u8Len);
 PRIVATE void vPutChar(unsigned char c);
 
+PRIVATE void vInitRangingSchedule(uint32 u32PeriodMs);
+PRIVATE void task_HandleConsole(void);
 PRIVATE void task_StartTof(void);
-PRIVATE void task_CalculateDistance(void);
-PRIVATE void tx_Distance(int32 i32TofDistance, uint32 u32RssiDistance);
+PRIVATE bool_t bDirectionUsed(teRangingMode eMode, teTofDir eDir);
+PRIVATE uint8 u8DirectionLimit(teRangingMode eMode);
+PRIVATE bool_t bStartSubBurst(tsTofBuffer *psBuffer);
+PRIVATE bool_t bStandardErrorReached(tsTofBuffer *psBuffer);
+PRIVATE void task_ContinueTof(void);
+PRIVATE void task_ProcessTofBuffers(void);
+PRIVATE void task_RecordBurstFinish(tsTofBuffer *psBuffer);
+PRIVATE uint8 u8ReduceDirection(tsTofReadings *psReadings, tsTofEstimate *psEstimate, uint32 *pu32RssiSum, uint32 *pu32SqiSum,
+                                int32 *pi32RemoteRssiSum, uint32 *pu32RemoteSqiSum);
+PRIVATE bool_t task_CalculateDistance(tsTofBuffer *psBuffer);
+PRIVATE void task_TrackDistance(uint8 u8Target, uint32 u32NowMs);
+PRIVATE uint16 u16TargetAdr(uint8 u8Target);
+PRIVATE uint8 u8Targets(void);
+PRIVATE bool_t bSurveyAnchor(void);
+PRIVATE void task_Survey(void);
+PRIVATE void vResetTracks(void);
+PRIVATE void task_QueueReport(tsTofBuffer *psBuffer, uint32 u32FinishMs);
+PRIVATE void task_AdjustTxPower(bool_t bReadings);
+PRIVATE void task_FlushReport(void);
+PRIVATE void tx_Report(tsReport *psReport);
+PRIVATE void vPrintLinkStats(void);
 
 /****************************************************************************/
 /***        Local Variables                                               ***/
@@ -81,24 +340,37 @@ PRIVATE void *s_pvMac;
 PRIVATE MAC_Pib_s *s_psMacPib;
 PRIVATE tsEndDeviceData sEndDeviceData;
 
+PRIVATE tsRangingSchedule sRangingSchedule;
+
 PRIVATE bool_t bLedState;
-PRIVATE uint32 u32Tick = 0;
-PRIVATE uint8 u8CurrentTxHandle = 0x00;
+PRIVATE uint32 u32LedToggleMs = 0;
 
-eTofReturn eTofStatus = -1;
 volatile bool_t bTofInProgress = FALSE;
-tsAppApiTof_Data asTofData[MAX_READINGS];
-
-/* RSSI to Distance (cm) lookup table. Generated from formula in JN-UG-3063 */
-uint32 au32RSSIdistance[] = { 502377, 447744, 399052, 355656, 316979, 282508,
-		251785, 224404, 200000, 178250, 158866, 141589, 126191, 112468, 100237,
-		89337, 79621, 70963, 63246, 56368, 50238, 44774, 39905, 35566, 31698,
-		28251, 25179, 22440, 20000, 17825, 15887, 14159, 12619, 11247, 10024,
-		8934, 7962, 7096, 6325, 5637, 5024, 4477, 3991, 3557, 3170, 2825, 2518,
-		2244, 2000, 1783, 1589, 1416, 1262, 1125, 1002, 893, 796, 710, 632,
-		564, 502, 448, 399, 356, 317, 283, 252, 224, 200, 178, 159, 142, 126,
-		112, 100, 89, 80, 71, 63, 56, 50, 45, 40, 36, 32, 28, 25, 22, 20, 18,
-		16, 14, 13, 11, 10, 9, 8, 7, 6, 6, 5, 4, 4, 4, 3, 3, 3, 2, 2 };
+PRIVATE tsTofBuffer asTofBuffer[TOF_BUFFERS];
+PRIVATE uint8 u8TofFillIndex = 0;
+PRIVATE uint8 u8TofReduceIndex = 0;
+
+/* Measurements awaiting transmission */
+PRIVATE tsReport sReport;
+
+/* Reporting slot, beacon enabled network only */
+PRIVATE tsTdmaSchedule sTdmaSchedule;
+
+/* Network parameters held in flash */
+PRIVATE tsPersistLog sNetworkLog;
+PRIVATE bool_t bNetworkLogOpen;
+PRIVATE uint8 au8SavedNetwork[NETWORK_RECORD_LEN];
+PRIVATE bool_t bNetworkSaved;
+
+/* Power saving */
+PRIVATE volatile bool_t bEventPending;
+PRIVATE tsPowerBudget sPowerBudget;
+PRIVATE uint32 u32WakeCalibration;
+PRIVATE bool_t bAsleep = FALSE;
+PRIVATE uint32 u32SleepMs;
+
+/* Transmit power of the ranging link */
+PRIVATE tsTxPower sTxPower;
 
 /****************************************************************************/
 /***        Exported Functions                                            ***/
@@ -110,7 +382,8 @@ uint32 au32RSSIdistance[] = { 502377, 447744, 399052, 355656, 316979, 282508,
  *
  * DESCRIPTION:
  * This function is passed to bAppApiGetTof. Function is called when the tof
- * readings have been completed and stored in asTofData.
+ * readings of a sub-burst have been completed and stored in the buffer being
+ * filled. The main loop then decides whether the burst continues.
  *
  * PASSED:
  * eTofReturn eStatus,
@@ -121,7 +394,13 @@ uint32 au32RSSIdistance[] = { 502377, 447744, 399052, 355656, 316979, 282508,
  ****************************************************************************/
 void vTofCallback(eTofReturn eStatus)
 {
-	eTofStatus = eStatus;
+	tsTofBuffer *psBuffer = &asTofBuffer[u8TofFillIndex];
+
+	psBuffer->u32FinishTicks = u32TickClockTicks();
+	psBuffer->eStatus        = eStatus;
+	psBuffer->eState         = E_TOF_BUFFER_FILLED;
+
+	bTofInProgress = FALSE;
 }
 
 /****************************************************************************
@@ -140,77 +419,115 @@ void vTofCallback(eTofReturn eStatus)
  ****************************************************************************/
 PUBLIC void AppColdStart(void)
 {
-	int n;
+	int n, b, d;
 
 #ifdef WATCHDOG_ENABLED
 	vAHI_WatchdogStop();
 #endif
 
-	vAHI_UartEnable(UART);
-	vAHI_UartReset(UART, TRUE, TRUE);
-	vAHI_UartSetClockDivisor(UART, E_AHI_UART_RATE_115200);
-	vAHI_UartReset(UART, FALSE, FALSE);
+	vInitUart();
 	vInitPrintf((void *)vPutChar);
 
 	/* Clear screen and tabs */
 	vPrintf("\x1B[2J\x1B[H\x1B[3g");
 	vPrintf("Time of Flight Triangulation Demo\n");
 
-	for(n = 0; n < MAX_READINGS; n++)
+	for(b = 0; b < TOF_BUFFERS; b++)
 	{
-		asTofData[n].s32Tof       = 0;
-		asTofData[n].s8LocalRSSI  = 0;
-		asTofData[n].u8LocalSQI   = 0;
-		asTofData[n].s8RemoteRSSI = 0;
-		asTofData[n].u8RemoteSQI  = 0;
-		asTofData[n].u32Timestamp = 0;
-		asTofData[n].u8Status     = 0;
+		asTofBuffer[b].eState = E_TOF_BUFFER_FREE;
+
+		for(d = 0; d < E_TOF_DIRECTIONS; d++)
+		{
+			for(n = 0; n < MAX_READINGS; n++)
+			{
+				asTofBuffer[b].asDir[d].asData[n].s32Tof       = 0;
+				asTofBuffer[b].asDir[d].asData[n].s8LocalRSSI  = 0;
+				asTofBuffer[b].asDir[d].asData[n].u8LocalSQI   = 0;
+				asTofBuffer[b].asDir[d].asData[n].s8RemoteRSSI = 0;
+				asTofBuffer[b].asDir[d].asData[n].u8RemoteSQI  = 0;
+				asTofBuffer[b].asDir[d].asData[n].u32Timestamp = 0;
+				asTofBuffer[b].asDir[d].asData[n].u8Status     = 0;
+			}
+		}
 	}
 
 	vInitSystem();
+	vInitRangingSchedule(RANGING_PERIOD_MS);
 
 	/* Enable TOF ranging. */
 	vAppApiTofInit(TRUE);
 
-	vPrintf("Starting Scan\n");
-	vStartActiveScan(SCAN_CHANNELS);
+	if (bRestoreNetwork())
+	{
+		vPrintf("Rejoined channel %i as %i\n", sEndDeviceData.u8Channel,
+		        sEndDeviceData.u16Address);
+	}
+	else
+	{
+		vPrintf("Starting Scan\n");
+		vStartActiveScan(SCAN_CHANNELS);
+	}
 
 	vLedInitRfd();
 
+	vMainLoop();
+}
+
+/****************************************************************************
+ *
+ * NAME: vMainLoop
+ *
+ * DESCRIPTION:
+ * Runs the tasks, entered at start up and again on waking from sleep.
+ *
+ * RETURNS:
+ * Never returns.
+ *
+ ****************************************************************************/
+PRIVATE void vMainLoop(void)
+{
 	while (1)
 	{
-		if (u32Tick++ > (bTofInProgress ? 10000 : 100000))
+		bEventPending = FALSE;
+
+		/* The LED is left off to save power in the low power modes */
+		if ((POWER_MODE == E_POWER_MODE_ALWAYS_ON) &&
+		    TICK_CLOCK_EXPIRED(u32TickClockNowMs(), u32LedToggleMs))
 		{
 			bLedState = !bLedState;
 			vLedControl(0, bLedState);
-			u32Tick = 0;
+			u32LedToggleMs = u32TickClockNowMs() +
+				(bTofInProgress ? LED_PERIOD_RANGING_MS : LED_PERIOD_IDLE_MS);
 		}
 
+		task_HandleConsole();
+
 		if (sEndDeviceData.eState >= E_STATE_ASSOCIATED)
 		{
-			task_StartTof();
+			task_Survey();
+		}
 
-			/* Check for return code to have been set in callback */
-			if (eTofStatus != -1)
+		if ((sEndDeviceData.eState >= E_STATE_ASSOCIATED) &&
+		    (RANGING_ENABLED || sEndDeviceData.bSurveying))
+		{
+			/* Start the next burst before reducing the last, so the radio
+			   is kept busy while the CPU works */
+			task_ContinueTof();
+			task_StartTof();
+			task_ProcessTofBuffers();
+			task_FlushReport();
+			if (BEACON_ENABLED_NETWORK)
 			{
-				if (eTofStatus == TOF_SUCCESS)
-				{
-					task_CalculateDistance();
-					tx_Distance(sEndDeviceData.i32TofDistance, sEndDeviceData.u32RssiDistance);
-				}
-				else
-				{
-					vPrintf("\nToF failed with error %d", eTofStatus);
-				}
-
-				/* Reset flags for next ToF burst */
-				eTofStatus = -1;
-				bTofInProgress = FALSE;
+				vTxQueueHold(!bTdmaInSlot(&sTdmaSchedule, u32TickClockNowMs()));
 			}
+			vTxQueueService(u32TickClockNowMs());
+			task_CheckLink();
+			task_ChangeChannel();
 		}
 
 		vProcessEventQueues();
 
+		task_SavePower();
 	}
 }
 
@@ -222,8 +539,9 @@ PUBLIC void AppColdStart(void)
  * NAME: AppWarmStart
  *
  * DESCRIPTION:
- * Entry point for application from boot loader. Simply jumps to AppColdStart
- * as, in this instance, application will never warm start.
+ * Entry point for application from boot loader on waking from sleep with
+ * RAM held. The hardware is set up again and the main loop carries on
+ * where it left off. Otherwise jumps to AppColdStart.
  *
  * RETURNS:
  * Never returns.
@@ -233,7 +551,13 @@ PUBLIC void AppColdStart(void)
  ****************************************************************************/
 PUBLIC void AppWarmStart(void)
 {
-	AppColdStart();
+	if (!bAsleep)
+	{
+		AppColdStart();
+	}
+
+	vWakeSystem();
+	vMainLoop();
 }
 
 /****************************************************************************/
@@ -255,17 +579,37 @@ PUBLIC void AppWarmStart(void)
  ****************************************************************************/
 PRIVATE void vInitSystem(void)
 {
-	/* Setup interface to MAC */
-	(void)u32AppQApiInit(NULL, NULL, NULL);
+	/* Setup interface to MAC. Queued events end a doze. */
+	(void)u32AppQApiInit(vQueueCallback, vQueueCallback, NULL);
 	(void)u32AHI_Init();
 
-	/* Enable high power modules */
-	vAHI_HighPowerModuleEnable(TRUE, TRUE);
+	/* Start the millisecond time base used to pace ranging */
+	vTickClockInit();
+	vPowerBudgetInit(&sPowerBudget, HIGH_POWER_MODULE, u32TickClockNowMs());
+	if (POWER_MODE != E_POWER_MODE_ALWAYS_ON)
+	{
+		u32WakeCalibration = u32AHI_WakeTimerCalibrate();
+	}
+
+	/* Enable high power modules, then start the link at full power and let
+	   the power control trim it from the ranging readings */
+	if (HIGH_POWER_MODULE)
+	{
+		vAHI_HighPowerModuleEnable(TRUE, TRUE);
+	}
+	vTxPowerInit(&sTxPower);
 
 	/* Initialise end device state */
 	sEndDeviceData.eState = E_STATE_IDLE;
 	sEndDeviceData.u8TxPacketSeqNb = 0;
-	sEndDeviceData.u8RxPacketSeqNb = 0;
+	vSeqTrackReset(&sEndDeviceData.sRxSeq);
+	sEndDeviceData.eTofEstimator = TOF_ESTIMATOR;
+	vResetTracks();
+	sEndDeviceData.bSurveying    = FALSE;
+	sEndDeviceData.u8SurveyAnchors = 0;
+	sEndDeviceData.eRangingMode  = RANGING_MODE;
+	sEndDeviceData.bRejoinPending = FALSE;
+	sEndDeviceData.bChannelChangePending = FALSE;
 
 	/* Set up the MAC handles. Must be called AFTER u32AppQApiInit() */
 	s_pvMac = pvAppApiGetMacHandle();
@@ -274,145 +618,1180 @@ PRIVATE void vInitSystem(void)
 	/* Set Pan ID in PIB (also sets match register in hardware) */
 	MAC_vPibSetPanId(s_pvMac, PAN_ID);
 
-	/* Enable receiver to be on when idle */
-	MAC_vPibSetRxOnWhenIdle(s_pvMac, TRUE, FALSE);
+	/* Enable receiver to be on when idle, unless saving power */
+	MAC_vPibSetRxOnWhenIdle(s_pvMac, RECEIVER_ALWAYS_ON, FALSE);
 
 	vPrintf("Done Init\n");
 }
 
 /****************************************************************************
  *
- * NAME: task_StartTof
+ * NAME: vInitUart
  *
  * DESCRIPTION:
- * Starts a TOF Forward Burst measurement that takes MAX_READINGS number of
- * measurements.
+ * Sets up the console UART, at start up and on waking from sleep.
+ *
+ * RETURNS:
+ * void
  *
- * RETURNS: void
- * 
  ****************************************************************************/
-PRIVATE void task_StartTof(void)
+PRIVATE void vInitUart(void)
 {
-	// Loop an obsurdly long number of times to slow down TOF captures.
-	// ran out of time to do a proper scheduler
-	uint64 wait;
-	for (wait = 0; wait < 100000000000000000000000uLL; wait++);
-	/* Create address for coordinator */
-	MAC_Addr_s sAddr;
-	sAddr.u8AddrMode     = 2;
-	sAddr.u16PanId       = PAN_ID;
-	sAddr.uAddr.u16Short = COORDINATOR_ADR;
+	vAHI_UartEnable(UART);
+	vAHI_UartReset(UART, TRUE, TRUE);
+	vAHI_UartSetClockDivisor(UART, E_AHI_UART_RATE_115200);
+	vAHI_UartReset(UART, FALSE, FALSE);
+}
+
+/****************************************************************************
+ *
+ * NAME: vQueueCallback
+ *
+ * DESCRIPTION:
+ * Called from interrupt context when the MAC queues an event, so the main
+ * loop does not doze with an event waiting.
+ *
+ * RETURNS:
+ * void
+ *
+ ****************************************************************************/
+PRIVATE void vQueueCallback(void)
+{
+	bEventPending = TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: task_SavePower
+ *
+ * DESCRIPTION:
+ * Charges the time since the last pass to the power budget, and in the low
+ * power modes dozes or sleeps until the next task is due when nothing is in
+ * progress. A burst, a scan or association, or frames waiting to be sent
+ * keep the device awake; their events arrive by interrupt but their
+ * timeouts are polled.
+ *
+ * RETURNS:
+ * void
+ *
+ ****************************************************************************/
+PRIVATE void task_SavePower(void)
+{
+	uint32 u32Now = u32TickClockNowMs();
+	uint32 u32WakeMs;
+	bool_t bBusy;
+	int32 i32IdleMs;
+	int b;
+
+	bBusy = bTofInProgress || (u8TxQueueWaiting() > 0) ||
+	        (sEndDeviceData.eState == E_STATE_ACTIVE_SCANNING) ||
+	        (sEndDeviceData.eState == E_STATE_ASSOCIATING);
+	for (b = 0; b < TOF_BUFFERS; b++)
+	{
+		bBusy |= (asTofBuffer[b].eState != E_TOF_BUFFER_FREE);
+	}
+
+	vPowerBudgetEnter(&sPowerBudget, (bBusy || RECEIVER_ALWAYS_ON || sEndDeviceData.bSurveying) ?
+	                  E_POWER_STATE_ACTIVE : E_POWER_STATE_IDLE, u32Now);
 
-	if(bTofInProgress==FALSE)
+	if ((POWER_MODE == E_POWER_MODE_ALWAYS_ON) || bBusy || bEventPending)
 	{
-		if (bAppApiGetTof( asTofData, &sAddr, MAX_READINGS, API_TOF_FORWARDS, vTofCallback))
+		return;
+	}
+
+	/* Wake for the next burst, report flush or channel move */
+	u32WakeMs = u32Now + POWER_MAX_DOZE_MS;
+	if ((sEndDeviceData.eState >= E_STATE_ASSOCIATED) &&
+	    (RANGING_ENABLED || sEndDeviceData.bSurveying))
+	{
+		if (TICK_CLOCK_EXPIRED(u32WakeMs, sRangingSchedule.u32NextReleaseMs))
+		{
+			u32WakeMs = sRangingSchedule.u32NextReleaseMs;
+		}
+		if ((sReport.u8Count > 0) &&
+		    TICK_CLOCK_EXPIRED(u32WakeMs, sReport.asMeasurement[0].u32TimestampMs + REPORT_MAX_AGE_MS))
 		{
-			vPrintf("\nForward burst started");
-			bTofInProgress = TRUE;
-		} else {
-			vPrintf("\nFailed to start ToF");
+			u32WakeMs = sReport.asMeasurement[0].u32TimestampMs + REPORT_MAX_AGE_MS;
 		}
 	}
+	if (sEndDeviceData.bChannelChangePending &&
+	    TICK_CLOCK_EXPIRED(u32WakeMs, sEndDeviceData.u32ChannelChangeMs))
+	{
+		u32WakeMs = sEndDeviceData.u32ChannelChangeMs;
+	}
+
+	i32IdleMs = (int32)(u32WakeMs - u32Now);
+	if (i32IdleMs <= 0)
+	{
+		return;
+	}
+
+	if (SLEEP_ALLOWED && (sEndDeviceData.eState >= E_STATE_ASSOCIATED) &&
+	    !sEndDeviceData.bSurveying && (i32IdleMs >= POWER_MIN_SLEEP_MS))
+	{
+		vSleep((uint32)i32IdleMs);
+	}
+	else
+	{
+		vDoze((uint32)i32IdleMs);
+	}
 }
 
 /****************************************************************************
  *
- * NAME: task_CalculateDistance
+ * NAME: vDoze
  *
  * DESCRIPTION:
- * Calculates the average i32TofDistance and the average u32RssiDistance 
+ * Stops the CPU until an interrupt, at the latest from wake timer 1 after
+ * the time given. Timers and the radio keep running. Interrupts are masked
+ * from the last check for a queued event until the doze, so an event
+ * queued in between still ends it: the doze ends on the interrupt request,
+ * which is then taken once interrupts are unmasked.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32Ms           R   Longest doze (ms)
+ *
+ * RETURNS:
+ * void
  *
- * RETURNS: void
- * 
  ****************************************************************************/
-PRIVATE void task_CalculateDistance(void)
+PRIVATE void vDoze(uint32 u32Ms)
 {
-	int32 n, s32Mean, s32StanDev;
-	double dStd, dMean;
-	uint8  u8NumErrors;
+	vAHI_WakeTimerEnable(E_AHI_WAKE_TIMER_1, TRUE);
+	vAHI_WakeTimerStart(E_AHI_WAKE_TIMER_1, u32WakeTimerTicks(u32Ms));
 
-	double dAcc = 0.0;
-	sEndDeviceData.u32RssiDistance = 0;
+	vPowerBudgetEnter(&sPowerBudget, E_POWER_STATE_DOZE, u32TickClockNowMs());
+	MICRO_DISABLE_INTERRUPTS();
+	if (!bEventPending)
+	{
+		vAHI_CpuDoze();
+	}
+	MICRO_ENABLE_INTERRUPTS();
+	vPowerBudgetEnter(&sPowerBudget, E_POWER_STATE_IDLE, u32TickClockNowMs());
 
-	u8NumErrors = 0;
+	(void)bAHI_WakeTimerStop(E_AHI_WAKE_TIMER_1);
+}
 
-	vPrintf("\n\n| #  \x1BH| ToF (ps) \x1BH| Lcl RSSI \x1BH| Lcl SQI \x1BH| Rmt RSSI \x1BH| Rmt SQI \x1BH| Timestamp \x1BH| Status \x1BH|");
-	vPrintf("\n--------------------------------------------------------------------------------");
+/****************************************************************************
+ *
+ * NAME: vSleep
+ *
+ * DESCRIPTION:
+ * Sleeps with RAM held until wake timer 0 fires. The MAC settings are saved
+ * to be restored on waking, see AppWarmStart.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32Ms           R   Time to sleep (ms)
+ *
+ * RETURNS:
+ * Does not return.
+ *
+ ****************************************************************************/
+PRIVATE void vSleep(uint32 u32Ms)
+{
+	vPowerBudgetEnter(&sPowerBudget, E_POWER_STATE_SLEEP, u32TickClockNowMs());
+
+	u32SleepMs = u32Ms;
+	bAsleep    = TRUE;
+
+	vAppApiSaveMacSettings();
+	vAHI_WakeTimerEnable(E_AHI_WAKE_TIMER_0, TRUE);
+	vAHI_WakeTimerStart(E_AHI_WAKE_TIMER_0, u32WakeTimerTicks(u32Ms));
+	vAHI_Sleep(E_AHI_SLEEP_OSCON_RAMON);
+}
+
+/****************************************************************************
+ *
+ * NAME: vWakeSystem
+ *
+ * DESCRIPTION:
+ * Sets the hardware and MAC up again after sleep. RAM, and so all of the
+ * application's state, was held. That includes the event queues, which are
+ * not set up again so that no event queued before sleeping is lost; a wake
+ * without RAM held goes through AppColdStart, which does set them up. The
+ * millisecond clock is moved on by the time asleep.
+ *
+ * RETURNS:
+ * void
+ *
+ ****************************************************************************/
+PRIVATE void vWakeSystem(void)
+{
+	bAsleep = FALSE;
+
+	(void)u32AHI_Init();
+	vAppApiRestoreMacSettings();
+
+	vInitUart();
+	vTickClockResume(u32SleepMs);
+	vPowerBudgetEnter(&sPowerBudget, E_POWER_STATE_IDLE, u32TickClockNowMs());
 
-	for(n = 0; n < MAX_READINGS; n++)
+	if (HIGH_POWER_MODULE)
 	{
-		vPrintf("\n|%d",n);
+		vAHI_HighPowerModuleEnable(TRUE, TRUE);
+	}
+	vTxPowerApply(&sTxPower);
+	vAppApiTofInit(TRUE);
+}
 
-		/* Only include successful readings */
-		if (asTofData[n].u8Status == MAC_TOF_STATUS_SUCCESS)
-		{
-			dAcc += asTofData[n].s32Tof;
-			sEndDeviceData.u32RssiDistance += au32RSSIdistance[asTofData[n].s8LocalRSSI];
-			sEndDeviceData.u32RssiDistance += au32RSSIdistance[asTofData[n].s8RemoteRSSI];
+/****************************************************************************
+ *
+ * NAME: u32WakeTimerTicks
+ *
+ * DESCRIPTION:
+ * Converts a time to wake timer ticks. The wake timer runs from the 32kHz
+ * RC oscillator; calibration gives its actual rate, 10000 being 32kHz.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32Ms           R   Time (ms)
+ *
+ * RETURNS:
+ * uint32 ticks
+ *
+ ****************************************************************************/
+PRIVATE uint32 u32WakeTimerTicks(uint32 u32Ms)
+{
+	uint32 u32Calibration = (u32WakeCalibration != 0) ? u32WakeCalibration : 10000;
 
-			vPrintf("\t|%i\t|%d\t|%d\t|%d\t|%d\t|%d\t|%d\t|",
-					asTofData[n].s32Tof,
-					asTofData[n].s8LocalRSSI,
-					asTofData[n].u8LocalSQI,
-					asTofData[n].s8RemoteRSSI,
-					asTofData[n].u8RemoteSQI,
-					asTofData[n].u32Timestamp,
-					asTofData[n].u8Status);
-		}
-		else
-		{
-			u8NumErrors++;
+	return (uint32)(((uint64)u32Ms * 32 * 10000) / u32Calibration);
+}
 
-			vPrintf("\t|-\t|-\t|-\t|-\t|-\t|-\t|%d\t|",
-					asTofData[n].u8Status);
-		}
+/****************************************************************************
+ *
+ * NAME: vInitRangingSchedule
+ *
+ * DESCRIPTION:
+ * Sets the ranging period and releases the first burst immediately.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32PeriodMs     R   Time between bursts (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vInitRangingSchedule(uint32 u32PeriodMs)
+{
+	int n;
+
+	sRangingSchedule.u32PeriodMs        = u32PeriodMs;
+	sRangingSchedule.u32NextReleaseMs   = u32TickClockNowMs();
+	sRangingSchedule.u32FirstStartMs    = 0;
+	sRangingSchedule.u32BurstsCompleted = 0;
+	sRangingSchedule.u32Overruns        = 0;
+	sRangingSchedule.u32ReadingsTaken   = 0;
+
+	for (n = 0; n < MAX_READINGS / TOF_SUBBURST_READINGS; n++)
+	{
+		sRangingSchedule.au16LengthHistogram[n] = 0;
+	}
+
+	if (sRangingSchedule.u32PeriodMs == 0)
+	{
+		sRangingSchedule.u32PeriodMs = 1;
+	}
+}
+
+/****************************************************************************
+ *
+ * NAME: task_HandleConsole
+ *
+ * DESCRIPTION:
+ * Selects the ranging mode from keys received on the UART: 'f' forward,
+ * 'r' reverse, 't' two-way. Takes effect from the next burst. 's' prints
+ * the link delivery statistics and 'p' the power budget.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_HandleConsole(void)
+{
+	if ((u8AHI_UartReadLineStatus(UART) & E_AHI_UART_LS_DR) == 0)
+	{
+		return;
 	}
 
-	/* Calculate statistics */
-	if(u8NumErrors != MAX_READINGS)
+	switch (u8AHI_UartReadData(UART))
+	{
+	case 'f':
+		sEndDeviceData.eRangingMode = E_RANGING_MODE_FORWARD;
+		break;
+	case 'r':
+		sEndDeviceData.eRangingMode = E_RANGING_MODE_REVERSE;
+		break;
+	case 't':
+		sEndDeviceData.eRangingMode = E_RANGING_MODE_TWO_WAY;
+		break;
+	case 's':
+		vPrintLinkStats();
+		return;
+	case 'p':
+		vPrintPowerBudget();
+		return;
+	default:
+		return;
+	}
+
+	vPrintf("\nRanging mode %d", sEndDeviceData.eRangingMode);
+}
+
+/****************************************************************************
+ *
+ * NAME: task_StartTof
+ *
+ * DESCRIPTION:
+ * Starts a TOF burst in the current ranging mode once the ranging schedule
+ * releases the next burst and a buffer is free to receive it. A tag, or an
+ * anchor in a survey, takes successive bursts against successive anchors.
+ * A device outside a survey holds its bursts until it ends.
+ *
+ * RETURNS: void
+ * 
+ ****************************************************************************/
+PRIVATE void task_StartTof(void)
+{
+	uint32 u32Now;
+	tsTofBuffer *psBuffer = &asTofBuffer[u8TofFillIndex];
+	int d;
+
+	if ((bTofInProgress == TRUE) || (psBuffer->eState != E_TOF_BUFFER_FREE) ||
+	    (sEndDeviceData.bSurveying && !bSurveyAnchor()))
+	{
+		return;
+	}
+
+	u32Now = u32TickClockNowMs();
+	if (!TICK_CLOCK_EXPIRED(u32Now, sRangingSchedule.u32NextReleaseMs))
+	{
+		return;
+	}
+
+	/* Release on a fixed grid. If the last burst ran past its slot, restart
+	   the grid from now rather than firing back-to-back bursts to catch up. */
+	sRangingSchedule.u32NextReleaseMs += sRangingSchedule.u32PeriodMs;
+	if (TICK_CLOCK_EXPIRED(u32Now, sRangingSchedule.u32NextReleaseMs))
+	{
+		sRangingSchedule.u32Overruns++;
+		sRangingSchedule.u32NextReleaseMs = u32Now + sRangingSchedule.u32PeriodMs;
+	}
+
+	/* Take each target in turn, passing over this device if it is one */
+	if ((u8Targets() > 1) &&
+	    (u16TargetAdr(sEndDeviceData.u8NextTarget) == sEndDeviceData.u16Address))
+	{
+		sEndDeviceData.u8NextTarget = (sEndDeviceData.u8NextTarget + 1) % u8Targets();
+	}
+
+	psBuffer->u32StartMs = u32Now;
+	psBuffer->eMode      = sEndDeviceData.eRangingMode;
+	psBuffer->u8TxPower  = sTxPower.u8Level;
+	psBuffer->u8Target   = sEndDeviceData.u8NextTarget;
+	sEndDeviceData.u8NextTarget = (sEndDeviceData.u8NextTarget + 1) % u8Targets();
+	for (d = 0; d < E_TOF_DIRECTIONS; d++)
+	{
+		psBuffer->asDir[d].u8Readings = 0;
+		vTofStatsReset(&psBuffer->asDir[d].sStats);
+	}
+
+	if (bStartSubBurst(psBuffer))
+	{
+		vPrintf("\nBurst started, mode %d, target %d", psBuffer->eMode, u16TargetAdr(psBuffer->u8Target));
+		if (sRangingSchedule.u32BurstsCompleted == 0)
+		{
+			sRangingSchedule.u32FirstStartMs = u32Now;
+		}
+	} else {
+		psBuffer->eState = E_TOF_BUFFER_FREE;
+		vPrintf("\nFailed to start ToF");
+	}
+}
+
+/****************************************************************************
+ *
+ * NAME: bDirectionUsed
+ *
+ * DESCRIPTION:
+ * Whether a ranging mode takes readings in a given direction.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  eMode           R   Ranging mode
+ *                  eDir            R   Direction
+ *
+ * RETURNS: bool_t TRUE if the direction is used
+ *
+ ****************************************************************************/
+PRIVATE bool_t bDirectionUsed(teRangingMode eMode, teTofDir eDir)
+{
+	switch (eMode)
+	{
+	case E_RANGING_MODE_FORWARD:
+		return (eDir == E_TOF_DIR_FORWARD);
+	case E_RANGING_MODE_REVERSE:
+		return (eDir == E_TOF_DIR_REVERSE);
+	default:
+		return TRUE;
+	}
+}
+
+/****************************************************************************
+ *
+ * NAME: u8DirectionLimit
+ *
+ * DESCRIPTION:
+ * Most readings a burst may take in each direction it uses. A two-way burst
+ * shares MAX_READINGS between its directions so it costs no more airtime.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  eMode           R   Ranging mode
+ *
+ * RETURNS: uint8 readings per direction
+ *
+ ****************************************************************************/
+PRIVATE uint8 u8DirectionLimit(teRangingMode eMode)
+{
+	if (!TOF_ADAPTIVE_BURSTS)
+	{
+		return TOF_FIXED_READINGS;
+	}
+
+	return (eMode == E_RANGING_MODE_TWO_WAY) ? MAX_READINGS / 2 : MAX_READINGS;
+}
+
+/****************************************************************************
+ *
+ * NAME: bStartSubBurst
+ *
+ * DESCRIPTION:
+ * Requests the next sub-burst of readings, appended to those already in
+ * the buffer. A two-way burst alternates direction, taking the next
+ * sub-burst in whichever direction has fewer readings.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psBuffer        RW  Buffer being filled
+ *
+ * RETURNS: bool_t TRUE if the sub-burst was started
+ *
+ ****************************************************************************/
+PRIVATE bool_t bStartSubBurst(tsTofBuffer *psBuffer)
+{
+	tsTofReadings *psReadings;
+	uint8 u8Remaining;
+	teTofDir eDir;
+
+	/* Create address for the node ranged against */
+	MAC_Addr_s sAddr;
+	sAddr.u8AddrMode     = 2;
+	sAddr.u16PanId       = PAN_ID;
+	sAddr.uAddr.u16Short = u16TargetAdr(psBuffer->u8Target);
+
+	if (psBuffer->eMode == E_RANGING_MODE_REVERSE)
+	{
+		eDir = E_TOF_DIR_REVERSE;
+	}
+	else if ((psBuffer->eMode == E_RANGING_MODE_TWO_WAY) &&
+	         (psBuffer->asDir[E_TOF_DIR_REVERSE].u8Readings <
+	          psBuffer->asDir[E_TOF_DIR_FORWARD].u8Readings))
+	{
+		eDir = E_TOF_DIR_REVERSE;
+	}
+	else
+	{
+		eDir = E_TOF_DIR_FORWARD;
+	}
+
+	psReadings  = &psBuffer->asDir[eDir];
+	u8Remaining = u8DirectionLimit(psBuffer->eMode) - psReadings->u8Readings;
+
+	psBuffer->eSubBurstDir = eDir;
+	psBuffer->u8SubBurst   = TOF_ADAPTIVE_BURSTS ? TOF_SUBBURST_READINGS : TOF_FIXED_READINGS;
+	if (psBuffer->u8SubBurst > u8Remaining)
+	{
+		psBuffer->u8SubBurst = u8Remaining;
+	}
+
+	psBuffer->eState = E_TOF_BUFFER_FILLING;
+	bTofInProgress   = TRUE;
+
+	if (!bAppApiGetTof(&psReadings->asData[psReadings->u8Readings], &sAddr,
+	                   psBuffer->u8SubBurst,
+	                   (eDir == E_TOF_DIR_FORWARD) ? API_TOF_FORWARDS : API_TOF_REVERSE,
+	                   vTofCallback))
+	{
+		bTofInProgress = FALSE;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: bStandardErrorReached
+ *
+ * DESCRIPTION:
+ * Whether the distance track, once this burst is fused into it, will have
+ * reached the target standard error T. The burst estimate has variance
+ * s^2 / N, or for a two-way burst (sF^2 / NF + sR^2 / NR) / 4, the
+ * average of the two directions. s^2 is the sample variance, the
+ * population variance V x N / (N - 1), so s^2 / N is V / (N - 1) and the
+ * few readings of a short burst do not understate their spread. Fused
+ * with a prior of variance P, the posterior reaches T^2 once the burst's
+ * variance is at most T^2 x P / (P - T^2), so a well established track
+ * needs few readings. Both sides are kept as fractions and compared
+ * multiplied out.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psBuffer        R   Buffer being filled
+ *
+ * RETURNS: bool_t TRUE if the burst may stop
+ *
+ ****************************************************************************/
+PRIVATE bool_t bStandardErrorReached(tsTofBuffer *psBuffer)
+{
+	tsTofStats *psFwd = &psBuffer->asDir[E_TOF_DIR_FORWARD].sStats;
+	tsTofStats *psRev = &psBuffer->asDir[E_TOF_DIR_REVERSE].sStats;
+	uint64 u64Target  = (uint64)TOF_TARGET_STDERR_PS * TOF_TARGET_STDERR_PS;
+	uint64 u64Prior;
+	uint64 u64Num;
+	uint64 u64Den;
+	int d;
+
+	for (d = 0; d < E_TOF_DIRECTIONS; d++)
+	{
+		if (bDirectionUsed(psBuffer->eMode, d) &&
+		    (psBuffer->asDir[d].sStats.u8Count < TOF_MIN_VALID_READINGS))
+		{
+			return FALSE;
+		}
+	}
+
+	/* Variance of the burst estimate as u64Num / u64Den */
+	switch (psBuffer->eMode)
+	{
+	case E_RANGING_MODE_FORWARD:
+		u64Num = u32TofStatsVariance(psFwd);
+		u64Den = psFwd->u8Count - 1;
+		break;
+	case E_RANGING_MODE_REVERSE:
+		u64Num = u32TofStatsVariance(psRev);
+		u64Den = psRev->u8Count - 1;
+		break;
+	default:
+		u64Num = (uint64)u32TofStatsVariance(psFwd) * (psRev->u8Count - 1) +
+		         (uint64)u32TofStatsVariance(psRev) * (psFwd->u8Count - 1);
+		u64Den = 4 * (uint64)(psFwd->u8Count - 1) * (psRev->u8Count - 1);
+		break;
+	}
+
+	u64Prior = u64TofTrackPriorVariance(&sEndDeviceData.asTofTrack[psBuffer->u8Target], u32TickClockNowMs());
+	if (u64Prior <= u64Target)
+	{
+		return TRUE;
+	}
+
+	/* Beyond 64 T^2 the prior adds under 2% to the allowance, and capping it
+	   keeps the products below within 64 bits */
+	if (u64Prior > 64 * u64Target)
+	{
+		u64Prior = 64 * u64Target;
+	}
+
+	return (u64Num * (u64Prior - u64Target) <= u64Target * u64Prior * u64Den);
+}
+
+/****************************************************************************
+ *
+ * NAME: task_ContinueTof
+ *
+ * DESCRIPTION:
+ * Applies the stopping rule once a sub-burst completes. The new readings
+ * are added to the running statistics and the burst is extended until the
+ * standard error of its estimate reaches the target or every direction it
+ * uses is full. A failed sub-burst ends the burst with only the readings
+ * gathered before it.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_ContinueTof(void)
+{
+	tsTofBuffer *psBuffer = &asTofBuffer[u8TofFillIndex];
+	tsTofReadings *psReadings;
+	tsAppApiTof_Data *psData;
+	bool_t bDone;
+	uint8 u8Kept;
+	uint8 n;
+	int d;
+
+	if (psBuffer->eState != E_TOF_BUFFER_FILLED)
+	{
+		return;
+	}
+
+	if (psBuffer->eStatus != TOF_SUCCESS)
+	{
+		/* Keep what was gathered before the failure, if anything. The failed
+		   sub-burst's readings were never added, to the count or the stats */
+		u8Kept = 0;
+		for (d = 0; d < E_TOF_DIRECTIONS; d++)
+		{
+			u8Kept += psBuffer->asDir[d].u8Readings;
+		}
+		if (u8Kept > 0)
+		{
+			psBuffer->eStatus = TOF_SUCCESS;
+		}
+		bDone = TRUE;
+	}
+	else
+	{
+		psReadings = &psBuffer->asDir[psBuffer->eSubBurstDir];
+		psData     = &psReadings->asData[psReadings->u8Readings];
+		for (n = 0; n < psBuffer->u8SubBurst; n++)
+		{
+			if (psData[n].u8Status == MAC_TOF_STATUS_SUCCESS)
+			{
+				vTofStatsAdd(&psReadings->sStats, psData[n].s32Tof);
+			}
+			else
+			{
+				vTofStatsAddError(&psReadings->sStats);
+			}
+		}
+		psReadings->u8Readings += psBuffer->u8SubBurst;
+
+		bDone = TRUE;
+		for (d = 0; d < E_TOF_DIRECTIONS; d++)
+		{
+			if (bDirectionUsed(psBuffer->eMode, d) &&
+			    (psBuffer->asDir[d].u8Readings < u8DirectionLimit(psBuffer->eMode)))
+			{
+				bDone = FALSE;
+			}
+		}
+
+		if (TOF_ADAPTIVE_BURSTS && bStandardErrorReached(psBuffer))
+		{
+			bDone = TRUE;
+		}
+	}
+
+	if (!bDone && bStartSubBurst(psBuffer))
+	{
+		return;
+	}
+
+	psBuffer->eState = E_TOF_BUFFER_READY;
+	u8TofFillIndex = (u8TofFillIndex + 1) % TOF_BUFFERS;
+}
+
+/****************************************************************************
+ *
+ * NAME: task_ProcessTofBuffers
+ *
+ * DESCRIPTION:
+ * Reduces and transmits completed bursts in the order they were started,
+ * then returns their buffers to the pool.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_ProcessTofBuffers(void)
+{
+	tsTofBuffer *psBuffer = &asTofBuffer[u8TofReduceIndex];
+
+	while (psBuffer->eState == E_TOF_BUFFER_READY)
+	{
+		task_RecordBurstFinish(psBuffer);
+
+		if (psBuffer->eStatus == TOF_SUCCESS)
+		{
+			if (task_CalculateDistance(psBuffer))
+			{
+				task_TrackDistance(psBuffer->u8Target, u32TickClockTicksToMs(psBuffer->u32FinishTicks));
+				task_QueueReport(psBuffer, u32TickClockTicksToMs(psBuffer->u32FinishTicks));
+				task_AdjustTxPower(TRUE);
+			}
+			else
+			{
+				task_AdjustTxPower(FALSE);
+			}
+		}
+		else
+		{
+			vPrintf("\nToF failed with error %d", psBuffer->eStatus);
+			task_AdjustTxPower(FALSE);
+		}
+
+		psBuffer->eState = E_TOF_BUFFER_FREE;
+
+		u8TofReduceIndex = (u8TofReduceIndex + 1) % TOF_BUFFERS;
+		psBuffer = &asTofBuffer[u8TofReduceIndex];
+	}
+}
+
+/****************************************************************************
+ *
+ * NAME: task_RecordBurstFinish
+ *
+ * DESCRIPTION:
+ * Reports the start and finish time of a completed burst and the achieved
+ * ranging rate against the configured one.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psBuffer        R   Completed burst
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_RecordBurstFinish(tsTofBuffer *psBuffer)
+{
+	uint32 u32Elapsed;
+	uint32 u32FinishMs;
+	uint32 u32RateMilliHz = 0;
+	char   acRate[FIXED_STR_LEN];
+	char   acTarget[FIXED_STR_LEN];
+	char   acAverage[FIXED_STR_LEN];
+	uint8  u8Readings;
+	int n;
+
+	u8Readings = psBuffer->asDir[E_TOF_DIR_FORWARD].u8Readings +
+	             psBuffer->asDir[E_TOF_DIR_REVERSE].u8Readings;
+
+	u32FinishMs = u32TickClockTicksToMs(psBuffer->u32FinishTicks);
+	sRangingSchedule.u32BurstsCompleted++;
+	sRangingSchedule.u32ReadingsTaken += u8Readings;
+	if (u8Readings > 0)
+	{
+		sRangingSchedule.au16LengthHistogram[(u8Readings - 1) / TOF_SUBBURST_READINGS]++;
+	}
+
+	/* Rate over all bursts so far, measured start-to-start */
+	u32Elapsed = psBuffer->u32StartMs - sRangingSchedule.u32FirstStartMs;
+	if (u32Elapsed > 0)
+	{
+		u32RateMilliHz = (uint32)(((uint64)(sRangingSchedule.u32BurstsCompleted - 1) * 1000000uLL) / u32Elapsed);
+	}
+
+	vPrintf("\nBurst %d: start %dms, finish %dms (%dms), rate %sHz of %sHz, overruns %d",
+			sRangingSchedule.u32BurstsCompleted,
+			psBuffer->u32StartMs,
+			u32FinishMs,
+			u32FinishMs - psBuffer->u32StartMs,
+			pcFixedToStr(u32RateMilliHz, 3, acRate),
+			pcFixedToStr(1000000UL / sRangingSchedule.u32PeriodMs, 3, acTarget),
+			sRangingSchedule.u32Overruns);
+
+	vPrintf("\nReadings: %d (fwd %d, rev %d), average %s",
+			u8Readings,
+			psBuffer->asDir[E_TOF_DIR_FORWARD].u8Readings,
+			psBuffer->asDir[E_TOF_DIR_REVERSE].u8Readings,
+			pcFixedToStr(sRangingSchedule.u32ReadingsTaken * 100 / sRangingSchedule.u32BurstsCompleted, 2,
+			             acAverage));
+
+	/* Histogram of burst lengths, in sub-burst sized bins, for tuning the
+	   stopping rule */
+	if ((sRangingSchedule.u32BurstsCompleted % TOF_LENGTH_REPORT_BURSTS) == 0)
+	{
+		vPrintf("\nBurst lengths:");
+		for (n = 0; n < MAX_READINGS / TOF_SUBBURST_READINGS; n++)
+		{
+			vPrintf(" <=%d:%d", (n + 1) * TOF_SUBBURST_READINGS,
+					sRangingSchedule.au16LengthHistogram[n]);
+		}
+	}
+}
+
+/****************************************************************************
+ *
+ * NAME: u8ReduceDirection
+ *
+ * DESCRIPTION:
+ * Prints the readings taken in one direction and reduces them with the
+ * selected estimator.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psReadings      R   Readings of one direction
+ *                  psEstimate      W   Result
+ *                  pu32RssiSum     RW  Sum of RSSI distances, added to
+ *                  pu32SqiSum      RW  Sum of local SQI, added to
+ *                  pi32RemoteRssiSum RW Sum of remote RSSI, added to
+ *                  pu32RemoteSqiSum RW Sum of remote SQI, added to
+ *
+ * RETURNS: uint8 number of successful readings
+ *
+ ****************************************************************************/
+PRIVATE uint8 u8ReduceDirection(tsTofReadings *psReadings, tsTofEstimate *psEstimate, uint32 *pu32RssiSum, uint32 *pu32SqiSum,
+                                int32 *pi32RemoteRssiSum, uint32 *pu32RemoteSqiSum)
+{
+	int32 n;
+	int32 ai32Tof[MAX_READINGS];
+	uint8 u8NumValid;
+	uint8 u8NumErrors;
+	tsAppApiTof_Data *pasTofData = psReadings->asData;
+
+	u8NumValid  = 0;
+	u8NumErrors = 0;
+
+	vPrintf("\n\n| #  \x1BH| ToF (ps) \x1BH| Lcl RSSI \x1BH| Lcl SQI \x1BH| Rmt RSSI \x1BH| Rmt SQI \x1BH| Timestamp \x1BH| Status \x1BH|");
+	vPrintf("\n--------------------------------------------------------------------------------");
+
+	for(n = 0; n < psReadings->u8Readings; n++)
+	{
+		vPrintf("\n|%d",n);
+
+		/* Only include successful readings */
+		if (pasTofData[n].u8Status == MAC_TOF_STATUS_SUCCESS)
+		{
+			ai32Tof[u8NumValid++] = pasTofData[n].s32Tof;
+			*pu32RssiSum += u32RssiDistanceCm(pasTofData[n].s8LocalRSSI);
+			*pu32RssiSum += u32RssiDistanceCm(pasTofData[n].s8RemoteRSSI);
+			*pu32SqiSum  += pasTofData[n].u8LocalSQI;
+			*pi32RemoteRssiSum += pasTofData[n].s8RemoteRSSI;
+			*pu32RemoteSqiSum  += pasTofData[n].u8RemoteSQI;
+
+			vPrintf("\t|%i\t|%d\t|%d\t|%d\t|%d\t|%d\t|%d\t|",
+					pasTofData[n].s32Tof,
+					pasTofData[n].s8LocalRSSI,
+					pasTofData[n].u8LocalSQI,
+					pasTofData[n].s8RemoteRSSI,
+					pasTofData[n].u8RemoteSQI,
+					pasTofData[n].u32Timestamp,
+					pasTofData[n].u8Status);
+		}
+		else
+		{
+			u8NumErrors++;
+
+			vPrintf("\t|-\t|-\t|-\t|-\t|-\t|-\t|%d\t|",
+					pasTofData[n].u8Status);
+		}
+	}
+
+	/* Calculate statistics. The estimator reorders ai32Tof in place. */
+	vTofEstimate(sEndDeviceData.eTofEstimator, ai32Tof, u8NumValid, psEstimate);
+
+	vPrintf("\n\nStandDev (ToF): %ips, Mean (ToF): %ips, Errors: %d, Used: %d, Estimator: %d",
+			psEstimate->u32Spread,
+			psEstimate->i32Tof,
+			u8NumErrors,
+			psEstimate->u8Used,
+			sEndDeviceData.eTofEstimator);
+
+	return u8NumValid;
+}
+
+/****************************************************************************
+ *
+ * NAME: task_CalculateDistance
+ *
+ * DESCRIPTION:
+ * Reduces a burst to i32BurstTof and its variance using the selected
+ * estimator, and calculates the average u32RssiDistance and the mean remote
+ * RSSI and SQI the power control works from. A two-way burst
+ * reduces each direction separately and averages the two, which cancels the
+ * fixed turnaround offset of either node; all three estimates are reported.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psBuffer        R   Completed burst
+ *
+ * RETURNS: bool_t TRUE if any reading succeeded
+ * 
+ ****************************************************************************/
+PRIVATE bool_t task_CalculateDistance(tsTofBuffer *psBuffer)
+{
+	tsTofEstimate asEstimate[E_TOF_DIRECTIONS];
+	bool_t abValid[E_TOF_DIRECTIONS];
+	uint32 u32RssiSum = 0;
+	uint32 u32SqiSum = 0;
+	int32  i32RemoteRssiSum = 0;
+	uint32 u32RemoteSqiSum = 0;
+	uint32 u32NumValid = 0;
+	uint8  u8NumValid;
+	int d;
+
+	sEndDeviceData.u8BurstUsed     = 0;
+	sEndDeviceData.u8BurstErrors   = 0;
+	sEndDeviceData.u8BurstReadings = 0;
+
+	for (d = 0; d < E_TOF_DIRECTIONS; d++)
+	{
+		abValid[d] = FALSE;
+		sEndDeviceData.ai32TofDirDistance[d] = 0;
+
+		if (bDirectionUsed(psBuffer->eMode, d))
+		{
+			vPrintf("\n\n%s readings", (d == E_TOF_DIR_FORWARD) ? "Forward" : "Reverse");
+			u8NumValid  = u8ReduceDirection(&psBuffer->asDir[d], &asEstimate[d], &u32RssiSum, &u32SqiSum,
+			                                &i32RemoteRssiSum, &u32RemoteSqiSum);
+			abValid[d]  = (u8NumValid != 0);
+			u32NumValid += u8NumValid;
+			sEndDeviceData.u8BurstReadings += psBuffer->asDir[d].u8Readings;
+			sEndDeviceData.u8BurstErrors += psBuffer->asDir[d].u8Readings - u8NumValid;
+			if (abValid[d])
+			{
+				sEndDeviceData.ai32TofDirDistance[d] = i32TofPsToCm(asEstimate[d].i32Tof);
+				sEndDeviceData.u8BurstUsed += asEstimate[d].u8Used;
+			}
+		}
+	}
+
+	if (abValid[E_TOF_DIR_FORWARD] && abValid[E_TOF_DIR_REVERSE])
+	{
+		sEndDeviceData.i32BurstTof = FIXED_DIV_ROUND(asEstimate[E_TOF_DIR_FORWARD].i32Tof +
+		                                             asEstimate[E_TOF_DIR_REVERSE].i32Tof, 2);
+		sEndDeviceData.u64BurstVariance = (u64TofEstimateVariance(&asEstimate[E_TOF_DIR_FORWARD]) +
+		                                   u64TofEstimateVariance(&asEstimate[E_TOF_DIR_REVERSE])) / 4;
+	}
+	else if (abValid[E_TOF_DIR_FORWARD] || abValid[E_TOF_DIR_REVERSE])
+	{
+		/* One direction only, by choice or because the other failed */
+		d = abValid[E_TOF_DIR_FORWARD] ? E_TOF_DIR_FORWARD : E_TOF_DIR_REVERSE;
+		sEndDeviceData.i32BurstTof      = asEstimate[d].i32Tof;
+		sEndDeviceData.u64BurstVariance = u64TofEstimateVariance(&asEstimate[d]);
+	}
+
+	/* RSSI distance is averaged over local and remote RSSI of every reading */
+	sEndDeviceData.u32RssiDistance = (u32NumValid != 0) ? u32RssiSum / (u32NumValid * 2) : 0;
+	sEndDeviceData.u8BurstSqi      = (u32NumValid != 0) ? (uint8)(u32SqiSum / u32NumValid) : 0;
+	sEndDeviceData.s8BurstRemoteRssi = (u32NumValid != 0) ? (int8)(i32RemoteRssiSum / (int32)u32NumValid) : 0;
+	sEndDeviceData.u8BurstRemoteSqi  = (u32NumValid != 0) ? (uint8)(u32RemoteSqiSum / u32NumValid) : 0;
+
+	if (u32NumValid == 0)
+	{
+		return FALSE;
+	}
+
+	vPrintf("\n\nDistance (ToF): fwd %icm, rev %icm, combined %icm",
+			sEndDeviceData.ai32TofDirDistance[E_TOF_DIR_FORWARD],
+			sEndDeviceData.ai32TofDirDistance[E_TOF_DIR_REVERSE],
+			i32TofPsToCm(sEndDeviceData.i32BurstTof));
+
+	return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: task_TrackDistance
+ *
+ * DESCRIPTION:
+ * Fuses the last burst estimate into the distance track of the node it was
+ * taken against and sets i32TofDistance, its standard deviation and rate
+ * from the track.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u8Target        R   Node ranged against
+ *                  u32NowMs        R   Time the burst finished (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_TrackDistance(uint8 u8Target, uint32 u32NowMs)
+{
+	tsTofTrack *psTrack = &sEndDeviceData.asTofTrack[u8Target];
+	uint64 u64Variance;
+	uint32 u32StdDev;
+	int32 i32Rate;
+
+	sEndDeviceData.bTofRejected = !bTofTrackUpdate(psTrack, u32NowMs, sEndDeviceData.i32BurstTof,
+	                                               sEndDeviceData.u64BurstVariance);
+	if (sEndDeviceData.bTofRejected)
+	{
+		vPrintf("\nBurst rejected by track");
+	}
+
+	/* cm^2 = ps^2 x 0.03^2 */
+	u64Variance = (psTrack->u64P00 * TOF_CM_PER_PS_NUM * TOF_CM_PER_PS_NUM) /
+	              (TOF_CM_PER_PS_DEN * TOF_CM_PER_PS_DEN);
+	u32StdDev   = u32FixedSqrt64(u64Variance);
+	i32Rate     = i32TofPsToCm(psTrack->i32Rate);
+
+	sEndDeviceData.i32TofDistance = i32TofPsToCm(psTrack->i32Tof);
+	sEndDeviceData.u16TofStdDev   = (u32StdDev > 0xffff) ? 0xffff : (uint16)u32StdDev;
+	sEndDeviceData.i16TofRate     = (i32Rate > 32767) ? 32767 : ((i32Rate < -32768) ? -32768 : (int16)i32Rate);
+
+	vPrintf("\nDistance to %d (ToF): %icm, StdDev: %dcm, Rate: %icm/s, Distance (RSSI): %dcm",
+			u16TargetAdr(u8Target),
+			sEndDeviceData.i32TofDistance,
+			sEndDeviceData.u16TofStdDev,
+			(int32)sEndDeviceData.i16TofRate,
+			sEndDeviceData.u32RssiDistance);
+}
+
+/****************************************************************************
+ *
+ * NAME: u16TargetAdr
+ *
+ * DESCRIPTION:
+ * Short address of a node ranged against: the coordinator, or for a tag or
+ * in a survey one of the anchors, which hold the first addresses handed
+ * out.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u8Target        R   Index of the node
+ *
+ * RETURNS: uint16 short address
+ *
+ ****************************************************************************/
+PRIVATE uint16 u16TargetAdr(uint8 u8Target)
+{
+	return (MULTI_TAG_TRACKING || sEndDeviceData.bSurveying) ?
+	       (uint16)(END_DEVICE_START_ADR + u8Target) : COORDINATOR_ADR;
+}
+
+/****************************************************************************
+ *
+ * NAME: u8Targets
+ *
+ * DESCRIPTION:
+ * Number of nodes ranged against in turn.
+ *
+ * RETURNS: uint8 nodes, see u16TargetAdr
+ *
+ ****************************************************************************/
+PRIVATE uint8 u8Targets(void)
+{
+	return sEndDeviceData.bSurveying ? sEndDeviceData.u8SurveyAnchors : RANGING_TARGETS;
+}
+
+/****************************************************************************
+ *
+ * NAME: bSurveyAnchor
+ *
+ * DESCRIPTION:
+ * Whether this device is one of the anchors in the survey last commanded.
+ *
+ * RETURNS: bool_t TRUE if it is
+ *
+ ****************************************************************************/
+PRIVATE bool_t bSurveyAnchor(void)
+{
+	return ((uint16)(sEndDeviceData.u16Address - END_DEVICE_START_ADR) <
+	        sEndDeviceData.u8SurveyAnchors);
+}
+
+/****************************************************************************
+ *
+ * NAME: task_Survey
+ *
+ * DESCRIPTION:
+ * Starts or ends a survey as commanded by the coordinator. The targets
+ * change only once no burst is in progress or waiting, so each burst is
+ * reported against the node it was taken against. A survey ends only once
+ * its reports are sent, as a device that does not range itself sends
+ * nothing outside one. An anchor keeps its receiver on for the survey so
+ * the others can range it, and starts its bursts offset by its place among
+ * the anchors so they do not all range at once.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_Survey(void)
+{
+	uint32 u32Now = u32TickClockNowMs();
+	bool_t bWanted;
+	int b;
+
+	bWanted = (sEndDeviceData.u8SurveyAnchors >= 2) &&
+	          !TICK_CLOCK_EXPIRED(u32Now, sEndDeviceData.u32SurveyEndMs);
+	if ((bWanted == sEndDeviceData.bSurveying) || bTofInProgress ||
+	    (!bWanted && ((sReport.u8Count > 0) || (u8TxQueueWaiting() > 0))))
+	{
+		return;
+	}
+	for (b = 0; b < TOF_BUFFERS; b++)
+	{
+		if (asTofBuffer[b].eState != E_TOF_BUFFER_FREE)
+		{
+			return;
+		}
+	}
+
+	sEndDeviceData.bSurveying = bWanted;
+	vResetTracks();
+
+	if (!bWanted)
+	{
+		sEndDeviceData.u8SurveyAnchors = 0;
+		MAC_vPibSetRxOnWhenIdle(s_pvMac, RECEIVER_ALWAYS_ON, FALSE);
+		vPrintf("\nSurvey ended");
+	}
+	else if (bSurveyAnchor())
+	{
+		MAC_vPibSetRxOnWhenIdle(s_pvMac, TRUE, FALSE);
+		sRangingSchedule.u32NextReleaseMs = u32Now +
+			((sEndDeviceData.u16Address - END_DEVICE_START_ADR) * sRangingSchedule.u32PeriodMs) /
+			sEndDeviceData.u8SurveyAnchors;
+		vPrintf("\nSurveying %d anchors", sEndDeviceData.u8SurveyAnchors);
+	}
+	else
+	{
+		vPrintf("\nHolding for survey");
+	}
+}
+
+/****************************************************************************
+ *
+ * NAME: vResetTracks
+ *
+ * DESCRIPTION:
+ * Drops the track of every node ranged against, and starts again from the
+ * first.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vResetTracks(void)
+{
+	int n;
+
+	for (n = 0; n < TOF_TRACKS; n++)
+	{
+		vTofTrackReset(&sEndDeviceData.asTofTrack[n]);
+	}
+	sEndDeviceData.u8NextTarget = 0;
+}
+
+/****************************************************************************
+ *
+ * NAME: task_AdjustTxPower
+ *
+ * DESCRIPTION:
+ * Feeds the remote RSSI and SQI of the last burst to the power control, so
+ * the node ranged against hears this one with the target margin and no
+ * more. A burst with no successful readings raises the power. A tag ranging
+ * several anchors settles at the level the weakest of them needs, as any
+ * poor burst raises the level and lowering it takes a run of good ones.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  bReadings       R   Burst had successful readings
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_AdjustTxPower(bool_t bReadings)
+{
+	bool_t bChanged;
+
+	if (bReadings)
 	{
-		dMean = dAcc / (MAX_READINGS - u8NumErrors);
-
-		/* Calculate standard deviation = sqrt((1/N)*(sigma(xi-xmean)2) */
-		dStd = 0.0;
-
-		/* Accumulate sum of squared deviances */
-		for(n = 0; n < MAX_READINGS; n++)
-		{
-			if(asTofData[n].u8Status == MAC_TOF_STATUS_SUCCESS)
-			{
-				dStd += ((double)asTofData[n].s32Tof - dMean) * ((double)asTofData[n].s32Tof - dMean);
-			}
-		}
-
-		/* std = sqrt(mean of sum of squared deviances) */
-		dStd /= (MAX_READINGS - u8NumErrors);
-		dStd = sqrt(dStd);
-
-
-		s32StanDev = (int32)dStd;
-		s32Mean    = (int32)dMean;
-
-		/* Calculate distances */
-		sEndDeviceData.i32TofDistance  = dMean * 0.03;
-		sEndDeviceData.u32RssiDistance /= (MAX_READINGS - u8NumErrors) * 2;
+		bChanged = bTxPowerUpdate(&sTxPower,
+		                          sEndDeviceData.u8BurstReadings,
+		                          sEndDeviceData.u8BurstErrors,
+		                          sEndDeviceData.s8BurstRemoteRssi,
+		                          sEndDeviceData.u8BurstRemoteSqi);
 	}
 	else
 	{
-		s32StanDev      = 0;
-		s32Mean         = 0;
-		sEndDeviceData.i32TofDistance  = 0;
-		sEndDeviceData.u32RssiDistance = 0;
+		bChanged = bTxPowerUpdate(&sTxPower, 0, 0, 0, 0);
 	}
 
-	vPrintf("\n\nStandDev (ToF): %ips, Mean (ToF): %ips, Errors: %d",
-			s32StanDev,
-			s32Mean,
-			u8NumErrors);
-
-	vPrintf("\nDistance (ToF): %icm, Distance (RSSI): %dcm",
-			sEndDeviceData.i32TofDistance,
-			sEndDeviceData.u32RssiDistance);
+	if (bChanged)
+	{
+		vPrintf("\nTX power level %d, remote RSSI %d, remote SQI %d",
+				sTxPower.u8Level,
+				sEndDeviceData.s8BurstRemoteRssi,
+				sEndDeviceData.u8BurstRemoteSqi);
+	}
 }
 
 /****************************************************************************
@@ -530,6 +1909,35 @@ PRIVATE void vProcessIncomingMlme(MAC_MlmeDcfmInd_s *psMlmeInd)
 		}
 		break;
 
+		/* Start of a superframe, beacon enabled network only */
+	case MAC_MLME_IND_BEACON_NOTIFY:
+		if (sEndDeviceData.eState >= E_STATE_ASSOCIATED)
+		{
+			sEndDeviceData.u8SyncLosses = 0;
+			vTdmaBeacon(&sTdmaSchedule, psMlmeInd->uParam.sIndBeacon.u8BSN,
+			            u32TickClockNowMs());
+		}
+		break;
+
+		/* Beacons missed. Hold reports until back in step. */
+	case MAC_MLME_IND_SYNC_LOSS:
+		if (sEndDeviceData.eState >= E_STATE_ASSOCIATED)
+		{
+			vPrintf("Sync lost\n");
+			vTdmaSyncLost(&sTdmaSchedule);
+			vTxQueueHold(TRUE);
+			if (sEndDeviceData.bRejoinPending ||
+			    (++sEndDeviceData.u8SyncLosses >= LINK_MAX_SYNC_LOSSES))
+			{
+				vStartActiveScan(SCAN_CHANNELS);
+			}
+			else
+			{
+				vStartSync();
+			}
+		}
+		break;
+
 	default:
 		break;
 	}
@@ -586,14 +1994,17 @@ PRIVATE void vProcessIncomingMcps(MAC_McpsDcfmInd_s *psMcpsInd)
  ****************************************************************************/
 PRIVATE void vHandleMcpsDataDcfm(MAC_McpsDcfmInd_s *psMcpsInd)
 {
-	if (psMcpsInd->uParam.sDcfmData.u8Status == MAC_ENUM_SUCCESS)
-	{
-		/* Data frame transmission successful */
-	}
-	else
+	if (psMcpsInd->uParam.sDcfmData.u8Status != MAC_ENUM_SUCCESS)
 	{
 		/* Data transmission failed after 3 retries at MAC layer. */
+		vPrintf("\nTx handle %d failed, status %x",
+				psMcpsInd->uParam.sDcfmData.u8Handle,
+				psMcpsInd->uParam.sDcfmData.u8Status);
 	}
+
+	vTxQueueConfirm(psMcpsInd->uParam.sDcfmData.u8Handle,
+	                psMcpsInd->uParam.sDcfmData.u8Status,
+	                u32TickClockNowMs());
 }
 
 /****************************************************************************
@@ -612,14 +2023,22 @@ PRIVATE void vHandleMcpsDataDcfm(MAC_McpsDcfmInd_s *psMcpsInd)
 PRIVATE void vHandleMcpsDataInd(MAC_McpsDcfmInd_s *psMcpsInd)
 {
 	MAC_RxFrameData_s *psFrame;
+	uint8 u8Missed;
 
 	psFrame = &psMcpsInd->uParam.sIndData.sFrame;
 
-	if (psFrame->sSrcAddr.uAddr.u16Short == COORDINATOR_ADR)
+	if ((psFrame->sSrcAddr.uAddr.u16Short == COORDINATOR_ADR) &&
+	    (psFrame->sDstAddr.uAddr.u16Short == 0xffff))
+	{
+		/* Broadcast commands are repeated rather than acknowledged, and
+		   acting on one twice is harmless */
+		vProcessReceivedDataPacket(&psFrame->au8Sdu[1],
+				(psFrame->u8SduLength) - 1);
+	}
+	else if (psFrame->sSrcAddr.uAddr.u16Short == COORDINATOR_ADR)
 	{
-		if (psFrame->au8Sdu[0] >= sEndDeviceData.u8RxPacketSeqNb)
+		if (eSeqTrackUpdate(&sEndDeviceData.sRxSeq, psFrame->au8Sdu[0], &u8Missed) != E_SEQ_DUPLICATE)
 		{
-			sEndDeviceData.u8RxPacketSeqNb++;
 			vProcessReceivedDataPacket(&psFrame->au8Sdu[1],
 					(psFrame->u8SduLength) - 1);
 		}
@@ -630,8 +2049,13 @@ PRIVATE void vHandleMcpsDataInd(MAC_McpsDcfmInd_s *psMcpsInd)
  * NAME: vProcessReceivedDataPacket
  *
  * DESCRIPTION:
+ * Handles a frame from the coordinator. A channel change command schedules
+ * the move announced, see task_ChangeChannel, and a survey command the
+ * survey, see task_Survey.
  *
  * PARAMETERS:      Name            RW  Usage
+ *                  pu8Data         R   Packet Data Received
+ *                  u8Len           R   Size of Data Array
  *
  * RETURNS:
  *
@@ -640,6 +2064,39 @@ PRIVATE void vHandleMcpsDataInd(MAC_McpsDcfmInd_s *psMcpsInd)
  ****************************************************************************/
 PRIVATE void vProcessReceivedDataPacket(uint8 *pu8Data, uint8 u8Len)
 {
+	uint8 u8Channel;
+	uint16 u16DelayMs;
+	uint16 u16PeriodMs;
+	uint32 u32PeriodMs;
+	uint8 u8Anchors;
+	uint16 u16DurationMs;
+
+	if (bChanAgilityDecode(pu8Data, u8Len, &u8Channel, &u16DelayMs) &&
+	    (u8Channel != sEndDeviceData.u8Channel))
+	{
+		sEndDeviceData.bChannelChangePending = TRUE;
+		sEndDeviceData.u8NewChannel          = u8Channel;
+		sEndDeviceData.u32ChannelChangeMs    = u32TickClockNowMs() + u16DelayMs;
+	}
+
+	/* The coordinator spaces the tags' bursts out as their number grows */
+	if (MULTI_TAG_TRACKING && END_DEVICE_TAG &&
+	    bReportPeriodDecode(pu8Data, u8Len, &u16PeriodMs))
+	{
+		u32PeriodMs = (u16PeriodMs > RANGING_PERIOD_MS) ? u16PeriodMs : RANGING_PERIOD_MS;
+		if (u32PeriodMs != sRangingSchedule.u32PeriodMs)
+		{
+			sRangingSchedule.u32PeriodMs = u32PeriodMs;
+			vPrintf("\nRanging period %d ms", u32PeriodMs);
+		}
+	}
+
+	/* Taken up by task_Survey. A duration of 0 ends a survey early. */
+	if (bReportSurveyDecode(pu8Data, u8Len, &u8Anchors, &u16DurationMs))
+	{
+		sEndDeviceData.u8SurveyAnchors = (u8Anchors < MAX_ANCHORS) ? u8Anchors : MAX_ANCHORS;
+		sEndDeviceData.u32SurveyEndMs  = u32TickClockNowMs() + u16DurationMs;
+	}
 }
 
 /****************************************************************************
@@ -710,7 +2167,9 @@ PRIVATE void vHandleAssociateResponse(MAC_MlmeDcfmInd_s *psMlmeInd)
 	{
 		vPrintf("Associated");
 		sEndDeviceData.u16Address = psMlmeInd->uParam.sDcfmAssociate.u16AssocShortAddr;
-		sEndDeviceData.eState = E_STATE_ASSOCIATED;
+		sEndDeviceData.bRejoinPending = FALSE;
+		vSaveNetwork();
+		vEnterNetwork();
 	}
 	else
 	{
@@ -718,6 +2177,234 @@ PRIVATE void vHandleAssociateResponse(MAC_MlmeDcfmInd_s *psMlmeInd)
 	}
 }
 
+/****************************************************************************
+ *
+ * NAME: vEnterNetwork
+ *
+ * DESCRIPTION:
+ * Starts ranging and reporting once the device has an address, whether
+ * from association or restored from flash.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ * None.
+ *
+ * RETURNS:
+ * None.
+ *
+ ****************************************************************************/
+PRIVATE void vEnterNetwork(void)
+{
+	sEndDeviceData.eState = E_STATE_ASSOCIATED;
+	sEndDeviceData.u32LinkDelivered      = 0;
+	sEndDeviceData.u32LinkFailed         = 0;
+	sEndDeviceData.u8SyncLosses          = 0;
+	sEndDeviceData.bChannelChangePending = FALSE;
+	vTxQueueInit(sEndDeviceData.u16Address);
+
+	if (BEACON_ENABLED_NETWORK)
+	{
+		vTdmaInit(&sTdmaSchedule, sEndDeviceData.u16Address);
+		vTxQueueHold(TRUE);
+		vPrintf(" slot %i of beacon %i/%i\n", sTdmaSchedule.sSlot.u8Slot,
+		        sTdmaSchedule.sSlot.u8Cycle, TDMA_CYCLES);
+		vStartSync();
+	}
+}
+
+/****************************************************************************
+ *
+ * NAME: bRestoreNetwork
+ *
+ * DESCRIPTION:
+ * Rejoins the network saved in flash without scanning or associating. The
+ * rejoin stays pending until a frame is delivered, see task_CheckLink.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ * None.
+ *
+ * RETURNS:
+ * TRUE if a network was restored
+ *
+ ****************************************************************************/
+PRIVATE bool_t bRestoreNetwork(void)
+{
+	uint16 u16PanId;
+
+	bNetworkLogOpen = bPersistOpen(&sNetworkLog, NETWORK_FLASH_SECTOR, NETWORK_RECORD_LEN);
+	bNetworkSaved   = bNetworkLogOpen && bPersistReadLast(&sNetworkLog, au8SavedNetwork);
+	if (!bNetworkSaved)
+	{
+		return FALSE;
+	}
+
+	u16PanId = (uint16)((au8SavedNetwork[1] << 8) | au8SavedNetwork[2]);
+	if ((u16PanId != PAN_ID) || (au8SavedNetwork[0] < CHANNEL_MIN))
+	{
+		return FALSE;
+	}
+
+	sEndDeviceData.u8Channel  = au8SavedNetwork[0];
+	sEndDeviceData.u16Address = (uint16)((au8SavedNetwork[3] << 8) | au8SavedNetwork[4]);
+
+	eAppApiPlmeSet(PHY_PIB_ATTR_CURRENT_CHANNEL, sEndDeviceData.u8Channel);
+	MAC_vPibSetShortAddr(s_pvMac, sEndDeviceData.u16Address);
+	s_psMacPib->u16CoordShortAddr = COORDINATOR_ADR;
+
+	sEndDeviceData.bRejoinPending = TRUE;
+	vEnterNetwork();
+
+	return TRUE;
+}
+
+/****************************************************************************
+ *
+ * NAME: vSaveNetwork
+ *
+ * DESCRIPTION:
+ * Saves the network just joined to flash, unless it is already saved.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ * None.
+ *
+ * RETURNS:
+ * None.
+ *
+ ****************************************************************************/
+PRIVATE void vSaveNetwork(void)
+{
+	uint8 au8Network[NETWORK_RECORD_LEN];
+	uint8 n;
+
+	au8Network[0] = sEndDeviceData.u8Channel;
+	au8Network[1] = (uint8)(PAN_ID >> 8);
+	au8Network[2] = (uint8)(PAN_ID);
+	au8Network[3] = (uint8)(sEndDeviceData.u16Address >> 8);
+	au8Network[4] = (uint8)(sEndDeviceData.u16Address);
+
+	if (bNetworkSaved)
+	{
+		for (n = 0; (n < NETWORK_RECORD_LEN) && (au8Network[n] == au8SavedNetwork[n]); n++);
+		if (n == NETWORK_RECORD_LEN)
+		{
+			return;
+		}
+	}
+
+	if (bNetworkLogOpen && bPersistAppend(&sNetworkLog, au8Network))
+	{
+		for (n = 0; n < NETWORK_RECORD_LEN; n++)
+		{
+			au8SavedNetwork[n] = au8Network[n];
+		}
+		bNetworkSaved = TRUE;
+	}
+}
+
+/****************************************************************************
+ *
+ * NAME: task_CheckLink
+ *
+ * DESCRIPTION:
+ * Confirms a rejoin from flash once a frame is delivered, or falls back to
+ * a scan if frames keep failing, as the coordinator has most likely moved
+ * channel or forgotten the device. Once confirmed, a longer run of failed
+ * frames is taken as a channel move that was missed.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ * None.
+ *
+ * RETURNS:
+ * None.
+ *
+ ****************************************************************************/
+PRIVATE void task_CheckLink(void)
+{
+	tsTxQueueStats *psStats = psTxQueueStats();
+	uint32 u32Failed;
+
+	if (psStats->u32Delivered != sEndDeviceData.u32LinkDelivered)
+	{
+		sEndDeviceData.u32LinkDelivered = psStats->u32Delivered;
+		sEndDeviceData.u32LinkFailed    = psStats->u32Failed;
+		sEndDeviceData.bRejoinPending   = FALSE;
+		return;
+	}
+
+	u32Failed = psStats->u32Failed - sEndDeviceData.u32LinkFailed;
+	if (u32Failed >= (sEndDeviceData.bRejoinPending ?
+	                  REJOIN_MAX_FAILED_FRAMES : LINK_MAX_FAILED_FRAMES))
+	{
+		vPrintf("Coordinator lost, starting scan\n");
+		sEndDeviceData.bRejoinPending = FALSE;
+		vStartActiveScan(SCAN_CHANNELS);
+	}
+}
+
+/****************************************************************************
+ *
+ * NAME: task_ChangeChannel
+ *
+ * DESCRIPTION:
+ * Follows the coordinator to the channel it announced, at the time it
+ * moves. The new channel is saved so a restart rejoins there.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ * None.
+ *
+ * RETURNS:
+ * None.
+ *
+ ****************************************************************************/
+PRIVATE void task_ChangeChannel(void)
+{
+	if (!sEndDeviceData.bChannelChangePending ||
+	    !TICK_CLOCK_EXPIRED(u32TickClockNowMs(), sEndDeviceData.u32ChannelChangeMs))
+	{
+		return;
+	}
+
+	vPrintf("Moving to channel %i\n", sEndDeviceData.u8NewChannel);
+	sEndDeviceData.bChannelChangePending = FALSE;
+	sEndDeviceData.u8Channel = sEndDeviceData.u8NewChannel;
+	eAppApiPlmeSet(PHY_PIB_ATTR_CURRENT_CHANNEL, sEndDeviceData.u8Channel);
+	vSaveNetwork();
+
+	if (BEACON_ENABLED_NETWORK)
+	{
+		vStartSync();
+	}
+}
+
+/****************************************************************************
+ *
+ * NAME: vStartSync
+ *
+ * DESCRIPTION:
+ * Starts tracking the coordinator's beacons. Every beacon is notified, not
+ * just those with a payload, so each superframe start is seen.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ * None.
+ *
+ * RETURNS:
+ * None.
+ *
+ ****************************************************************************/
+PRIVATE void vStartSync(void)
+{
+	MAC_MlmeReqRsp_s  sMlmeReqRsp;
+	MAC_MlmeSyncCfm_s sMlmeSyncCfm;
+
+	s_psMacPib->bAutoRequest = FALSE;
+
+	sMlmeReqRsp.u8Type = MAC_MLME_REQ_SYNC;
+	sMlmeReqRsp.u8ParamLength = sizeof(MAC_MlmeReqSync_s);
+	sMlmeReqRsp.uParam.sReqSync.u8Channel = sEndDeviceData.u8Channel;
+	sMlmeReqRsp.uParam.sReqSync.u8TrackBeacon = TRUE;
+
+	vAppApiMlmeRequest(&sMlmeReqRsp, &sMlmeSyncCfm);
+}
+
 /****************************************************************************
  *
  * NAME: vStartActiveScan
@@ -832,71 +2519,197 @@ PRIVATE void vPutChar(unsigned char c) {
 
 /****************************************************************************
  *
- * NAME: tx_Distance
+ * NAME: task_QueueReport
+ *
+ * DESCRIPTION:
+ * Adds the result of a burst to the pending report, sending the report
+ * first if it cannot take another measurement and after if it is full.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psBuffer        R   Completed burst
+ *                  u32FinishMs     R   Time the burst finished (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_QueueReport(tsTofBuffer *psBuffer, uint32 u32FinishMs)
+{
+	tsReportMeasurement sMeasurement;
+
+	sMeasurement.u32TimestampMs  = u32FinishMs;
+	sMeasurement.i32TofDistance  = sEndDeviceData.i32TofDistance;
+	sMeasurement.u16StdDev       = sEndDeviceData.u16TofStdDev;
+	sMeasurement.u16RssiDistance = (sEndDeviceData.u32RssiDistance > 0xffff) ?
+	                               0xffff : (uint16)sEndDeviceData.u32RssiDistance;
+	sMeasurement.i16Rate         = sEndDeviceData.i16TofRate;
+	sMeasurement.u8Used          = sEndDeviceData.u8BurstUsed;
+	sMeasurement.u8Errors        = sEndDeviceData.u8BurstErrors;
+	sMeasurement.u8Sqi           = sEndDeviceData.u8BurstSqi;
+	sMeasurement.u8Flags         = (uint8)psBuffer->eMode & REPORT_FLAG_MODE_MASK;
+	sMeasurement.u8TxPower       = psBuffer->u8TxPower;
+	sMeasurement.u16Target       = u16TargetAdr(psBuffer->u8Target);
+	if (sEndDeviceData.bTofRejected)
+	{
+		sMeasurement.u8Flags |= REPORT_FLAG_REJECTED;
+	}
+
+	if (!bReportAdd(&sReport, &sMeasurement))
+	{
+		tx_Report(&sReport);
+		vReportReset(&sReport);
+		(void)bReportAdd(&sReport, &sMeasurement);
+	}
+
+	if (sReport.u8Count >= REPORT_BATCH_SIZE)
+	{
+		tx_Report(&sReport);
+		vReportReset(&sReport);
+	}
+}
+
+/****************************************************************************
+ *
+ * NAME: task_FlushReport
+ *
+ * DESCRIPTION:
+ * Sends the pending report once its oldest measurement reaches
+ * REPORT_MAX_AGE_MS, bounding the latency batching adds at low rates.
+ * While earlier frames are still queued the link is backed up, so the
+ * report is held open and later measurements coalesce into it until it
+ * is full.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void task_FlushReport(void)
+{
+	if (sReport.u8Count == 0)
+	{
+		return;
+	}
+
+	if ((u8TxQueueWaiting() == 0) &&
+	    TICK_CLOCK_EXPIRED(u32TickClockNowMs(),
+	                       sReport.asMeasurement[0].u32TimestampMs + REPORT_MAX_AGE_MS))
+	{
+		tx_Report(&sReport);
+		vReportReset(&sReport);
+	}
+}
+
+/****************************************************************************
+ *
+ * NAME: tx_Report
  *
  * DESCRIPTION:
- * Transmits the i32TofDistance and u32RssiDistance to the coordinator.
+ * Queues a report of one or more measurements for transmission to the
+ * coordinator.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psReport        R   Report to send
  *
  * RETURNS: void
  * 
  ****************************************************************************/
-PRIVATE void tx_Distance(int32 i32TofDistance, uint32 u32RssiDistance)
-{
-	/* Structures used to hold data for MLME request and response */
-	MAC_McpsReqRsp_s sMcpsReqRsp;
-	MAC_McpsSyncCfm_s sMcpsSyncCfm;
-	uint8 *pu8Payload;
-
-	/* Create frame transmission request */
-	sMcpsReqRsp.u8Type = MAC_MCPS_REQ_DATA;
-	sMcpsReqRsp.u8ParamLength = sizeof(MAC_McpsReqData_s);
-
-	/* Set handle so we can match confirmation to request */
-	sMcpsReqRsp.uParam.sReqData.u8Handle = u8CurrentTxHandle;
-	u8CurrentTxHandle +=1;
-
-	/* Use short address for source */
-	sMcpsReqRsp.uParam.sReqData.sFrame.sSrcAddr.u8AddrMode = 2;
-	sMcpsReqRsp.uParam.sReqData.sFrame.sSrcAddr.u16PanId = PAN_ID;
-	sMcpsReqRsp.uParam.sReqData.sFrame.sSrcAddr.uAddr.u16Short = sEndDeviceData.u16Address;
-
-	/* Use short address for destination */
-	sMcpsReqRsp.uParam.sReqData.sFrame.sDstAddr.u8AddrMode = 2;
-	sMcpsReqRsp.uParam.sReqData.sFrame.sDstAddr.u16PanId = PAN_ID;
-	sMcpsReqRsp.uParam.sReqData.sFrame.sDstAddr.uAddr.u16Short = COORDINATOR_ADR;
-
-	/* Frame requires ack but not security, indirect transmit or GTS */
-	sMcpsReqRsp.uParam.sReqData.sFrame.u8TxOptions = MAC_TX_OPTION_ACK;
-
-	/* Set payload, only use first 8 bytes */
-	sMcpsReqRsp.uParam.sReqData.sFrame.u8SduLength = 10;
-	pu8Payload = sMcpsReqRsp.uParam.sReqData.sFrame.au8Sdu;
-	vPrintf("\nTransmitting Distance to Coordinator\n");
-
-	pu8Payload[0] = sEndDeviceData.u8TxPacketSeqNb++;
-	pu8Payload[1] = (uint8)(0xd1);
-	pu8Payload[2] = (uint8)(((uint32)i32TofDistance & 0xff000000uL) >> 24);
-	pu8Payload[3] = (uint8)(((uint32)i32TofDistance & 0x00ff0000uL) >> 16);
-	pu8Payload[4] = (uint8)(((uint32)i32TofDistance & 0x0000ff00uL) >> 8);
-	pu8Payload[5] = (uint8)((uint32)i32TofDistance & 0x000000ffuL);
-	pu8Payload[6] = (uint8)((u32RssiDistance & 0xff000000uL) >> 24);
-	pu8Payload[7] = (uint8)((u32RssiDistance & 0x00ff0000uL) >> 16);
-	pu8Payload[8] = (uint8)((u32RssiDistance & 0x0000ff00uL) >> 8);
-	pu8Payload[9] = (uint8)(u32RssiDistance & 0x000000ffuL);
+PRIVATE void tx_Report(tsReport *psReport)
+{
+	uint8 au8Payload[REPORT_MAX_LEN + 1];
+	uint8 u8Len;
+
+	/* Application sequence number, then the report */
+	au8Payload[0] = sEndDeviceData.u8TxPacketSeqNb;
+
+	u8Len = u8ReportEncode(psReport, &au8Payload[1], REPORT_MAX_LEN);
+	if (u8Len == 0)
+	{
+		return;
+	}
+
+	vPrintf("\nQueueing %d measurements for Coordinator\n", psReport->u8Count);
 
 	#ifdef DEBUG_DISTANCE_TRANSMISSION
-		vPrintf("TOF  Byte0: "BYTE_TO_BINARY_PATTERN"\n", BYTE_TO_BINARY(pu8Payload[2]));
-		vPrintf("TOF  Byte1: "BYTE_TO_BINARY_PATTERN"\n", BYTE_TO_BINARY(pu8Payload[3]));
-		vPrintf("TOF  Byte2: "BYTE_TO_BINARY_PATTERN"\n", BYTE_TO_BINARY(pu8Payload[4]));
-		vPrintf("TOF  Byte3: "BYTE_TO_BINARY_PATTERN"\n\n", BYTE_TO_BINARY(pu8Payload[5]));
-		vPrintf("RSSI Byte0: "BYTE_TO_BINARY_PATTERN"\n", BYTE_TO_BINARY(pu8Payload[6]));
-		vPrintf("RSSI Byte1: "BYTE_TO_BINARY_PATTERN"\n", BYTE_TO_BINARY(pu8Payload[7]));
-		vPrintf("RSSI Byte2: "BYTE_TO_BINARY_PATTERN"\n", BYTE_TO_BINARY(pu8Payload[8]));
-		vPrintf("RSSI Byte3: "BYTE_TO_BINARY_PATTERN"\n\n", BYTE_TO_BINARY(pu8Payload[9]));
+	{
+		uint8 n;
+		for (n = 0; n <= u8Len; n++)
+		{
+			vPrintf("Byte%d: "BYTE_TO_BINARY_PATTERN"\n", n, BYTE_TO_BINARY(au8Payload[n]));
+		}
+	}
 	#endif
 
-	vAppApiMcpsRequest(&sMcpsReqRsp, &sMcpsSyncCfm);
+	if (bTxQueuePost(COORDINATOR_ADR, au8Payload, u8Len + 1, u32TickClockNowMs()))
+	{
+		sEndDeviceData.u8TxPacketSeqNb++;
+	}
+}
+
+/****************************************************************************
+ *
+ * NAME: vPrintLinkStats
+ *
+ * DESCRIPTION:
+ * Prints the delivery statistics of the link to and from the coordinator.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vPrintLinkStats(void)
+{
+	tsTxQueueStats *psStats = psTxQueueStats();
+	tsSeqTrack *psSeq = &sEndDeviceData.sRxSeq;
+
+	vPrintf("\nLink: posted %d, sent %d, delivered %d, retries %d, failed %d, dropped full %d, dropped stale %d, queued %d",
+			psStats->u32Posted,
+			psStats->u32Sent,
+			psStats->u32Delivered,
+			psStats->u32Retries,
+			psStats->u32Failed,
+			psStats->u32DroppedFull,
+			psStats->u32DroppedStale,
+			u8TxQueueWaiting());
+	vPrintf("\nFrom coordinator: received %d, lost %d, duplicates %d, reordered %d, restarts %d",
+			psSeq->u32Received,
+			psSeq->u32Lost,
+			psSeq->u32Duplicates,
+			psSeq->u32Reordered,
+			psSeq->u32Restarts);
+}
+
+/****************************************************************************
+ *
+ * NAME: vPrintPowerBudget
+ *
+ * DESCRIPTION:
+ * Prints the estimated current in each power state for this configuration,
+ * the time spent in each, and the resulting average current and battery
+ * life.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vPrintPowerBudget(void)
+{
+	static const char *apcState[E_POWER_STATES] = { "active", "idle", "doze", "sleep" };
+	int n;
+
+	vPowerBudgetEnter(&sPowerBudget, sPowerBudget.eState, u32TickClockNowMs());
+
+	vPrintf("\nPower mode %d, high power module %d, burst every %d ms",
+			POWER_MODE, HIGH_POWER_MODULE, sRangingSchedule.u32PeriodMs);
+	vPrintf("\nTX power level %d, raised %d, lowered %d",
+			sTxPower.u8Level, sTxPower.u32Raised, sTxPower.u32Lowered);
+	for (n = 0; n < E_POWER_STATES; n++)
+	{
+		vPrintf("\n%s: %d uA for %d ms", apcState[n],
+				u32PowerBudgetStateUa(&sPowerBudget, (tePowerState)n),
+				sPowerBudget.au32Ms[n]);
+	}
+	vPrintf("\nAverage %d uA, %d hours from %d mAh",
+			u32PowerBudgetAverageUa(&sPowerBudget),
+			u32PowerBudgetLifeHours(&sPowerBudget, BATTERY_CAPACITY_MAH),
+			BATTERY_CAPACITY_MAH);
 }
+
 /****************************************************************************/
 /***        END OF FILE                                                   ***/
 /****************************************************************************/
@@ -0,0 +1,49 @@
+/****************************************************************************
+ *
+ * MODULE:      AppApiTof.h
+ *
+ * DESCRIPTION:
+ * Host stand-in for the SDK's time of flight API. Readings are simulated,
+ * see sdkstub.h.
+ *
+ ****************************************************************************/
+
+#ifndef  APPAPITOF_H_INCLUDED
+#define  APPAPITOF_H_INCLUDED
+
+#include <jendefs.h>
+#include <mac_sap.h>
+
+#define MAC_TOF_STATUS_SUCCESS      0
+
+typedef enum
+{
+    TOF_SUCCESS,
+    TOF_FAIL,
+    TOF_TIMEOUT
+} eTofReturn;
+
+typedef enum
+{
+    API_TOF_FORWARDS,
+    API_TOF_REVERSE
+} eTofDirection;
+
+typedef struct
+{
+    int32   s32Tof;
+    int8    s8LocalRSSI;
+    uint8   u8LocalSQI;
+    int8    s8RemoteRSSI;
+    uint8   u8RemoteSQI;
+    uint32  u32Timestamp;
+    uint8   u8Status;
+} tsAppApiTof_Data;
+
+typedef void (*PR_GET_TOF_CALLBACK)(eTofReturn eStatus);
+
+PUBLIC void   vAppApiTofInit(bool_t bEnable);
+PUBLIC bool_t bAppApiGetTof(tsAppApiTof_Data *psTofData, MAC_Addr_s *psAddr, uint8 u8Readings,
+                            eTofDirection eDirection, PR_GET_TOF_CALLBACK prCallback);
+
+#endif  /* APPAPITOF_H_INCLUDED */
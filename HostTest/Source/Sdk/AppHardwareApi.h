@@ -0,0 +1,65 @@
+/****************************************************************************
+ *
+ * MODULE:      AppHardwareApi.h
+ *
+ * DESCRIPTION:
+ * Host stand-in for the SDK's peripheral API, holding only what the
+ * application uses. The tick timer is simulated, see sdkstub.h.
+ *
+ ****************************************************************************/
+
+#ifndef  APPHARDWAREAPI_H_INCLUDED
+#define  APPHARDWAREAPI_H_INCLUDED
+
+#include <jendefs.h>
+
+#define E_AHI_UART_0                0
+#define E_AHI_UART_RATE_38400       4
+#define E_AHI_UART_RATE_115200      5
+#define E_AHI_UART_LS_DR            0x01
+#define E_AHI_UART_LS_THRE          0x20
+#define E_AHI_UART_LS_TEMT          0x40
+
+#define E_AHI_TICK_TIMER_DISABLE    0
+#define E_AHI_TICK_TIMER_RESTART    1
+#define E_AHI_TICK_TIMER_STOP       2
+#define E_AHI_TICK_TIMER_CONT       3
+
+#define E_AHI_WAKE_TIMER_0          0
+#define E_AHI_WAKE_TIMER_1          1
+
+#define E_AHI_SLEEP_OSCON_RAMON     0
+#define E_AHI_SLEEP_OSCON_RAMOFF    1
+
+#define E_FL_CHIP_AUTO              0
+
+PUBLIC uint32 u32AHI_Init(void);
+PUBLIC void   vAHI_WatchdogStop(void);
+PUBLIC void   vAHI_HighPowerModuleEnable(bool_t bRFTXEn, bool_t bRFRXEn);
+PUBLIC bool_t bAHI_PhyRadioSetPower(uint8 u8PowerLevel);
+
+PUBLIC void   vAHI_UartEnable(uint8 u8Uart);
+PUBLIC void   vAHI_UartReset(uint8 u8Uart, bool_t bTxReset, bool_t bRxReset);
+PUBLIC void   vAHI_UartSetClockDivisor(uint8 u8Uart, uint8 u8BaudRate);
+PUBLIC uint8  u8AHI_UartReadLineStatus(uint8 u8Uart);
+PUBLIC uint8  u8AHI_UartReadData(uint8 u8Uart);
+PUBLIC void   vAHI_UartWriteData(uint8 u8Uart, uint8 u8Data);
+
+PUBLIC void   vAHI_TickTimerConfigure(uint8 u8Mode);
+PUBLIC void   vAHI_TickTimerWrite(uint32 u32Count);
+PUBLIC uint32 u32AHI_TickTimerRead(void);
+PUBLIC void   vAHI_TickTimerIntEnable(bool_t bIntEnable);
+
+PUBLIC void   vAHI_CpuDoze(void);
+PUBLIC void   vAHI_Sleep(int eSleepMode);
+PUBLIC void   vAHI_WakeTimerEnable(uint8 u8Timer, bool_t bIntEnable);
+PUBLIC void   vAHI_WakeTimerStart(uint8 u8Timer, uint32 u32Count);
+PUBLIC bool_t bAHI_WakeTimerStop(uint8 u8Timer);
+PUBLIC uint32 u32AHI_WakeTimerCalibrate(void);
+
+PUBLIC bool_t bAHI_FlashInit(int iFlashType, void *psCustomFuncTable);
+PUBLIC bool_t bAHI_FlashEraseSector(uint8 u8Sector);
+PUBLIC bool_t bAHI_FullFlashProgram(uint32 u32Addr, uint16 u16Len, uint8 *pu8Data);
+PUBLIC bool_t bAHI_FullFlashRead(uint32 u32Addr, uint16 u16Len, uint8 *pu8Data);
+
+#endif  /* APPHARDWAREAPI_H_INCLUDED */
@@ -0,0 +1,39 @@
+/****************************************************************************
+ *
+ * MODULE:      AppQueueApi.h
+ *
+ * DESCRIPTION:
+ * Host stand-in for the SDK's MAC and hardware event queues. The queues
+ * are always empty on the host.
+ *
+ ****************************************************************************/
+
+#ifndef  APPQUEUEAPI_H_INCLUDED
+#define  APPQUEUEAPI_H_INCLUDED
+
+#include <jendefs.h>
+#include <mac_sap.h>
+
+typedef struct
+{
+    uint32  u32DeviceId;
+    uint32  u32ItemBitmap;
+} AppQApiHwInd_s;
+
+PUBLIC uint32 u32AppQApiInit(void *pvMlmeCallback, void *pvMcpsCallback, void *pvHwCallback);
+PUBLIC MAC_MlmeDcfmInd_s *psAppQApiReadMlmeInd(void);
+PUBLIC MAC_McpsDcfmInd_s *psAppQApiReadMcpsInd(void);
+PUBLIC AppQApiHwInd_s    *psAppQApiReadHwInd(void);
+PUBLIC void   vAppQApiReturnMlmeIndBuffer(MAC_MlmeDcfmInd_s *psBuffer);
+PUBLIC void   vAppQApiReturnMcpsIndBuffer(MAC_McpsDcfmInd_s *psBuffer);
+PUBLIC void   vAppQApiReturnHwIndBuffer(AppQApiHwInd_s *psBuffer);
+
+PUBLIC void  *pvAppApiGetMacHandle(void);
+PUBLIC void   vAppApiMlmeRequest(MAC_MlmeReqRsp_s *psMlmeReqRsp, MAC_MlmeSyncCfm_s *psMlmeSyncCfm);
+PUBLIC void   vAppApiMcpsRequest(MAC_McpsReqRsp_s *psMcpsReqRsp, MAC_McpsSyncCfm_s *psMcpsSyncCfm);
+PUBLIC PHY_Enum_e eAppApiPlmeSet(int eAttribute, uint32 u32Value);
+PUBLIC PHY_Enum_e eAppApiPlmeGet(int eAttribute, uint32 *pu32Value);
+PUBLIC void   vAppApiSaveMacSettings(void);
+PUBLIC void   vAppApiRestoreMacSettings(void);
+
+#endif  /* APPQUEUEAPI_H_INCLUDED */
@@ -0,0 +1,21 @@
+/****************************************************************************
+ *
+ * MODULE:      LcdDriver.h
+ *
+ * DESCRIPTION:
+ * Host stand-in for the SDK's LCD driver, see sdkstub.h.
+ *
+ ****************************************************************************/
+
+#ifndef  LCDDRIVER_H_INCLUDED
+#define  LCDDRIVER_H_INCLUDED
+
+#include <jendefs.h>
+
+PUBLIC void vLcdResetDefault(void);
+PUBLIC void vLcdClear(void);
+PUBLIC void vLcdWriteText(char *pcString, uint8 u8Row, uint8 u8Column);
+PUBLIC void vLcdWriteTextRightJustified(char *pcString, uint8 u8Row, uint8 u8Column);
+PUBLIC void vLcdRefreshAll(void);
+
+#endif  /* LCDDRIVER_H_INCLUDED */
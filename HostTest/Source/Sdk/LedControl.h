@@ -0,0 +1,19 @@
+/****************************************************************************
+ *
+ * MODULE:      LedControl.h
+ *
+ * DESCRIPTION:
+ * Host stand-in for the SDK's LED driver, see sdkstub.h.
+ *
+ ****************************************************************************/
+
+#ifndef  LEDCONTROL_H_INCLUDED
+#define  LEDCONTROL_H_INCLUDED
+
+#include <jendefs.h>
+
+PUBLIC void vLedInitRfd(void);
+PUBLIC void vLedInitFfd(void);
+PUBLIC void vLedControl(uint8 u8Led, bool_t bOn);
+
+#endif  /* LEDCONTROL_H_INCLUDED */
@@ -0,0 +1,21 @@
+/****************************************************************************
+ *
+ * MODULE:      MicroSpecific.h
+ *
+ * DESCRIPTION:
+ * Host stand-in for the SDK's processor specific macros, see sdkstub.h.
+ * Simulated interrupts are held off while masked and taken on unmasking.
+ *
+ ****************************************************************************/
+
+#ifndef  MICROSPECIFIC_H_INCLUDED
+#define  MICROSPECIFIC_H_INCLUDED
+
+#include <jendefs.h>
+
+PUBLIC void vSimMaskInterrupts(bool_t bMask);
+
+#define MICRO_DISABLE_INTERRUPTS()  vSimMaskInterrupts(TRUE)
+#define MICRO_ENABLE_INTERRUPTS()   vSimMaskInterrupts(FALSE)
+
+#endif  /* MICROSPECIFIC_H_INCLUDED */
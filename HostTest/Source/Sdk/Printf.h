@@ -0,0 +1,18 @@
+/****************************************************************************
+ *
+ * MODULE:      Printf.h
+ *
+ * DESCRIPTION:
+ * Host stand-in for the SDK's console printf, see sdkstub.h.
+ *
+ ****************************************************************************/
+
+#ifndef  PRINTF_H_INCLUDED
+#define  PRINTF_H_INCLUDED
+
+#include <jendefs.h>
+
+PUBLIC void vInitPrintf(void (*fp)(char c));
+PUBLIC void vPrintf(const char *fmt, ...);
+
+#endif  /* PRINTF_H_INCLUDED */
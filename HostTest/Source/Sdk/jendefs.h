@@ -0,0 +1,32 @@
+/****************************************************************************
+ *
+ * MODULE:      jendefs.h
+ *
+ * DESCRIPTION:
+ * Host stand-in for the SDK's basic types, see sdkstub.h.
+ *
+ ****************************************************************************/
+
+#ifndef  JENDEFS_H_INCLUDED
+#define  JENDEFS_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t     uint8;
+typedef int8_t      int8;
+typedef uint16_t    uint16;
+typedef int16_t     int16;
+typedef uint32_t    uint32;
+typedef int32_t     int32;
+typedef uint64_t    uint64;
+typedef int64_t     int64;
+typedef int         bool_t;
+
+#define TRUE        1
+#define FALSE       0
+
+#define PUBLIC
+#define PRIVATE     static
+
+#endif  /* JENDEFS_H_INCLUDED */
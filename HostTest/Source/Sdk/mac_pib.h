@@ -0,0 +1,37 @@
+/****************************************************************************
+ *
+ * MODULE:      mac_pib.h
+ *
+ * DESCRIPTION:
+ * Host stand-in for the SDK's MAC PIB access, holding only the attributes
+ * the application uses.
+ *
+ ****************************************************************************/
+
+#ifndef  MAC_PIB_H_INCLUDED
+#define  MAC_PIB_H_INCLUDED
+
+#include <jendefs.h>
+#include <mac_sap.h>
+
+typedef struct
+{
+    uint16  u16CoordShortAddr;
+    MAC_ExtAddr_s sCoordExtAddr;
+    uint16  u16ShortAddr;
+    uint16  u16PanId;
+    uint8   bAssociationPermit;
+    uint8   u8MaxFrameRetries;
+    uint8   bAutoRequest;
+    uint8   u8MaxCsmaBackoffs;
+    uint8   u8MinBe;
+    uint8   u8BeaconPayloadLength;
+    uint8   au8BeaconPayload[52];
+} MAC_Pib_s;
+
+PUBLIC MAC_Pib_s *MAC_psPibGetHandle(void *pvMac);
+PUBLIC void   MAC_vPibSetPanId(void *pvMac, uint16 u16PanId);
+PUBLIC void   MAC_vPibSetShortAddr(void *pvMac, uint16 u16ShortAddr);
+PUBLIC void   MAC_vPibSetRxOnWhenIdle(void *pvMac, bool_t bNewState, bool_t bInReset);
+
+#endif  /* MAC_PIB_H_INCLUDED */
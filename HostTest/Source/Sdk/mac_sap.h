@@ -0,0 +1,300 @@
+/****************************************************************************
+ *
+ * MODULE:      mac_sap.h
+ *
+ * DESCRIPTION:
+ * Host stand-in for the SDK's 802.15.4 MAC service access point, holding
+ * only the primitives and fields the application uses.
+ *
+ ****************************************************************************/
+
+#ifndef  MAC_SAP_H_INCLUDED
+#define  MAC_SAP_H_INCLUDED
+
+#include <jendefs.h>
+
+#define MAC_MAX_DATA_PAYLOAD_LEN            118
+
+#define MAC_ENUM_SUCCESS                    0x00
+#define MAC_ENUM_CHANNEL_ACCESS_FAILURE     0xe1
+#define MAC_ENUM_NO_ACK                     0xe9
+#define MAC_ENUM_TRANSACTION_OVERFLOW       0xf1
+
+#define MAC_TX_OPTION_ACK                   1
+#define MAC_TX_OPTION_GTS                   2
+#define MAC_TX_OPTION_INDIRECT              4
+
+#define MAC_MCPS_REQ_DATA                   0
+#define MAC_MCPS_DCFM_DATA                  0
+#define MAC_MCPS_IND_DATA                   1
+#define MAC_MCPS_CFM_OK                     1
+#define MAC_MCPS_CFM_DEFERRED               2
+
+#define MAC_MLME_REQ_SCAN                   1
+#define MAC_MLME_REQ_ASSOCIATE              2
+#define MAC_MLME_RSP_ASSOCIATE              3
+#define MAC_MLME_REQ_START                  4
+#define MAC_MLME_REQ_SYNC                   5
+#define MAC_MLME_REQ_POLL                   6
+
+#define MAC_MLME_DCFM_SCAN                  0
+#define MAC_MLME_DCFM_ASSOCIATE             2
+#define MAC_MLME_DCFM_POLL                  4
+#define MAC_MLME_IND_ASSOCIATE              5
+#define MAC_MLME_IND_DISASSOCIATE           6
+#define MAC_MLME_IND_BEACON_NOTIFY          8
+#define MAC_MLME_IND_SYNC_LOSS              10
+
+#define MAC_MLME_SCAN_TYPE_ENERGY_DETECT    0
+#define MAC_MLME_SCAN_TYPE_ACTIVE           1
+#define MAC_MLME_SCAN_TYPE_ORPHAN           3
+
+#define PHY_PIB_ATTR_CURRENT_CHANNEL        0
+#define PHY_PIB_ATTR_TX_POWER               2
+
+typedef enum
+{
+    PHY_ENUM_SUCCESS = 7
+} PHY_Enum_e;
+
+typedef struct
+{
+    uint32  u32L;
+    uint32  u32H;
+} MAC_ExtAddr_s;
+
+typedef struct
+{
+    uint8   u8AddrMode;
+    uint16  u16PanId;
+    union
+    {
+        uint16  u16Short;
+        MAC_ExtAddr_s sExt;
+    } uAddr;
+} MAC_Addr_s;
+
+/* Data service */
+typedef struct
+{
+    MAC_Addr_s sSrcAddr;
+    MAC_Addr_s sDstAddr;
+    uint8   u8TxOptions;
+    uint8   u8SduLength;
+    uint8   au8Sdu[MAC_MAX_DATA_PAYLOAD_LEN];
+} MAC_TxFrameData_s;
+
+typedef struct
+{
+    MAC_Addr_s sSrcAddr;
+    MAC_Addr_s sDstAddr;
+    uint8   u8LinkQuality;
+    uint8   u8SecurityUse;
+    uint8   u8AclEntry;
+    uint8   u8SduLength;
+    uint8   au8Sdu[MAC_MAX_DATA_PAYLOAD_LEN];
+} MAC_RxFrameData_s;
+
+typedef struct
+{
+    uint8   u8Handle;
+    MAC_TxFrameData_s sFrame;
+} MAC_McpsReqData_s;
+
+typedef struct
+{
+    uint8   u8Handle;
+    uint8   u8Status;
+} MAC_McpsCfmData_s;
+
+typedef struct
+{
+    MAC_RxFrameData_s sFrame;
+} MAC_McpsIndData_s;
+
+typedef struct
+{
+    uint8   u8Type;
+    uint8   u8ParamLength;
+    uint16  u16Pad;
+    union
+    {
+        MAC_McpsReqData_s sReqData;
+    } uParam;
+} MAC_McpsReqRsp_s;
+
+typedef struct
+{
+    uint8   u8Status;
+    uint8   u8ParamLength;
+    uint16  u16Pad;
+    union
+    {
+        MAC_McpsCfmData_s sCfmData;
+    } uParam;
+} MAC_McpsSyncCfm_s;
+
+typedef struct
+{
+    uint8   u8Type;
+    uint8   u8ParamLength;
+    uint16  u16Pad;
+    union
+    {
+        MAC_McpsCfmData_s sDcfmData;
+        MAC_McpsIndData_s sIndData;
+    } uParam;
+} MAC_McpsDcfmInd_s;
+
+/* Management service */
+typedef struct
+{
+    MAC_Addr_s sCoord;
+    uint8   u8LogicalChan;
+    uint16  u16SuperframeSpec;
+    uint8   u8GtsPermit;
+    uint8   u8LinkQuality;
+    uint32  u32TimeStamp;
+} MAC_PanDescr_s;
+
+typedef struct
+{
+    uint8   u8Status;
+    uint8   u8ScanType;
+    uint8   u8ResultListSize;
+    uint8   u8Pad;
+    uint32  u32UnscannedChannels;
+    union
+    {
+        uint8   au8EnergyDetect[16];
+        MAC_PanDescr_s asPanDescr[8];
+    } uList;
+} MAC_MlmeCfmScan_s;
+
+typedef struct
+{
+    uint8   u8Status;
+    uint16  u16AssocShortAddr;
+} MAC_MlmeCfmAssociate_s;
+
+typedef struct
+{
+    MAC_ExtAddr_s sDeviceAddr;
+    uint8   u8Capability;
+    uint8   u8SecurityUse;
+    uint8   u8AclEntry;
+} MAC_MlmeIndAssociate_s;
+
+typedef struct
+{
+    MAC_ExtAddr_s sDeviceAddr;
+    uint8   u8Reason;
+    uint8   u8SecurityUse;
+    uint8   u8AclEntry;
+} MAC_MlmeIndDisassociate_s;
+
+typedef struct
+{
+    uint8   u8BSN;
+    MAC_PanDescr_s sPANdescriptor;
+    uint8   u8SDUlength;
+    uint8   au8SDU[52];
+} MAC_MlmeIndBeacon_s;
+
+typedef struct
+{
+    uint8   u8LossReason;
+} MAC_MlmeIndSyncLoss_s;
+
+typedef struct
+{
+    uint8   u8Status;
+} MAC_MlmeCfmStart_s;
+
+typedef struct
+{
+    uint8   u8Type;
+    uint8   u8ParamLength;
+    uint16  u16Pad;
+    union
+    {
+        MAC_MlmeCfmScan_s sDcfmScan;
+        MAC_MlmeCfmAssociate_s sDcfmAssociate;
+        MAC_MlmeIndAssociate_s sIndAssociate;
+        MAC_MlmeIndDisassociate_s sIndDisassociate;
+        MAC_MlmeIndBeacon_s sIndBeacon;
+        MAC_MlmeIndSyncLoss_s sIndSyncLoss;
+        MAC_MlmeCfmStart_s sDcfmStart;
+    } uParam;
+} MAC_MlmeDcfmInd_s;
+
+typedef struct
+{
+    uint8   u8ScanType;
+    uint32  u32ScanChannels;
+    uint8   u8ScanDuration;
+} MAC_MlmeReqScan_s;
+
+typedef struct
+{
+    uint8   u8LogicalChan;
+    uint8   u8Capability;
+    uint8   u8SecurityEnable;
+    MAC_Addr_s sCoord;
+} MAC_MlmeReqAssociate_s;
+
+typedef struct
+{
+    MAC_ExtAddr_s sDeviceAddr;
+    uint16  u16AssocShortAddr;
+    uint8   u8Status;
+    uint8   u8SecurityEnable;
+} MAC_MlmeRspAssociate_s;
+
+typedef struct
+{
+    uint16  u16PanId;
+    uint8   u8Channel;
+    uint8   u8BeaconOrder;
+    uint8   u8SuperframeOrder;
+    uint8   u8PanCoordinator;
+    uint8   u8BatteryLifeExt;
+    uint8   u8Realignment;
+    uint8   u8SecurityEnable;
+} MAC_MlmeReqStart_s;
+
+typedef struct
+{
+    uint8   u8Channel;
+    uint8   u8TrackBeacon;
+} MAC_MlmeReqSync_s;
+
+typedef struct
+{
+    MAC_Addr_s sCoord;
+    uint8   u8SecurityEnable;
+} MAC_MlmeReqPoll_s;
+
+typedef struct
+{
+    uint8   u8Type;
+    uint8   u8ParamLength;
+    uint16  u16Pad;
+    union
+    {
+        MAC_MlmeReqScan_s sReqScan;
+        MAC_MlmeReqAssociate_s sReqAssociate;
+        MAC_MlmeRspAssociate_s sRspAssociate;
+        MAC_MlmeReqStart_s sReqStart;
+        MAC_MlmeReqSync_s sReqSync;
+        MAC_MlmeReqPoll_s sReqPoll;
+    } uParam;
+} MAC_MlmeReqRsp_s;
+
+typedef struct
+{
+    uint8   u8Status;
+    uint8   u8ParamLength;
+} MAC_MlmeSyncCfm_s;
+
+#endif  /* MAC_SAP_H_INCLUDED */
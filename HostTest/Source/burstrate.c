@@ -0,0 +1,251 @@
+/****************************************************************************
+ *
+ * MODULE:      burstrate.c
+ *
+ * DESCRIPTION:
+ * Runs the end device's main loop on the simulated SDK, with bAppApiGetTof
+ * completing after a set time per reading, and checks the burst rate the
+ * ranging schedule achieves against the one configured. Each case is run
+ * in its own process, from a cold start, for BURST_RUN_MS of simulated
+ * time. The rate is taken from the end device's own console line and
+ * compared with the bursts the simulated ToF engine saw started.
+ *
+ * A case whose bursts fit their period must achieve its configured rate to
+ * within BURST_RATE_TOLERANCE_PERMILLE. One whose bursts do not must report
+ * overruns and run no faster than its bursts allow.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "sdkstub.h"
+#include "enddevice.c"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+#define BURST_RUN_MS                    60000
+#define BURST_RATE_TOLERANCE_PERMILLE   5
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+typedef struct
+{
+    uint32  u32PeriodMs;
+    uint32  u32ReadingUs;
+    uint32  u32NoisePs;
+} tsBurstCase;
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE void vRunCase(const tsBurstCase *psCase);
+PRIVATE void vLine(const char *pcLine);
+PRIVATE void vEndCase(void);
+
+/****************************************************************************/
+/***        Local Variables                                               ***/
+/****************************************************************************/
+PRIVATE const tsBurstCase asCase[] =
+{
+    { 1500, 2500,  500 },
+    { 1000, 2500,  500 },
+    {  500, 2500,  500 },
+    {  100, 2500,  500 },
+    {   50, 2500, 2000 },
+};
+
+PRIVATE const tsBurstCase *psRunning;
+PRIVATE char   acBurstLine[SIM_LINE_LEN];
+PRIVATE char   acReadingsLine[SIM_LINE_LEN];
+PRIVATE uint32 u32LastStartMs;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+int main(void)
+{
+    int iFailed = 0;
+    int iStatus;
+    unsigned i;
+
+    printf("Burst rate over %d s simulated, forward bursts, adaptive length\n",
+           BURST_RUN_MS / 1000);
+    printf("%9s %9s %10s %9s %9s %10s %9s %8s\n", "period", "target", "reading",
+           "burst", "readings", "achieved", "overruns", "result");
+
+    for (i = 0; i < sizeof(asCase) / sizeof(asCase[0]); i++)
+    {
+        fflush(stdout);
+        if (fork() == 0)
+        {
+            vRunCase(&asCase[i]);
+        }
+        (void)wait(&iStatus);
+        if (!WIFEXITED(iStatus) || (WEXITSTATUS(iStatus) != 0))
+        {
+            iFailed++;
+        }
+    }
+
+    return (iFailed == 0) ? 0 : 1;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vRunCase
+ *
+ * DESCRIPTION:
+ * Starts the end device as if just associated and runs its main loop until
+ * vEndCase ends the process.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psCase          R   Case to run
+ *
+ * RETURNS: Does not return
+ *
+ ****************************************************************************/
+PRIVATE void vRunCase(const tsBurstCase *psCase)
+{
+    int b;
+
+    psRunning = psCase;
+    vSimReset(12345);
+    sSimTof.u32ReadingUs = psCase->u32ReadingUs;
+    sSimTof.u32NoisePs   = psCase->u32NoisePs;
+    prSimLine = vLine;
+
+    for (b = 0; b < TOF_BUFFERS; b++)
+    {
+        asTofBuffer[b].eState = E_TOF_BUFFER_FREE;
+    }
+    vInitSystem();
+    vInitRangingSchedule(psCase->u32PeriodMs);
+    vAppApiTofInit(TRUE);
+
+    sEndDeviceData.eState     = E_STATE_ASSOCIATED;
+    sEndDeviceData.u16Address = END_DEVICE_START_ADR;
+
+    vSimStopAt(BURST_RUN_MS, vEndCase);
+    vMainLoop();
+}
+
+/****************************************************************************
+ *
+ * NAME: vLine
+ *
+ * DESCRIPTION:
+ * Keeps the end device's latest burst and readings reports.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pcLine          R   Console line
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vLine(const char *pcLine)
+{
+    unsigned uBurst, uStartMs;
+
+    if (sscanf(pcLine, "Burst %u: start %ums", &uBurst, &uStartMs) == 2)
+    {
+        strncpy(acBurstLine, pcLine, sizeof(acBurstLine) - 1);
+        u32LastStartMs = uStartMs;
+    }
+    else if (strncmp(pcLine, "Readings: ", 10) == 0)
+    {
+        strncpy(acReadingsLine, pcLine, sizeof(acReadingsLine) - 1);
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: vEndCase
+ *
+ * DESCRIPTION:
+ * Compares the rate the end device reports with the configured rate and
+ * with the bursts the simulated engine saw, then ends the process.
+ *
+ * RETURNS: Does not return
+ *
+ ****************************************************************************/
+PRIVATE void vEndCase(void)
+{
+    const tsBurstCase *psCase = psRunning;
+    uint32 u32Bursts = sRangingSchedule.u32BurstsCompleted;
+    uint32 u32TargetMilliHz = 1000000UL / psCase->u32PeriodMs;
+    uint32 u32RateMilliHz;
+    uint32 u32MaxMilliHz;
+    uint32 u32BurstUs;
+    uint32 u32Readings;
+    uint32 u32AverageX100;
+    const char *pcRate;
+    const char *pcAverage;
+    char acRate[32];
+    char acAverage[32];
+    bool_t bPass;
+
+    if ((u32Bursts < 2) || (u32LastStartMs == sRangingSchedule.u32FirstStartMs))
+    {
+        printf("%7dms: too few bursts\n", psCase->u32PeriodMs);
+        exit(1);
+    }
+
+    /* Start-to-start rate, as the end device measures it */
+    u32RateMilliHz = (uint32)(((uint64)(u32Bursts - 1) * 1000000ULL) /
+                              (u32LastStartMs - sRangingSchedule.u32FirstStartMs));
+    u32Readings = sRangingSchedule.u32ReadingsTaken / u32Bursts;
+    u32AverageX100 = sRangingSchedule.u32ReadingsTaken * 100 / u32Bursts;
+    u32BurstUs  = (sSimTof.u32Requests * sSimTof.u32RequestUs +
+                   sSimTof.u32Readings * sSimTof.u32ReadingUs) / u32Bursts;
+
+    /* The end device's lines must agree, fractions padded */
+    pcRate = strstr(acBurstLine, "rate ");
+    snprintf(acRate, sizeof(acRate), "rate %u.%03uHz", u32RateMilliHz / 1000, u32RateMilliHz % 1000);
+    pcAverage = strstr(acReadingsLine, "average ");
+    snprintf(acAverage, sizeof(acAverage), "average %u.%02u", u32AverageX100 / 100, u32AverageX100 % 100);
+
+    if ((u32BurstUs / 1000) < psCase->u32PeriodMs)
+    {
+        bPass = (sRangingSchedule.u32Overruns == 0) &&
+                ((uint32)abs((int)(u32RateMilliHz - u32TargetMilliHz)) * 1000 <=
+                 u32TargetMilliHz * BURST_RATE_TOLERANCE_PERMILLE);
+    }
+    else
+    {
+        u32MaxMilliHz = (uint32)(1000000000ULL / u32BurstUs);
+        bPass = (sRangingSchedule.u32Overruns > 0) && (u32RateMilliHz <= u32MaxMilliHz);
+    }
+    bPass = bPass && (pcRate != NULL) && (strncmp(pcRate, acRate, strlen(acRate)) == 0);
+    bPass = bPass && (pcAverage != NULL) && (strcmp(pcAverage, acAverage) == 0);
+
+    printf("%7dms %5d.%03dHz %8dus %7dms %9d %6d.%03dHz %9d %8s\n",
+           psCase->u32PeriodMs,
+           u32TargetMilliHz / 1000, u32TargetMilliHz % 1000,
+           psCase->u32ReadingUs,
+           u32BurstUs / 1000,
+           u32Readings,
+           u32RateMilliHz / 1000, u32RateMilliHz % 1000,
+           sRangingSchedule.u32Overruns,
+           bPass ? "pass" : "FAIL");
+    printf("    end device: %s\n", acBurstLine);
+    printf("    end device: %s\n", acReadingsLine);
+
+    exit(bPass ? 0 : 1);
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,256 @@
+/****************************************************************************
+ *
+ * MODULE:      mathbench.c
+ *
+ * DESCRIPTION:
+ * Compares the coordinator's fixed point positioning with the double and
+ * libm maths it replaced, see mathold.c, for cost and for results.
+ *
+ * The original layout is used: beacons at (0, 0) and (120, 0) and the tag
+ * on the positive side, ranged to the nearest centimetre from MATH_POINTS
+ * positions within a 120 x 150 cm room, where the original's int32 Heron
+ * product does not overflow. Each is scored by its largest error from the
+ * true position on either axis, as truncated for display; the original
+ * halves the perimeter in integers, so it is not itself exact. The fixed
+ * point solver must be no worse than the original. The square roots of
+ * squared distances, both under and over 32 bits, must match floor(sqrt()).
+ *
+ * Cycles are host cycles, each a whole batch over the inputs divided by
+ * their number. The host runs double in its floating point unit and
+ * links libm dynamically, so neither the cycles nor the section sizes the
+ * Makefile prints for mathold.o count the soft float and libm code the
+ * JN5148 build linked; they are proxies, not target figures.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <jendefs.h>
+#include "fixedpoint.h"
+#include "multilat.h"
+#include "mathold.h"
+#include "sdkstub.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+#define MATH_POINTS                 10000
+#define MATH_ROOTS                  100000
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE bool_t bBenchPosition(void);
+PRIVATE int32  i32Error(int32 i32X, int32 i32Y, int p);
+PRIVATE bool_t bBenchSqrt(const char *pcName, uint64 u64Max);
+
+/****************************************************************************/
+/***        Local Variables                                               ***/
+/****************************************************************************/
+PRIVATE int32  ai32RangeA[MATH_POINTS];
+PRIVATE int32  ai32RangeB[MATH_POINTS];
+PRIVATE int32  ai32TrueX[MATH_POINTS];
+PRIVATE int32  ai32TrueY[MATH_POINTS];
+PRIVATE double adOldX[MATH_POINTS];
+PRIVATE double adOldY[MATH_POINTS];
+PRIVATE tsMultilatFix asFix[MATH_POINTS];
+PRIVATE uint64 au64Square[MATH_ROOTS];
+PRIVATE uint32 au32Root[3][MATH_ROOTS];
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+int main(void)
+{
+    bool_t bPass = TRUE;
+
+    srand(2021);
+
+    printf("Positioning maths, double and libm against fixed point\n");
+    printf("%-12s %12s %12s %12s %8s %12s %8s\n", "", "double cyc", "old int cyc", "fixed cyc",
+           "ratio", "max err/diff", "result");
+
+    bPass &= bBenchPosition();
+    bPass &= bBenchSqrt("sqrt <2^32", 0xffffffffULL);
+    bPass &= bBenchSqrt("sqrt <2^40", 0xffffffffffULL);
+
+    return bPass ? 0 : 1;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: bBenchPosition
+ *
+ * DESCRIPTION:
+ * Solves each position the original way and with bMultilatSolve.
+ *
+ * RETURNS: bool_t TRUE if bMultilatSolve is no further from the truth
+ *
+ ****************************************************************************/
+PRIVATE bool_t bBenchPosition(void)
+{
+    tsMultilatRange asRange[2] = { { { { 0, 0, 0 } }, 0 },
+                                   { { { MATH_OLD_BASELINE_CM, 0, 0 } }, 0 } };
+    uint64 u64OldCycles;
+    uint64 u64NewCycles;
+    uint64 u64Start;
+    int32  i32OldErr = 0;
+    int32  i32NewErr = 0;
+    int32  i32X, i32Y;
+    bool_t bPass;
+    int p;
+
+    for (p = 0; p < MATH_POINTS; p++)
+    {
+        i32X = rand() % (MATH_OLD_BASELINE_CM + 1);
+        i32Y = 20 + rand() % 131;
+        ai32TrueX[p] = i32X;
+        ai32TrueY[p] = i32Y;
+        ai32RangeA[p] = (int32)lround(sqrt((double)i32X * i32X + (double)i32Y * i32Y));
+        i32X -= MATH_OLD_BASELINE_CM;
+        ai32RangeB[p] = (int32)lround(sqrt((double)i32X * i32X + (double)i32Y * i32Y));
+    }
+
+    u64Start = u64HostCycles();
+    for (p = 0; p < MATH_POINTS; p++)
+    {
+        vMathOldTriangle(ai32RangeA[p], ai32RangeB[p], &adOldX[p], &adOldY[p]);
+    }
+    u64OldCycles = u64HostCycles() - u64Start;
+
+    u64Start = u64HostCycles();
+    for (p = 0; p < MATH_POINTS; p++)
+    {
+        asRange[0].i32RangeCm = ai32RangeA[p];
+        asRange[1].i32RangeCm = ai32RangeB[p];
+        (void)bMultilatSolve(asRange, 2, 2, &asFix[p]);
+    }
+    u64NewCycles = u64HostCycles() - u64Start;
+
+    for (p = 0; p < MATH_POINTS; p++)
+    {
+        /* The original truncated to int for display and the LCD */
+        if (i32Error((int32)adOldX[p], (int32)adOldY[p], p) > i32OldErr)
+        {
+            i32OldErr = i32Error((int32)adOldX[p], (int32)adOldY[p], p);
+        }
+        if (i32Error(asFix[p].sPos.ai32Cm[0], asFix[p].sPos.ai32Cm[1], p) > i32NewErr)
+        {
+            i32NewErr = i32Error(asFix[p].sPos.ai32Cm[0], asFix[p].sPos.ai32Cm[1], p);
+        }
+    }
+
+    bPass = (i32NewErr <= i32OldErr);
+    printf("%-12s %12llu %12s %12llu %7.2fx %4d/%3dcm %8s\n", "position",
+           (unsigned long long)(u64OldCycles / MATH_POINTS), "-",
+           (unsigned long long)(u64NewCycles / MATH_POINTS),
+           (double)u64OldCycles / (double)u64NewCycles, i32OldErr, i32NewErr, bPass ? "pass" : "FAIL");
+
+    return bPass;
+}
+
+/****************************************************************************
+ *
+ * NAME: i32Error
+ *
+ * DESCRIPTION:
+ * Distance of a solved position from the true one, on the worse axis.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  i32X            R   Solved x (cm)
+ *                  i32Y            R   Solved y (cm)
+ *                  p               R   Index of the true position
+ *
+ * RETURNS: int32 error (cm)
+ *
+ ****************************************************************************/
+PRIVATE int32 i32Error(int32 i32X, int32 i32Y, int p)
+{
+    int32 i32ErrX = abs(i32X - ai32TrueX[p]);
+    int32 i32ErrY = abs(i32Y - ai32TrueY[p]);
+
+    return (i32ErrX > i32ErrY) ? i32ErrX : i32ErrY;
+}
+
+/****************************************************************************
+ *
+ * NAME: bBenchSqrt
+ *
+ * DESCRIPTION:
+ * Takes square roots of squared distances in double, by the 64 bit only
+ * integer root and by u32FixedSqrt64.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pcName          R   Name of the set
+ *                  u64Max          R   Largest square
+ *
+ * RETURNS: bool_t TRUE if every root is floor(sqrt())
+ *
+ ****************************************************************************/
+PRIVATE bool_t bBenchSqrt(const char *pcName, uint64 u64Max)
+{
+    uint64 au64Cycles[3];
+    uint64 u64Start;
+    uint32 u32Mismatch = 0;
+    uint64 u64Root;
+    bool_t bPass;
+    int r;
+
+    for (r = 0; r < MATH_ROOTS; r++)
+    {
+        au64Square[r] = (((uint64)rand() << 31) ^ (uint64)rand() ^ ((uint64)rand() << 20)) % (u64Max + 1);
+    }
+
+    u64Start = u64HostCycles();
+    for (r = 0; r < MATH_ROOTS; r++)
+    {
+        au32Root[0][r] = (uint32)sqrt((double)au64Square[r]);
+    }
+    au64Cycles[0] = u64HostCycles() - u64Start;
+
+    u64Start = u64HostCycles();
+    for (r = 0; r < MATH_ROOTS; r++)
+    {
+        au32Root[1][r] = u32MathOldSqrt64(au64Square[r]);
+    }
+    au64Cycles[1] = u64HostCycles() - u64Start;
+
+    u64Start = u64HostCycles();
+    for (r = 0; r < MATH_ROOTS; r++)
+    {
+        au32Root[2][r] = u32FixedSqrt64(au64Square[r]);
+    }
+    au64Cycles[2] = u64HostCycles() - u64Start;
+
+    for (r = 0; r < MATH_ROOTS; r++)
+    {
+        u64Root = au32Root[2][r];
+        if ((u64Root * u64Root > au64Square[r]) || ((u64Root + 1) * (u64Root + 1) <= au64Square[r]) ||
+            (au32Root[1][r] != au32Root[2][r]))
+        {
+            u32Mismatch++;
+        }
+    }
+
+    bPass = (u32Mismatch == 0);
+    printf("%-12s %12llu %12llu %12llu %7.2fx %12d %8s\n", pcName,
+           (unsigned long long)(au64Cycles[0] / MATH_ROOTS),
+           (unsigned long long)(au64Cycles[1] / MATH_ROOTS),
+           (unsigned long long)(au64Cycles[2] / MATH_ROOTS),
+           (double)au64Cycles[1] / (double)au64Cycles[2], u32Mismatch, bPass ? "pass" : "FAIL");
+
+    return bPass;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
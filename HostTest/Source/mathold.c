@@ -0,0 +1,97 @@
+/****************************************************************************
+ *
+ * MODULE:      mathold.c
+ *
+ * DESCRIPTION:
+ * The coordinator's positioning maths as it was before double and libm
+ * were dropped: the original two beacon triangle solution, by Heron's
+ * formula in double with sqrt and pow, and the integer square root before
+ * it gained its 32 bit path. Kept in a module of its own so its size can
+ * be compared with that of the fixed point path.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <math.h>
+#include <jendefs.h>
+#include "mathold.h"
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vMathOldTriangle
+ *
+ * DESCRIPTION:
+ * Position from the ranges to beacons at (0, 0) and (120, 0), as the
+ * original task_CalculateXYPos found it, without its printing.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  a               R   Range to the first beacon (cm)
+ *                  b               R   Range to the second beacon (cm)
+ *                  pdX             W   x (cm)
+ *                  pdY             W   y (cm)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vMathOldTriangle(int32 a, int32 b, double *pdX, double *pdY)
+{
+    int32 c = (int32)MATH_OLD_BASELINE_CM;
+    int32 s = (a + b + c) / 2;
+    int32 n = s * (s-a) * (s-b) * (s-c);
+    double y = 2 * sqrt(n) / c;
+    double x = sqrt(pow(a, 2) - pow(y, 2));
+
+    *pdX = x;
+    *pdY = y;
+}
+
+/****************************************************************************
+ *
+ * NAME: u32MathOldSqrt64
+ *
+ * DESCRIPTION:
+ * u32FixedSqrt64 before its 32 bit path: the 64 bit digit-by-digit method
+ * for every argument.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u64Value        R   Value to take the root of
+ *
+ * RETURNS: uint32 floor(sqrt(u64Value))
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32MathOldSqrt64(uint64 u64Value)
+{
+    uint64 u64Root = 0;
+    uint64 u64Bit  = 1uLL << 62;
+
+    while (u64Bit > u64Value)
+    {
+        u64Bit >>= 2;
+    }
+
+    while (u64Bit != 0)
+    {
+        if (u64Value >= u64Root + u64Bit)
+        {
+            u64Value -= u64Root + u64Bit;
+            u64Root   = (u64Root >> 1) + u64Bit;
+        }
+        else
+        {
+            u64Root >>= 1;
+        }
+        u64Bit >>= 2;
+    }
+
+    return (uint32)u64Root;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,27 @@
+/****************************************************************************
+ *
+ * MODULE:      mathold.h
+ *
+ * DESCRIPTION:
+ * The coordinator's positioning maths as it was before double and libm
+ * were dropped, kept for comparison with the fixed point path, see
+ * mathbench.c.
+ *
+ ****************************************************************************/
+
+#ifndef  MATHOLD_H_INCLUDED
+#define  MATHOLD_H_INCLUDED
+
+#include <jendefs.h>
+
+/* Separation of the two beacons of the original layout (cm) */
+#define MATH_OLD_BASELINE_CM        120
+
+PUBLIC void   vMathOldTriangle(int32 a, int32 b, double *pdX, double *pdY);
+PUBLIC uint32 u32MathOldSqrt64(uint64 u64Value);
+
+#endif  /* MATHOLD_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
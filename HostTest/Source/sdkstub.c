@@ -0,0 +1,735 @@
+/****************************************************************************
+ *
+ * MODULE:      sdkstub.c
+ *
+ * DESCRIPTION:
+ * Simulated JN5148 SDK for host builds, see sdkstub.h.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <jendefs.h>
+#include <AppHardwareApi.h>
+#include <AppQueueApi.h>
+#include <AppApiTof.h>
+#include <mac_sap.h>
+#include <mac_pib.h>
+#include <LedControl.h>
+#include <LcdDriver.h>
+#include <Printf.h>
+#include "sdkstub.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+#define SIM_FLASH_SECTORS           8
+#define SIM_FLASH_SECTOR_SIZE       0x10000UL
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE void   vRunDue(void);
+PRIVATE uint32 u32Random(void);
+PRIVATE void   vPutChar(char c);
+PRIVATE void   vPutNumber(uint32 u32Value, uint8 u8Base, bool_t bNegative);
+
+/****************************************************************************/
+/***        Exported Variables                                            ***/
+/****************************************************************************/
+PUBLIC tsSimTof sSimTof;
+PUBLIC bool_t   bSimEcho;
+PUBLIC void   (*prSimLine)(const char *pcLine);
+
+/****************************************************************************/
+/***        Local Variables                                               ***/
+/****************************************************************************/
+PRIVATE uint64 u64Ticks;            /* Simulated time, never wraps */
+PRIVATE uint32 u32TimerBase;        /* Tick timer count at u64TimerStart */
+PRIVATE uint64 u64TimerStart;
+PRIVATE uint64 u64StopTicks;
+PRIVATE void (*prStopAt)(void);
+PRIVATE uint32 u32Seed;
+
+/* ToF request in progress */
+PRIVATE bool_t bTofBusy;
+PRIVATE uint64 u64TofDoneTicks;
+PRIVATE tsAppApiTof_Data *psTofData;
+PRIVATE uint8  u8TofReadings;
+PRIVATE PR_GET_TOF_CALLBACK prTofCallback;
+PRIVATE bool_t bInInterrupt;
+PRIVATE bool_t bMasked;             /* Interrupts held off */
+
+PRIVATE uint8  au8Flash[SIM_FLASH_SECTORS * SIM_FLASH_SECTOR_SIZE];
+PRIVATE MAC_Pib_s sPib;
+PRIVATE char   acLine[SIM_LINE_LEN];
+PRIVATE uint16 u16LineLen;
+
+/****************************************************************************/
+/***        Simulation                                                    ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vSimReset
+ *
+ * DESCRIPTION:
+ * Starts the simulation again from time zero, with flash erased and the
+ * ToF engine idle, taking 2.5ms per reading 10m away by default.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32NewSeed      R   Seed of the reading noise
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vSimReset(uint32 u32NewSeed)
+{
+    u64Ticks      = 0;
+    u32TimerBase  = 0;
+    u64TimerStart = 0;
+    u64StopTicks  = 0;
+    prStopAt      = NULL;
+    u32Seed       = u32NewSeed;
+    bTofBusy      = FALSE;
+    bInInterrupt  = FALSE;
+    bMasked       = FALSE;
+    u16LineLen    = 0;
+
+    sSimTof.u32RequestUs  = 2000;
+    sSimTof.u32ReadingUs  = 2500;
+    sSimTof.i32TofPs      = 33356;
+    sSimTof.u32NoisePs    = 500;
+    sSimTof.u8FailPercent = 0;
+    sSimTof.u32Requests   = 0;
+    sSimTof.u32Readings   = 0;
+
+    memset(au8Flash, 0xff, sizeof(au8Flash));
+    memset(&sPib, 0, sizeof(sPib));
+}
+
+/****************************************************************************
+ *
+ * NAME: u32SimNowMs
+ *
+ * DESCRIPTION:
+ * Simulated time since vSimReset, without moving it on.
+ *
+ * RETURNS: uint32 time (ms)
+ *
+ ****************************************************************************/
+PUBLIC uint32 u32SimNowMs(void)
+{
+    return (uint32)(u64Ticks / SIM_TICKS_PER_MS);
+}
+
+/****************************************************************************
+ *
+ * NAME: vSimStopAt
+ *
+ * DESCRIPTION:
+ * Calls a function, which must not return, once simulated time reaches a
+ * given time. This ends a run of the application's main loop.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32EndMs        R   Time to stop (ms)
+ *                  prStop          R   Function to call
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vSimStopAt(uint32 u32EndMs, void (*prStop)(void))
+{
+    u64StopTicks = (uint64)u32EndMs * SIM_TICKS_PER_MS;
+    prStopAt     = prStop;
+}
+
+/****************************************************************************
+ *
+ * NAME: i32SimGaussian
+ *
+ * DESCRIPTION:
+ * Approximately normal noise, as the sum of twelve uniform values.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32StdDev       R   Standard deviation
+ *
+ * RETURNS: int32 sample
+ *
+ ****************************************************************************/
+PUBLIC int32 i32SimGaussian(uint32 u32StdDev)
+{
+    int64 i64Sum = 0;
+    int i;
+
+    /* Each term is uniform on [0, 65536), so the sum has mean 6 x 65536
+       and standard deviation 65536 */
+    for (i = 0; i < 12; i++)
+    {
+        i64Sum += u32Random() >> 16;
+    }
+
+    return (int32)(((i64Sum - 6 * 65536LL) * (int64)u32StdDev) / 65536);
+}
+
+/****************************************************************************
+ *
+ * NAME: u64HostCycles
+ *
+ * DESCRIPTION:
+ * Host cycle counter for benchmarks, or nanoseconds where there is none.
+ *
+ * RETURNS: uint64 count
+ *
+ ****************************************************************************/
+PUBLIC uint64 u64HostCycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint32 u32Lo, u32Hi;
+
+    __asm__ __volatile__("rdtsc" : "=a"(u32Lo), "=d"(u32Hi));
+    return ((uint64)u32Hi << 32) | u32Lo;
+#else
+    struct timespec sNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &sNow);
+    return (uint64)sNow.tv_sec * 1000000000ULL + (uint64)sNow.tv_nsec;
+#endif
+}
+
+/****************************************************************************/
+/***        Tick timer, sleep and wake timers                             ***/
+/****************************************************************************/
+
+PUBLIC void vAHI_TickTimerConfigure(uint8 u8Mode)
+{
+}
+
+PUBLIC void vAHI_TickTimerWrite(uint32 u32Count)
+{
+    u32TimerBase  = u32Count;
+    u64TimerStart = u64Ticks;
+}
+
+PUBLIC uint32 u32AHI_TickTimerRead(void)
+{
+    if (!bInInterrupt)
+    {
+        u64Ticks += SIM_TICKS_PER_READ;
+        vRunDue();
+    }
+
+    return u32TimerBase + (uint32)(u64Ticks - u64TimerStart);
+}
+
+PUBLIC void vAHI_TickTimerIntEnable(bool_t bIntEnable)
+{
+}
+
+/* Interrupts raised while masked are taken on unmasking */
+PUBLIC void vSimMaskInterrupts(bool_t bMask)
+{
+    bMasked = bMask;
+    if (!bMasked)
+    {
+        vRunDue();
+    }
+}
+
+/* A doze lasts until the next simulated event, here the ToF completion,
+   which ends it whether or not interrupts are masked */
+PUBLIC void vAHI_CpuDoze(void)
+{
+    if (bTofBusy && (u64TofDoneTicks > u64Ticks))
+    {
+        u64Ticks = u64TofDoneTicks;
+    }
+    vRunDue();
+}
+
+PUBLIC void vAHI_Sleep(int eSleepMode)
+{
+    fprintf(stderr, "vAHI_Sleep is not simulated\n");
+}
+
+PUBLIC void vAHI_WakeTimerEnable(uint8 u8Timer, bool_t bIntEnable)
+{
+}
+
+PUBLIC void vAHI_WakeTimerStart(uint8 u8Timer, uint32 u32Count)
+{
+}
+
+PUBLIC bool_t bAHI_WakeTimerStop(uint8 u8Timer)
+{
+    return TRUE;
+}
+
+PUBLIC uint32 u32AHI_WakeTimerCalibrate(void)
+{
+    return 10000;
+}
+
+/****************************************************************************/
+/***        Time of flight                                                ***/
+/****************************************************************************/
+
+PUBLIC void vAppApiTofInit(bool_t bEnable)
+{
+}
+
+PUBLIC bool_t bAppApiGetTof(tsAppApiTof_Data *psData, MAC_Addr_s *psAddr, uint8 u8Readings,
+                            eTofDirection eDirection, PR_GET_TOF_CALLBACK prCallback)
+{
+    if (bTofBusy || (u8Readings == 0))
+    {
+        return FALSE;
+    }
+
+    bTofBusy        = TRUE;
+    psTofData       = psData;
+    u8TofReadings   = u8Readings;
+    prTofCallback   = prCallback;
+    u64TofDoneTicks = u64Ticks +
+        ((uint64)sSimTof.u32RequestUs + (uint64)sSimTof.u32ReadingUs * u8Readings) *
+        SIM_TICKS_PER_MS / 1000;
+    sSimTof.u32Requests++;
+
+    return TRUE;
+}
+
+/****************************************************************************/
+/***        Remaining peripherals                                         ***/
+/****************************************************************************/
+
+PUBLIC uint32 u32AHI_Init(void)
+{
+    return 1;
+}
+
+PUBLIC void vAHI_WatchdogStop(void)
+{
+}
+
+PUBLIC void vAHI_HighPowerModuleEnable(bool_t bRFTXEn, bool_t bRFRXEn)
+{
+}
+
+PUBLIC bool_t bAHI_PhyRadioSetPower(uint8 u8PowerLevel)
+{
+    return TRUE;
+}
+
+PUBLIC void vAHI_UartEnable(uint8 u8Uart)
+{
+}
+
+PUBLIC void vAHI_UartReset(uint8 u8Uart, bool_t bTxReset, bool_t bRxReset)
+{
+}
+
+PUBLIC void vAHI_UartSetClockDivisor(uint8 u8Uart, uint8 u8BaudRate)
+{
+}
+
+/* Transmit always empty, nothing received */
+PUBLIC uint8 u8AHI_UartReadLineStatus(uint8 u8Uart)
+{
+    return E_AHI_UART_LS_THRE | E_AHI_UART_LS_TEMT;
+}
+
+PUBLIC uint8 u8AHI_UartReadData(uint8 u8Uart)
+{
+    return 0;
+}
+
+PUBLIC void vAHI_UartWriteData(uint8 u8Uart, uint8 u8Data)
+{
+}
+
+PUBLIC bool_t bAHI_FlashInit(int iFlashType, void *psCustomFuncTable)
+{
+    return TRUE;
+}
+
+PUBLIC bool_t bAHI_FlashEraseSector(uint8 u8Sector)
+{
+    if (u8Sector >= SIM_FLASH_SECTORS)
+    {
+        return FALSE;
+    }
+    memset(&au8Flash[u8Sector * SIM_FLASH_SECTOR_SIZE], 0xff, SIM_FLASH_SECTOR_SIZE);
+    return TRUE;
+}
+
+/* Programming can only clear bits, as on the device */
+PUBLIC bool_t bAHI_FullFlashProgram(uint32 u32Addr, uint16 u16Len, uint8 *pu8Data)
+{
+    uint16 n;
+
+    if (u32Addr + u16Len > sizeof(au8Flash))
+    {
+        return FALSE;
+    }
+    for (n = 0; n < u16Len; n++)
+    {
+        au8Flash[u32Addr + n] &= pu8Data[n];
+    }
+    return TRUE;
+}
+
+PUBLIC bool_t bAHI_FullFlashRead(uint32 u32Addr, uint16 u16Len, uint8 *pu8Data)
+{
+    if (u32Addr + u16Len > sizeof(au8Flash))
+    {
+        return FALSE;
+    }
+    memcpy(pu8Data, &au8Flash[u32Addr], u16Len);
+    return TRUE;
+}
+
+/****************************************************************************/
+/***        MAC                                                           ***/
+/****************************************************************************/
+
+PUBLIC uint32 u32AppQApiInit(void *pvMlmeCallback, void *pvMcpsCallback, void *pvHwCallback)
+{
+    return 1;
+}
+
+PUBLIC MAC_MlmeDcfmInd_s *psAppQApiReadMlmeInd(void)
+{
+    return NULL;
+}
+
+PUBLIC MAC_McpsDcfmInd_s *psAppQApiReadMcpsInd(void)
+{
+    return NULL;
+}
+
+PUBLIC AppQApiHwInd_s *psAppQApiReadHwInd(void)
+{
+    return NULL;
+}
+
+PUBLIC void vAppQApiReturnMlmeIndBuffer(MAC_MlmeDcfmInd_s *psBuffer)
+{
+}
+
+PUBLIC void vAppQApiReturnMcpsIndBuffer(MAC_McpsDcfmInd_s *psBuffer)
+{
+}
+
+PUBLIC void vAppQApiReturnHwIndBuffer(AppQApiHwInd_s *psBuffer)
+{
+}
+
+PUBLIC void *pvAppApiGetMacHandle(void)
+{
+    return &sPib;
+}
+
+PUBLIC void vAppApiMlmeRequest(MAC_MlmeReqRsp_s *psMlmeReqRsp, MAC_MlmeSyncCfm_s *psMlmeSyncCfm)
+{
+    psMlmeSyncCfm->u8Status = MAC_ENUM_SUCCESS;
+}
+
+/* Every frame is delivered at once */
+PUBLIC void vAppApiMcpsRequest(MAC_McpsReqRsp_s *psMcpsReqRsp, MAC_McpsSyncCfm_s *psMcpsSyncCfm)
+{
+    psMcpsSyncCfm->u8Status = MAC_MCPS_CFM_OK;
+    psMcpsSyncCfm->uParam.sCfmData.u8Handle = psMcpsReqRsp->uParam.sReqData.u8Handle;
+    psMcpsSyncCfm->uParam.sCfmData.u8Status = MAC_ENUM_SUCCESS;
+}
+
+PUBLIC PHY_Enum_e eAppApiPlmeSet(int eAttribute, uint32 u32Value)
+{
+    return PHY_ENUM_SUCCESS;
+}
+
+PUBLIC PHY_Enum_e eAppApiPlmeGet(int eAttribute, uint32 *pu32Value)
+{
+    *pu32Value = 0;
+    return PHY_ENUM_SUCCESS;
+}
+
+PUBLIC void vAppApiSaveMacSettings(void)
+{
+}
+
+PUBLIC void vAppApiRestoreMacSettings(void)
+{
+}
+
+PUBLIC MAC_Pib_s *MAC_psPibGetHandle(void *pvMac)
+{
+    return &sPib;
+}
+
+PUBLIC void MAC_vPibSetPanId(void *pvMac, uint16 u16PanId)
+{
+    sPib.u16PanId = u16PanId;
+}
+
+PUBLIC void MAC_vPibSetShortAddr(void *pvMac, uint16 u16ShortAddr)
+{
+    sPib.u16ShortAddr = u16ShortAddr;
+}
+
+PUBLIC void MAC_vPibSetRxOnWhenIdle(void *pvMac, bool_t bNewState, bool_t bInReset)
+{
+}
+
+/****************************************************************************/
+/***        LEDs, LCD and console                                         ***/
+/****************************************************************************/
+
+PUBLIC void vLedInitRfd(void)
+{
+}
+
+PUBLIC void vLedInitFfd(void)
+{
+}
+
+PUBLIC void vLedControl(uint8 u8Led, bool_t bOn)
+{
+}
+
+PUBLIC void vLcdResetDefault(void)
+{
+}
+
+PUBLIC void vLcdClear(void)
+{
+}
+
+PUBLIC void vLcdWriteText(char *pcString, uint8 u8Row, uint8 u8Column)
+{
+}
+
+PUBLIC void vLcdWriteTextRightJustified(char *pcString, uint8 u8Row, uint8 u8Column)
+{
+}
+
+PUBLIC void vLcdRefreshAll(void)
+{
+}
+
+PUBLIC void vInitPrintf(void (*fp)(char c))
+{
+}
+
+/****************************************************************************
+ *
+ * NAME: vPrintf
+ *
+ * DESCRIPTION:
+ * Console output with the SDK's conversions. Flags and field widths are
+ * skipped, as the SDK does, so %02d converts as %d.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pcFormat        R   Format
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PUBLIC void vPrintf(const char *pcFormat, ...)
+{
+    va_list ap;
+    const char *pcStr;
+    int32 i32Value;
+
+    va_start(ap, pcFormat);
+    for (; *pcFormat != '\0'; pcFormat++)
+    {
+        if (*pcFormat != '%')
+        {
+            vPutChar(*pcFormat);
+            continue;
+        }
+
+        pcFormat++;
+        while ((*pcFormat == '0') || (*pcFormat == '-') ||
+               ((*pcFormat >= '1') && (*pcFormat <= '9')))
+        {
+            pcFormat++;
+        }
+
+        switch (*pcFormat)
+        {
+        case 'd':
+        case 'i':
+            i32Value = va_arg(ap, int32);
+            vPutNumber((i32Value < 0) ? (uint32)0 - (uint32)i32Value : (uint32)i32Value,
+                       10, i32Value < 0);
+            break;
+        case 'u':
+            vPutNumber(va_arg(ap, uint32), 10, FALSE);
+            break;
+        case 'x':
+        case 'X':
+            vPutNumber(va_arg(ap, uint32), 16, FALSE);
+            break;
+        case 'c':
+            vPutChar((char)va_arg(ap, int));
+            break;
+        case 's':
+            for (pcStr = va_arg(ap, const char *); *pcStr != '\0'; pcStr++)
+            {
+                vPutChar(*pcStr);
+            }
+            break;
+        case '\0':
+            pcFormat--;
+            break;
+        default:
+            vPutChar(*pcFormat);
+            break;
+        }
+    }
+    va_end(ap);
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: vRunDue
+ *
+ * DESCRIPTION:
+ * Completes a ToF request whose time has come, calling back as from the
+ * interrupt, then stops the run if its time has come.
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vRunDue(void)
+{
+    uint8 n;
+
+    if (bTofBusy && !bMasked && (u64Ticks >= u64TofDoneTicks))
+    {
+        for (n = 0; n < u8TofReadings; n++)
+        {
+            memset(&psTofData[n], 0, sizeof(tsAppApiTof_Data));
+            psTofData[n].s32Tof       = sSimTof.i32TofPs + i32SimGaussian(sSimTof.u32NoisePs);
+            psTofData[n].s8LocalRSSI  = -60;
+            psTofData[n].u8LocalSQI   = 200;
+            psTofData[n].s8RemoteRSSI = -60;
+            psTofData[n].u8RemoteSQI  = 200;
+            psTofData[n].u8Status     = ((u32Random() % 100) < sSimTof.u8FailPercent) ?
+                                        1 : MAC_TOF_STATUS_SUCCESS;
+        }
+        sSimTof.u32Readings += u8TofReadings;
+        bTofBusy = FALSE;
+
+        bInInterrupt = TRUE;
+        prTofCallback(TOF_SUCCESS);
+        bInInterrupt = FALSE;
+    }
+
+    if ((prStopAt != NULL) && (u64Ticks >= u64StopTicks))
+    {
+        prStopAt();
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: u32Random
+ *
+ * DESCRIPTION:
+ * Linear congruential generator, so runs repeat from a seed.
+ *
+ * RETURNS: uint32 pseudo-random value
+ *
+ ****************************************************************************/
+PRIVATE uint32 u32Random(void)
+{
+    u32Seed = u32Seed * 1664525UL + 1013904223UL;
+    return u32Seed;
+}
+
+/****************************************************************************
+ *
+ * NAME: vPutChar
+ *
+ * DESCRIPTION:
+ * Adds a character to the console line, passing each line on as it ends.
+ * Lines are ended by the newline that starts the next.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  c               R   Character
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vPutChar(char c)
+{
+    if (bSimEcho)
+    {
+        putchar(c);
+    }
+
+    if (c == '\n')
+    {
+        acLine[u16LineLen] = '\0';
+        if ((prSimLine != NULL) && (u16LineLen > 0))
+        {
+            prSimLine(acLine);
+        }
+        u16LineLen = 0;
+    }
+    else if (u16LineLen < SIM_LINE_LEN - 1)
+    {
+        acLine[u16LineLen++] = c;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: vPutNumber
+ *
+ * DESCRIPTION:
+ * Prints a number without padding.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u32Value        R   Magnitude
+ *                  u8Base          R   10 or 16
+ *                  bNegative       R   Print a minus sign first
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vPutNumber(uint32 u32Value, uint8 u8Base, bool_t bNegative)
+{
+    char acDigits[12];
+    uint8 u8Digits = 0;
+
+    do
+    {
+        acDigits[u8Digits++] = "0123456789abcdef"[u32Value % u8Base];
+        u32Value /= u8Base;
+    } while (u32Value != 0);
+
+    if (bNegative)
+    {
+        vPutChar('-');
+    }
+    while (u8Digits > 0)
+    {
+        vPutChar(acDigits[--u8Digits]);
+    }
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,79 @@
+/****************************************************************************
+ *
+ * MODULE:      sdkstub.h
+ *
+ * DESCRIPTION:
+ * Simulated JN5148 SDK for host builds of the application sources. The
+ * headers in Sdk/ stand in for the SDK's, declaring only what the
+ * application uses, and this module implements them.
+ *
+ * Time is simulated: every read of the tick timer moves it on by
+ * SIM_TICKS_PER_READ, standing for the work the main loop does between
+ * reads. ToF sub-bursts complete after a set time per request and reading,
+ * with readings drawn about a set flight time, and the completion callback
+ * is made from the tick timer read that passes it, as the interrupt would
+ * be, unless interrupts are masked, when it waits for them to be unmasked.
+ * Frames sent are confirmed at once. The event queues are empty.
+ *
+ * vPrintf converts only %d, %i, %u, %x, %c and %s like the SDK's, which
+ * ignores field widths and flags, so output padded with %02d and the like
+ * shows here as it would on the target.
+ *
+ ****************************************************************************/
+
+#ifndef  SDKSTUB_H_INCLUDED
+#define  SDKSTUB_H_INCLUDED
+
+/****************************************************************************/
+/***        Include Files                                                 ***/
+/****************************************************************************/
+#include <jendefs.h>
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+
+/* 16MHz tick timer moved on 10us by each read */
+#define SIM_TICKS_PER_MS            16000UL
+#define SIM_TICKS_PER_READ          160
+
+/* Longest console line passed to prSimLine */
+#define SIM_LINE_LEN                256
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+
+/* Simulated ToF engine */
+typedef struct
+{
+    uint32  u32RequestUs;       /* Time to start a request */
+    uint32  u32ReadingUs;       /* Time per reading */
+    int32   i32TofPs;           /* True flight time */
+    uint32  u32NoisePs;         /* Standard deviation of the readings */
+    uint8   u8FailPercent;      /* Readings that fail on status */
+    uint32  u32Requests;        /* Requests made */
+    uint32  u32Readings;        /* Readings taken */
+} tsSimTof;
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+PUBLIC void   vSimReset(uint32 u32Seed);
+PUBLIC uint32 u32SimNowMs(void);
+PUBLIC void   vSimStopAt(uint32 u32EndMs, void (*prStop)(void));
+PUBLIC int32  i32SimGaussian(uint32 u32StdDev);
+PUBLIC uint64 u64HostCycles(void);
+
+/****************************************************************************/
+/***        Exported Variables                                            ***/
+/****************************************************************************/
+extern tsSimTof sSimTof;
+extern bool_t   bSimEcho;                       /* Copy vPrintf to stdout */
+extern void   (*prSimLine)(const char *pcLine); /* Called with each line */
+
+#endif  /* SDKSTUB_H_INCLUDED */
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,288 @@
+/****************************************************************************
+ *
+ * MODULE:      statsbench.c
+ *
+ * DESCRIPTION:
+ * Compares the single pass fixed point burst statistics of tofstats.c with
+ * the two pass double precision reduction they replaced, for cost and for
+ * results. The reference is the statistics part of the original
+ * task_CalculateDistance, without its printing.
+ *
+ * Both are run over the same simulated bursts of MAX_READINGS readings,
+ * some failed. The mean and standard deviation must agree to within a
+ * picosecond and the distance to within a centimetre; the original
+ * truncates where tofstats rounds. A second set of bursts is offset near
+ * the top of the int32 range, where squaring the raw sum would overflow.
+ *
+ * Cycles are host cycles. The host runs the double reference on its
+ * floating point unit, where the JN5148 emulates it in software, so they
+ * measure the cost of the 64 bit integer path and not the gain on target.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <jendefs.h>
+#include <AppApiTof.h>
+#include "tofstats.h"
+#include "sdkstub.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+#define MAX_READINGS                20
+#define BENCH_BURSTS                20000
+#define BENCH_FAIL_PERCENT          10
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+typedef struct
+{
+    int32   i32Mean;            /* ps */
+    int32   i32StdDev;          /* ps */
+    int32   i32DistanceCm;
+} tsBurstResult;
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE void   vFillBurst(tsAppApiTof_Data *psData, int32 i32TofPs, uint32 u32NoisePs);
+PRIVATE void   vReduceDouble(tsAppApiTof_Data *psData, tsBurstResult *psResult)
+                   __attribute__((noinline));
+PRIVATE void   vReduceFixed(tsAppApiTof_Data *psData, tsBurstResult *psResult)
+                   __attribute__((noinline));
+PRIVATE bool_t bRun(const char *pcName, int32 i32TofPs, uint32 u32NoisePs);
+
+/****************************************************************************/
+/***        Local Variables                                               ***/
+/****************************************************************************/
+PRIVATE tsAppApiTof_Data asBurst[BENCH_BURSTS][MAX_READINGS];
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+int main(void)
+{
+    bool_t bPass = TRUE;
+
+    vSimReset(2002);
+    srand(2002);
+
+    printf("Burst statistics over %d bursts of %d readings, %d%% failed\n",
+           BENCH_BURSTS, MAX_READINGS, BENCH_FAIL_PERCENT);
+    printf("%-10s %14s %14s %8s %11s %11s %11s %7s\n", "bursts", "double cyc/b", "fixed cyc/b",
+           "ratio", "max dmean", "max dstd", "max ddist", "result");
+
+    bPass &= bRun("10m", 33356, 500);
+    bPass &= bRun("100m", 333564, 3000);
+    bPass &= bRun("offset", 0x7ff00000L, 100000);
+
+    return bPass ? 0 : 1;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: bRun
+ *
+ * DESCRIPTION:
+ * Reduces one set of bursts both ways, timing each and comparing results.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pcName          R   Name of the set
+ *                  i32TofPs        R   True flight time
+ *                  u32NoisePs      R   Standard deviation of the readings
+ *
+ * RETURNS: bool_t TRUE if the results agree
+ *
+ ****************************************************************************/
+PRIVATE bool_t bRun(const char *pcName, int32 i32TofPs, uint32 u32NoisePs)
+{
+    tsBurstResult sDouble;
+    tsBurstResult sFixed;
+    uint64 u64DoubleCycles = 0;
+    uint64 u64FixedCycles  = 0;
+    uint64 u64Start;
+    int32  i32MaxMean = 0;
+    int32  i32MaxStd  = 0;
+    int32  i32MaxDist = 0;
+    bool_t bPass;
+    int b;
+
+    for (b = 0; b < BENCH_BURSTS; b++)
+    {
+        vFillBurst(asBurst[b], i32TofPs, u32NoisePs);
+    }
+
+    /* Each way over every burst in turn, so both see the same cache state */
+    for (b = 0; b < BENCH_BURSTS; b++)
+    {
+        u64Start = u64HostCycles();
+        vReduceDouble(asBurst[b], &sDouble);
+        u64DoubleCycles += u64HostCycles() - u64Start;
+
+        u64Start = u64HostCycles();
+        vReduceFixed(asBurst[b], &sFixed);
+        u64FixedCycles += u64HostCycles() - u64Start;
+
+        if (abs(sDouble.i32Mean - sFixed.i32Mean) > i32MaxMean)
+        {
+            i32MaxMean = abs(sDouble.i32Mean - sFixed.i32Mean);
+        }
+        if (abs(sDouble.i32StdDev - sFixed.i32StdDev) > i32MaxStd)
+        {
+            i32MaxStd = abs(sDouble.i32StdDev - sFixed.i32StdDev);
+        }
+        if (abs(sDouble.i32DistanceCm - sFixed.i32DistanceCm) > i32MaxDist)
+        {
+            i32MaxDist = abs(sDouble.i32DistanceCm - sFixed.i32DistanceCm);
+        }
+    }
+
+    bPass = (i32MaxMean <= 1) && (i32MaxStd <= 1) && (i32MaxDist <= 1);
+    printf("%-10s %14llu %14llu %7.1fx %9dps %9dps %9dcm %7s\n", pcName,
+           (unsigned long long)(u64DoubleCycles / BENCH_BURSTS),
+           (unsigned long long)(u64FixedCycles / BENCH_BURSTS),
+           (double)u64DoubleCycles / (double)u64FixedCycles,
+           i32MaxMean, i32MaxStd, i32MaxDist, bPass ? "pass" : "FAIL");
+
+    return bPass;
+}
+
+/****************************************************************************
+ *
+ * NAME: vFillBurst
+ *
+ * DESCRIPTION:
+ * Simulated burst readings, BENCH_FAIL_PERCENT failing on status.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psData          W   Readings
+ *                  i32TofPs        R   True flight time
+ *                  u32NoisePs      R   Standard deviation of the readings
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vFillBurst(tsAppApiTof_Data *psData, int32 i32TofPs, uint32 u32NoisePs)
+{
+    int64 i64Tof;
+    int n;
+
+    for (n = 0; n < MAX_READINGS; n++)
+    {
+        i64Tof = (int64)i32TofPs + i32SimGaussian(u32NoisePs);
+        psData[n].s32Tof   = (i64Tof > 0x7fffffffL) ? 0x7fffffffL : (int32)i64Tof;
+        psData[n].u8Status = ((rand() % 100) < BENCH_FAIL_PERCENT) ? 1 : MAC_TOF_STATUS_SUCCESS;
+    }
+}
+
+/****************************************************************************
+ *
+ * NAME: vReduceDouble
+ *
+ * DESCRIPTION:
+ * The original reduction: mean, then the standard deviation about it in a
+ * second pass, in double, converted to a distance by dMean x 0.03.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psData          R   Readings
+ *                  psResult        W   Result
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vReduceDouble(tsAppApiTof_Data *psData, tsBurstResult *psResult)
+{
+    double dAcc = 0.0;
+    double dMean;
+    double dStd;
+    uint8  u8NumErrors = 0;
+    int32  n;
+
+    for (n = 0; n < MAX_READINGS; n++)
+    {
+        if (psData[n].u8Status == MAC_TOF_STATUS_SUCCESS)
+        {
+            dAcc += psData[n].s32Tof;
+        }
+        else
+        {
+            u8NumErrors++;
+        }
+    }
+
+    if (u8NumErrors == MAX_READINGS)
+    {
+        psResult->i32Mean       = 0;
+        psResult->i32StdDev     = 0;
+        psResult->i32DistanceCm = 0;
+        return;
+    }
+
+    dMean = dAcc / (MAX_READINGS - u8NumErrors);
+    dStd  = 0.0;
+    for (n = 0; n < MAX_READINGS; n++)
+    {
+        if (psData[n].u8Status == MAC_TOF_STATUS_SUCCESS)
+        {
+            dStd += ((double)psData[n].s32Tof - dMean) * ((double)psData[n].s32Tof - dMean);
+        }
+    }
+    dStd /= (MAX_READINGS - u8NumErrors);
+    dStd = sqrt(dStd);
+
+    psResult->i32StdDev     = (int32)dStd;
+    psResult->i32Mean       = (int32)dMean;
+    psResult->i32DistanceCm = dMean * 0.03;
+}
+
+/****************************************************************************
+ *
+ * NAME: vReduceFixed
+ *
+ * DESCRIPTION:
+ * The same reduction with tofstats.c, accumulating each reading once.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psData          R   Readings
+ *                  psResult        W   Result
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vReduceFixed(tsAppApiTof_Data *psData, tsBurstResult *psResult)
+{
+    tsTofStats sStats;
+    int32 n;
+
+    vTofStatsReset(&sStats);
+    for (n = 0; n < MAX_READINGS; n++)
+    {
+        if (psData[n].u8Status == MAC_TOF_STATUS_SUCCESS)
+        {
+            vTofStatsAdd(&sStats, psData[n].s32Tof);
+        }
+        else
+        {
+            vTofStatsAddError(&sStats);
+        }
+    }
+
+    psResult->i32Mean       = i32TofStatsMean(&sStats);
+    psResult->i32StdDev     = (int32)u32TofStatsStdDev(&sStats);
+    psResult->i32DistanceCm = i32TofPsToCm(psResult->i32Mean);
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,184 @@
+/****************************************************************************
+ *
+ * MODULE:      subburst.c
+ *
+ * DESCRIPTION:
+ * Checks the end device's adaptive burst stopping rule, task_ContinueTof,
+ * on sub-bursts built by hand. A sub-burst that fails must leave neither
+ * its readings nor their statistics in the burst, and a burst must not
+ * stop on the population variance of a few readings when their sample
+ * variance still puts the standard error above its target.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "sdkstub.h"
+#include "enddevice.c"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+#define SUB_TOF_PS                  33356
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE tsTofBuffer *psStartBurst(void);
+PRIVATE void   vCompleteSubBurst(tsTofBuffer *psBuffer, eTofReturn eStatus, const int32 *pai32Offset,
+                                 uint8 u8Readings);
+PRIVATE bool_t bCheck(const char *pcName, bool_t bPass);
+
+/****************************************************************************/
+/***        Local Variables                                               ***/
+/****************************************************************************/
+/* Offsets from SUB_TOF_PS; 0x7fffffff marks a reading failed on status */
+PRIVATE const int32 ai32Spread[]   = { -1000, 1000, -1000, 1000, 0 };
+PRIVATE const int32 ai32Wild[]     = { 400000, 400000, 400000, 400000, 400000 };
+PRIVATE const int32 ai32Marginal[] = { -290, 290, -290, 290, 0x7fffffff };
+PRIVATE const int32 ai32Tight[]    = { -200, 200, -200, 200, 0x7fffffff };
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+int main(void)
+{
+    tsTofReadings *psFwd;
+    tsTofBuffer *psBuffer;
+    bool_t bPass = TRUE;
+
+    printf("Sub-burst stopping rule, forward bursts\n");
+
+    /* A wide first sub-burst continues; the second fails with wild readings */
+    psBuffer = psStartBurst();
+    psFwd    = &psBuffer->asDir[E_TOF_DIR_FORWARD];
+    vCompleteSubBurst(psBuffer, TOF_SUCCESS, ai32Spread, 5);
+    bPass &= bCheck("wide sub-burst continues", psBuffer->eState == E_TOF_BUFFER_FILLING);
+    vCompleteSubBurst(psBuffer, TOF_FAIL, ai32Wild, 5);
+    bPass &= bCheck("failed sub-burst ends the burst",
+                    (psBuffer->eState == E_TOF_BUFFER_READY) && (psBuffer->eStatus == TOF_SUCCESS));
+    bPass &= bCheck("failed readings not kept", psFwd->u8Readings == 5);
+    bPass &= bCheck("failed readings not in the stats",
+                    (psFwd->sStats.u8Count == 5) && (psFwd->sStats.u8Errors == 0) &&
+                    (i32TofStatsMean(&psFwd->sStats) == SUB_TOF_PS) &&
+                    (u32TofStatsVariance(&psFwd->sStats) == 800000));
+
+    /* Four readings of variance 84100ps^2: 21025 under the population rule,
+       28033 under the sample rule, either side of the 22857 allowed */
+    psBuffer = psStartBurst();
+    vCompleteSubBurst(psBuffer, TOF_SUCCESS, ai32Marginal, 5);
+    bPass &= bCheck("sample variance above target continues", psBuffer->eState == E_TOF_BUFFER_FILLING);
+
+    psBuffer = psStartBurst();
+    vCompleteSubBurst(psBuffer, TOF_SUCCESS, ai32Tight, 5);
+    bPass &= bCheck("sample variance below target stops", psBuffer->eState == E_TOF_BUFFER_READY);
+
+    return bPass ? 0 : 1;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: psStartBurst
+ *
+ * DESCRIPTION:
+ * Cold starts the end device and takes the buffer its first burst fills,
+ * as bStartSubBurst would have left it, against a target with no track.
+ *
+ * RETURNS: tsTofBuffer * buffer being filled
+ *
+ ****************************************************************************/
+PRIVATE tsTofBuffer *psStartBurst(void)
+{
+    tsTofBuffer *psBuffer;
+
+    vSimReset(5);
+    memset(asTofBuffer, 0, sizeof(asTofBuffer));
+    vInitSystem();
+    sEndDeviceData.eState     = E_STATE_ASSOCIATED;
+    sEndDeviceData.u16Address = END_DEVICE_START_ADR;
+
+    psBuffer = &asTofBuffer[u8TofFillIndex];
+    psBuffer->eMode        = E_RANGING_MODE_FORWARD;
+    psBuffer->u8Target     = 0;
+    psBuffer->eSubBurstDir = E_TOF_DIR_FORWARD;
+    psBuffer->eState       = E_TOF_BUFFER_FILLING;
+
+    return psBuffer;
+}
+
+/****************************************************************************
+ *
+ * NAME: vCompleteSubBurst
+ *
+ * DESCRIPTION:
+ * Writes the readings of the sub-burst in progress, as the ToF callback
+ * would, and applies the stopping rule to them.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psBuffer        RW  Buffer being filled
+ *                  eStatus         R   Status the sub-burst completed with
+ *                  pai32Offset     R   Readings, as offsets from SUB_TOF_PS
+ *                  u8Readings      R   Readings in the sub-burst
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vCompleteSubBurst(tsTofBuffer *psBuffer, eTofReturn eStatus, const int32 *pai32Offset,
+                               uint8 u8Readings)
+{
+    tsTofReadings *psReadings = &psBuffer->asDir[psBuffer->eSubBurstDir];
+    tsAppApiTof_Data *psData  = &psReadings->asData[psReadings->u8Readings];
+    uint8 n;
+
+    for (n = 0; n < u8Readings; n++)
+    {
+        memset(&psData[n], 0, sizeof(tsAppApiTof_Data));
+        if (pai32Offset[n] == 0x7fffffff)
+        {
+            psData[n].u8Status = 1;
+        }
+        else
+        {
+            psData[n].s32Tof   = SUB_TOF_PS + pai32Offset[n];
+            psData[n].u8Status = MAC_TOF_STATUS_SUCCESS;
+        }
+    }
+
+    psBuffer->u8SubBurst = u8Readings;
+    psBuffer->eStatus    = eStatus;
+    psBuffer->eState     = E_TOF_BUFFER_FILLED;
+    task_ContinueTof();
+}
+
+/****************************************************************************
+ *
+ * NAME: bCheck
+ *
+ * DESCRIPTION:
+ * Reports one check.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  pcName          R   What was checked
+ *                  bPass           R   Whether it held
+ *
+ * RETURNS: bool_t bPass
+ *
+ ****************************************************************************/
+PRIVATE bool_t bCheck(const char *pcName, bool_t bPass)
+{
+    printf("%-40s %8s\n", pcName, bPass ? "pass" : "FAIL");
+
+    return bPass;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,336 @@
+/****************************************************************************
+ *
+ * MODULE:      tagrate.c
+ *
+ * DESCRIPTION:
+ * Measures the position updates the coordinator makes per second against
+ * the number of tags it tracks, through the tag table and its round robin
+ * as task_UpdateTags runs them, one main loop pass per millisecond.
+ *
+ * Each tag walks at TAG_SPEED_CM_S within a room with an anchor in each
+ * corner and at the middle of each wall. It ranges the anchors in turn, at
+ * TAG_TRACK_TAG_PERIOD_MS or the period the coordinator announces for the
+ * number of tags, whichever is longer. Its ranges are batched into
+ * reports as the end device batches them, REPORT_MAX_MEASUREMENTS to a
+ * report or REPORT_MAX_AGE_MS old, and held by the coordinator until the
+ * tag's next update. The rates are taken from u32TagTableWindowFixes over
+ * TAG_WINDOW_MS, after the tracks have started, as task_PrintTagStats
+ * takes them.
+ *
+ * The Makefile builds it with TAG_TRACK_MAX_TAGS raised, so that the counts
+ * at which the announced period exceeds the tags' own are covered too.
+ *
+ * The bursts of all the tags must fit the airtime given to ranging, every
+ * tag must be updated, and the tag updated least often must get at least
+ * TAG_FAIR_PERCENT of the mean rate. However long a tag takes to range
+ * every anchor, its updates must still use TAG_TRACK_SELECT_ANCHORS of
+ * them, as they do when none of its ranges has gone stale.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <jendefs.h>
+#include "fixedpoint.h"
+#include "multilat.h"
+#include "report.h"
+#include "tagtrack.h"
+#include "sdkstub.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+/* End device default, see enddevice.c */
+#define REPORT_MAX_AGE_MS           500
+
+#define TAG_ANCHORS_RUN             8
+#define TAG_ROOM_CM                 1000
+#define TAG_SPEED_CM_S              50
+#define TAG_RANGE_STDDEV_CM         15
+#define TAG_WARMUP_MS               10000
+#define TAG_WINDOW_MS               60000
+#define TAG_FAIR_PERCENT            50
+
+/****************************************************************************/
+/***        Type Definitions                                              ***/
+/****************************************************************************/
+typedef struct
+{
+    int32   ai32PosCm[2];
+    int32   ai32VelCm[2];       /* cm/s */
+    uint32  u32NextBurstMs;
+    uint8   u8NextAnchor;
+    uint8   u8Held;             /* Ranges waiting for a report */
+    uint8   au8Anchor[REPORT_MAX_MEASUREMENTS];
+    int32   ai32RangeCm[REPORT_MAX_MEASUREMENTS];
+    uint32  au32RangeMs[REPORT_MAX_MEASUREMENTS];
+} tsSimTag;
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE bool_t bRun(uint8 u8Tags);
+PRIVATE void   vBurst(tsSimTag *psSim, uint32 u32NowMs);
+PRIVATE void   vReport(tsTag *psTag, tsSimTag *psSim);
+PRIVATE void   vWalk(tsSimTag *psSim);
+
+/****************************************************************************/
+/***        Local Variables                                               ***/
+/****************************************************************************/
+PRIVATE const tsMultilatPoint asAnchor[TAG_ANCHORS_RUN] =
+{
+    { { 0,           0,           0 } },
+    { { TAG_ROOM_CM, 0,           0 } },
+    { { TAG_ROOM_CM, TAG_ROOM_CM, 0 } },
+    { { 0,           TAG_ROOM_CM, 0 } },
+    { { TAG_ROOM_CM / 2, 0,               0 } },
+    { { TAG_ROOM_CM,     TAG_ROOM_CM / 2, 0 } },
+    { { TAG_ROOM_CM / 2, TAG_ROOM_CM,     0 } },
+    { { 0,               TAG_ROOM_CM / 2, 0 } },
+};
+
+/* Beyond the table's default size when built with a larger one, to reach
+   the counts at which the period grows */
+PRIVATE const uint8 au8Tags[] = { 1, 2, 4, 8, 16, 24, 32, 40 };
+
+PRIVATE tsTagTable sTable;
+PRIVATE tsSimTag   asSim[TAG_TRACK_MAX_TAGS];
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+int main(void)
+{
+    bool_t bPass = TRUE;
+    unsigned i;
+
+    printf("Tag fixes per second over %d s, %d anchors, one pass per ms, %d tags per pass\n",
+           TAG_WINDOW_MS / 1000, TAG_ANCHORS_RUN, TAG_TRACK_UPDATES_PER_PASS);
+    printf("%6s %9s %10s %10s %12s %10s %8s %8s\n", "tags", "period", "bursts/s", "fixes/s",
+           "fixes/s/tag", "least tag", "anchors", "result");
+
+    for (i = 0; (i < sizeof(au8Tags) / sizeof(au8Tags[0])) && (au8Tags[i] <= TAG_TRACK_MAX_TAGS); i++)
+    {
+        bPass &= bRun(au8Tags[i]);
+    }
+
+    return bPass ? 0 : 1;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: bRun
+ *
+ * DESCRIPTION:
+ * Runs one number of tags from cold and reports their update rates.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u8Tags          R   Tags to track
+ *
+ * RETURNS: bool_t TRUE if the rates meet the checks
+ *
+ ****************************************************************************/
+PRIVATE bool_t bRun(uint8 u8Tags)
+{
+    uint32 u32PeriodMs;
+    uint32 u32NowMs;
+    uint32 u32Bursts = 0;
+    uint32 u32Fixes;
+    uint32 u32Rate;
+    uint32 u32MinRate;
+    uint32 u32BurstRate;
+    uint32 u32Updates = 0;
+    uint32 u32Used = 0;
+    uint32 u32UsedX100;
+    uint16 u16MinFixes;
+    tsTag *psTag;
+    bool_t bPass;
+    uint8 i, n;
+
+    vSimReset(u8Tags);
+    vTagTableInit(&sTable);
+    memset(asSim, 0, sizeof(asSim));
+
+    for (i = 0; i < u8Tags; i++)
+    {
+        (void)psTagTableAdd(&sTable, (uint16)(TAG_ANCHORS_RUN + i));
+    }
+    u32PeriodMs = u16TagTablePeriodMs(&sTable);
+    if (u32PeriodMs < TAG_TRACK_TAG_PERIOD_MS)
+    {
+        u32PeriodMs = TAG_TRACK_TAG_PERIOD_MS;
+    }
+
+    for (i = 0; i < u8Tags; i++)
+    {
+        asSim[i].ai32PosCm[0]   = 100 + (i * 97) % (TAG_ROOM_CM - 200);
+        asSim[i].ai32PosCm[1]   = 100 + (i * 331) % (TAG_ROOM_CM - 200);
+        asSim[i].ai32VelCm[0]   = (i & 1) ? TAG_SPEED_CM_S : -TAG_SPEED_CM_S;
+        asSim[i].ai32VelCm[1]   = (i & 2) ? TAG_SPEED_CM_S / 2 : -TAG_SPEED_CM_S / 2;
+        asSim[i].u32NextBurstMs = 1 + (i * u32PeriodMs) / u8Tags;
+        asSim[i].u8NextAnchor   = i % TAG_ANCHORS_RUN;
+    }
+
+    for (u32NowMs = 1; u32NowMs <= TAG_WARMUP_MS + TAG_WINDOW_MS; u32NowMs++)
+    {
+        if (u32NowMs == TAG_WARMUP_MS)
+        {
+            (void)u32TagTableWindowFixes(&sTable, &u16MinFixes);
+            u32Bursts  = 0;
+            u32Updates = 0;
+            u32Used    = 0;
+        }
+
+        for (i = 0; i < u8Tags; i++)
+        {
+            if ((u32NowMs % 1000) == 0)
+            {
+                vWalk(&asSim[i]);
+            }
+            if (u32NowMs >= asSim[i].u32NextBurstMs)
+            {
+                vBurst(&asSim[i], u32NowMs);
+                asSim[i].u32NextBurstMs += u32PeriodMs;
+                u32Bursts++;
+            }
+            if ((asSim[i].u8Held == REPORT_MAX_MEASUREMENTS) ||
+                ((asSim[i].u8Held != 0) && (u32NowMs - asSim[i].au32RangeMs[0] >= REPORT_MAX_AGE_MS)))
+            {
+                vReport(psTagTableFind(&sTable, (uint16)(TAG_ANCHORS_RUN + i)), &asSim[i]);
+            }
+        }
+
+        /* task_UpdateTags */
+        for (n = 0; n < TAG_TRACK_UPDATES_PER_PASS; n++)
+        {
+            psTag = psTagTableNext(&sTable);
+            if (psTag == NULL)
+            {
+                break;
+            }
+            if (bTagUpdate(psTag, asAnchor, TAG_ANCHORS_RUN, 2, u32NowMs, (uint16)u32PeriodMs))
+            {
+                u32Updates++;
+                u32Used += (uint32)__builtin_popcount(psTag->u8Selected);
+            }
+        }
+    }
+
+    /* Hundredths of a fix per second, as task_PrintTagStats */
+    u32Fixes     = u32TagTableWindowFixes(&sTable, &u16MinFixes);
+    u32Rate      = (uint32)(((uint64)u32Fixes * 100000) / TAG_WINDOW_MS);
+    u32MinRate   = (uint32)(((uint64)u16MinFixes * 100000) / TAG_WINDOW_MS);
+    u32BurstRate = (uint32)(((uint64)u32Bursts * 100000) / TAG_WINDOW_MS);
+    u32UsedX100  = (u32Updates != 0) ? (u32Used * 100) / u32Updates : 0;
+
+    bPass = (u32BurstRate <= 100000 / TAG_TRACK_BURST_MS) && (u16MinFixes > 0) &&
+            (u32MinRate * u8Tags * 100 >= u32Rate * TAG_FAIR_PERCENT) &&
+            (u32UsedX100 >= TAG_TRACK_SELECT_ANCHORS * 100);
+    printf("%6d %7ldms %7ld.%02ld %7ld.%02ld %9ld.%02ld %7ld.%02ld %5ld.%02ld %8s\n", u8Tags, (long)u32PeriodMs,
+           (long)(u32BurstRate / 100), (long)(u32BurstRate % 100),
+           (long)(u32Rate / 100), (long)(u32Rate % 100),
+           (long)(u32Rate / u8Tags / 100), (long)(u32Rate / u8Tags % 100),
+           (long)(u32MinRate / 100), (long)(u32MinRate % 100),
+           (long)(u32UsedX100 / 100), (long)(u32UsedX100 % 100),
+           bPass ? "pass" : "FAIL");
+
+    return bPass;
+}
+
+/****************************************************************************
+ *
+ * NAME: vBurst
+ *
+ * DESCRIPTION:
+ * Ranges a tag to its next anchor and holds the range for its report.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psSim           RW  Tag
+ *                  u32NowMs        R   Time of the burst (ms)
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vBurst(tsSimTag *psSim, uint32 u32NowMs)
+{
+    const tsMultilatPoint *psAnchor = &asAnchor[psSim->u8NextAnchor];
+    int32 ai32Pos[MULTILAT_AXES] = { psSim->ai32PosCm[0], psSim->ai32PosCm[1], 0 };
+    uint8 u8Held = psSim->u8Held;
+
+    if (u8Held == REPORT_MAX_MEASUREMENTS)
+    {
+        return;
+    }
+
+    psSim->au8Anchor[u8Held]   = psSim->u8NextAnchor;
+    psSim->ai32RangeCm[u8Held] = (int32)u32FixedDist(ai32Pos, psAnchor->ai32Cm, 2) +
+                                 i32SimGaussian(TAG_RANGE_STDDEV_CM);
+    psSim->au32RangeMs[u8Held] = u32NowMs;
+    psSim->u8Held++;
+    psSim->u8NextAnchor = (psSim->u8NextAnchor + 1) % TAG_ANCHORS_RUN;
+}
+
+/****************************************************************************
+ *
+ * NAME: vReport
+ *
+ * DESCRIPTION:
+ * Delivers a tag's held ranges, as task_TagRange does with a report.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psTag           RW  Tag in the table
+ *                  psSim           RW  Tag
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vReport(tsTag *psTag, tsSimTag *psSim)
+{
+    uint8 n;
+
+    for (n = 0; n < psSim->u8Held; n++)
+    {
+        vTagRange(psTag, psSim->au8Anchor[n], psSim->ai32RangeCm[n], TAG_RANGE_STDDEV_CM,
+                  psSim->au32RangeMs[n]);
+    }
+    psSim->u8Held = 0;
+}
+
+/****************************************************************************
+ *
+ * NAME: vWalk
+ *
+ * DESCRIPTION:
+ * Moves a tag on by one second, turning back at the walls.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  psSim           RW  Tag
+ *
+ * RETURNS: void
+ *
+ ****************************************************************************/
+PRIVATE void vWalk(tsSimTag *psSim)
+{
+    uint8 i;
+
+    for (i = 0; i < 2; i++)
+    {
+        psSim->ai32PosCm[i] += psSim->ai32VelCm[i];
+        if ((psSim->ai32PosCm[i] < 50) || (psSim->ai32PosCm[i] > TAG_ROOM_CM - 50))
+        {
+            psSim->ai32VelCm[i] = -psSim->ai32VelCm[i];
+        }
+    }
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/
@@ -0,0 +1,148 @@
+/****************************************************************************
+ *
+ * MODULE:      tdmawait.c
+ *
+ * DESCRIPTION:
+ * Checks that a report queued by an end device in a beacon enabled network
+ * reaches the coordinator before it goes stale, with every one of the
+ * TDMA_DEVICES slot owners associated. Each device in turn runs its
+ * transmit queue against its own TDMA schedule over TDMA_RUN_BEACONS
+ * beacons, twice round the beacon sequence number, posting a report at a
+ * varying offset once the last has been sent. The simulated MAC delivers
+ * every frame it is given, so only the wait for the slot is measured.
+ *
+ * The longest delay from post to delivery must stay below both the bound
+ * tdma.h gives and TX_QUEUE_MAX_AGE_MS, and no report may be dropped.
+ *
+ ****************************************************************************/
+
+/****************************************************************************/
+/***        Include files                                                 ***/
+/****************************************************************************/
+#include <stdio.h>
+#include <jendefs.h>
+#include "config.h"
+#include "tdma.h"
+#include "txqueue.h"
+#include "sdkstub.h"
+
+/****************************************************************************/
+/***        Macro Definitions                                             ***/
+/****************************************************************************/
+#define TDMA_RUN_BEACONS            512
+#define TDMA_REPORT_LEN             40
+
+/****************************************************************************/
+/***        Local Function Prototypes                                     ***/
+/****************************************************************************/
+PRIVATE uint32 u32RunDevice(uint16 u16ShortAdr, uint32 *pu32Stale);
+
+/****************************************************************************/
+/***        Exported Functions                                            ***/
+/****************************************************************************/
+
+int main(void)
+{
+    uint32 u32MaxDelayMs = 0;
+    uint32 u32DelayMs;
+    uint32 u32Stale = 0;
+    uint16 u16Device;
+    bool_t bPass;
+
+    printf("Report delay with %d devices in %d beacons of %dms, max age %dms\n",
+           TDMA_DEVICES, TDMA_CYCLES, (int)(TDMA_BEACON_US / 1000), TX_QUEUE_MAX_AGE_MS);
+    printf("%8s %8s %11s %11s %8s %8s\n", "devices", "cycles", "bound", "max delay", "stale", "result");
+
+    for (u16Device = 0; u16Device < TDMA_DEVICES; u16Device++)
+    {
+        u32DelayMs = u32RunDevice(END_DEVICE_START_ADR + u16Device, &u32Stale);
+        if (u32DelayMs > u32MaxDelayMs)
+        {
+            u32MaxDelayMs = u32DelayMs;
+        }
+    }
+
+    bPass = (u32Stale == 0) && (u32MaxDelayMs < TX_QUEUE_MAX_AGE_MS) &&
+            (u32MaxDelayMs <= TDMA_MAX_WAIT_MS);
+    printf("%8d %8d %9dms %9dms %8d %8s\n", TDMA_DEVICES, TDMA_CYCLES, (int)TDMA_MAX_WAIT_MS,
+           u32MaxDelayMs, u32Stale, bPass ? "pass" : "FAIL");
+
+    return bPass ? 0 : 1;
+}
+
+/****************************************************************************/
+/***        Local Functions                                               ***/
+/****************************************************************************/
+
+/****************************************************************************
+ *
+ * NAME: u32RunDevice
+ *
+ * DESCRIPTION:
+ * Runs one device's transmit queue against its slot, in 1ms steps, the
+ * way the end device's main loop holds and services it.
+ *
+ * PARAMETERS:      Name            RW  Usage
+ *                  u16ShortAdr     R   Short address of the device
+ *                  pu32Stale       RW  Reports dropped, added to
+ *
+ * RETURNS: uint32 longest delay from post to delivery (ms)
+ *
+ ****************************************************************************/
+PRIVATE uint32 u32RunDevice(uint16 u16ShortAdr, uint32 *pu32Stale)
+{
+    tsTdmaSchedule sSchedule;
+    tsTxQueueStats *psStats;
+    uint8  au8Report[TDMA_REPORT_LEN] = { 0 };
+    uint32 u32EndMs = (uint32)((TDMA_RUN_BEACONS * TDMA_BEACON_US) / 1000);
+    uint32 u32NextPostMs = 0;
+    uint32 u32PostedMs = 0;
+    uint32 u32Delivered = 0;
+    uint32 u32MaxDelayMs = 0;
+    uint32 u32Beacon = 0;
+    uint32 u32Reports = 0;
+    uint32 u32NowMs;
+
+    vSimReset(u16ShortAdr);
+    vTxQueueInit(u16ShortAdr);
+    vTdmaInit(&sSchedule, u16ShortAdr);
+    psStats = psTxQueueStats();
+
+    for (u32NowMs = 0; u32NowMs < u32EndMs; u32NowMs++)
+    {
+        if (u32NowMs >= (uint32)((u32Beacon * TDMA_BEACON_US) / 1000))
+        {
+            vTdmaBeacon(&sSchedule, (uint8)u32Beacon, u32NowMs);
+            u32Beacon++;
+        }
+
+        if ((u8TxQueueWaiting() == 0) && (u32NowMs >= u32NextPostMs))
+        {
+            (void)bTxQueuePost(COORDINATOR_ADR, au8Report, sizeof(au8Report), u32NowMs);
+            u32PostedMs = u32NowMs;
+            u32Reports++;
+        }
+
+        vTxQueueHold(!bTdmaInSlot(&sSchedule, u32NowMs));
+        vTxQueueService(u32NowMs);
+
+        if (psStats->u32Delivered != u32Delivered)
+        {
+            u32Delivered = psStats->u32Delivered;
+            if ((u32NowMs - u32PostedMs) > u32MaxDelayMs)
+            {
+                u32MaxDelayMs = u32NowMs - u32PostedMs;
+            }
+            /* Next report lands at a different point in the cycle */
+            u32NextPostMs = u32NowMs + 1 + (u32Reports * 37) % 500;
+        }
+    }
+
+    *pu32Stale += psStats->u32DroppedStale + psStats->u32DroppedFull;
+
+    return u32MaxDelayMs;
+}
+
+/****************************************************************************/
+/***        END OF FILE                                                   ***/
+/****************************************************************************/